@@ -4,6 +4,7 @@
 #include "librelinkup.h"
 #include "mqtt.h"
 #include "hba1c.h"
+#include "llutask.h"
 #include <ESP32Ping.h>
 #include <LittleFS.h>
 
@@ -16,6 +17,7 @@ extern WiFiClient mqttClient;
 extern PubSubClient mqtt_client;
 extern MQTT mqtt;
 extern HBA1C hba1c;
+extern LLUTASK llu_task;
 extern HELPER helper;
 extern uint16_t telnet_port;
 
@@ -76,6 +78,27 @@ void LLULoginDataCommand(uuid::console::Shell &shell, const std::vector<std::str
     }
 }
 
+void LLUServerCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    if (!arguments.empty()) {
+        String llu_server = arguments[0].c_str();
+        if (llu_server == "default") {
+            llu_server = "";
+        }
+        if (!llu_server.isEmpty() && !llu_server.startsWith("https://")) {
+            shell.printfln("invalid url: %s", llu_server.c_str());
+            return;
+        }
+        settings.config.llu_server = llu_server;
+        settings.saveConfiguration(settings.config_filename, settings.config);
+        shell.printfln("LLU server: %s (active after esp_reset)", llu_server.isEmpty() ? LLU_DEFAULT_BASE_URL : llu_server.c_str());
+    } else {
+        shell.printfln("LLU server: %s", librelinkup.base_url.c_str());
+        if (!librelinkup.region.isEmpty()) {
+            shell.printfln("LLU region: %s (%s)", librelinkup.region.c_str(), librelinkup.api_url.c_str());
+        }
+    }
+}
+
 void WiFiSettingCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {    
     if (!arguments.empty()) {
         String wifi_bssid = arguments[0].c_str();
@@ -99,6 +122,9 @@ void espResetCommand(uuid::console::Shell &shell, const std::vector<std::string>
 void espStatusCommand(uuid::console::Shell &shell, const std::vector<std::string> &) {
     esp_status();
     shell.printfln(F("ESP status: WiFi connected, free heap: %d"), ESP.getFreeHeap());
+    Heap_Info heap = HELPER::getHeapInfo();
+    shell.printfln(F("internal heap: free %d, largest block %d, min. free %d, fragmentation %d%%"),
+                   heap.free_size, heap.largest_block, heap.minimum_free, heap.fragmentation);
 }
 
 void configSettingCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
@@ -175,6 +201,29 @@ void timezoneCommand(uuid::console::Shell &shell, const std::vector<std::string>
     shell.printfln(F("Timezone set to %d and saved to config"), timezone);
 }
 
+void tirThresholdsCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    if (arguments.size() == 4) {
+        int very_low = parseArgument(arguments, 0);
+        int low = parseArgument(arguments, 1);
+        int high = parseArgument(arguments, 2);
+        int very_high = parseArgument(arguments, 3);
+        if (very_low <= 0 || very_low > low || low >= high || high > very_high || very_high > GLYCEMICSTATS_MAX_VALUE) {
+            shell.println(F("invalid thresholds, expected 0 < very_low <= low < high <= very_high"));
+            return;
+        }
+        settings.config.tir_very_low = very_low;
+        settings.config.tir_low = low;
+        settings.config.tir_high = high;
+        settings.config.tir_very_high = very_high;
+        settings.saveConfiguration(settings.config_filename, settings.config);
+    } else if (!arguments.empty()) {
+        shell.println(F("usage: tir_thresholds <very_low> <low> <high> <very_high>"));
+        return;
+    }
+    shell.printfln(F("TIR thresholds: very low <%d, low <%d, in range %d-%d, very high >%d mg/dl"), settings.config.tir_very_low,
+                   settings.config.tir_low, settings.config.tir_low, settings.config.tir_high, settings.config.tir_very_high);
+}
+
 void otaSettingCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
     
     if (!arguments.empty()) {
@@ -243,7 +292,33 @@ void debugRawFileContentsCommand(uuid::console::Shell &shell, const std::vector<
     }
 }
 
+// token is printed in parts of 220 characters (shell print buffer)
+static void print_token(uuid::console::Shell &shell) {
+    const char *token = librelinkup.llu_login_data.user_token.c_str();
+    size_t len = librelinkup.llu_login_data.user_token.length();
+
+    shell.printf("LLU User_Token: ");
+    for (size_t pos = 0; pos < len; pos += 220) {
+        shell.printf("%.*s", (int)((len - pos > 220) ? 220 : len - pos), token + pos);
+    }
+    shell.println();
+}
+
 void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    // single flight: join the fetch of the network task instead of sending an own request
+    if (!arguments.empty() && arguments[0] == "get_graphdata") {
+        shell.println(F("LLU Get GraphData..."));
+        if (!llu_task.fetch_and_wait()) {
+            shell.println(F("LibreLinkUp fetch timeout"));
+            return;
+        }
+    }
+
+    // LIBRELINKUP is shared with the network task
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
 
     if (!arguments.empty()) {
         String llu_argument = arguments[0].c_str();
@@ -255,34 +330,32 @@ void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arg
         }
         else if((llu_argument == "user_token")){
             //shell.printfln(F("LLU User_Token: %s"), librelinkup.user_token.c_str());
-
-            String token_part1;
-            String token_part2;
-
-            token_part1 = librelinkup.llu_login_data.user_token.substring(0, 220);                // Die ersten 220 Zeichen
-            token_part2 = librelinkup.llu_login_data.user_token.substring(220, librelinkup.llu_login_data.user_token.length());  // Der Rest
-            
-            shell.printf("LLU User_Token: %s", token_part1.c_str());
-            shell.printfln("%s", token_part2.c_str());
+            print_token(shell);
         }
         else if((llu_argument == "auth")){
             shell.println(F("LLU Auth..."));
-            librelinkup.auth_user(settings.config.login_email,settings.config.login_password);
+            librelinkup.session_invalidate("console");
+            librelinkup.ensure_token();
             shell.printfln("LLU User_ID: %s", librelinkup.llu_login_data.user_id.c_str());
-            
-            String token_part1;
-            String token_part2;
-
-            token_part1 = librelinkup.llu_login_data.user_token.substring(0, 220);                // Die ersten 220 Zeichen
-            token_part2 = librelinkup.llu_login_data.user_token.substring(220, librelinkup.llu_login_data.user_token.length());  // Der Rest
-            
-            shell.printf("LLU User_Token: %s", token_part1.c_str());
-            shell.printfln("%s", token_part2.c_str());
+            print_token(shell);
         }
         else if((llu_argument == "tou")){
             shell.println(F("LLU Tou..."));
             librelinkup.tou_user();
         }
+        else if((llu_argument == "token")){
+            shell.printfln("LLU token source  : %s", librelinkup.llu_login_data.token_from_cache ? "NVS cache" : "login");
+            shell.printfln("LLU token expires : %d", librelinkup.llu_login_data.user_token_expires);
+            shell.printfln("LLU session       : %s (logins: %d, tou: %d, rejected: %d)", LIBRELINKUP::session_name(librelinkup.llu_session.state),
+                           librelinkup.llu_session.logins, librelinkup.llu_session.tou, librelinkup.llu_session.rejected);
+            if (librelinkup.llu_session.state == LLU_SESSION_BACKOFF) {
+                shell.printfln("LLU next login in : %ds (failures: %d)", librelinkup.session_backoff_in() / 1000, librelinkup.llu_session.failures);
+            }
+        }
+        else if((llu_argument == "token_clear")){
+            librelinkup.session_invalidate("console");
+            shell.println(F("LLU token cache cleared, next fetch will login again"));
+        }
         else if((llu_argument == "sensor_id")){
             shell.printfln(F("LLU Sensor_ID: %s"), librelinkup.llu_sensor_data.sensor_id.c_str());
         }
@@ -296,7 +369,7 @@ void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arg
             static char time_in_hours[librelinkup.GRAPHDATAARRAYSIZE][6]; // "HH:MM" + Null-Terminator
             shell.printfln(F("LLU History...:"));
             uint8_t data_count = librelinkup.check_graphdata();
-            shell.printfln("Historical data: [%d/%d]",data_count, librelinkup.GRAPHDATAARRAYSIZE);
+            shell.printfln("Historical data: [%d/%d] seq: %u",data_count, librelinkup.GRAPHDATAARRAYSIZE, librelinkup.llu_history.seq);
             for(uint8_t i=0;i<librelinkup.GRAPHDATAARRAYSIZE;i++){
                 helper.format_time(time_in_hours[i], sizeof(time_in_hours[i]), librelinkup.llu_sensor_history_data.timestamp[i]);
                 shell.printfln("ArrayPos.: %03d Value: %03d TimeStamp: %d (%s)", i, librelinkup.llu_sensor_history_data.graph_data[i], librelinkup.llu_sensor_history_data.timestamp[i], time_in_hours[i]);
@@ -320,8 +393,6 @@ void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arg
             draw_chart_glucose_data(3, false);
         }
         else if((llu_argument == "get_graphdata")){
-            shell.println(F("LLU Get GraphData..."));
-            librelinkup.get_graph_data();
             shell.printfln("SensorSN_non_activated: %s", librelinkup.llu_sensor_data.sensor_sn_non_active.c_str());
             uint8_t data_count = librelinkup.check_graphdata();
             shell.printfln("glucoseMeasurement: %d %s",librelinkup.llu_glucose_data.glucoseMeasurement, librelinkup.llu_glucose_data.str_trendArrow.c_str());
@@ -331,6 +402,68 @@ void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arg
             shell.println(F("LLU print glucose statistics..."));
             glucose_statistics();
         }
+        else if((llu_argument == "connection")){
+            shell.printfln("LLU connection host : %s", librelinkup.llu_connection.host[0] ? librelinkup.llu_connection.host : "closed");
+            shell.printfln("API url             : %s (region: %s)", librelinkup.api_url.c_str(), librelinkup.region.isEmpty() ? "-" : librelinkup.region.c_str());
+            shell.printfln("DNS cache           : %s %s (lookups: %u, hits: %u)", librelinkup.llu_dns.host[0] ? librelinkup.llu_dns.host : "-",
+                           librelinkup.llu_dns.address.toString().c_str(), librelinkup.llu_dns.lookups, librelinkup.llu_dns.hits);
+            shell.printfln("TLS handshakes      : %d", librelinkup.llu_connection.handshakes);
+            shell.printfln("reused requests     : %d", librelinkup.llu_connection.reused);
+            shell.printfln("reconnects          : %d", librelinkup.llu_connection.reconnects);
+            shell.printfln("last fetch          : %dms (handshake: %dms, transfer: %dms)", librelinkup.https_llu_api_fetch_time, librelinkup.https_llu_api_handshake_time, librelinkup.https_llu_api_transfer_time);
+            shell.printfln("last fetch bytes    : %u (%u on the wire)", librelinkup.https_llu_api_body_bytes, librelinkup.https_llu_api_wire_bytes);
+            shell.printfln("compressed responses: %u", librelinkup.llu_connection.compressed);
+            shell.printfln("total bytes         : %u (%u on the wire, %d%% saved)", librelinkup.llu_connection.body_bytes, librelinkup.llu_connection.wire_bytes,
+                           librelinkup.llu_connection.body_bytes ? 100 - (int)((uint64_t)librelinkup.llu_connection.wire_bytes * 100 / librelinkup.llu_connection.body_bytes) : 0);
+            shell.printfln("next fetch in       : %ds", llu_task.next_fetch_in() / 1000);
+            shell.printfln("snapshot retries    : %d", llu_task.snapshot_retries);
+        }
+        else if((llu_argument == "stages")){
+            // latency per request stage, bucket limits as percentiles
+            shell.println(F("stage         n    p50    p90    p99    max [ms]"));
+            for(uint8_t stage = 0; stage < LLU_STAGE_COUNT; stage++){
+                shell.printfln("%-8s %6u %6u %6u %6u %6u", StageStats::stage_name(stage), librelinkup.stage_stats.count(stage),
+                               librelinkup.stage_stats.percentile(stage, 50), librelinkup.stage_stats.percentile(stage, 90),
+                               librelinkup.stage_stats.percentile(stage, 99), librelinkup.stage_stats.max(stage));
+            }
+            // round-trip time per API host (since boot)
+            shell.println(F("host                              n   last    avg    min    max [ms]"));
+            for(uint8_t i = 0; i < LLU_HOST_STATS; i++){
+                const LLU_HostRtt &h = librelinkup.llu_hosts[i];
+                if(h.host[0] == '\0') continue;
+                shell.printfln("%-28s %6u %6u %6u %6u %6u", h.host, h.requests, h.last, h.avg, h.min, h.max);
+            }
+        }
+        else if((llu_argument == "region_clear")){
+            librelinkup.clear_region();
+            shell.println(F("LLU region cleared, next login goes to the configured server"));
+        }
+        else if((llu_argument == "stages_reset")){
+            librelinkup.stage_stats.reset();
+            shell.println(F("stage histograms cleared"));
+        }
+        else if((llu_argument == "poll")){
+            shell.printfln("next fetch in       : %ds (%s)", llu_task.next_fetch_in() / 1000, POLLSCHEDULER::reason_name(llu_task.scheduler.reason()));
+            shell.printfln("measurement period  : %dms", llu_task.scheduler.period_ms());
+            shell.printfln("margin              : %dms", llu_task.scheduler.margin_ms());
+            shell.printfln("last measurement    : %d", llu_task.scheduler.last_measurement());
+            shell.printfln("failed fetches      : %d", llu_task.scheduler.errors());
+            shell.printfln("stale fetches       : %d", llu_task.scheduler.stale_fetches);
+            shell.printfln("unchanged fetches   : %d (graph hash %08x)", llu_task.unchanged_fetches, librelinkup.graph_hash);
+        }
+        else if((llu_argument == "patients")){
+            shell.printfln("followed patients: %d (active: %d)", librelinkup.llu_patient_count, librelinkup.llu_active_patient);
+            for(uint8_t i=0;i<librelinkup.llu_patient_count;i++){
+                const LIBRELINKUP::Patient &patient = librelinkup.llu_patients[i];
+                shell.printfln("%c%d: %s %s  %d mg/dL  measurement: %u  history: %d points (newest: %u)",
+                               (i == librelinkup.llu_active_patient) ? '*' : ' ', i,
+                               patient.first_name.c_str(), patient.last_name.c_str(), patient.glucoseMeasurement,
+                               patient.measurement_unixtime,
+                               (i == librelinkup.llu_active_patient) ? librelinkup.llu_history.count : patient.history.count,
+                               LIBRELINKUP::ring_newest((i == librelinkup.llu_active_patient) ? librelinkup.llu_history : patient.history));
+            }
+            shell.printfln("glucose log patient: %s", settings.config.glucose_log_patient.isEmpty() ? "-" : settings.config.glucose_log_patient.c_str());
+        }
         else {
             shell.printfln("invalid argument: %s",llu_argument);
         }
@@ -338,6 +471,25 @@ void lluCommand(uuid::console::Shell &shell, const std::vector<std::string> &arg
         shell.println(F("command: llu <> <>"));
     }
 
+    llu_task.unlock();
+}
+
+void lluPatientCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
+
+    int patient = parseArgument(arguments, 0, librelinkup.llu_active_patient);
+    if (patient >= 0 && librelinkup.set_active_patient(patient)) {
+        shell.printfln("patient %d on screen: %s %s", patient, librelinkup.llu_patients[patient].first_name.c_str(), librelinkup.llu_patients[patient].last_name.c_str());
+        llu_task.unlock();
+        llu_task.request_fetch();
+        return;
+    }
+    shell.printfln("invalid patient: %d (followed patients: %d)", patient, librelinkup.llu_patient_count);
+
+    llu_task.unlock();
 }
 
 void PingCommand(uuid::console::Shell &shell, const std::vector<std::string> &) {
@@ -390,6 +542,11 @@ void wgSettingCommand(uuid::console::Shell &shell, const std::vector<std::string
 }
 
 void downloadRootCaToFileCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    // LIBRELINKUP is shared with the network task
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
     
     if (!arguments.empty()) {
         String downloadRootCaToFile_argument = arguments[0].c_str();
@@ -420,9 +577,15 @@ void downloadRootCaToFileCommand(uuid::console::Shell &shell, const std::vector<
     }else{
         shell.println(F("command: download_ca_to_file <DigiCert|Baltimore|GoogleTrust>"));
     }
+    llu_task.unlock();
 }
 
 void downloadRootCaFromURLToFileCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    // LIBRELINKUP is shared with the network task
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
     
     if (!arguments.empty()) {
         String https_url     = arguments[0].c_str();
@@ -434,9 +597,15 @@ void downloadRootCaFromURLToFileCommand(uuid::console::Shell &shell, const std::
             shell.println(F("Error downloading Root certificate."));
         }
     }
+    llu_task.unlock();
 }
 
 void setCaFromFileCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    // LIBRELINKUP is shared with the network task
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
     
     if (!arguments.empty()) {
         String setRootCaFromFile_argument = arguments[0].c_str();
@@ -456,6 +625,7 @@ void setCaFromFileCommand(uuid::console::Shell &shell, const std::vector<std::st
             shell.printfln("invalid argument: %s",setRootCaFromFile_argument);
         }
     }
+    llu_task.unlock();
 }
 
 void showCaFromFileCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
@@ -480,6 +650,180 @@ void showCaFromFileCommand(uuid::console::Shell &shell, const std::vector<std::s
     }
 }
 
+void caBundleCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    // LIBRELINKUP is shared with the network task
+    if (!llu_task.lock()) {
+        shell.println(F("LibreLinkUp busy, try again"));
+        return;
+    }
+
+    String caBundle_argument = arguments.empty() ? "info" : arguments[0].c_str();
+    if (caBundle_argument == "rebuild") {
+        uint16_t roots = librelinkup.setCAbundle(true);
+        shell.printfln("CA bundle rebuilt: %d roots", roots);
+    }
+    else if (caBundle_argument != "info") {
+        shell.printfln("invalid argument: %s", caBundle_argument.c_str());
+        llu_task.unlock();
+        return;
+    }
+
+    TrustStore &trust_store = librelinkup.trust_store;
+    shell.printfln("CA bundle: %d roots, %d bytes, %s", trust_store.count(), trust_store.size(), trust_store.from_cache() ? "from cache" : "built from PEM");
+    for (uint16_t i = 0; i < trust_store.count(); i++) {
+        char name[64];
+        trust_store.common_name(i, name, sizeof(name));
+        shell.printfln("  %d: %s", i, name);
+    }
+    llu_task.unlock();
+}
+
+// called with the glucose log locked (flush task)
+static void glucoseLogLockedCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    GlucoseLog &glucose_log = hba1c.glucose_log;
+
+    String glucoseLog_argument = arguments.empty() ? "stats" : arguments[0].c_str();
+    if (glucoseLog_argument == "import") {
+        hba1c.begin();
+    }
+    else if (glucoseLog_argument == "days") {
+        // last 14 days from the day summaries, then the periods
+        uint32_t today = GlucoseLog::day_of(time(NULL));
+        shell.printfln("day       count  mean   min  max  <54 <70  in range  >180 >250");
+        for (int32_t i = 13; i >= 0; i--) {
+            const GlucoseDaySummary *summary = glucose_log.summary(GlucoseLog::add_days(today, -i));
+            if (summary == NULL || summary->count == 0) continue;
+            shell.printfln("%08lu  %5d  %5.1f  %3d  %3d  %3d %3d  %8d  %4d %4d", (unsigned long)summary->day, summary->count, (float)summary->sum / summary->count,
+                           summary->min, summary->max, summary->tir[0], summary->tir[1], summary->tir[2], summary->tir[3], summary->tir[4]);
+        }
+        static const uint16_t periods[] = {7, 14, 30, 90};
+        for (uint16_t days : periods) {
+            GlucoseStatistics statistics;
+            if (!glucose_log.statistics(days, statistics)) continue;
+            shell.printfln("%2d days: %lu values, mean %.1f, SD %.1f, CV %.1f %%, GMI %.2f %%, TIR %.1f/%.1f/%.1f/%.1f/%.1f %%",
+                           days, (unsigned long)statistics.count, statistics.mean, statistics.sd, statistics.cv, statistics.gmi,
+                           statistics.tir[0], statistics.tir[1], statistics.tir[2], statistics.tir[3], statistics.tir[4]);
+        }
+        return;
+    }
+    else if (glucoseLog_argument == "last") {
+        // records of the last hours through the range query
+        uint32_t hours = (arguments.size() > 1) ? strtoul(arguments[1].c_str(), NULL, 10) : 3;
+        uint32_t now = time(NULL);
+        uint32_t read_bytes = glucose_log.stats.range_read_bytes;
+        uint32_t count = glucose_log.range(now - hours * 3600, now, [](const GlucoseRecord &record, void *context) {
+            time_t timestamp = record.timestamp;
+            struct tm timeinfo;
+            localtime_r(&timestamp, &timeinfo);
+            ((uuid::console::Shell *)context)->printfln("%02d.%02d. %02d:%02d  %3d mg/dL", timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_hour, timeinfo.tm_min, record.value);
+            return true;
+        }, &shell);
+        shell.printfln("%lu records of the last %lu hours, %lu bytes read", (unsigned long)count, (unsigned long)hours, (unsigned long)(glucose_log.stats.range_read_bytes - read_bytes));
+        return;
+    }
+    else if (glucoseLog_argument == "agp") {
+        // percentiles per time of day slot of the last 14 days
+        GlucoseAGP &agp = glucose_log.agp;
+        shell.printfln("AGP since %08lu, %lu values", (unsigned long)agp.first_day(), (unsigned long)agp.count());
+        shell.printfln("time   count   p5  p25  p50  p75  p95");
+        for (uint8_t slot = 0; slot < GLUCOSEAGP_SLOTS; slot++) {
+            uint16_t minutes = slot * GLUCOSEAGP_SLOT_MINUTES;
+            shell.printfln("%02d:%02d  %5lu  %3d  %3d  %3d  %3d  %3d", minutes / 60, minutes % 60, (unsigned long)agp.count(slot),
+                           agp.percentile(slot, 5), agp.percentile(slot, 25), agp.percentile(slot, 50), agp.percentile(slot, 75), agp.percentile(slot, 95));
+        }
+        return;
+    }
+    else if (glucoseLog_argument == "trend") {
+        // 100 points (console width) over the last hours, level picked by trend()
+        uint32_t hours = (arguments.size() > 1) ? strtoul(arguments[1].c_str(), NULL, 10) : 7 * 24;
+        uint32_t now = time(NULL);
+        uint32_t read_bytes = glucose_log.stats.range_read_bytes;
+        uint8_t level;
+        uint32_t count = glucose_log.trend(now - hours * 3600, now, 100, [](const GlucosePoint &point, void *context) {
+            time_t timestamp = point.time;
+            struct tm timeinfo;
+            localtime_r(&timestamp, &timeinfo);
+            ((uuid::console::Shell *)context)->printfln("%02d.%02d. %02d:%02d  n %4d  min %3d  p10 %3d  p50 %3d  mean %3d  p90 %3d  max %3d",
+                                                        timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_hour, timeinfo.tm_min,
+                                                        point.count, point.min, point.p10, point.p50, point.mean, point.p90, point.max);
+            return true;
+        }, &shell, &level);
+        static const char *levels[] = {"records", "hours", "days"};
+        shell.printfln("%lu points (%s) of the last %lu hours, %lu bytes read", (unsigned long)count, levels[level], (unsigned long)hours,
+                       (unsigned long)(glucose_log.stats.range_read_bytes - read_bytes));
+        return;
+    }
+    else if (glucoseLog_argument == "compact") {
+        uint32_t archived = glucose_log.stats.archived_days;
+        glucose_log.compact();
+        shell.printfln("%lu segments archived, %d segments and %d archives", (unsigned long)(glucose_log.stats.archived_days - archived),
+                       glucose_log.segments().size(), glucose_log.archives().size());
+        return;
+    }
+    else if (glucoseLog_argument != "stats") {
+        shell.printfln("invalid argument: %s", glucoseLog_argument.c_str());
+        return;
+    }
+
+    shell.printfln("glucose log %s: last record %lu, segment %s", GLUCOSELOG_DIR, (unsigned long)glucose_log.last_timestamp(), today_log_filename);
+    shell.printfln("  appends %lu, skipped %lu, segments %lu", (unsigned long)glucose_log.stats.appends, (unsigned long)glucose_log.stats.skipped, (unsigned long)glucose_log.stats.segments);
+    shell.printfln("  payload %lu bytes, written %lu bytes, write amplification %lu.%02lux",
+                   (unsigned long)glucose_log.stats.payload_bytes, (unsigned long)glucose_log.stats.written_bytes,
+                   (unsigned long)(glucose_log.write_amplification() / 100), (unsigned long)(glucose_log.write_amplification() % 100));
+    shell.printfln("  repaired %lu (%lu records dropped), imported %lu JSON files (%lu records), %lu day summaries stored",
+                   (unsigned long)glucose_log.stats.repaired, (unsigned long)glucose_log.stats.dropped,
+                   (unsigned long)glucose_log.stats.imported_files, (unsigned long)glucose_log.stats.imported_records,
+                   (unsigned long)glucose_log.stats.summaries);
+    shell.printfln("  %lu hour rollups stored, %lu range queries (%lu bytes read), %lu AGP saves",
+                   (unsigned long)glucose_log.stats.hours, (unsigned long)glucose_log.stats.range_queries,
+                   (unsigned long)glucose_log.stats.range_read_bytes, (unsigned long)glucose_log.stats.agp_saves);
+    shell.printfln("  %d records staged, %lu flushes, %lu replayed after reset, %lu dropped (journal full)",
+                   glucose_log.staged(), (unsigned long)glucose_log.stats.flushes, (unsigned long)glucose_log.stats.replayed,
+                   (unsigned long)glucose_log.stats.journal_full);
+    shell.printfln("  %d segments, %d archives, %lu days (%lu records) archived, %lu archives expired, %lu rollups pruned",
+                   glucose_log.segments().size(), glucose_log.archives().size(), (unsigned long)glucose_log.stats.archived_days,
+                   (unsigned long)glucose_log.stats.archived_records, (unsigned long)glucose_log.stats.expired_archives,
+                   (unsigned long)glucose_log.stats.pruned_rollups);
+    shell.printfln("  %lu records filled in from the history, %lu segments rewritten",
+                   (unsigned long)glucose_log.stats.backfilled, (unsigned long)glucose_log.stats.backfill_rewrites);
+}
+
+void glucoseRetentionCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    if (arguments.size() == 2) {
+        int raw_days = parseArgument(arguments, 0);
+        int rollup_months = parseArgument(arguments, 1);
+        if (raw_days < GLUCOSELOG_SEGMENT_DAYS || raw_days > 3650 || rollup_months < 1 || rollup_months > 120) {
+            shell.printfln("invalid retention, expected %d-3650 days and 1-120 months", GLUCOSELOG_SEGMENT_DAYS);
+            return;
+        }
+        settings.config.glucose_raw_days = raw_days;
+        settings.config.glucose_rollup_months = rollup_months;
+        settings.saveConfiguration(settings.config_filename, settings.config);
+        hba1c.glucose_log.set_retention(raw_days, rollup_months);
+    } else if (!arguments.empty()) {
+        shell.println(F("usage: glucose_retention <raw_days> <rollup_months>"));
+        return;
+    }
+    shell.printfln("glucose log retention: values %d days, hour and day statistics %d months (compaction once a day)",
+                   settings.config.glucose_raw_days, settings.config.glucose_rollup_months);
+}
+
+void glucoseLogCommand(uuid::console::Shell &shell, const std::vector<std::string> &arguments) {
+    GlucoseLog &glucose_log = hba1c.glucose_log;
+
+    if (!arguments.empty() && arguments[0] == "flush") {
+        size_t written = glucose_log.flush();
+        shell.printfln("%d staged records written", written);
+        return;
+    }
+    if (!glucose_log.lock()) {
+        shell.println(F("glucose log busy"));
+        return;
+    }
+    glucoseLogLockedCommand(shell, arguments);
+    glucose_log.unlock();
+}
+
 void registerCommands(std::shared_ptr<uuid::console::Commands> commands) {
     commands->add_command(uuid::flash_string_vector{F("help")}, helpCommand);
     commands->add_command(uuid::flash_string_vector{F("exit")}, exitCommand);
@@ -490,6 +834,7 @@ void registerCommands(std::shared_ptr<uuid::console::Commands> commands) {
     commands->add_command(uuid::flash_string_vector{F("wifi_settings")}, uuid::flash_string_vector{F("<bssid>"), F("<password>")}, WiFiSettingCommand);    
     commands->add_command(uuid::flash_string_vector{F("timezone")}, uuid::flash_string_vector{F("<+/-hours>")}, timezoneCommand);
     commands->add_command(uuid::flash_string_vector{F("ota")}, uuid::flash_string_vector{F("<enable|disable>")}, otaSettingCommand);
+    commands->add_command(uuid::flash_string_vector{F("tir_thresholds")}, uuid::flash_string_vector{F("[very_low]"), F("[low]"), F("[high]"), F("[very_high]")}, tirThresholdsCommand);
     commands->add_command(uuid::flash_string_vector{F("trgb_brightness")}, uuid::flash_string_vector{F("<0-256>")}, trgbBrightnessCommand);
     commands->add_command(uuid::flash_string_vector{F("create_json_week_files")}, create_json_week_files_Command);
     commands->add_command(uuid::flash_string_vector{F("add_glucosevalue_to_json")}, addGlucoseValueToJsonCommand);
@@ -498,7 +843,9 @@ void registerCommands(std::shared_ptr<uuid::console::Commands> commands) {
     commands->add_command(uuid::flash_string_vector{F("delete_json_file")}, uuid::flash_string_vector{F("<filename>")}, deleteJsonFileCommand);
     commands->add_command(uuid::flash_string_vector{F("print_raw_json_file")}, uuid::flash_string_vector{F("<filename>")}, debugRawFileContentsCommand);
     commands->add_command(uuid::flash_string_vector{F("llu_login_data")}, uuid::flash_string_vector{F("<email@domain.com>"), F("<password>")}, LLULoginDataCommand);    
-    commands->add_command(uuid::flash_string_vector{F("llu")}, uuid::flash_string_vector{F("\t<value>\n\r\t<user_id>\n\r\t<user_token>\n\r\t<auth>\n\r\t<tou>\n\r\t<timestamp>\n\r\t<history>\n\r\t<graphdata>\n\r\t<graph_redraw>\n\r\t<get_graphdata>\n\r\t<statistics>")}, lluCommand);
+    commands->add_command(uuid::flash_string_vector{F("llu_server")}, uuid::flash_string_vector{F("<https://host:port/scenario|default>")}, LLUServerCommand);
+    commands->add_command(uuid::flash_string_vector{F("llu")}, uuid::flash_string_vector{F("\t<value>\n\r\t<user_id>\n\r\t<user_token>\n\r\t<auth>\n\r\t<tou>\n\r\t<token>\n\r\t<token_clear>\n\r\t<timestamp>\n\r\t<history>\n\r\t<graphdata>\n\r\t<graph_redraw>\n\r\t<get_graphdata>\n\r\t<statistics>\n\r\t<connection>\n\r\t<poll>\n\r\t<stages>\n\r\t<stages_reset>\n\r\t<region_clear>\n\r\t<patients>")}, lluCommand);
+    commands->add_command(uuid::flash_string_vector{F("llu_patient")}, uuid::flash_string_vector{F("<index>")}, lluPatientCommand);
     commands->add_command(uuid::flash_string_vector{F("ping")}, PingCommand);
     commands->add_command(uuid::flash_string_vector{F("mqtt_client")}, uuid::flash_string_vector{F("<enable|disable>")}, mqttClientSettingCommand);
     commands->add_command(uuid::flash_string_vector{F("wireguard")}, uuid::flash_string_vector{F("<enable|disable>")}, wgSettingCommand);
@@ -506,4 +853,7 @@ void registerCommands(std::shared_ptr<uuid::console::Commands> commands) {
     commands->add_command(uuid::flash_string_vector{F("download_ca_from_url")}, uuid::flash_string_vector{F("<https_url>"), F("<littlefs_path>")}, downloadRootCaFromURLToFileCommand);
     commands->add_command(uuid::flash_string_vector{F("set_ca_from_file")}, uuid::flash_string_vector{F("<DigiCert|Baltimore|GoogleTrust>")}, setCaFromFileCommand);
     commands->add_command(uuid::flash_string_vector{F("show_ca_from_file")}, uuid::flash_string_vector{F("<DigiCert|Baltimore|GoogleTrust>")}, showCaFromFileCommand);
+    commands->add_command(uuid::flash_string_vector{F("ca_bundle")}, uuid::flash_string_vector{F("<info|rebuild>")}, caBundleCommand);
+    commands->add_command(uuid::flash_string_vector{F("glucose_retention")}, uuid::flash_string_vector{F("[raw_days]"), F("[rollup_months]")}, glucoseRetentionCommand);
+    commands->add_command(uuid::flash_string_vector{F("glucose_log")}, uuid::flash_string_vector{F("<stats|days|last|trend|agp|flush|compact|import>"), F("[hours]")}, glucoseLogCommand);
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+/**
+ * @file fixedstring.h
+ * @brief Fixed-capacity string without heap allocation
+ *
+ * Replacement for Arduino String in structs which are rewritten on every
+ * fetch. The text is stored inline, longer input is truncated (and flagged),
+ * so the heap is never touched.
+ */
+
+#ifndef FIXEDSTRING_H
+#define FIXEDSTRING_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <string.h>
+
+/**
+ * @class FixedString
+ * @brief Inline string with room for N characters plus terminator
+ * @tparam N Maximum number of characters
+ */
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char *str) { assign(str); }
+    FixedString(const String &str) { assign(str.c_str(), str.length()); }
+
+    FixedString &operator=(const char *str) { assign(str); return *this; }
+    FixedString &operator=(const String &str) { assign(str.c_str(), str.length()); return *this; }
+    template <size_t M>
+    FixedString &operator=(const FixedString<M> &str) { assign(str.c_str(), str.length()); return *this; }
+
+    /**
+     * @brief Copy text, NULL is stored as empty string
+     * @return false if the text was truncated
+     */
+    bool assign(const char *str) {
+        return assign(str, (str != NULL) ? strlen(str) : 0);
+    }
+
+    /**
+     * @brief Copy len characters of str (need not be terminated)
+     * @return false if the text was truncated
+     */
+    bool assign(const char *str, size_t len) {
+        _truncated = len > N;
+        if(_truncated) len = N;
+        if(len > 0) memmove(_buf, str, len);
+        _buf[len] = '\0';
+        _len = len;
+        return !_truncated;
+    }
+
+    /**
+     * @brief Formatted assignment (snprintf)
+     * @return false if the text was truncated
+     */
+    bool printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(_buf, N + 1, format, args);
+        va_end(args);
+        if(len < 0) len = 0;
+        _truncated = (size_t)len > N;
+        _len = _truncated ? N : len;
+        return !_truncated;
+    }
+
+    void clear(void) { _buf[0] = '\0'; _len = 0; _truncated = false; }
+
+    const char *c_str(void) const { return _buf; }
+    size_t length(void) const { return _len; }
+    bool isEmpty(void) const { return _len == 0; }
+    bool truncated(void) const { return _truncated; }  ///< last assignment did not fit
+    static constexpr size_t capacity(void) { return N; }
+
+    bool operator==(const char *str) const { return strcmp(_buf, (str != NULL) ? str : "") == 0; }
+    bool operator!=(const char *str) const { return !(*this == str); }
+    bool operator==(const String &str) const { return *this == str.c_str(); }
+    bool operator!=(const String &str) const { return !(*this == str.c_str()); }
+    template <size_t M>
+    bool operator==(const FixedString<M> &str) const { return *this == str.c_str(); }
+    template <size_t M>
+    bool operator!=(const FixedString<M> &str) const { return !(*this == str.c_str()); }
+
+private:
+    char _buf[N + 1];
+    uint16_t _len;
+    bool _truncated;
+};
+
+#endif // FIXEDSTRING_H
@@ -0,0 +1,156 @@
+#include "glucoseagp.h"
+#include "glucoselog.h"
+
+#include <LittleFS.h>
+#include <time.h>
+#include <uuid/log.h>
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+#define GLUCOSEAGP_TMP_PATH     "/glucose/agp.tmp"
+
+void GlucoseAGP::add(uint32_t timestamp, uint16_t value) {
+    uint16_t &bin = _bins[slot_of(timestamp)][bin_of(value)];
+    if (bin < UINT16_MAX) {
+        bin++;
+        _count++;
+    }
+    if (timestamp > _last_timestamp) {
+        _last_timestamp = timestamp;
+    }
+}
+
+void GlucoseAGP::remove(uint32_t timestamp, uint16_t value) {
+    uint16_t &bin = _bins[slot_of(timestamp)][bin_of(value)];
+    if (bin > 0) {
+        bin--;
+        _count--;
+    }
+}
+
+void GlucoseAGP::reset(uint32_t first_day) {
+    memset(_bins, 0, sizeof(_bins));
+    _count = 0;
+    _first_day = first_day;
+    _last_timestamp = 0;
+}
+
+uint16_t GlucoseAGP::percentile(uint8_t slot, uint8_t percent) const {
+    uint32_t total = count(slot);
+    if (total == 0) {
+        return 0;
+    }
+
+    // rank inside the bin -> linear between its limits
+    float rank = total * percent / 100.0f;
+    uint32_t below = 0;
+    for (uint8_t bin = 0; bin < GLUCOSEAGP_BINS; bin++) {
+        uint16_t n = _bins[slot][bin];
+        if (n == 0 || below + n < rank) {
+            below += n;
+            continue;
+        }
+        float value = GLUCOSEAGP_MIN + bin * GLUCOSEAGP_BIN_WIDTH + GLUCOSEAGP_BIN_WIDTH * (rank - below) / n;
+        return (uint16_t)std::min(value + 0.5f, (float)GLUCOSEAGP_MAX);
+    }
+    return GLUCOSEAGP_MAX;
+}
+
+uint32_t GlucoseAGP::count(uint8_t slot) const {
+    if (slot >= GLUCOSEAGP_SLOTS) {
+        return 0;
+    }
+    uint32_t total = 0;
+    for (uint8_t bin = 0; bin < GLUCOSEAGP_BINS; bin++) {
+        total += _bins[slot][bin];
+    }
+    return total;
+}
+
+uint8_t GlucoseAGP::slot_of(uint32_t timestamp) {
+    time_t t = timestamp;
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    return (timeinfo.tm_hour * 60 + timeinfo.tm_min) / GLUCOSEAGP_SLOT_MINUTES;
+}
+
+uint8_t GlucoseAGP::bin_of(uint16_t value) {
+    if (value <= GLUCOSEAGP_MIN) return 0;
+    if (value >= GLUCOSEAGP_MAX) return GLUCOSEAGP_BINS - 1;
+    return (value - GLUCOSEAGP_MIN) / GLUCOSEAGP_BIN_WIDTH;
+}
+
+bool GlucoseAGP::load(void) {
+    File file = LittleFS.open(GLUCOSEAGP_PATH, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    reset(0);
+    FileHeader header;
+    bool result = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == GLUCOSEAGP_MAGIC &&
+                  header.version == GLUCOSEAGP_VERSION && header.slots == GLUCOSEAGP_SLOTS && header.bins == GLUCOSEAGP_BINS;
+    uint8_t crc = GlucoseLog::crc8((const uint8_t *)&header, sizeof(header) - 1);
+    for (uint8_t slot = 0; result && slot < GLUCOSEAGP_SLOTS; slot++) {
+        uint8_t range[2];
+        result = file.read(range, sizeof(range)) == sizeof(range) && range[0] <= range[1] && range[1] < GLUCOSEAGP_BINS;
+        if (!result) break;
+        size_t bytes = (range[1] - range[0] + 1) * sizeof(uint16_t);
+        result = file.read((uint8_t *)&_bins[slot][range[0]], bytes) == bytes;
+        crc = GlucoseLog::crc8(range, sizeof(range), crc);
+        crc = GlucoseLog::crc8((const uint8_t *)&_bins[slot][range[0]], bytes, crc);
+    }
+    file.close();
+
+    if (!result || crc != header.crc) {
+        logger.err("AGP: %s not valid", GLUCOSEAGP_PATH);
+        reset(0);
+        return false;
+    }
+
+    for (uint8_t slot = 0; slot < GLUCOSEAGP_SLOTS; slot++) {
+        _count += count(slot);
+    }
+    _first_day = header.first_day;
+    _last_timestamp = header.last_timestamp;
+    logger.debug("AGP: loaded %d values from %d", _count, _first_day);
+    return true;
+}
+
+size_t GlucoseAGP::save(void) {
+    FileHeader header = {GLUCOSEAGP_MAGIC, _first_day, _last_timestamp, GLUCOSEAGP_VERSION, GLUCOSEAGP_SLOTS, GLUCOSEAGP_BINS, 0};
+
+    // used bin range per slot, the CRC covers what is written
+    uint8_t ranges[GLUCOSEAGP_SLOTS][2];
+    uint8_t crc = GlucoseLog::crc8((const uint8_t *)&header, sizeof(header) - 1);
+    for (uint8_t slot = 0; slot < GLUCOSEAGP_SLOTS; slot++) {
+        uint8_t first = 0;
+        uint8_t last = GLUCOSEAGP_BINS - 1;
+        while (first < last && _bins[slot][first] == 0) first++;
+        while (last > first && _bins[slot][last] == 0) last--;
+        ranges[slot][0] = first;
+        ranges[slot][1] = last;
+        crc = GlucoseLog::crc8(ranges[slot], 2, crc);
+        crc = GlucoseLog::crc8((const uint8_t *)&_bins[slot][first], (last - first + 1) * sizeof(uint16_t), crc);
+    }
+    header.crc = crc;
+
+    File file = LittleFS.open(GLUCOSEAGP_TMP_PATH, FILE_WRITE);
+    size_t expected = sizeof(header);
+    size_t written = file ? file.write((const uint8_t *)&header, sizeof(header)) : 0;
+    for (uint8_t slot = 0; file && slot < GLUCOSEAGP_SLOTS; slot++) {
+        size_t bytes = (ranges[slot][1] - ranges[slot][0] + 1) * sizeof(uint16_t);
+        written += file.write(ranges[slot], 2);
+        written += file.write((const uint8_t *)&_bins[slot][ranges[slot][0]], bytes);
+        expected += 2 + bytes;
+    }
+    file.close();
+    if (written != expected || !LittleFS.rename(GLUCOSEAGP_TMP_PATH, GLUCOSEAGP_PATH)) {
+        logger.err("AGP: %s not saved", GLUCOSEAGP_PATH);
+        LittleFS.remove(GLUCOSEAGP_TMP_PATH);
+        return 0;
+    }
+    return written;
+}
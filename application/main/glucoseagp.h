@@ -0,0 +1,120 @@
+/**
+ * @file glucoseagp.h
+ * @brief Ambulatory glucose profile (AGP) of the last 14 days
+ *
+ * One histogram per 30 minute time of day slot over the bounded glucose
+ * domain 40-500 mg/dL (5 mg/dL bins, lower and higher values count as 40 and
+ * 500 like the LibreView AGP). Adding or removing a value is one increment,
+ * the 5/25/50/75/95th percentiles are read from the bins.
+ *
+ * The window is managed by GlucoseLog: the day leaving the window is removed
+ * by reading its segment once, the histograms are saved to LittleFS after that
+ * (once per day) and the values since the last save are added again at boot.
+ * Only the used bin range of every slot is saved (at most 9 KB).
+ */
+
+#ifndef GLUCOSEAGP_H
+#define GLUCOSEAGP_H
+
+#include <Arduino.h>
+
+/**
+ * @defgroup glucoseagp_config AGP Settings
+ * @{
+ */
+#define GLUCOSEAGP_DAYS         14                  ///< Window length in days
+#define GLUCOSEAGP_SLOT_MINUTES 30                  ///< Time of day resolution
+#define GLUCOSEAGP_SLOTS        (24 * 60 / GLUCOSEAGP_SLOT_MINUTES)
+#define GLUCOSEAGP_MIN          40                  ///< Lowest value (mg/dL)
+#define GLUCOSEAGP_MAX          500                 ///< Highest value (mg/dL)
+#define GLUCOSEAGP_BIN_WIDTH    5                   ///< mg/dL per bin
+#define GLUCOSEAGP_BINS         ((GLUCOSEAGP_MAX - GLUCOSEAGP_MIN) / GLUCOSEAGP_BIN_WIDTH + 1)
+#define GLUCOSEAGP_PATH         "/glucose/agp.bin"  ///< Saved histograms
+#define GLUCOSEAGP_MAGIC        0x31504741          ///< "AGP1" (little endian)
+#define GLUCOSEAGP_VERSION      2                   ///< File layout version
+/** @} */
+
+/**
+ * @class GlucoseAGP
+ * @brief Fixed-memory time of day histograms
+ */
+class GlucoseAGP {
+public:
+    /**
+     * @brief Add one value
+     * @param timestamp Unix time, selects the time of day slot
+     * @param value Glucose in mg/dL
+     */
+    void add(uint32_t timestamp, uint16_t value);
+
+    /**
+     * @brief Remove a value that was added before (day leaves the window)
+     */
+    void remove(uint32_t timestamp, uint16_t value);
+
+    /**
+     * @brief Remove all values
+     * @param first_day First day YYYYMMDD of the new window
+     */
+    void reset(uint32_t first_day);
+
+    /**
+     * @brief Percentile of a time of day slot
+     * @param slot 0 - GLUCOSEAGP_SLOTS-1
+     * @param percent 1-99
+     * @return mg/dL (interpolated inside the bin), 0 without values
+     */
+    uint16_t percentile(uint8_t slot, uint8_t percent) const;
+
+    /**
+     * @brief Values in a time of day slot
+     */
+    uint32_t count(uint8_t slot) const;
+
+    uint32_t count(void) const { return _count; }                       ///< Values in the window
+    uint32_t first_day(void) const { return _first_day; }               ///< First day YYYYMMDD of the window
+    void set_first_day(uint32_t day) { _first_day = day; }              ///< Window moved (values of older days removed)
+    uint32_t last_timestamp(void) const { return _last_timestamp; }     ///< Newest added value
+
+    /**
+     * @brief Time of day slot of a Unix time (local time)
+     */
+    static uint8_t slot_of(uint32_t timestamp);
+
+    /**
+     * @brief Read the histograms from LittleFS
+     * @return false if nothing (valid) is stored
+     */
+    bool load(void);
+
+    /**
+     * @brief Write the histograms to LittleFS (temp file + rename)
+     * @return Bytes written, 0 on error
+     */
+    size_t save(void);
+
+private:
+    /**
+     * @struct FileHeader
+     * @brief First 16 bytes of GLUCOSEAGP_PATH
+     */
+    struct FileHeader {
+        uint32_t magic;             ///< GLUCOSEAGP_MAGIC
+        uint32_t first_day;         ///< Window start YYYYMMDD
+        uint32_t last_timestamp;    ///< Newest value in the histograms
+        uint8_t version;            ///< GLUCOSEAGP_VERSION
+        uint8_t slots;              ///< GLUCOSEAGP_SLOTS
+        uint8_t bins;               ///< GLUCOSEAGP_BINS
+        uint8_t crc;                ///< CRC-8 of the first 15 bytes and the slots
+    };
+    // followed by GLUCOSEAGP_SLOTS times: first bin, last bin (uint8_t), counts of the bins between (uint16_t)
+
+    static uint8_t bin_of(uint16_t value);
+
+    uint16_t _bins[GLUCOSEAGP_SLOTS][GLUCOSEAGP_BINS] = {};
+    uint32_t _count = 0;
+    uint32_t _first_day = 0;
+    uint32_t _last_timestamp = 0;
+};
+
+#endif // GLUCOSEAGP_H
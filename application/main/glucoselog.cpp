@@ -0,0 +1,1847 @@
+#include "glucoselog.h"
+#include "jsonstream.h"
+
+#include <time.h>
+#include <math.h>
+#include <uuid/log.h>
+#include <vector>
+#include <algorithm>
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+#define GLUCOSELOG_TMP_PATH     GLUCOSELOG_DIR "/segment.tmp"   // repair / import, renamed over the segment
+#define GLUCOSELOG_READ_RECORDS 32                               // records per read() (256 bytes)
+#define GLUCOSELOG_SUMMARY_TMP  GLUCOSELOG_DIR "/days.tmp"       // repair of days.bin
+#define GLUCOSELOG_HOURS_TMP    GLUCOSELOG_DIR "/hours.tmp"      // repair / merge of hours.bin
+
+// staged records, not cleared by a software, watchdog or brownout reset (checked by begin())
+RTC_NOINIT_ATTR static GlucoseJournal journal;
+static portMUX_TYPE journal_mux = portMUX_INITIALIZER_UNLOCKED;
+static portMUX_TYPE history_mux = portMUX_INITIALIZER_UNLOCKED;   // history handed from backfill() to the flush task
+
+static void journal_seal(void){
+    journal.magic = GLUCOSELOG_JOURNAL_MAGIC;
+    journal.crc = GlucoseLog::crc8((const uint8_t *)&journal, 7);
+}
+
+// lower bounds of the sketch buckets (mg/dL), finer around the target range
+static const uint16_t sketch_edges[GLUCOSELOG_SKETCH_BINS] = {0, 54, 63, 70, 80, 90, 100, 115, 130, 145, 160, 180, 200, 225, 250, 300};
+
+static uint8_t sketch_bucket(uint16_t value){
+
+    uint8_t bucket = GLUCOSELOG_SKETCH_BINS - 1;
+    while(bucket > 0 && value < sketch_edges[bucket]) bucket--;
+    return bucket;
+}
+
+// percentile estimate: linear inside the bucket, limited to min/max
+template<typename T>
+static uint16_t sketch_percentile(const T *sketch, uint32_t count, uint16_t min, uint16_t max, uint8_t percent){
+
+    if(count == 0) return 0;
+    float rank = count * percent / 100.0f;
+    uint32_t below = 0;
+    for(uint8_t bucket = 0; bucket < GLUCOSELOG_SKETCH_BINS; bucket++){
+        if(sketch[bucket] == 0 || below + sketch[bucket] < rank){
+            below += sketch[bucket];
+            continue;
+        }
+        float low = std::max(sketch_edges[bucket], min);
+        float high = (bucket + 1 < GLUCOSELOG_SKETCH_BINS) ? std::min<uint16_t>(sketch_edges[bucket + 1], max) : max;
+        float value = low + (high - low) * (rank - below) / sketch[bucket];
+        return (uint16_t)std::min(std::max(value + 0.5f, (float)min), (float)max);
+    }
+    return max;
+}
+
+// collects {"timestamp":..,"glucose":..} objects of a JSON day file
+class GlucoseJsonListener : public JsonStreamListener {
+public:
+    explicit GlucoseJsonListener(std::vector<GlucoseRecord> &records) : _records(records) {}
+
+    void value(JsonStreamParser &parser, JsonStreamType type, const char *value) override {
+        if(type != JSONSTREAM_NUMBER) return;
+        if(parser.match("[].timestamp"))    _timestamp = strtoul(value, NULL, 10);
+        else if(parser.match("[].glucose")) _glucose = strtoul(value, NULL, 10);
+    }
+
+    void end(JsonStreamParser &parser) override {
+        if(parser.depth() != 1) return;         // object inside the root array closed
+        if(_timestamp != 0 && _glucose != 0 && _glucose <= GLUCOSELOG_MAX_VALUE){
+            _records.push_back({_timestamp, (uint16_t)_glucose, GLUCOSELOG_FLAG_IMPORTED, 0});
+        }
+        _timestamp = 0;
+        _glucose = 0;
+    }
+
+private:
+    std::vector<GlucoseRecord> &_records;
+    uint32_t _timestamp = 0;
+    uint32_t _glucose = 0;
+};
+
+bool GlucoseLog::begin(void){
+
+    if(!LittleFS.exists(GLUCOSELOG_DIR) && !LittleFS.mkdir(GLUCOSELOG_DIR)){
+        logger.err("glucose log: %s can not be created", GLUCOSELOG_DIR);
+        return false;
+    }
+
+    scan_manifest();
+    load_hours();
+    _agp_ready = false;
+    uint32_t imported = stats.imported_files;
+    import_all_json();
+
+    // only the newest segment can have an interrupted append, a segment without header is removed
+    while(!_segments.empty()){
+        char path[GLUCOSELOG_PATH_SIZE];
+        segment_path(_segments.back(), path);
+        if(recover(path) || LittleFS.exists(path)){
+            break;
+        }
+        _segments.pop_back();
+    }
+
+    // before the summaries, rollups and AGP are rebuilt from the segments
+    replay_journal();
+
+    load_summaries();
+    rebuild_summaries();
+    rebuild_hours();
+    agp_begin(stats.imported_files != imported);
+
+    logger.notice("glucose log: last record %d (day %d)", _last_timestamp, _last_day);
+    return true;
+}
+
+void GlucoseLog::start_flush_task(void){
+
+    if(_task != NULL){
+        return;
+    }
+    _mutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(
+        task,                       // Task-Funktion
+        "GlucoseLog",               // Name des Tasks
+        GLUCOSELOG_TASK_STACK,      // Stack-Größe
+        this,                       // Parameter
+        GLUCOSELOG_TASK_PRIORITY,   // Priorität
+        &_task,                     // Task-Handle
+        GLUCOSELOG_TASK_CORE        // Core
+    );
+}
+
+bool GlucoseLog::append(uint32_t timestamp, uint16_t value, uint8_t flags){
+
+    // a history point stored just before is the same measurement
+    uint32_t last = last_timestamp();
+    if(timestamp <= last || (last != 0 && timestamp - last < GLUCOSELOG_BACKFILL_NEAR)){
+        stats.skipped++;
+        return false;
+    }
+    if(value == 0 || value > GLUCOSELOG_MAX_VALUE){
+        logger.debug("glucose log: value %d rejected", value);
+        return false;
+    }
+
+    GlucoseRecord record = {timestamp, value, flags, 0};
+    seal(record);
+
+    // no flush task (setup, tools): write right away
+    if(_task == NULL){
+        return commit(&record, 1, true);
+    }
+
+    bool staged = false;
+    portENTER_CRITICAL(&journal_mux);
+    if(journal.count < GLUCOSELOG_JOURNAL_RECORDS){
+        journal.records[journal.count++] = record;
+        journal_seal();
+        staged = true;
+    }
+    uint32_t first = journal.records[0].timestamp;
+    uint16_t count = journal.count;
+    portEXIT_CRITICAL(&journal_mux);
+
+    // flush task did not keep up (flash error or starved): the caller never waits for flash,
+    // the record is dropped (the next /graph history fills the gap)
+    if(!staged){
+        stats.journal_full++;
+        logger.warning("glucose log: journal full, value %d dropped", value);
+        xTaskNotifyGive(_task);
+        return false;
+    }
+
+    _staged_timestamp = timestamp;
+    // batch complete or first record of a new day: wake up the flush task
+    if(count >= GLUCOSELOG_FLUSH_RECORDS || day_of(first) != day_of(timestamp)){
+        xTaskNotifyGive(_task);
+    }
+    return true;
+}
+
+size_t GlucoseLog::flush(void){
+
+    if(!lock()){
+        return 0;
+    }
+
+    GlucoseRecord records[GLUCOSELOG_JOURNAL_RECORDS];
+    portENTER_CRITICAL(&journal_mux);
+    uint16_t count = journal.count;
+    memcpy(records, journal.records, count * sizeof(GlucoseRecord));
+    portEXIT_CRITICAL(&journal_mux);
+
+    // records stay in the journal until they are on flash, commit() skips a part written before
+    bool result = count > 0 && commit(records, count, true);
+    if(result){
+        stats.flushes++;
+        portENTER_CRITICAL(&journal_mux);
+        journal.count -= count;
+        memmove(journal.records, journal.records + count, journal.count * sizeof(GlucoseRecord));
+        journal_seal();
+        portEXIT_CRITICAL(&journal_mux);
+    }
+    unlock();
+    return result ? count : 0;
+}
+
+uint16_t GlucoseLog::staged(void) const {
+
+    return journal.count;
+}
+
+bool GlucoseLog::lock(uint32_t timeout_ms){
+
+    if(_mutex == NULL) return true;     // no flush task, nobody else writes
+    return xSemaphoreTake(_mutex, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void GlucoseLog::unlock(void){
+
+    if(_mutex != NULL) xSemaphoreGive(_mutex);
+}
+
+void GlucoseLog::task(void *parameter){
+
+    static_cast<GlucoseLog *>(parameter)->run();
+}
+
+void GlucoseLog::run(void){
+
+    logger.notice("glucose log: flush task started on core %d", xPortGetCoreID());
+    while(1){
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GLUCOSELOG_FLUSH_CHECK));   // wakes up early from append() and backfill()
+
+        // history first: newer points join the journal before the flush check
+        if(_history_count > 0){
+            merge_pending_history();
+        }
+
+        portENTER_CRITICAL(&journal_mux);
+        uint16_t count = journal.count;
+        uint32_t first = journal.records[0].timestamp;
+        uint32_t newest = journal.records[count > 0 ? count - 1 : 0].timestamp;
+        portEXIT_CRITICAL(&journal_mux);
+
+        uint32_t now = time(nullptr);
+        if(count > 0 && (count >= GLUCOSELOG_FLUSH_RECORDS || day_of(first) != day_of(newest) || now - first >= GLUCOSELOG_FLUSH_AGE)){
+            size_t written = flush();
+            logger.debug("glucose log: %d staged records flushed", written);
+        }
+
+        // archives and retention once a day
+        uint32_t today = day_of(now);
+        if(today != _compacted_day && today >= 20200101 && lock()){
+            compact();
+            unlock();
+            _compacted_day = today;
+        }
+    }
+}
+
+// writes sorted records with one append per segment, derived = update summaries, rollups and AGP
+bool GlucoseLog::commit(const GlucoseRecord *records, size_t count, bool derived){
+
+    size_t start = 0;
+    while(start < count && records[start].timestamp <= _last_timestamp){
+        start++;
+    }
+
+    while(start < count){
+        uint32_t day = day_of(records[start].timestamp);
+        size_t end = start + 1;
+        while(end < count && day_of(records[end].timestamp) == day){
+            end++;
+        }
+
+        File file;
+        if(!open_segment(day, file)){
+            return false;
+        }
+        bool result = write_records(file, records + start, end - start);
+        file.close();
+        if(!result){
+            logger.err("glucose log: append to day %d failed", day);
+            return false;
+        }
+
+        _last_timestamp = records[end - 1].timestamp;
+        _last_day = day;
+        stats.appends += end - start;
+        stats.payload_bytes += (end - start) * sizeof(GlucoseRecord);
+        if(derived){
+            for(size_t i = start; i < end; i++){
+                apply(records[i]);
+            }
+        }
+        start = end;
+    }
+    return true;
+}
+
+// records a reset left in the journal (or staged before "glucose_log import"), written before the
+// derived data is rebuilt from the segments
+void GlucoseLog::replay_journal(void){
+
+    GlucoseRecord records[GLUCOSELOG_JOURNAL_RECORDS];
+    portENTER_CRITICAL(&journal_mux);
+    bool result = journal.magic == GLUCOSELOG_JOURNAL_MAGIC && journal.count <= GLUCOSELOG_JOURNAL_RECORDS &&
+                  journal.crc == crc8((const uint8_t *)&journal, 7);
+    uint16_t count = result ? journal.count : 0;
+    memcpy(records, journal.records, count * sizeof(GlucoseRecord));
+    portEXIT_CRITICAL(&journal_mux);
+
+    // random RTC memory after power on: stop at the first invalid record
+    uint16_t replay = 0;
+    while(replay < count && valid(records[replay]) && (replay == 0 || records[replay].timestamp > records[replay - 1].timestamp)){
+        replay++;
+    }
+    if(replay > 0 && commit(records, replay, false)){
+        stats.replayed += replay;
+        logger.notice("glucose log: %d staged records written", replay);
+    }
+
+    // records staged in the meantime stay
+    portENTER_CRITICAL(&journal_mux);
+    if(!result){
+        journal.count = 0;
+    }else{
+        journal.count -= count;
+        memmove(journal.records, journal.records + count, journal.count * sizeof(GlucoseRecord));
+    }
+    journal_seal();
+    portEXIT_CRITICAL(&journal_mux);
+}
+
+void GlucoseLog::apply(const GlucoseRecord &record){
+
+    uint32_t day = day_of(record.timestamp);
+    uint16_t value = record.value;
+
+    // first value of a new day: the previous day is finished
+    if(day != _today.day){
+        if(_today.count > 0){
+            store_summary(_today);
+        }
+        _today = {};
+        _today.day = day;
+    }
+    summary_add(_today, value);
+
+    // hours are UTC aligned, the rollup of an hour is stored with the first value of the next one
+    std::vector<GlucoseHourRollup> finished;
+    hour_add(_hour, finished, record);
+    if(!finished.empty()){
+        store_hours(finished.data(), finished.size());
+    }
+
+    if(_agp_ready){
+        agp_feed(record.timestamp, value);
+    }
+}
+
+uint32_t GlucoseLog::read_segment(const char *path, GlucoseLogCallback callback, void *context){
+
+    File file = LittleFS.open(path, FILE_READ);
+    if(!file){
+        return 0;
+    }
+
+    GlucoseLogHeader header;
+    if(!read_header(file, header)){
+        logger.err("glucose log: %s has no valid header", path);
+        file.close();
+        return 0;
+    }
+
+    // stops at the first invalid record, like the repair in begin()
+    GlucoseRecord records[GLUCOSELOG_READ_RECORDS];
+    uint32_t count = 0;
+    uint32_t last = 0;
+    bool done = false;
+    while(!done){
+        size_t n = file.read((uint8_t *)records, sizeof(records)) / sizeof(GlucoseRecord);
+        if(n == 0) break;
+        for(size_t i = 0; i < n; i++){
+            if(!valid(records[i]) || records[i].timestamp <= last){
+                done = true;
+                break;
+            }
+            last = records[i].timestamp;
+            count++;
+            if(!callback(records[i], context)){
+                done = true;
+                break;
+            }
+        }
+    }
+    file.close();
+    return count;
+}
+
+uint32_t GlucoseLog::range(uint32_t from, uint32_t to, GlucoseLogCallback callback, void *context){
+
+    if(from > to){
+        return 0;
+    }
+    stats.range_queries++;
+
+    // archived months are older than the segments, a record is stored in the segment of its local day
+    uint32_t count = 0;
+    bool done = false;
+    uint32_t first_day = day_of(from);
+    uint32_t last_day = day_of(to);
+    size_t i = std::lower_bound(_archives.begin(), _archives.end(), first_day / 100) - _archives.begin();
+    for(; !done && i < _archives.size() && _archives[i] <= last_day / 100; i++){
+        count += archive_range(_archives[i], from, to, callback, context, done);
+    }
+    i = std::lower_bound(_segments.begin(), _segments.end(), first_day) - _segments.begin();
+    for(; !done && i < _segments.size() && _segments[i] <= last_day; i++){
+        uint32_t day = _segments[i];
+        char path[GLUCOSELOG_PATH_SIZE];
+        segment_path(day, path);
+        File file = LittleFS.open(path, FILE_READ);
+        GlucoseLogHeader header;
+        if(!file || !read_header(file, header)){
+            file.close();
+            continue;
+        }
+        stats.range_read_bytes += sizeof(header);
+
+        // last block starting at or before from
+        SegmentIndex &index = segment_index(day, file);
+        size_t block = std::upper_bound(index.timestamps.begin(), index.timestamps.end(), from) - index.timestamps.begin();
+        block = (block > 0) ? block - 1 : 0;
+        if(!file.seek(sizeof(header) + block * GLUCOSELOG_INDEX_STRIDE * sizeof(GlucoseRecord))){
+            file.close();
+            continue;
+        }
+
+        GlucoseRecord records[GLUCOSELOG_READ_RECORDS];
+        uint32_t last = 0;
+        bool segment_done = false;
+        while(!segment_done){
+            size_t bytes = file.read((uint8_t *)records, sizeof(records));
+            stats.range_read_bytes += bytes;
+            size_t n = bytes / sizeof(GlucoseRecord);
+            if(n == 0) break;
+            for(size_t i = 0; i < n; i++){
+                if(!valid(records[i]) || records[i].timestamp <= last){
+                    segment_done = true;
+                    break;
+                }
+                last = records[i].timestamp;
+                if(last < from) continue;
+                if(last > to || !callback(records[i], context)){
+                    done = true;
+                    segment_done = true;
+                    break;
+                }
+                count++;
+            }
+        }
+        file.close();
+    }
+
+    // staged records are newer than every stored one
+    if(!done && journal.count > 0){
+        GlucoseRecord records[GLUCOSELOG_JOURNAL_RECORDS];
+        portENTER_CRITICAL(&journal_mux);
+        uint16_t staged = journal.count;
+        memcpy(records, journal.records, staged * sizeof(GlucoseRecord));
+        portEXIT_CRITICAL(&journal_mux);
+        for(uint16_t i = 0; i < staged; i++){
+            if(records[i].timestamp <= _last_timestamp || records[i].timestamp < from) continue;
+            if(records[i].timestamp > to || !callback(records[i], context)) break;
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t GlucoseLog::trend(uint32_t from, uint32_t to, uint16_t pixels, GlucosePointCallback callback, void *context, uint8_t *level){
+
+    if(from > to || pixels == 0){
+        return 0;
+    }
+    uint32_t span = to - from;
+    uint8_t selected = (span / 86400 >= pixels) ? GLUCOSELOG_LEVEL_DAY :
+                       (span / 3600 >= pixels)  ? GLUCOSELOG_LEVEL_HOUR : GLUCOSELOG_LEVEL_RAW;
+    if(level != NULL){
+        *level = selected;
+    }
+
+    if(selected == GLUCOSELOG_LEVEL_HOUR){
+        return hours_range(from, to, callback, context);
+    }
+
+    if(selected == GLUCOSELOG_LEVEL_DAY){
+        uint32_t count = 0;
+        uint32_t last_day = day_of(to);
+        for(uint32_t day = day_of(from); day <= last_day; day = add_days(day, 1)){
+            const GlucoseDaySummary *entry = summary(day);
+            if(entry == NULL || entry->count == 0) continue;
+            GlucosePoint point = {day_time(day), 86400, entry->count, entry->min, entry->max, (uint16_t)((entry->sum + entry->count / 2) / entry->count),
+                                  sketch_percentile(entry->sketch, entry->count, entry->min, entry->max, 10),
+                                  sketch_percentile(entry->sketch, entry->count, entry->min, entry->max, 50),
+                                  sketch_percentile(entry->sketch, entry->count, entry->min, entry->max, 90)};
+            count++;
+            if(!callback(point, context)) break;
+        }
+        return count;
+    }
+
+    struct Forward {
+        GlucosePointCallback callback;
+        void *context;
+    } forward = {callback, context};
+    return range(from, to, [](const GlucoseRecord &record, void *context){
+        Forward *forward = (Forward *)context;
+        GlucosePoint point = {record.timestamp, 0, 1, record.value, record.value, record.value, record.value, record.value, record.value};
+        return forward->callback(point, forward->context);
+    }, &forward);
+}
+
+uint32_t GlucoseLog::import_json(const char *path){
+
+    // "/2025-03-14.json" -> 20250314, the segment of the file name (written in local time)
+    const char *name = strrchr(path, '/');
+    name = (name != NULL) ? name + 1 : path;
+    unsigned year, month, mday;
+    if(sscanf(name, "%4u-%2u-%2u.json", &year, &month, &mday) != 3){
+        return 0;
+    }
+    uint32_t day = year * 10000 + month * 100 + mday;
+
+    File json = LittleFS.open(path, FILE_READ);
+    if(!json){
+        return 0;
+    }
+    std::vector<GlucoseRecord> records;
+    GlucoseJsonListener listener(records);
+    JsonStreamParser parser(listener);
+    uint8_t status = parser.parse(json);
+    json.close();
+    if(status != JSONSTREAM_DONE){
+        logger.err("glucose log: %s not imported (parse error after %d bytes)", path, parser.bytes());
+        return 0;
+    }
+
+    std::sort(records.begin(), records.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp < b.timestamp; });
+    records.erase(std::unique(records.begin(), records.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp == b.timestamp; }), records.end());
+    for(GlucoseRecord &record : records){
+        seal(record);
+    }
+
+    // a segment of that day exists if a previous import was interrupted before the JSON file was removed
+    char segment[GLUCOSELOG_PATH_SIZE];
+    segment_path(day, segment);
+    if(!LittleFS.exists(segment) && !records.empty()){
+        if(!write_segment(day, records)){
+            logger.err("glucose log: import of %s failed", path);
+            return 0;
+        }
+        stats.segments++;
+
+        GlucoseDaySummary summary = {};
+        summary.day = day;
+        GlucoseHourRollup hour = {};
+        std::vector<GlucoseHourRollup> finished;
+        for(const GlucoseRecord &record : records){
+            summary_add(summary, record.value);
+            hour_add(hour, finished, record);
+        }
+        if(day > _last_day){
+            // newest segment now, later appends continue behind it
+            if(_today.count > 0){
+                store_summary(_today);
+            }
+            if(_hour.count > 0){
+                finished.insert(finished.begin(), _hour);
+            }
+            _today = summary;
+            _hour = hour;
+            _last_day = day;
+            _last_timestamp = records.back().timestamp;
+        }else{
+            store_summary(summary);
+            finished.push_back(hour);
+        }
+        // without hours.bin, begin() builds it from all segments later
+        if(_hours_complete && !finished.empty()){
+            store_hours(finished.data(), finished.size());
+        }
+        if(_agp_ready){
+            for(const GlucoseRecord &record : records){
+                agp_feed(record.timestamp, record.value);
+            }
+        }
+    }
+
+    LittleFS.remove(path);
+    stats.imported_files++;
+    stats.imported_records += records.size();
+    logger.notice("glucose log: %s imported (%d records)", path, records.size());
+    return records.size();
+}
+
+bool GlucoseLog::backfill(const uint32_t *timestamps, const uint16_t *values, size_t count){
+
+    std::vector<GlucoseRecord> points;
+    points.reserve(count);
+    for(size_t i = 0; i < count; i++){
+        if(timestamps[i] != 0 && values[i] != 0 && values[i] <= GLUCOSELOG_MAX_VALUE){
+            points.push_back({timestamps[i], values[i], GLUCOSELOG_FLAG_BACKFILL, 0});
+        }
+    }
+    if(points.empty()){
+        return false;
+    }
+    std::sort(points.begin(), points.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp < b.timestamp; });
+    points.erase(std::unique(points.begin(), points.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp == b.timestamp; }), points.end());
+
+    // without the flush task (setup, tools) merged right away
+    if(_task == NULL){
+        if(!lock(0)){
+            return false;
+        }
+        merge_history(points);
+        unlock();
+        return true;
+    }
+
+    // flash reads and writes in the flush task, a newer history replaces one not merged yet
+    size_t first = (points.size() > GLUCOSELOG_HISTORY_RECORDS) ? points.size() - GLUCOSELOG_HISTORY_RECORDS : 0;
+    portENTER_CRITICAL(&history_mux);
+    _history_count = points.size() - first;
+    memcpy(_history, points.data() + first, _history_count * sizeof(GlucoseRecord));
+    portEXIT_CRITICAL(&history_mux);
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+// history handed over by backfill() (flush task)
+void GlucoseLog::merge_pending_history(void){
+
+    std::vector<GlucoseRecord> points(GLUCOSELOG_HISTORY_RECORDS);
+    portENTER_CRITICAL(&history_mux);
+    uint16_t count = _history_count;
+    memcpy(points.data(), _history, count * sizeof(GlucoseRecord));
+    _history_count = 0;
+    portEXIT_CRITICAL(&history_mux);
+    points.resize(count);
+
+    if(count > 0 && lock()){
+        merge_history(points);
+        unlock();
+    }
+}
+
+// sorted history, flush task or no flush task: skips known points, then one write per segment
+size_t GlucoseLog::merge_history(std::vector<GlucoseRecord> &points){
+
+    // stored and staged records around the history (index and journal, a few hundred bytes)
+    std::vector<uint32_t> known;
+    uint32_t from = points.front().timestamp > GLUCOSELOG_BACKFILL_NEAR ? points.front().timestamp - GLUCOSELOG_BACKFILL_NEAR : 0;
+    uint32_t to = points.back().timestamp + GLUCOSELOG_BACKFILL_NEAR;
+    range(from, to, [](const GlucoseRecord &record, void *context){
+        ((std::vector<uint32_t> *)context)->push_back(record.timestamp);
+        return true;
+    }, &known);
+
+    std::vector<GlucoseRecord> stored;
+    std::vector<GlucoseRecord> staged;
+    for(GlucoseRecord &point : points){
+        auto it = std::lower_bound(known.begin(), known.end(), point.timestamp - std::min(point.timestamp, (uint32_t)GLUCOSELOG_BACKFILL_NEAR));
+        if(it != known.end() && *it <= point.timestamp + GLUCOSELOG_BACKFILL_NEAR){
+            continue;
+        }
+        seal(point);
+        if(point.timestamp <= _last_timestamp){
+            stored.push_back(point);
+        }else{
+            staged.push_back(point);
+        }
+    }
+
+    bool result = (stored.empty() || backfill_stored(stored)) &&
+                  (staged.empty() || backfill_staged(staged));
+
+    size_t added = result ? stored.size() + staged.size() : 0;
+    if(added > 0){
+        stats.backfilled += added;
+        logger.notice("glucose log: %d records filled in from the history (%d older, %d newer)", added, stored.size(), staged.size());
+    }
+    return added;
+}
+
+// sorted records older than the newest stored one: one rewrite per segment, then the derived data
+bool GlucoseLog::backfill_stored(const std::vector<GlucoseRecord> &records){
+
+    std::vector<uint32_t> hours;
+    size_t start = 0;
+    while(start < records.size()){
+        uint32_t day = day_of(records[start].timestamp);
+        size_t end = start + 1;
+        while(end < records.size() && day_of(records[end].timestamp) == day){
+            end++;
+        }
+
+        // archived months are not rewritten (compact() only archives finished months)
+        bool segment = std::binary_search(_segments.begin(), _segments.end(), day);
+        if(!segment && std::binary_search(_archives.begin(), _archives.end(), day / 100)){
+            logger.debug("glucose log: day %d is archived, %d history points skipped", day, end - start);
+            start = end;
+            continue;
+        }
+
+        std::vector<GlucoseRecord> merged;
+        if(segment){
+            char path[GLUCOSELOG_PATH_SIZE];
+            segment_path(day, path);
+            read_segment(path, [](const GlucoseRecord &record, void *context){
+                ((std::vector<GlucoseRecord> *)context)->push_back(record);
+                return true;
+            }, &merged);
+        }
+        size_t old = merged.size();
+        merged.insert(merged.end(), records.begin() + start, records.begin() + end);
+        std::inplace_merge(merged.begin(), merged.begin() + old, merged.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp < b.timestamp; });
+        if(!write_segment(day, merged)){
+            logger.err("glucose log: backfill of day %d failed", day);
+            return false;
+        }
+        stats.segments += !segment;
+        stats.backfill_rewrites++;
+        stats.payload_bytes += (end - start) * sizeof(GlucoseRecord);
+
+        // the newest day is summarized in RAM, a finished day gets a new entry in days.bin
+        if(day == _today.day){
+            for(size_t i = start; i < end; i++){
+                summary_add(_today, records[i].value);
+            }
+        }else{
+            GlucoseDaySummary summary = {};
+            summary.day = day;
+            for(const GlucoseRecord &record : merged){
+                summary_add(summary, record.value);
+            }
+            store_summary(summary);
+        }
+
+        for(size_t i = start; i < end; i++){
+            uint32_t hour = records[i].timestamp - records[i].timestamp % 3600;
+            if(hours.empty() || hours.back() != hour){
+                hours.push_back(hour);
+            }
+            if(_agp_ready){
+                agp_feed(records[i].timestamp, records[i].value);
+            }
+        }
+        start = end;
+    }
+
+    // hours touched: rollups again from the stored records (an hour can span two local days)
+    std::vector<GlucoseHourRollup> finished;
+    for(uint32_t start_hour : hours){
+        GlucoseHourRollup hour = {};
+        std::vector<GlucoseHourRollup> unused;
+        struct Rollup {
+            GlucoseHourRollup &hour;
+            std::vector<GlucoseHourRollup> &finished;
+        } rollup = {hour, unused};
+        range(start_hour, std::min(start_hour + 3599, _last_timestamp), [](const GlucoseRecord &record, void *context){
+            Rollup *rollup = (Rollup *)context;
+            hour_add(rollup->hour, rollup->finished, record);
+            return true;
+        }, &rollup);
+        if(start_hour == _hour.hour){
+            _hour = hour;
+        }else if(hour.count > 0){
+            finished.push_back(hour);
+        }
+    }
+    if(_hours_complete && !finished.empty()){
+        store_hours(finished.data(), finished.size());
+    }
+    return true;
+}
+
+// sorted records newer than the newest stored one: merged into the journal, written at once if it does not fit
+bool GlucoseLog::backfill_staged(const std::vector<GlucoseRecord> &records){
+
+    GlucoseRecord journaled[GLUCOSELOG_JOURNAL_RECORDS];
+    portENTER_CRITICAL(&journal_mux);
+    uint16_t count = journal.count;
+    memcpy(journaled, journal.records, count * sizeof(GlucoseRecord));
+    portEXIT_CRITICAL(&journal_mux);
+
+    std::vector<GlucoseRecord> merged(journaled, journaled + count);
+    merged.insert(merged.end(), records.begin(), records.end());
+    std::inplace_merge(merged.begin(), merged.begin() + count, merged.end(), [](const GlucoseRecord &a, const GlucoseRecord &b){ return a.timestamp < b.timestamp; });
+
+    if(_task != NULL && merged.size() <= GLUCOSELOG_JOURNAL_RECORDS){
+        // flush task: flush() runs after this, append() only adds newer records at the end
+        portENTER_CRITICAL(&journal_mux);
+        bool result = (journal.count == count);
+        if(result){
+            memcpy(journal.records, merged.data(), merged.size() * sizeof(GlucoseRecord));
+            journal.count = merged.size();
+            journal_seal();
+        }
+        portEXIT_CRITICAL(&journal_mux);
+        if(result){
+            _staged_timestamp = std::max(_staged_timestamp, merged.back().timestamp);
+            return true;
+        }
+    }
+
+    // longer gap: journal and history in one append per day
+    if(!commit(merged.data(), merged.size(), true)){
+        return false;
+    }
+    stats.flushes += (count > 0);
+    portENTER_CRITICAL(&journal_mux);
+    journal.count -= count;
+    memmove(journal.records, journal.records + count, journal.count * sizeof(GlucoseRecord));
+    journal_seal();
+    portEXIT_CRITICAL(&journal_mux);
+    return true;
+}
+
+bool GlucoseLog::statistics(uint16_t days, GlucoseStatistics &result, uint32_t end_day) const {
+
+    result = {};
+    if(days == 0){
+        return false;
+    }
+    if(end_day == 0){
+        end_day = day_of(time(NULL));
+    }
+    uint32_t first_day = add_days(end_day, -(int32_t)(days - 1));
+
+    uint32_t tir[GLUCOSELOG_TIR_BINS] = {0};
+    uint64_t sum = 0;
+    uint64_t sum_squares = 0;
+    auto add = [&](const GlucoseDaySummary &summary){
+        if(summary.count == 0 || summary.day < first_day || summary.day > end_day) return;
+        if(result.count == 0 || summary.min < result.min) result.min = summary.min;
+        if(summary.max > result.max) result.max = summary.max;
+        result.days++;
+        result.count += summary.count;
+        sum += summary.sum;
+        sum_squares += summary.sum_squares;
+        for(uint8_t bin = 0; bin < GLUCOSELOG_TIR_BINS; bin++){
+            tir[bin] += summary.tir[bin];
+        }
+    };
+    for(const GlucoseDaySummary &summary : _days){
+        add(summary);
+    }
+    add(_today);
+
+    if(result.count == 0){
+        return false;
+    }
+
+    // population standard deviation like HBA1C::calculate_standard_deviation()
+    double mean = (double)sum / result.count;
+    double variance = (double)sum_squares / result.count - mean * mean;
+    result.mean = mean;
+    result.sd = (variance > 0) ? sqrt(variance) : 0;
+    result.cv = (mean > 0) ? result.sd / mean * 100.0 : 0;
+    result.gmi = 3.31 + 0.02392 * mean;
+    for(uint8_t bin = 0; bin < GLUCOSELOG_TIR_BINS; bin++){
+        result.tir[bin] = tir[bin] * 100.0f / result.count;
+    }
+    return true;
+}
+
+const GlucoseDaySummary *GlucoseLog::summary(uint32_t day) const {
+
+    if(_today.count > 0 && _today.day == day){
+        return &_today;
+    }
+    auto it = std::lower_bound(_days.begin(), _days.end(), day, [](const GlucoseDaySummary &summary, uint32_t day){ return summary.day < day; });
+    return (it != _days.end() && it->day == day) ? &(*it) : NULL;
+}
+
+uint32_t GlucoseLog::day_time(uint32_t day){
+
+    struct tm timeinfo = {};
+    timeinfo.tm_year = day / 10000 - 1900;
+    timeinfo.tm_mon  = (day / 100) % 100 - 1;
+    timeinfo.tm_mday = day % 100;
+    timeinfo.tm_isdst = -1;
+    return mktime(&timeinfo);
+}
+
+uint32_t GlucoseLog::add_days(uint32_t day, int32_t delta){
+
+    // noon: a DST change can not move the date
+    struct tm timeinfo = {};
+    timeinfo.tm_year = day / 10000 - 1900;
+    timeinfo.tm_mon  = (day / 100) % 100 - 1;
+    timeinfo.tm_mday = day % 100 + delta;
+    timeinfo.tm_hour = 12;
+    timeinfo.tm_isdst = -1;
+    mktime(&timeinfo);
+    return (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+}
+
+uint32_t GlucoseLog::day_of(uint32_t timestamp){
+
+    time_t t = timestamp;
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    return (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+}
+
+void GlucoseLog::segment_path(uint32_t day, char *path){
+
+    snprintf(path, GLUCOSELOG_PATH_SIZE, GLUCOSELOG_DIR "/%08u.log", (unsigned)day);
+}
+
+uint8_t GlucoseLog::crc8(const uint8_t *data, size_t len, uint8_t crc){
+
+    while(len--){
+        crc ^= *data++;
+        for(uint8_t bit = 0; bit < 8; bit++){
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint32_t GlucoseLog::write_amplification(void) const {
+
+    return stats.payload_bytes ? (uint32_t)((uint64_t)stats.written_bytes * 100 / stats.payload_bytes) : 0;
+}
+
+// segment of a day for appending, a new segment gets its header first
+bool GlucoseLog::open_segment(uint32_t day, File &file){
+
+    char path[GLUCOSELOG_PATH_SIZE];
+    segment_path(day, path);
+    bool exists = LittleFS.exists(path);
+
+    file = LittleFS.open(path, FILE_APPEND);
+    if(!file){
+        logger.err("glucose log: %s can not be opened", path);
+        return false;
+    }
+    if(exists){
+        return true;
+    }
+
+    GlucoseLogHeader header = {GLUCOSELOG_MAGIC, day, (uint32_t)time(NULL), GLUCOSELOG_VERSION, sizeof(GlucoseRecord), 0, 0};
+    header.crc = crc8((const uint8_t *)&header, sizeof(header) - 1);
+    size_t written = file.write((const uint8_t *)&header, sizeof(header));
+    stats.written_bytes += written;
+    if(written != sizeof(header)){
+        file.close();
+        LittleFS.remove(path);
+        return false;
+    }
+    stats.segments++;
+    manifest_insert(_segments, day);
+    logger.debug("glucose log: new segment %s", path);
+    return true;
+}
+
+// sorted records as the whole segment of a day, the rename replaces an existing one in one step
+bool GlucoseLog::write_segment(uint32_t day, const std::vector<GlucoseRecord> &records){
+
+    char path[GLUCOSELOG_PATH_SIZE];
+    segment_path(day, path);
+    File file = LittleFS.open(GLUCOSELOG_TMP_PATH, FILE_WRITE);
+    GlucoseLogHeader header = {GLUCOSELOG_MAGIC, day, records.front().timestamp, GLUCOSELOG_VERSION, sizeof(GlucoseRecord), 0, 0};
+    header.crc = crc8((const uint8_t *)&header, sizeof(header) - 1);
+    size_t written = file ? file.write((const uint8_t *)&header, sizeof(header)) : 0;
+    bool result = written == sizeof(header) && write_records(file, records.data(), records.size());
+    stats.written_bytes += written;
+    file.close();
+    if(!result || !LittleFS.rename(GLUCOSELOG_TMP_PATH, path)){
+        LittleFS.remove(GLUCOSELOG_TMP_PATH);
+        return false;
+    }
+    invalidate_index(day);
+    manifest_insert(_segments, day);
+    return true;
+}
+
+bool GlucoseLog::write_records(File &file, const GlucoseRecord *records, size_t count){
+
+    size_t bytes = count * sizeof(GlucoseRecord);
+    size_t written = file.write((const uint8_t *)records, bytes);
+    stats.written_bytes += written;
+    return written == bytes;
+}
+
+// interrupted append: incomplete last record, wrong CRC or timestamp order -> keep the valid records
+bool GlucoseLog::recover(const char *path){
+
+    File file = LittleFS.open(path, FILE_READ);
+    if(!file){
+        return false;
+    }
+    size_t size = file.size();
+
+    GlucoseLogHeader header;
+    if(!read_header(file, header)){
+        file.close();
+        logger.err("glucose log: %s has no valid header -> removed", path);
+        LittleFS.remove(path);
+        invalidate_index(header.day);
+        stats.repaired++;
+        return false;
+    }
+
+    uint32_t count = 0;
+    uint32_t last = 0;
+    GlucoseRecord record;
+    while(file.read((uint8_t *)&record, sizeof(record)) == sizeof(record) && valid(record) && record.timestamp > last){
+        last = record.timestamp;
+        count++;
+    }
+
+    size_t valid_size = sizeof(header) + count * sizeof(GlucoseRecord);
+    if(valid_size != size){
+        // copy the valid part, the rename replaces the segment in one step
+        File tmp = LittleFS.open(GLUCOSELOG_TMP_PATH, FILE_WRITE);
+        bool result = (bool)tmp && file.seek(0);
+        uint8_t buffer[256];
+        for(size_t copied = 0; result && copied < valid_size; ){
+            size_t n = file.read(buffer, std::min(sizeof(buffer), valid_size - copied));
+            size_t written = (n > 0) ? tmp.write(buffer, n) : 0;
+            stats.written_bytes += written;
+            result = (n > 0 && written == n);
+            copied += n;
+        }
+        tmp.close();
+        file.close();
+        if(!result || !LittleFS.rename(GLUCOSELOG_TMP_PATH, path)){
+            logger.err("glucose log: repair of %s failed", path);
+            LittleFS.remove(GLUCOSELOG_TMP_PATH);
+            return false;
+        }
+        invalidate_index(header.day);
+        uint32_t dropped = (size - valid_size + sizeof(GlucoseRecord) - 1) / sizeof(GlucoseRecord);
+        stats.repaired++;
+        stats.dropped += dropped;
+        logger.warning("glucose log: %s repaired, %d records kept, %d dropped", path, count, dropped);
+    }else{
+        file.close();
+    }
+
+    _last_timestamp = last;
+    _last_day = header.day;
+    return true;
+}
+
+// JSON day files of older firmware versions in the LittleFS root
+void GlucoseLog::import_all_json(void){
+
+    std::vector<String> files;
+    File root = LittleFS.open("/");
+    for(File file = root.openNextFile(); file; file = root.openNextFile()){
+        unsigned year, month, mday;
+        if(sscanf(file.name(), "%4u-%2u-%2u.json", &year, &month, &mday) == 3){
+            files.push_back(String("/") + file.name());
+        }
+    }
+    root.close();
+
+    for(const String &path : files){
+        import_json(path.c_str());
+    }
+}
+
+// days.bin -> _days, a torn or corrupt entry is removed by rewriting the file
+void GlucoseLog::load_summaries(void){
+
+    _days.clear();
+    _days.reserve(GLUCOSELOG_SUMMARY_DAYS);
+
+    File file = LittleFS.open(GLUCOSELOG_SUMMARY_PATH, FILE_READ);
+    if(!file){
+        return;
+    }
+    bool clean = (file.size() % sizeof(GlucoseDaySummary)) == 0;
+    GlucoseDaySummary summary;
+    while(file.read((uint8_t *)&summary, sizeof(summary)) == sizeof(summary)){
+        if(summary.day != 0 && summary.crc == crc8((const uint8_t *)&summary, sizeof(summary) - 1)){
+            keep_summary(summary);
+        }else{
+            clean = false;
+        }
+    }
+
+    if(!clean){
+        File tmp = LittleFS.open(GLUCOSELOG_SUMMARY_TMP, FILE_WRITE);
+        bool result = (bool)tmp && file.seek(0);
+        while(result && file.read((uint8_t *)&summary, sizeof(summary)) == sizeof(summary)){
+            if(summary.day != 0 && summary.crc == crc8((const uint8_t *)&summary, sizeof(summary) - 1)){
+                size_t written = tmp.write((const uint8_t *)&summary, sizeof(summary));
+                stats.written_bytes += written;
+                result = (written == sizeof(summary));
+            }
+        }
+        tmp.close();
+        file.close();
+        if(!result || !LittleFS.rename(GLUCOSELOG_SUMMARY_TMP, GLUCOSELOG_SUMMARY_PATH)){
+            logger.err("glucose log: repair of %s failed", GLUCOSELOG_SUMMARY_PATH);
+            LittleFS.remove(GLUCOSELOG_SUMMARY_TMP);
+            return;
+        }
+        stats.repaired++;
+        logger.warning("glucose log: %s repaired", GLUCOSELOG_SUMMARY_PATH);
+        return;
+    }
+    file.close();
+}
+
+// summaries missing after a reset (or older versions): recompute from the segments
+void GlucoseLog::rebuild_summaries(void){
+
+    _today = {};
+
+    // archived days had their summary before the segment was archived
+    std::vector<uint32_t> missing;
+    for(uint32_t day : _segments){
+        if(day == _last_day) continue;
+        bool in_range = _days.size() < GLUCOSELOG_SUMMARY_DAYS || day > _days.front().day;
+        if(in_range && summary(day) == NULL){
+            missing.push_back(day);
+        }
+    }
+
+    for(uint32_t day : missing){
+        GlucoseDaySummary entry;
+        if(summarize_segment(day, entry)){
+            store_summary(entry);
+        }
+    }
+
+    // the newest day is kept in RAM only, a stale copy in days.bin is replaced when the day is finished
+    if(_last_day != 0){
+        auto it = std::lower_bound(_days.begin(), _days.end(), _last_day, [](const GlucoseDaySummary &summary, uint32_t day){ return summary.day < day; });
+        if(it != _days.end() && it->day == _last_day){
+            _days.erase(it);
+        }
+        summarize_segment(_last_day, _today);
+    }
+    if(!missing.empty()){
+        logger.notice("glucose log: %d day summaries rebuilt", missing.size());
+    }
+}
+
+bool GlucoseLog::summarize_segment(uint32_t day, GlucoseDaySummary &summary){
+
+    char path[GLUCOSELOG_PATH_SIZE];
+    segment_path(day, path);
+    summary = {};
+    summary.day = day;
+    read_segment(path, [](const GlucoseRecord &record, void *context){
+        summary_add(*(GlucoseDaySummary *)context, record.value);
+        return true;
+    }, &summary);
+    return summary.count > 0;
+}
+
+// append a finished day to days.bin
+void GlucoseLog::store_summary(GlucoseDaySummary &summary){
+
+    summary.crc = crc8((const uint8_t *)&summary, sizeof(summary) - 1);
+    File file = LittleFS.open(GLUCOSELOG_SUMMARY_PATH, FILE_APPEND);
+    size_t written = file ? file.write((const uint8_t *)&summary, sizeof(summary)) : 0;
+    file.close();
+    stats.written_bytes += written;
+    if(written != sizeof(summary)){
+        logger.err("glucose log: summary of day %d not stored", summary.day);
+    }else{
+        stats.summaries++;
+    }
+    keep_summary(summary);
+}
+
+// sorted by day, a later entry of the same day replaces the earlier one
+void GlucoseLog::keep_summary(const GlucoseDaySummary &summary){
+
+    auto it = std::lower_bound(_days.begin(), _days.end(), summary.day, [](const GlucoseDaySummary &entry, uint32_t day){ return entry.day < day; });
+    if(it != _days.end() && it->day == summary.day){
+        *it = summary;
+        return;
+    }
+    _days.insert(it, summary);
+    if(_days.size() > GLUCOSELOG_SUMMARY_DAYS){
+        _days.erase(_days.begin());
+    }
+}
+
+void GlucoseLog::summary_add(GlucoseDaySummary &summary, uint16_t value){
+
+    if(summary.count == 0 || value < summary.min) summary.min = value;
+    if(value > summary.max) summary.max = value;
+    summary.count++;
+    summary.sum += value;
+    summary.sum_squares += (uint32_t)value * value;
+
+    uint8_t bin = (value < GLUCOSELOG_TIR_VERY_LOW)  ? 0 :
+                  (value < GLUCOSELOG_TIR_LOW)       ? 1 :
+                  (value <= GLUCOSELOG_TIR_HIGH)     ? 2 :
+                  (value <= GLUCOSELOG_TIR_VERY_HIGH) ? 3 : 4;
+    summary.tir[bin]++;
+    summary.sketch[sketch_bucket(value)]++;
+}
+
+// newest hour of hours.bin, a torn tail is cut off by copying the complete entries
+void GlucoseLog::load_hours(void){
+
+    _hours_last = 0;
+    _hours_complete = false;
+    _hour = {};
+
+    File file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_READ);
+    if(!file){
+        return;
+    }
+    size_t size = file.size();
+    size_t entries = size / sizeof(GlucoseHourRollup);
+
+    if(size % sizeof(GlucoseHourRollup) != 0){
+        File tmp = LittleFS.open(GLUCOSELOG_HOURS_TMP, FILE_WRITE);
+        bool result = (bool)tmp;
+        GlucoseHourRollup hour;
+        for(size_t i = 0; result && i < entries; i++){
+            size_t written = (file.read((uint8_t *)&hour, sizeof(hour)) == sizeof(hour)) ? tmp.write((const uint8_t *)&hour, sizeof(hour)) : 0;
+            stats.written_bytes += written;
+            result = (written == sizeof(hour));
+        }
+        tmp.close();
+        file.close();
+        if(!result || !LittleFS.rename(GLUCOSELOG_HOURS_TMP, GLUCOSELOG_HOURS_PATH)){
+            logger.err("glucose log: repair of %s failed", GLUCOSELOG_HOURS_PATH);
+            LittleFS.remove(GLUCOSELOG_HOURS_TMP);
+            return;
+        }
+        stats.repaired++;
+        logger.warning("glucose log: %s repaired", GLUCOSELOG_HOURS_PATH);
+        file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_READ);
+    }
+
+    GlucoseHourRollup hour;
+    if(entries > 0 && file.seek((entries - 1) * sizeof(hour)) && file.read((uint8_t *)&hour, sizeof(hour)) == sizeof(hour)){
+        _hours_last = hour.hour;
+        _hours_complete = true;
+    }
+    file.close();
+}
+
+// hours after the newest stored one (reset), or all hours if hours.bin is new
+void GlucoseLog::rebuild_hours(void){
+
+    struct Builder {
+        GlucoseHourRollup hour;
+        std::vector<GlucoseHourRollup> finished;
+    } builder = {};
+    auto add = [](const GlucoseRecord &record, void *context){
+        Builder *builder = (Builder *)context;
+        hour_add(builder->hour, builder->finished, record);
+        return true;
+    };
+
+    if(!_hours_complete){
+        // written per archive and segment, the RAM use does not grow with the history
+        for(uint32_t month : _archives){
+            bool done = false;
+            archive_range(month, 0, UINT32_MAX, add, &builder, done);
+            if(!builder.finished.empty()){
+                store_hours(builder.finished.data(), builder.finished.size());
+                builder.finished.clear();
+            }
+        }
+        std::vector<uint32_t> days = _segments;
+        for(uint32_t day : days){
+            char path[GLUCOSELOG_PATH_SIZE];
+            segment_path(day, path);
+            read_segment(path, add, &builder);
+            if(!builder.finished.empty()){
+                store_hours(builder.finished.data(), builder.finished.size());
+                builder.finished.clear();
+            }
+        }
+        if(!days.empty() || !_archives.empty()){
+            logger.notice("glucose log: %s built from %d segments and %d archives", GLUCOSELOG_HOURS_PATH, days.size(), _archives.size());
+        }
+    }else if(_last_timestamp >= _hours_last + 3600){
+        range(_hours_last + 3600, _last_timestamp, add, &builder);
+        if(!builder.finished.empty()){
+            store_hours(builder.finished.data(), builder.finished.size());
+        }
+    }
+
+    _hour = builder.hour;
+    _hours_complete = true;
+}
+
+// sorted hours: appended if newer than hours.bin, merged otherwise (imports of older days)
+void GlucoseLog::store_hours(GlucoseHourRollup *hours, size_t count){
+
+    for(size_t i = 0; i < count; i++){
+        hours[i].crc = crc8((const uint8_t *)&hours[i], sizeof(GlucoseHourRollup) - 1);
+    }
+    if(hours[0].hour <= _hours_last){
+        merge_hours(hours, count);
+        return;
+    }
+
+    File file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_APPEND);
+    size_t bytes = count * sizeof(GlucoseHourRollup);
+    size_t written = file ? file.write((const uint8_t *)hours, bytes) : 0;
+    file.close();
+    stats.written_bytes += written;
+    if(written != bytes){
+        logger.err("glucose log: %s append failed", GLUCOSELOG_HOURS_PATH);
+        return;
+    }
+    stats.hours += count;
+    _hours_last = hours[count - 1].hour;
+}
+
+void GlucoseLog::merge_hours(const GlucoseHourRollup *hours, size_t count){
+
+    File file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_READ);
+    File tmp = LittleFS.open(GLUCOSELOG_HOURS_TMP, FILE_WRITE);
+    bool result = (bool)tmp;
+    size_t i = 0;
+    GlucoseHourRollup hour;
+    auto write = [&](const GlucoseHourRollup &entry){
+        size_t written = tmp.write((const uint8_t *)&entry, sizeof(entry));
+        stats.written_bytes += written;
+        result = result && (written == sizeof(entry));
+    };
+    while(result && file && file.read((uint8_t *)&hour, sizeof(hour)) == sizeof(hour)){
+        while(i < count && hours[i].hour < hour.hour){
+            write(hours[i++]);
+        }
+        if(i < count && hours[i].hour == hour.hour){
+            write(hours[i++]);      // new rollup of the same hour replaces the stored one
+        }else{
+            write(hour);
+        }
+    }
+    while(result && i < count){
+        write(hours[i++]);
+    }
+    file.close();
+    tmp.close();
+    if(!result || !LittleFS.rename(GLUCOSELOG_HOURS_TMP, GLUCOSELOG_HOURS_PATH)){
+        logger.err("glucose log: merge into %s failed", GLUCOSELOG_HOURS_PATH);
+        LittleFS.remove(GLUCOSELOG_HOURS_TMP);
+        return;
+    }
+    stats.hours += count;
+    _hours_last = std::max(_hours_last, hours[count - 1].hour);
+}
+
+// hour points from hours.bin (binary search by seek) and the current hour
+uint32_t GlucoseLog::hours_range(uint32_t from, uint32_t to, GlucosePointCallback callback, void *context){
+
+    auto emit = [&](const GlucoseHourRollup &hour){
+        GlucosePoint point = {hour.hour, 3600, hour.count, hour.min, hour.max, (uint16_t)((hour.sum + hour.count / 2) / hour.count),
+                              sketch_percentile(hour.sketch, hour.count, hour.min, hour.max, 10),
+                              sketch_percentile(hour.sketch, hour.count, hour.min, hour.max, 50),
+                              sketch_percentile(hour.sketch, hour.count, hour.min, hour.max, 90)};
+        return callback(point, context);
+    };
+
+    uint32_t first = from - from % 3600;
+    uint32_t count = 0;
+    bool done = false;
+    stats.range_queries++;
+
+    File file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_READ);
+    if(file){
+        size_t low = 0;
+        size_t high = file.size() / sizeof(GlucoseHourRollup);
+        GlucoseHourRollup hour;
+        while(low < high){
+            size_t middle = (low + high) / 2;
+            file.seek(middle * sizeof(hour));
+            file.read((uint8_t *)&hour, sizeof(hour));
+            stats.range_read_bytes += sizeof(hour);
+            if(hour.hour < first) low = middle + 1;
+            else high = middle;
+        }
+        file.seek(low * sizeof(hour));
+        while(!done && file.read((uint8_t *)&hour, sizeof(hour)) == sizeof(hour)){
+            stats.range_read_bytes += sizeof(hour);
+            if(hour.hour > to){
+                done = true;
+            }else if(hour.count > 0 && hour.crc == crc8((const uint8_t *)&hour, sizeof(hour) - 1)){
+                count++;
+                done = !emit(hour);
+            }
+        }
+        file.close();
+    }
+
+    if(!done && _hour.count > 0 && _hour.hour >= first && _hour.hour <= to && _hour.hour > _hours_last){
+        count++;
+        emit(_hour);
+    }
+    return count;
+}
+
+// saved histograms + values since the save, or built from the segments of the window
+void GlucoseLog::agp_begin(bool rebuild){
+
+    auto feed = [](const GlucoseRecord &record, void *context){
+        ((GlucoseLog *)context)->agp_feed(record.timestamp, record.value);
+        return true;
+    };
+
+    if(_last_day == 0){
+        agp.reset(0);
+        _agp_ready = true;
+        return;
+    }
+
+    uint32_t first_day = add_days(_last_day, -(GLUCOSEAGP_DAYS - 1));
+    bool loaded = !rebuild && agp.load() && agp.last_timestamp() <= _last_timestamp;
+    if(loaded){
+        range(agp.last_timestamp() + 1, _last_timestamp, feed, this);
+    }else{
+        agp.reset(first_day);
+        range(day_time(first_day), _last_timestamp, feed, this);
+        size_t written = agp.save();
+        stats.written_bytes += written;
+        stats.agp_saves += (written > 0);
+        logger.notice("glucose log: AGP built from %d values", agp.count());
+    }
+    _agp_ready = true;
+}
+
+// new values move the window with the first value of a day, older values of the window (imports) are added
+void GlucoseLog::agp_feed(uint32_t timestamp, uint16_t value){
+
+    uint32_t day = day_of(timestamp);
+    if(timestamp > agp.last_timestamp()){
+        uint32_t first_day = add_days(day, -(GLUCOSEAGP_DAYS - 1));
+        if(first_day > agp.first_day()){
+            agp_expire(first_day);
+        }
+        agp.add(timestamp, value);
+    }else if(day >= agp.first_day()){
+        agp.add(timestamp, value);
+    }
+}
+
+// removes the days before first_day (one segment read per day) and saves the histograms
+void GlucoseLog::agp_expire(uint32_t first_day){
+
+    uint32_t old = agp.first_day();
+    if(old == 0 || first_day > add_days(old, GLUCOSEAGP_DAYS - 1)){
+        agp.reset(first_day);
+    }else{
+        for(uint32_t day = old; day < first_day; day = add_days(day, 1)){
+            char path[GLUCOSELOG_PATH_SIZE];
+            segment_path(day, path);
+            read_segment(path, [](const GlucoseRecord &record, void *context){
+                ((GlucoseAGP *)context)->remove(record.timestamp, record.value);
+                return true;
+            }, &agp);
+        }
+        agp.set_first_day(first_day);
+    }
+
+    size_t written = agp.save();
+    stats.written_bytes += written;
+    stats.agp_saves += (written > 0);
+}
+
+// adds a record to the current hour, a finished hour is moved to the list
+bool GlucoseLog::hour_add(GlucoseHourRollup &hour, std::vector<GlucoseHourRollup> &finished, const GlucoseRecord &record){
+
+    uint32_t start = record.timestamp - record.timestamp % 3600;
+    bool next = (start != hour.hour);
+    if(next){
+        if(hour.count > 0){
+            finished.push_back(hour);
+        }
+        hour = {};
+        hour.hour = start;
+    }
+    if(hour.count == 0 || record.value < hour.min) hour.min = record.value;
+    if(record.value > hour.max) hour.max = record.value;
+    hour.count++;
+    hour.sum += record.value;
+    uint8_t bucket = sketch_bucket(record.value);
+    if(hour.sketch[bucket] < UINT8_MAX) hour.sketch[bucket]++;
+    return next;
+}
+
+bool GlucoseLog::read_header(File &file, GlucoseLogHeader &header){
+
+    return file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == GLUCOSELOG_MAGIC &&
+           header.version == GLUCOSELOG_VERSION && header.record_size == sizeof(GlucoseRecord) &&
+           header.crc == crc8((const uint8_t *)&header, sizeof(header) - 1);
+}
+
+// index of a segment, blocks appended since the last use are added (one record read per block)
+GlucoseLog::SegmentIndex &GlucoseLog::segment_index(uint32_t day, File &file){
+
+    uint32_t position = file.position();
+    uint32_t records = (file.size() - sizeof(GlucoseLogHeader)) / sizeof(GlucoseRecord);
+
+    auto it = std::find_if(_index.begin(), _index.end(), [day](const SegmentIndex &index){ return index.day == day; });
+    if(it == _index.end()){
+        if(_index.size() >= GLUCOSELOG_INDEX_SEGMENTS){
+            it = std::min_element(_index.begin(), _index.end(), [](const SegmentIndex &a, const SegmentIndex &b){ return a.used < b.used; });
+        }else{
+            it = _index.insert(_index.end(), SegmentIndex());
+        }
+        it->day = day;
+        it->records = 0;
+        it->timestamps.clear();
+    }
+    SegmentIndex &index = *it;
+    index.used = ++_index_clock;
+    if(records < index.records){
+        index.records = 0;
+        index.timestamps.clear();
+    }
+
+    for(uint32_t block = index.timestamps.size(); block * GLUCOSELOG_INDEX_STRIDE < records; block++){
+        GlucoseRecord record;
+        if(!file.seek(sizeof(GlucoseLogHeader) + block * GLUCOSELOG_INDEX_STRIDE * sizeof(GlucoseRecord)) ||
+           file.read((uint8_t *)&record, sizeof(record)) != sizeof(record) || !valid(record)){
+            break;
+        }
+        stats.range_read_bytes += sizeof(record);
+        index.timestamps.push_back(record.timestamp);
+    }
+    index.records = records;
+    file.seek(position);
+    return index;
+}
+
+void GlucoseLog::invalidate_index(uint32_t day){
+
+    _index.erase(std::remove_if(_index.begin(), _index.end(), [day](const SegmentIndex &index){ return index.day == day; }), _index.end());
+}
+
+void GlucoseLog::seal(GlucoseRecord &record){
+
+    record.crc = crc8((const uint8_t *)&record, sizeof(record) - 1);
+}
+
+bool GlucoseLog::valid(const GlucoseRecord &record){
+
+    return record.crc == crc8((const uint8_t *)&record, sizeof(record) - 1) && record.timestamp != 0;
+}
+
+void GlucoseLog::set_retention(uint16_t raw_days, uint8_t rollup_months){
+
+    _raw_days = std::max<uint16_t>(raw_days, GLUCOSELOG_SEGMENT_DAYS);
+    _rollup_months = std::max<uint8_t>(rollup_months, 1);
+}
+
+void GlucoseLog::archive_path(uint32_t month, char *path){
+
+    snprintf(path, GLUCOSELOG_PATH_SIZE, GLUCOSELOG_DIR "/%06u.arc", (unsigned)month);
+}
+
+// the only directory scan: begin() lists the segments and archives, later changes update the lists
+void GlucoseLog::scan_manifest(void){
+
+    _segments.clear();
+    _archives.clear();
+    File dir = LittleFS.open(GLUCOSELOG_DIR);
+    for(File file = dir.openNextFile(); file; file = dir.openNextFile()){
+        char *end = NULL;
+        uint32_t key = strtoul(file.name(), &end, 10);
+        if(end == NULL || key == 0) continue;
+        if(strcmp(end, ".log") == 0){
+            _segments.push_back(key);
+        }else if(strcmp(end, ".arc") == 0){
+            _archives.push_back(key);
+        }
+    }
+    dir.close();
+    std::sort(_segments.begin(), _segments.end());
+    std::sort(_archives.begin(), _archives.end());
+    logger.debug("glucose log: %d segments, %d archives", _segments.size(), _archives.size());
+}
+
+void GlucoseLog::manifest_insert(std::vector<uint32_t> &list, uint32_t key){
+
+    auto it = std::lower_bound(list.begin(), list.end(), key);
+    if(it == list.end() || *it != key){
+        list.insert(it, key);
+    }
+}
+
+void GlucoseLog::manifest_erase(std::vector<uint32_t> &list, uint32_t key){
+
+    auto it = std::lower_bound(list.begin(), list.end(), key);
+    if(it != list.end() && *it == key){
+        list.erase(it);
+    }
+}
+
+bool GlucoseLog::read_archive_header(File &file, GlucoseArchiveHeader &header){
+
+    return file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == GLUCOSELOG_ARCHIVE_MAGIC &&
+           header.version == GLUCOSELOG_ARCHIVE_VERSION && header.record_size == sizeof(GlucoseArchiveRecord) &&
+           header.crc == crc8((const uint8_t *)&header, sizeof(header) - 1) &&
+           file.size() == sizeof(header) + header.count * sizeof(GlucoseArchiveRecord);
+}
+
+// records of an archive in [from, to], done = a record after to was reached or the callback stopped
+uint32_t GlucoseLog::archive_range(uint32_t month, uint32_t from, uint32_t to, GlucoseLogCallback callback, void *context, bool &done){
+
+    char path[GLUCOSELOG_PATH_SIZE];
+    archive_path(month, path);
+    File file = LittleFS.open(path, FILE_READ);
+    GlucoseArchiveHeader header;
+    if(!file || !read_archive_header(file, header)){
+        logger.err("glucose log: %s not valid", path);
+        file.close();
+        return 0;
+    }
+    stats.range_read_bytes += sizeof(header);
+
+    // first record at or after from (binary search by seek, the records are sorted)
+    uint32_t first = (from > header.start) ? (from - header.start + 59) / 60 : 0;
+    size_t low = 0;
+    size_t high = header.count;
+    GlucoseArchiveRecord records[GLUCOSELOG_READ_RECORDS * 2];
+    while(low < high){
+        size_t middle = (low + high) / 2;
+        file.seek(sizeof(header) + middle * sizeof(GlucoseArchiveRecord));
+        file.read((uint8_t *)records, sizeof(GlucoseArchiveRecord));
+        stats.range_read_bytes += sizeof(GlucoseArchiveRecord);
+        if(records[0].minute < first) low = middle + 1;
+        else high = middle;
+    }
+    file.seek(sizeof(header) + low * sizeof(GlucoseArchiveRecord));
+
+    uint32_t count = 0;
+    while(!done){
+        size_t bytes = file.read((uint8_t *)records, sizeof(records));
+        stats.range_read_bytes += bytes;
+        size_t n = bytes / sizeof(GlucoseArchiveRecord);
+        if(n == 0) break;
+        for(size_t i = 0; i < n; i++){
+            GlucoseRecord record = {header.start + records[i].minute * 60U, (uint16_t)(records[i].value & 0x0FFF), (uint8_t)(records[i].value >> 12), 0};
+            if(record.timestamp > to){
+                done = true;
+                break;
+            }
+            seal(record);
+            if(!callback(record, context)){
+                done = true;
+                break;
+            }
+            count++;
+        }
+    }
+    file.close();
+    return count;
+}
+
+// segments of a month (and an archive of it from an interrupted run) -> one archive, then the segments are removed
+bool GlucoseLog::archive_month(uint32_t month){
+
+    struct Packer {
+        uint32_t start;
+        std::vector<GlucoseArchiveRecord> records;
+    } packer = {day_time(month * 100 + 1), {}};
+    auto pack = [](const GlucoseRecord &record, void *context){
+        Packer *packer = (Packer *)context;
+        uint32_t minute = (record.timestamp - packer->start) / 60;
+        if(record.timestamp >= packer->start && minute <= UINT16_MAX){
+            packer->records.push_back({(uint16_t)minute, (uint16_t)(record.value | (record.flags & 0x0F) << 12)});
+        }
+        return true;
+    };
+
+    char path[GLUCOSELOG_PATH_SIZE];
+    if(std::binary_search(_archives.begin(), _archives.end(), month)){
+        bool done = false;
+        archive_range(month, 0, UINT32_MAX, pack, &packer, done);
+    }
+    std::vector<uint32_t> days;
+    for(uint32_t day : _segments){
+        if(day / 100 == month){
+            days.push_back(day);
+            segment_path(day, path);
+            read_segment(path, pack, &packer);
+        }
+    }
+
+    // minute resolution: a second value in the same minute is dropped
+    std::vector<GlucoseArchiveRecord> &records = packer.records;
+    std::stable_sort(records.begin(), records.end(), [](const GlucoseArchiveRecord &a, const GlucoseArchiveRecord &b){ return a.minute < b.minute; });
+    records.erase(std::unique(records.begin(), records.end(), [](const GlucoseArchiveRecord &a, const GlucoseArchiveRecord &b){ return a.minute == b.minute; }), records.end());
+
+    GlucoseArchiveHeader header = {GLUCOSELOG_ARCHIVE_MAGIC, month, packer.start, (uint32_t)records.size(), GLUCOSELOG_ARCHIVE_VERSION, sizeof(GlucoseArchiveRecord), 0, 0};
+    header.crc = crc8((const uint8_t *)&header, sizeof(header) - 1);
+    size_t bytes = records.size() * sizeof(GlucoseArchiveRecord);
+    File file = LittleFS.open(GLUCOSELOG_TMP_PATH, FILE_WRITE);
+    size_t written = file ? file.write((const uint8_t *)&header, sizeof(header)) : 0;
+    written += (file && bytes > 0) ? file.write((const uint8_t *)records.data(), bytes) : 0;
+    file.close();
+    stats.written_bytes += written;
+
+    archive_path(month, path);
+    if(written != sizeof(header) + bytes || !LittleFS.rename(GLUCOSELOG_TMP_PATH, path)){
+        logger.err("glucose log: archive %s not written", path);
+        LittleFS.remove(GLUCOSELOG_TMP_PATH);
+        return false;
+    }
+    manifest_insert(_archives, month);
+
+    for(uint32_t day : days){
+        segment_path(day, path);
+        LittleFS.remove(path);
+        invalidate_index(day);
+        manifest_erase(_segments, day);
+    }
+    stats.archived_days += days.size();
+    stats.archived_records += records.size();
+    logger.notice("glucose log: %d segments of %06d archived (%d records, %d bytes)", days.size(), month, records.size(), written);
+    return true;
+}
+
+void GlucoseLog::compact(void){
+
+    uint32_t today = day_of(time(NULL));
+    if(today < 20200101){
+        return;     // no time yet
+    }
+
+    // finished months older than GLUCOSELOG_SEGMENT_DAYS (AGP window and range index use the segments)
+    uint32_t archive_month_limit = add_days(today, -GLUCOSELOG_SEGMENT_DAYS) / 100;
+    while(!_segments.empty() && _segments.front() / 100 < archive_month_limit && _segments.front() != _last_day){
+        if(!archive_month(_segments.front() / 100)){
+            break;
+        }
+    }
+
+    // raw retention in whole months
+    uint32_t raw_month_limit = add_days(today, -_raw_days) / 100;
+    while(!_archives.empty() && _archives.front() < raw_month_limit){
+        char path[GLUCOSELOG_PATH_SIZE];
+        archive_path(_archives.front(), path);
+        LittleFS.remove(path);
+        _archives.erase(_archives.begin());
+        stats.expired_archives++;
+        logger.notice("glucose log: %s removed (retention %d days)", path, _raw_days);
+    }
+
+    // rollup retention: first day of the month _rollup_months ago
+    uint32_t months = (today / 10000) * 12 + (today / 100 % 100 - 1) - _rollup_months;
+    uint32_t rollup_day = (months / 12) * 10000 + (months % 12 + 1) * 100 + 1;
+    prune_hours(day_time(rollup_day));
+    prune_summaries(rollup_day);
+}
+
+// hours.bin is sorted: nothing to do if the first hour is in the retention
+void GlucoseLog::prune_hours(uint32_t before){
+
+    File file = LittleFS.open(GLUCOSELOG_HOURS_PATH, FILE_READ);
+    GlucoseHourRollup hour;
+    if(!file || file.read((uint8_t *)&hour, sizeof(hour)) != sizeof(hour) || hour.hour >= before){
+        file.close();
+        return;
+    }
+
+    File tmp = LittleFS.open(GLUCOSELOG_HOURS_TMP, FILE_WRITE);
+    bool result = (bool)tmp && file.seek(0);
+    uint32_t removed = 0;
+    while(result && file.read((uint8_t *)&hour, sizeof(hour)) == sizeof(hour)){
+        if(hour.hour < before){
+            removed++;
+            continue;
+        }
+        size_t written = tmp.write((const uint8_t *)&hour, sizeof(hour));
+        stats.written_bytes += written;
+        result = (written == sizeof(hour));
+    }
+    tmp.close();
+    file.close();
+    if(!result || !LittleFS.rename(GLUCOSELOG_HOURS_TMP, GLUCOSELOG_HOURS_PATH)){
+        logger.err("glucose log: pruning of %s failed", GLUCOSELOG_HOURS_PATH);
+        LittleFS.remove(GLUCOSELOG_HOURS_TMP);
+        return;
+    }
+    stats.pruned_rollups += removed;
+    logger.notice("glucose log: %d hour rollups removed", removed);
+}
+
+// days.bin is in write order (imports of older days are appended), one read pass decides
+void GlucoseLog::prune_summaries(uint32_t before){
+
+    while(!_days.empty() && _days.front().day < before){
+        _days.erase(_days.begin());
+    }
+
+    File file = LittleFS.open(GLUCOSELOG_SUMMARY_PATH, FILE_READ);
+    if(!file){
+        return;
+    }
+    GlucoseDaySummary summary;
+    uint32_t removed = 0;
+    while(file.read((uint8_t *)&summary, sizeof(summary)) == sizeof(summary)){
+        removed += (summary.day < before);
+    }
+    if(removed == 0){
+        file.close();
+        return;
+    }
+
+    File tmp = LittleFS.open(GLUCOSELOG_SUMMARY_TMP, FILE_WRITE);
+    bool result = (bool)tmp && file.seek(0);
+    while(result && file.read((uint8_t *)&summary, sizeof(summary)) == sizeof(summary)){
+        if(summary.day < before) continue;
+        size_t written = tmp.write((const uint8_t *)&summary, sizeof(summary));
+        stats.written_bytes += written;
+        result = (written == sizeof(summary));
+    }
+    tmp.close();
+    file.close();
+    if(!result || !LittleFS.rename(GLUCOSELOG_SUMMARY_TMP, GLUCOSELOG_SUMMARY_PATH)){
+        logger.err("glucose log: pruning of %s failed", GLUCOSELOG_SUMMARY_PATH);
+        LittleFS.remove(GLUCOSELOG_SUMMARY_TMP);
+        return;
+    }
+    stats.pruned_rollups += removed;
+    logger.notice("glucose log: %d day summaries removed", removed);
+}
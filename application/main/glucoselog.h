@@ -0,0 +1,560 @@
+/**
+ * @file glucoselog.h
+ * @brief Append-only binary glucose log on LittleFS
+ *
+ * Every local day has one segment file (/glucose/YYYYMMDD.log): a 16 byte
+ * header followed by fixed-size 8 byte records in timestamp order. A new
+ * value is one append of 8 bytes, the rest of the file is never rewritten.
+ *
+ * A write interrupted by a reset leaves an incomplete or corrupt last record.
+ * begin() checks the tail of the newest segment (size, CRC, timestamp order)
+ * and copies the valid records into a new file if needed. The per-day JSON
+ * files of older versions (/YYYY-MM-DD.json) are imported once and removed.
+ *
+ * Every append also updates a summary of its day (count, sum, sum of squares,
+ * min, max, time in range bins). Finished days are appended to
+ * /glucose/days.bin, the last GLUCOSELOG_SUMMARY_DAYS days stay in RAM, so
+ * multi-day statistics need no flash reads.
+ *
+ * range() reads any time window: the records are fixed-size and sorted, a
+ * sparse index (timestamp of every GLUCOSELOG_INDEX_STRIDE-th record) of the
+ * recently used segments finds the first block, only the matching records
+ * are read.
+ *
+ * Long views use rollups instead of the raw records: finished hours
+ * (/glucose/hours.bin, sorted) and the day summaries, both with min, max,
+ * mean, count and a coarse percentile sketch. trend() picks the coarsest
+ * level that still has one point per chart pixel.
+ *
+ * agp holds the time of day percentiles of the last GLUCOSEAGP_DAYS days.
+ *
+ * After start_flush_task() append() only stages the record in a journal in
+ * RTC memory (kept over software, watchdog and brownout resets, not over a
+ * power loss). A low priority task writes the staged records with one append
+ * per segment once GLUCOSELOG_FLUSH_RECORDS are staged, a new day starts or
+ * the oldest is GLUCOSELOG_FLUSH_AGE seconds old. begin() writes what a reset
+ * left in the journal. range() includes the staged records, the summaries,
+ * rollups and AGP follow when the records are flushed.
+ *
+ * The segments and archives are listed once by begin() (manifest), range()
+ * and the rebuilds never scan the directory. Once a day compact() (flush task)
+ * moves finished months older than GLUCOSELOG_SEGMENT_DAYS into one archive
+ * per month (/glucose/YYYYMM.arc, 4 byte records with minute resolution),
+ * removes archives older than the raw retention and rollups (hours.bin,
+ * days.bin) older than the rollup retention.
+ */
+
+#ifndef GLUCOSELOG_H
+#define GLUCOSELOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <vector>
+#include <algorithm>
+#include "glucoseagp.h"
+
+/**
+ * @defgroup glucoselog_config Glucose Log Settings
+ * @{
+ */
+#define GLUCOSELOG_DIR          "/glucose"      ///< Directory of the segment files
+#define GLUCOSELOG_MAGIC        0x474F4C47      ///< "GLOG" (little endian)
+#define GLUCOSELOG_VERSION      1               ///< Segment layout version
+#define GLUCOSELOG_MAX_VALUE    1000            ///< Values above are rejected (mg/dL)
+#define GLUCOSELOG_PATH_SIZE    24              ///< "/glucose/YYYYMMDD.log" + terminator
+#define GLUCOSELOG_SUMMARY_PATH GLUCOSELOG_DIR "/days.bin"  ///< Summaries of finished days
+#define GLUCOSELOG_SUMMARY_DAYS 90              ///< Day summaries kept in RAM
+#define GLUCOSELOG_INDEX_STRIDE 32              ///< Records per sparse index entry (one read chunk)
+#define GLUCOSELOG_INDEX_SEGMENTS 8             ///< Segment indexes kept in RAM
+#define GLUCOSELOG_HOURS_PATH   GLUCOSELOG_DIR "/hours.bin" ///< Rollups of finished hours
+#define GLUCOSELOG_SKETCH_BINS  16              ///< Buckets of the percentile sketch
+#define GLUCOSELOG_JOURNAL_MAGIC 0x4C4E4A47     ///< "GJNL" (little endian)
+#define GLUCOSELOG_JOURNAL_RECORDS 64           ///< Records staged in RTC memory
+#define GLUCOSELOG_FLUSH_RECORDS 32             ///< Records per flush (256 bytes, one LittleFS program page)
+#define GLUCOSELOG_FLUSH_AGE    10800           ///< Oldest staged record is flushed after (s)
+#define GLUCOSELOG_FLUSH_CHECK  60000           ///< Flush task checks the age every (ms)
+#define GLUCOSELOG_TASK_STACK   6144            ///< Flush task stack size (compaction and history merge)
+#define GLUCOSELOG_TASK_PRIORITY 0              ///< Idle priority, flash writes only when nothing else runs
+#define GLUCOSELOG_TASK_CORE    0               ///< Network core, LVGL runs on core 1
+#define GLUCOSELOG_SEGMENT_DAYS 31              ///< Days kept as segments, older finished months are archived
+#define GLUCOSELOG_ARCHIVE_MAGIC 0x43524147     ///< "GARC" (little endian)
+#define GLUCOSELOG_ARCHIVE_VERSION 1            ///< Archive layout version
+#define GLUCOSELOG_RAW_DAYS     365             ///< Default retention of the records (segments and archives)
+#define GLUCOSELOG_ROLLUP_MONTHS 24             ///< Default retention of hours.bin and days.bin
+#define GLUCOSELOG_HISTORY_RECORDS 144          ///< History points handed to the flush task (12 h of 5 minute values)
+#define GLUCOSELOG_BACKFILL_NEAR 180            ///< Value or history point this close (s) to a stored record is the same measurement
+/** @} */
+
+/**
+ * @defgroup glucoselog_tir Time In Range Bins (mg/dL)
+ * @{
+ */
+#define GLUCOSELOG_TIR_VERY_LOW     54          ///< bin 0: below
+#define GLUCOSELOG_TIR_LOW          70          ///< bin 1: below (from VERY_LOW)
+#define GLUCOSELOG_TIR_HIGH         180         ///< bin 2: up to (in range)
+#define GLUCOSELOG_TIR_VERY_HIGH    250         ///< bin 3: up to, bin 4: above
+#define GLUCOSELOG_TIR_BINS         5
+/** @} */
+
+/**
+ * @defgroup glucoselog_level Rollup Levels
+ * @{
+ */
+#define GLUCOSELOG_LEVEL_RAW        0           ///< single records
+#define GLUCOSELOG_LEVEL_HOUR       1           ///< hours.bin
+#define GLUCOSELOG_LEVEL_DAY        2           ///< day summaries
+/** @} */
+
+/**
+ * @defgroup glucoselog_flags Record Flags
+ * @{
+ */
+#define GLUCOSELOG_FLAG_IMPORTED    0x01        ///< imported from a JSON day file
+#define GLUCOSELOG_FLAG_BACKFILL    0x02        ///< filled in from the LibreLinkUp history (/graph)
+/** @} */
+
+/**
+ * @struct GlucoseRecord
+ * @brief One measurement as stored in a segment (8 bytes)
+ */
+struct GlucoseRecord {
+    uint32_t timestamp;     ///< Unix time (UTC)
+    uint16_t value;         ///< Glucose in mg/dL
+    uint8_t flags;          ///< GLUCOSELOG_FLAG_*
+    uint8_t crc;            ///< CRC-8 of the first 7 bytes
+};
+static_assert(sizeof(GlucoseRecord) == 8, "GlucoseRecord must be 8 bytes");
+
+/**
+ * @struct GlucoseLogHeader
+ * @brief First 16 bytes of a segment
+ */
+struct GlucoseLogHeader {
+    uint32_t magic;         ///< GLUCOSELOG_MAGIC
+    uint32_t day;           ///< Local date YYYYMMDD
+    uint32_t created;       ///< Unix time of the first write
+    uint8_t version;        ///< GLUCOSELOG_VERSION
+    uint8_t record_size;    ///< sizeof(GlucoseRecord)
+    uint8_t reserved;
+    uint8_t crc;            ///< CRC-8 of the first 15 bytes
+};
+static_assert(sizeof(GlucoseLogHeader) == 16, "GlucoseLogHeader must be 16 bytes");
+
+/**
+ * @struct GlucoseJournal
+ * @brief Staged records in RTC memory (not written to flash yet)
+ */
+struct GlucoseJournal {
+    uint32_t magic;         ///< GLUCOSELOG_JOURNAL_MAGIC
+    uint16_t count;         ///< Staged records
+    uint8_t reserved;
+    uint8_t crc;            ///< CRC-8 of the first 7 bytes (records have their own)
+    GlucoseRecord records[GLUCOSELOG_JOURNAL_RECORDS];  ///< Oldest first
+};
+
+/**
+ * @struct GlucoseDaySummary
+ * @brief Aggregates of one local day, as stored in days.bin (72 bytes)
+ */
+struct GlucoseDaySummary {
+    uint32_t day;                           ///< Local date YYYYMMDD
+    uint32_t sum;                           ///< Sum of the values
+    uint64_t sum_squares;                   ///< Sum of the squared values
+    uint16_t count;                         ///< Number of values
+    uint16_t min;                           ///< Lowest value
+    uint16_t max;                           ///< Highest value
+    uint16_t tir[GLUCOSELOG_TIR_BINS];      ///< Values per time in range bin
+    uint16_t sketch[GLUCOSELOG_SKETCH_BINS];///< Values per sketch bucket
+    uint8_t reserved[7];
+    uint8_t crc;                            ///< CRC-8 of the first 71 bytes
+};
+static_assert(sizeof(GlucoseDaySummary) == 72, "GlucoseDaySummary must be 72 bytes");
+
+/**
+ * @struct GlucoseHourRollup
+ * @brief Aggregates of one hour, as stored in hours.bin (32 bytes)
+ */
+struct GlucoseHourRollup {
+    uint32_t hour;                          ///< Unix time of the hour start
+    uint32_t sum;                           ///< Sum of the values
+    uint16_t count;                         ///< Number of values
+    uint16_t min;                           ///< Lowest value
+    uint16_t max;                           ///< Highest value
+    uint8_t sketch[GLUCOSELOG_SKETCH_BINS]; ///< Values per sketch bucket
+    uint8_t reserved;
+    uint8_t crc;                            ///< CRC-8 of the first 31 bytes
+};
+static_assert(sizeof(GlucoseHourRollup) == 32, "GlucoseHourRollup must be 32 bytes");
+
+/**
+ * @struct GlucoseArchiveHeader
+ * @brief First 20 bytes of a month archive, written once (temp file + rename)
+ */
+struct GlucoseArchiveHeader {
+    uint32_t magic;         ///< GLUCOSELOG_ARCHIVE_MAGIC
+    uint32_t month;         ///< Local month YYYYMM
+    uint32_t start;         ///< Unix time of the first local midnight of the month
+    uint32_t count;         ///< Records following the header
+    uint8_t version;        ///< GLUCOSELOG_ARCHIVE_VERSION
+    uint8_t record_size;    ///< sizeof(GlucoseArchiveRecord)
+    uint8_t reserved;
+    uint8_t crc;            ///< CRC-8 of the first 19 bytes
+};
+static_assert(sizeof(GlucoseArchiveHeader) == 20, "GlucoseArchiveHeader must be 20 bytes");
+
+/**
+ * @struct GlucoseArchiveRecord
+ * @brief One measurement in a month archive (4 bytes)
+ */
+struct GlucoseArchiveRecord {
+    uint16_t minute;        ///< Minutes since GlucoseArchiveHeader::start
+    uint16_t value;         ///< Glucose in mg/dL (bits 0-11), GLUCOSELOG_FLAG_* (bits 12-15)
+};
+static_assert(sizeof(GlucoseArchiveRecord) == 4, "GlucoseArchiveRecord must be 4 bytes");
+
+/**
+ * @struct GlucosePoint
+ * @brief One point of a trend view (record, hour or day)
+ */
+struct GlucosePoint {
+    uint32_t time;                          ///< Start (Unix time)
+    uint32_t span;                          ///< Covered seconds (0 = single record)
+    uint16_t count;                         ///< Number of values
+    uint16_t min;                           ///< Lowest value
+    uint16_t max;                           ///< Highest value
+    uint16_t mean;                          ///< Mean value
+    uint16_t p10;                           ///< 10th percentile (sketch estimate)
+    uint16_t p50;                           ///< Median (sketch estimate)
+    uint16_t p90;                           ///< 90th percentile (sketch estimate)
+};
+
+/**
+ * @brief Called for every point of a trend view
+ * @return false to stop
+ */
+typedef bool (*GlucosePointCallback)(const GlucosePoint &point, void *context);
+
+/**
+ * @struct GlucoseStatistics
+ * @brief Statistics of a range of days
+ */
+struct GlucoseStatistics {
+    uint16_t days;                          ///< Days with values
+    uint32_t count;                         ///< Number of values
+    float mean;                             ///< Mean glucose (mg/dL)
+    float sd;                               ///< Standard deviation (mg/dL)
+    float cv;                               ///< Coefficient of variation (%)
+    float gmi;                              ///< Glucose management indicator (%)
+    uint16_t min;                           ///< Lowest value
+    uint16_t max;                           ///< Highest value
+    float tir[GLUCOSELOG_TIR_BINS];         ///< Percent of values per time in range bin
+};
+
+/**
+ * @brief Called for every valid record of a segment
+ * @return false to stop reading
+ */
+typedef bool (*GlucoseLogCallback)(const GlucoseRecord &record, void *context);
+
+/**
+ * @class GlucoseLog
+ * @brief Segment files with O(1) appends
+ */
+class GlucoseLog {
+public:
+    /**
+     * @brief Create the directory, import old JSON day files and repair the newest segment
+     * @return false if LittleFS is not usable
+     */
+    bool begin(void);
+
+    /**
+     * @brief Start the flush task, append() stages records from now on
+     */
+    void start_flush_task(void);
+
+    /**
+     * @brief Append one measurement to the segment of its local day
+     *
+     * A timestamp not newer than the last stored or staged one, or less
+     * than GLUCOSELOG_BACKFILL_NEAR seconds newer, is skipped (same
+     * measurement logged twice or already filled in from the history). With the flush task the record is
+     * staged in the journal, without it is written right away. A full
+     * journal (flush task starved) drops the record, the caller never
+     * waits for flash.
+     * @param timestamp Unix time of the measurement
+     * @param value Glucose in mg/dL
+     * @param flags GLUCOSELOG_FLAG_*
+     * @return true if the record was staged or written
+     */
+    bool append(uint32_t timestamp, uint16_t value, uint8_t flags = 0);
+
+    /**
+     * @brief Merge a measurement history (LibreLinkUp /graph) into the log
+     *
+     * Fills the gap a reboot or outage left. A point with a stored or staged
+     * record within GLUCOSELOG_BACKFILL_NEAR seconds is skipped. Points newer
+     * than the last stored record are staged with the journal, older ones are
+     * merged into their segment with one rewrite per day. With the flush task
+     * the caller only hands the history over (the newest
+     * GLUCOSELOG_HISTORY_RECORDS points, a newer history replaces one not
+     * merged yet), without it the history is merged right away.
+     * stats.backfilled counts the added records.
+     * @param timestamps Unix times, any order, 0 = no point
+     * @param values Glucose in mg/dL, 0 = no point
+     * @param count Number of points
+     * @return true if the history had valid points
+     */
+    bool backfill(const uint32_t *timestamps, const uint16_t *values, size_t count);
+
+    /**
+     * @brief Write the staged records now (before an OTA update, console)
+     * @return Number of records written
+     */
+    size_t flush(void);
+
+    /**
+     * @brief Records in the journal
+     */
+    uint16_t staged(void) const;
+
+    /**
+     * @brief Retention of the records and rollups (before begin(), settings)
+     * @param raw_days Records older are removed (at least GLUCOSELOG_SEGMENT_DAYS)
+     * @param rollup_months Hour rollups and day summaries older are removed
+     */
+    void set_retention(uint16_t raw_days, uint8_t rollup_months);
+
+    /**
+     * @brief Archive finished months, remove data beyond the retention (flush task, once a day)
+     */
+    void compact(void);
+
+    const std::vector<uint32_t> &segments(void) const { return _segments; }    ///< Days YYYYMMDD with a segment, sorted
+    const std::vector<uint32_t> &archives(void) const { return _archives; }    ///< Months YYYYMM with an archive, sorted
+
+    /**
+     * @brief Archive path of a local month
+     * @param month YYYYMM
+     * @param path Destination, GLUCOSELOG_PATH_SIZE bytes
+     */
+    static void archive_path(uint32_t month, char *path);
+
+    /**
+     * @brief Get exclusive access while the flush task may write (console, statistics of the UI)
+     * @param timeout_ms Maximum wait time, 0 = only if free
+     * @return true if locked
+     */
+    bool lock(uint32_t timeout_ms = 30000);
+
+    /**
+     * @brief Release the lock
+     */
+    void unlock(void);
+
+    /**
+     * @brief Read all valid records of a segment in timestamp order
+     * @param path Segment file
+     * @param callback Receiver of the records
+     * @param context Passed to the callback
+     * @return Number of records passed to the callback
+     */
+    uint32_t read_segment(const char *path, GlucoseLogCallback callback, void *context);
+
+    /**
+     * @brief Read the records of a time window in timestamp order
+     * @param from First Unix time (inclusive)
+     * @param to Last Unix time (inclusive)
+     * @param callback Receiver of the records
+     * @param context Passed to the callback
+     * @return Number of records passed to the callback
+     */
+    uint32_t range(uint32_t from, uint32_t to, GlucoseLogCallback callback, void *context);
+
+    /**
+     * @brief Points of a time window at the coarsest level with at least one point per pixel
+     * @param from First Unix time
+     * @param to Last Unix time
+     * @param pixels Chart width
+     * @param callback Receiver of the points
+     * @param context Passed to the callback
+     * @param level Destination for the used GLUCOSELOG_LEVEL_* (optional)
+     * @return Number of points passed to the callback
+     */
+    uint32_t trend(uint32_t from, uint32_t to, uint16_t pixels, GlucosePointCallback callback, void *context, uint8_t *level = NULL);
+
+    /**
+     * @brief Import one JSON day file ([{"timestamp":..,"glucose":..},...]) into the segments
+     * @param path JSON file, removed after a successful import
+     * @return Number of imported records
+     */
+    uint32_t import_json(const char *path);
+
+    /**
+     * @brief Statistics of the last days from the day summaries (no flash access)
+     * @param days Number of days including the end day
+     * @param result Destination
+     * @param end_day Last day YYYYMMDD, 0 = today
+     * @return false if there are no values in the range
+     */
+    bool statistics(uint16_t days, GlucoseStatistics &result, uint32_t end_day = 0) const;
+
+    /**
+     * @brief Summary of a day (finished days and the current day)
+     * @return NULL if the day has no summary in RAM
+     */
+    const GlucoseDaySummary *summary(uint32_t day) const;
+
+    /**
+     * @brief Local midnight of a date
+     * @param day YYYYMMDD
+     * @return Unix time
+     */
+    static uint32_t day_time(uint32_t day);
+
+    /**
+     * @brief Add days to a local date
+     * @param day YYYYMMDD
+     * @param delta Days, negative for earlier days
+     * @return YYYYMMDD
+     */
+    static uint32_t add_days(uint32_t day, int32_t delta);
+
+    /**
+     * @brief Local date YYYYMMDD of a Unix time
+     */
+    static uint32_t day_of(uint32_t timestamp);
+
+    /**
+     * @brief Segment path of a local date
+     * @param day YYYYMMDD
+     * @param path Destination, GLUCOSELOG_PATH_SIZE bytes
+     */
+    static void segment_path(uint32_t day, char *path);
+
+    /**
+     * @brief CRC-8 (polynomial 0x07)
+     * @param crc Result of the previous part for data in several parts
+     */
+    static uint8_t crc8(const uint8_t *data, size_t len, uint8_t crc = 0);
+
+    uint32_t last_timestamp(void) const { return std::max(_last_timestamp, _staged_timestamp); }   ///< Newest stored or staged record (0 = none)
+    uint32_t last_day(void) const { return _last_day; }                 ///< Day of the newest segment (0 = none)
+
+    GlucoseAGP agp;     ///< Ambulatory glucose profile of the last GLUCOSEAGP_DAYS days
+
+    /**
+     * @struct stats
+     * @brief Write counters since boot (write amplification = written_bytes / payload_bytes)
+     */
+    struct {
+        uint32_t appends = 0;           ///< Records appended
+        uint32_t skipped = 0;           ///< Appends skipped (not newer than the last record)
+        uint32_t payload_bytes = 0;     ///< Record bytes that had to be stored
+        uint32_t written_bytes = 0;     ///< Bytes written to flash (headers, repairs and imports included)
+        uint32_t segments = 0;          ///< Segments created
+        uint32_t repaired = 0;          ///< Segments repaired after an interrupted write
+        uint32_t dropped = 0;           ///< Records dropped by a repair
+        uint32_t imported_files = 0;    ///< JSON day files imported
+        uint32_t imported_records = 0;  ///< Records imported from JSON
+        uint32_t summaries = 0;         ///< Day summaries written to days.bin
+        uint32_t hours = 0;             ///< Hour rollups written to hours.bin
+        uint32_t agp_saves = 0;         ///< AGP histograms written
+        uint32_t range_queries = 0;     ///< range() calls
+        uint32_t range_read_bytes = 0;  ///< Bytes read by range() (index included)
+        uint32_t flushes = 0;           ///< Batches of staged records written
+        uint32_t replayed = 0;          ///< Records written from the journal at boot
+        uint32_t journal_full = 0;      ///< Records dropped because the journal was full
+        uint32_t archived_days = 0;     ///< Segments moved into archives
+        uint32_t archived_records = 0;  ///< Records moved into archives
+        uint32_t expired_archives = 0;  ///< Archives removed by the raw retention
+        uint32_t pruned_rollups = 0;    ///< Hour rollups and day summaries removed by the rollup retention
+        uint32_t backfilled = 0;        ///< Records added from a history
+        uint32_t backfill_rewrites = 0; ///< Segments rewritten to insert older records
+    } stats;
+
+    /**
+     * @brief Write amplification in percent (100 = every written byte is payload)
+     */
+    uint32_t write_amplification(void) const;
+
+private:
+    /**
+     * @struct SegmentIndex
+     * @brief First timestamp of every GLUCOSELOG_INDEX_STRIDE-th record of a segment
+     */
+    struct SegmentIndex {
+        uint32_t day;                       ///< Segment YYYYMMDD
+        uint32_t records;                   ///< Records covered by the index
+        uint32_t used;                      ///< LRU clock
+        std::vector<uint32_t> timestamps;   ///< Block start timestamps
+    };
+
+    bool open_segment(uint32_t day, File &file);
+    static bool read_header(File &file, GlucoseLogHeader &header);
+    SegmentIndex &segment_index(uint32_t day, File &file);
+    void invalidate_index(uint32_t day);
+    bool write_records(File &file, const GlucoseRecord *records, size_t count);
+    bool write_segment(uint32_t day, const std::vector<GlucoseRecord> &records);
+    void merge_pending_history(void);
+    size_t merge_history(std::vector<GlucoseRecord> &points);
+    bool backfill_stored(const std::vector<GlucoseRecord> &records);
+    bool backfill_staged(const std::vector<GlucoseRecord> &records);
+    bool recover(const char *path);
+    bool commit(const GlucoseRecord *records, size_t count, bool derived);
+    void apply(const GlucoseRecord &record);
+    void replay_journal(void);
+    static void task(void *parameter);
+    void run(void);
+    void scan_manifest(void);
+    static void manifest_insert(std::vector<uint32_t> &list, uint32_t key);
+    static void manifest_erase(std::vector<uint32_t> &list, uint32_t key);
+    bool read_archive_header(File &file, GlucoseArchiveHeader &header);
+    uint32_t archive_range(uint32_t month, uint32_t from, uint32_t to, GlucoseLogCallback callback, void *context, bool &done);
+    bool archive_month(uint32_t month);
+    void prune_hours(uint32_t before);
+    void prune_summaries(uint32_t before);
+    void import_all_json(void);
+    void load_summaries(void);
+    void rebuild_summaries(void);
+    bool summarize_segment(uint32_t day, GlucoseDaySummary &summary);
+    void store_summary(GlucoseDaySummary &summary);
+    void keep_summary(const GlucoseDaySummary &summary);
+    static void summary_add(GlucoseDaySummary &summary, uint16_t value);
+    void load_hours(void);
+    void rebuild_hours(void);
+    void store_hours(GlucoseHourRollup *hours, size_t count);
+    void merge_hours(const GlucoseHourRollup *hours, size_t count);
+    uint32_t hours_range(uint32_t from, uint32_t to, GlucosePointCallback callback, void *context);
+    static bool hour_add(GlucoseHourRollup &hour, std::vector<GlucoseHourRollup> &finished, const GlucoseRecord &record);
+    void agp_begin(bool rebuild);
+    void agp_feed(uint32_t timestamp, uint16_t value);
+    void agp_expire(uint32_t first_day);
+    static void seal(GlucoseRecord &record);
+    static bool valid(const GlucoseRecord &record);
+
+    uint32_t _last_timestamp = 0;
+    uint32_t _last_day = 0;
+    GlucoseDaySummary _today = {};              ///< Summary of the newest segment (not in days.bin yet)
+    std::vector<GlucoseDaySummary> _days;       ///< Finished days, sorted, at most GLUCOSELOG_SUMMARY_DAYS
+    GlucoseHourRollup _hour = {};               ///< Current hour (not in hours.bin yet)
+    uint32_t _hours_last = 0;                   ///< Newest hour in hours.bin
+    bool _hours_complete = false;               ///< hours.bin holds all finished hours (imports add theirs)
+    bool _agp_ready = false;                    ///< agp matches the segments, new values are fed
+    std::vector<SegmentIndex> _index;           ///< At most GLUCOSELOG_INDEX_SEGMENTS
+    uint32_t _index_clock = 0;
+    uint32_t _staged_timestamp = 0;             ///< Newest staged record
+    SemaphoreHandle_t _mutex = NULL;            ///< Held by the flush task while it writes
+    TaskHandle_t _task = NULL;                  ///< Flush task, NULL = append() writes right away
+    GlucoseRecord _history[GLUCOSELOG_HISTORY_RECORDS];    ///< History handed over by backfill()
+    volatile uint16_t _history_count = 0;       ///< Points in _history, 0 = nothing to merge
+    std::vector<uint32_t> _segments;            ///< Manifest: days with a segment, sorted
+    std::vector<uint32_t> _archives;            ///< Manifest: months with an archive, sorted
+    uint16_t _raw_days = GLUCOSELOG_RAW_DAYS;
+    uint8_t _rollup_months = GLUCOSELOG_ROLLUP_MONTHS;
+    uint32_t _compacted_day = 0;                ///< Day of the last compact() by the flush task
+};
+
+#endif // GLUCOSELOG_H
@@ -0,0 +1,123 @@
+#include "glycemicstats.h"
+
+#include <math.h>
+#include <string.h>
+
+// derived values and percentages of both kernels
+static void finish(GlycemicStats &stats, const uint32_t bins[5]) {
+    if (stats.count == 0) {
+        stats.min = 0;
+        return;
+    }
+    stats.sd = sqrtf(stats.variance);
+    stats.cv = (stats.mean > 0) ? stats.sd / stats.mean * 100.0f : 0;
+    stats.gmi = 3.31f + 0.02392f * stats.mean;
+
+    float scale = 100.0f / stats.count;
+    stats.very_low  = bins[0] * scale;
+    stats.low       = bins[1] * scale;
+    stats.in_range  = bins[2] * scale;
+    stats.high      = bins[3] * scale;
+    stats.very_high = bins[4] * scale;
+}
+
+void glycemic_stats(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats) {
+#if GLYCEMICSTATS_FAST_PATH
+    glycemic_stats_unrolled(values, size, thresholds, stats);
+#else
+    glycemic_stats_welford(values, size, thresholds, stats);
+#endif
+}
+
+void glycemic_stats_welford(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats) {
+    memset(&stats, 0, sizeof(stats));
+    stats.min = UINT16_MAX;
+
+    uint32_t bins[5] = {0};
+    double mean = 0;
+    double m2 = 0;
+    for (uint16_t i = 0; i < size; i++) {
+        uint16_t value = values[i];
+        if (value == 0 || value > GLYCEMICSTATS_MAX_VALUE) {
+            stats.gaps++;
+            continue;
+        }
+        stats.count++;
+        double delta = value - mean;
+        mean += delta / stats.count;
+        m2 += delta * (value - mean);
+
+        if (value < stats.min) stats.min = value;
+        if (value > stats.max) stats.max = value;
+
+        if (value < thresholds.very_low)        bins[0]++;
+        else if (value < thresholds.low)        bins[1]++;
+        else if (value <= thresholds.high)      bins[2]++;
+        else if (value <= thresholds.very_high) bins[3]++;
+        else                                    bins[4]++;
+    }
+
+    stats.mean = mean;
+    stats.variance = (stats.count > 0) ? m2 / stats.count : 0;
+    finish(stats, bins);
+}
+
+// uint16_t input: sums of values and squares are exact integers, no cancellation like a float sum of squares.
+// The inner loop has no branches and only 32 bit accumulators (GLYCEMICSTATS_CHUNK values fit), so the
+// compiler can unroll it or map it to vector instructions.
+#define GLYCEMICSTATS_CHUNK 4096
+
+void glycemic_stats_unrolled(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats) {
+    memset(&stats, 0, sizeof(stats));
+
+    const uint16_t very_low = thresholds.very_low;
+    const uint16_t low = thresholds.low;
+    const uint16_t high = thresholds.high;
+    const uint16_t very_high = thresholds.very_high;
+
+    uint32_t count = 0;
+    uint32_t sum = 0;
+    uint64_t sum_squares = 0;
+    uint32_t below_very_low = 0;    // cumulative: below very_low, below low, up to high, up to very_high
+    uint32_t below_low = 0;
+    uint32_t up_to_high = 0;
+    uint32_t up_to_very_high = 0;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0;
+
+    for (uint32_t start = 0; start < size; start += GLYCEMICSTATS_CHUNK) {
+        uint32_t end = (size - start > GLYCEMICSTATS_CHUNK) ? start + GLYCEMICSTATS_CHUNK : size;
+        uint32_t chunk_squares = 0;
+        #pragma GCC unroll 4
+        for (uint32_t i = start; i < end; i++) {
+            uint16_t value = values[i];
+            // gaps: 0 wraps to 0xFFFF, one compare covers both limits
+            uint16_t valid = (uint16_t)(value - 1) < GLYCEMICSTATS_MAX_VALUE;
+            uint16_t masked = valid ? value : 0;
+            count += valid;
+            sum += masked;
+            chunk_squares += (uint32_t)masked * masked;
+            below_very_low  += valid & (value < very_low);
+            below_low       += valid & (value < low);
+            up_to_high      += valid & (value <= high);
+            up_to_very_high += valid & (value <= very_high);
+            uint16_t lowest = valid ? value : UINT16_MAX;
+            min = (lowest < min) ? lowest : min;
+            max = (masked > max) ? masked : max;
+        }
+        sum_squares += chunk_squares;
+    }
+
+    stats.count = count;
+    stats.gaps = size - count;
+    stats.min = min;
+    stats.max = max;
+    if (count > 0) {
+        // variance from the exact sums: (n * sum(x^2) - sum(x)^2) / n^2
+        uint64_t numerator = (uint64_t)count * sum_squares - (uint64_t)sum * sum;
+        stats.mean = (float)sum / count;
+        stats.variance = (double)numerator / ((double)count * count);
+    }
+    uint32_t bins[5] = {below_very_low, below_low - below_very_low, up_to_high - below_low, up_to_very_high - up_to_high, count - up_to_very_high};
+    finish(stats, bins);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file glycemicstats.h
+ * @brief Single-pass glycemic statistics over a uint16_t glucose array
+ *
+ * One pass returns count, mean, variance, min/max, time below/in/above range,
+ * CV and GMI. Gaps (0 or values above GLYCEMICSTATS_MAX_VALUE, e.g. missing
+ * history points) are skipped and are not part of any denominator.
+ *
+ * Two kernels with the same results:
+ * - glycemic_stats_welford(): scalar reference, Welford's running variance
+ * - glycemic_stats_unrolled(): branch-free loop with exact integer sums and
+ *   cumulative range counters, unrolled by 4 (GLYCEMICSTATS_FAST_PATH)
+ *
+ * No Arduino dependencies, tools/glucose_bench builds it on the host.
+ */
+
+#ifndef GLYCEMICSTATS_H
+#define GLYCEMICSTATS_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup glycemicstats_config Glycemic Statistics Settings
+ * @{
+ */
+#ifndef GLYCEMICSTATS_FAST_PATH
+#define GLYCEMICSTATS_FAST_PATH 1       ///< 1 = glycemic_stats() uses the unrolled kernel
+#endif
+#define GLYCEMICSTATS_MAX_VALUE 1000    ///< Values above are gaps (mg/dL)
+/** @} */
+
+/**
+ * @struct GlycemicThresholds
+ * @brief Range limits in mg/dL (defaults: international consensus)
+ */
+struct GlycemicThresholds {
+    uint16_t very_low = 54;     ///< TBR level 2: below
+    uint16_t low = 70;          ///< TBR level 1: below (from very_low)
+    uint16_t high = 180;        ///< TIR: low to high inclusive
+    uint16_t very_high = 250;   ///< TAR level 1: up to, level 2: above
+};
+
+/**
+ * @struct GlycemicStats
+ * @brief Result of one pass
+ */
+struct GlycemicStats {
+    uint16_t count;             ///< Valid values
+    uint16_t gaps;              ///< Skipped values
+    uint16_t min;               ///< Lowest value
+    uint16_t max;               ///< Highest value
+    float mean;                 ///< mg/dL
+    float variance;             ///< Population variance (mg/dL)^2
+    float sd;                   ///< Standard deviation (mg/dL)
+    float cv;                   ///< Coefficient of variation (%)
+    float gmi;                  ///< Glucose management indicator (%)
+    float very_low;             ///< % below very_low
+    float low;                  ///< % very_low to below low
+    float in_range;             ///< % low to high
+    float high;                 ///< % above high up to very_high
+    float very_high;            ///< % above very_high
+};
+
+/**
+ * @brief Statistics with the kernel selected by GLYCEMICSTATS_FAST_PATH
+ * @param values Glucose values in mg/dL, gaps are skipped
+ * @param size Number of values
+ * @param thresholds Range limits
+ * @param stats Destination
+ */
+void glycemic_stats(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats);
+
+/**
+ * @brief Scalar reference kernel (Welford)
+ */
+void glycemic_stats_welford(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats);
+
+/**
+ * @brief Unrolled kernel with integer accumulators
+ */
+void glycemic_stats_unrolled(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats);
+
+#endif // GLYCEMICSTATS_H
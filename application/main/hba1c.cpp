@@ -17,9 +17,22 @@ static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
 DynamicJsonDocument* globalJsonDoc = new DynamicJsonDocument(JSON_BUFFER_SIZE);
 
 //
-char today_json_filename[20];  // Aktueller Dateiname im Format YYYY-MM-DD.json
+char today_log_filename[GLUCOSELOG_PATH_SIZE];  // Aktuelles Segment im Format /glucose/YYYYMMDD.log
 time_t last_timestamp = 0;     // Letzter gespeicherter Zeitstempel
 
+// Summe und Anzahl beim Lesen eines Segments
+struct GlucoseSum {
+    uint32_t sum;
+    uint32_t count;
+};
+
+bool HBA1C::begin() {
+    bool result = glucose_log.begin();
+    glucose_log.start_flush_task();
+    updateFilename();
+    return result;
+}
+
 void HBA1C::createTestJsonFiles() {
     time_t now = time(nullptr);
     struct tm timeinfo;
@@ -46,6 +59,7 @@ void HBA1C::createTestJsonFiles() {
             file.flush(); // **Wichtig für sicheres Speichern**
             file.close();
             logger.notice("✅ Testdatei erstellt: %s", filename);
+            glucose_log.import_json(filename);
         } else {
             logger.notice("❌ Fehler beim Erstellen der Datei %s!", filename);
         }
@@ -55,9 +69,8 @@ void HBA1C::createTestJsonFiles() {
 // Funktion, um den aktuellen Dateinamen zu generieren
 void HBA1C::updateFilename() {
     time_t now = time(nullptr);  // Aktuelle Zeit holen
-    struct tm *timeinfo = localtime(&now);
-    strftime(today_json_filename, sizeof(today_json_filename), "/%Y-%m-%d.json", timeinfo);
-    logger.debug("UpdateFilename: %s", today_json_filename);
+    GlucoseLog::segment_path(GlucoseLog::day_of(now), today_log_filename);
+    logger.debug("UpdateFilename: %s", today_log_filename);
 }
 
 void HBA1C::debugRawFileContents(const char* filename) {
@@ -99,6 +112,23 @@ void HBA1C::printJsonFileTelnet(const char* filename) {
         return;
     }
 
+    if (path.endsWith(".log")) {
+        file.close();
+        uint32_t count = glucose_log.read_segment(path.c_str(), [](const GlucoseRecord &record, void *) {
+            time_t timestamp = record.timestamp;
+            struct tm *timeinfo = localtime(&timestamp);
+            char timeString[20];
+            strftime(timeString, sizeof(timeString), "%Y-%m-%d %H:%M:%S", timeinfo);
+
+            logger.notice("Zeit: %s | Glucose: %d mg/dL%s", timeString, record.value, (record.flags & GLUCOSELOG_FLAG_IMPORTED) ? " (import)" : "");
+            Serial.printf("Zeit: %s | Glucose: %d mg/dL\n\r", timeString, record.value);
+            yield();  // Telnet-Verarbeitung sicherstellen
+            return true;
+        }, NULL);
+        logger.notice("=== %d Glucose-Werte aus %s ===", count, filename);
+        return;
+    }
+
     globalJsonDoc->clear();
 
     logger.notice("Debug: Lese JSON-Daten...");
@@ -159,50 +189,20 @@ void HBA1C::listJsonFilesTelnet() {
         }
         file = root.openNextFile();
     }
-}
-
-void HBA1C::loadJsonFromFile(const char* filename, DynamicJsonDocument &jsonDoc) {
-    File file = LittleFS.open(filename, "r");
-    if (!file) {
-        logger.debug("📂 Datei %s nicht gefunden, neue Datei wird erstellt!", filename);
-        jsonDoc.clear();
-        jsonDoc.to<JsonArray>();  // Neues leeres Array initialisieren
-        return;
-    }
-
-    logger.notice("📂 Lade Datei %s...", filename);
-
-    jsonDoc.clear();
-    DeserializationError error = deserializeJson(jsonDoc, file);
-    file.close();
-
-    if (error) {
-        logger.err("❌ Fehler beim Lesen von %s: %s", filename, error.c_str());
-        jsonDoc.clear();
-        jsonDoc.to<JsonArray>();  // Stelle sicher, dass wir ein Array behalten
-    }
-
-    logger.debug("📄 Datei %s geladen mit %d Einträgen.", filename, jsonDoc.size());
-}
 
-void HBA1C::saveJsonToFile(const char* filename, DynamicJsonDocument &jsonDoc) {
-    if (!jsonDoc.is<JsonArray>() || jsonDoc.size() == 0) {
-        logger.err("❌ Fehler: JSON-Dokument ist leer oder ungültig! Speichern abgebrochen.");
-        return;
-    }
+    logger.notice("=== Glucose-Log Segmente (%s) ===", GLUCOSELOG_DIR);
 
-    File file = LittleFS.open(filename, "w");
-    if (!file) {
-        logger.err("❌ Fehler: Datei %s konnte nicht zum Schreiben geöffnet werden!", filename);
-        return;
+    File dir = LittleFS.open(GLUCOSELOG_DIR);
+    for (File segment = dir.openNextFile(); segment; segment = dir.openNextFile()) {
+        String name = segment.name();
+        uint32_t records = 0;
+        if (name.endsWith(".log") && segment.size() > sizeof(GlucoseLogHeader)) {
+            records = (segment.size() - sizeof(GlucoseLogHeader)) / sizeof(GlucoseRecord);
+        } else if (name.endsWith(".arc") && segment.size() > sizeof(GlucoseArchiveHeader)) {
+            records = (segment.size() - sizeof(GlucoseArchiveHeader)) / sizeof(GlucoseArchiveRecord);
+        }
+        logger.notice("Datei: %s/%s | Größe: %d Bytes | Werte: %d", GLUCOSELOG_DIR, name.c_str(), segment.size(), records);
     }
-
-    serializeJson(jsonDoc, file);
-    file.flush();
-    file.close();
-
-    logger.debug("✅ Datei %s erfolgreich gespeichert mit %d Einträgen.", filename, jsonDoc.size());
-    jsonDoc.clear();
 }
 
 bool HBA1C::deleteJsonFile(const char* filename) {
@@ -222,50 +222,20 @@ bool HBA1C::deleteJsonFile(const char* filename) {
 
 // Neuen Wert speichern
 void HBA1C::addGlucoseValue(time_t timestamp, uint16_t glucose) {
-    static time_t last_timestamp = 0;
-    updateFilename();
+    uint32_t day = GlucoseLog::day_of(timestamp);
 
-    struct tm *timeinfo = localtime(&timestamp);
-    struct tm *last_timeinfo = localtime(&last_timestamp);
-
-    if (last_timeinfo->tm_mday != timeinfo->tm_mday) {
-        logger.debug("🟢 Neuer Tag erkannt, Datei wechseln zu %s...", today_json_filename);
+    if (day != glucose_log.last_day()) {
         updateFilename();
+        logger.debug("🟢 Neuer Tag erkannt, Segment %s...", today_log_filename);
     }
 
-    last_timestamp = timestamp;
-
-    loadJsonFromFile(today_json_filename, *globalJsonDoc);
-
-    if (!globalJsonDoc->is<JsonArray>()) {
-        logger.err("❌ Fehler: JSON-Dokument ist kein Array! Erstelle neues Array.");
-        globalJsonDoc->clear();
-        globalJsonDoc->to<JsonArray>();
-    }
-
-    JsonArray arr = globalJsonDoc->as<JsonArray>();
-
-    // Prüfe, ob der letzte Wert identisch ist → Verhindert doppelte Werte
-    if (arr.size() > 0) {
-        JsonObject lastEntry = arr[arr.size() - 1];  // Letzter Eintrag
-        if (lastEntry.containsKey("glucose") && lastEntry["glucose"] == glucose) {
-            logger.debug("⚠️  Neuer Wert ist identisch zum letzten Eintrag (%d mg/dL). Speichern übersprungen.", glucose);
-            return;
-        }
-    }
-
-    if (arr.size() >= MAX_ENTRIES) {
-        arr.remove(0);
+    // Gleicher Messzeitpunkt → Wert ist bereits gespeichert
+    if (!glucose_log.append(timestamp, glucose)) {
+        logger.debug("⚠️  Wert %d mg/dL (%ld) nicht gespeichert (nicht neuer als %d).", glucose, timestamp, glucose_log.last_timestamp());
+        return;
     }
 
-    JsonObject obj = arr.createNestedObject();
-    obj["timestamp"] = timestamp;
-    obj["glucose"]   = glucose;
-
-    saveJsonToFile(today_json_filename, *globalJsonDoc);
-    globalJsonDoc->clear();
-
-    logger.debug("✅ Neuer Wert gespeichert: %ld | Glucose: %d mg/dL in Datei: %s", timestamp, glucose, today_json_filename);
+    logger.debug("✅ Neuer Wert gespeichert: %ld | Glucose: %d mg/dL in Segment %08d", timestamp, glucose, day);
 }
 
 // Prüfen, ob eine neue Datei um 00:00 benötigt wird
@@ -283,16 +253,16 @@ void HBA1C::checkNewDay() {
     last_timestamp = now;
 }
 
+// alle Werte des History Arrays in einem Durchlauf
+void HBA1C::calculate_statistics(const uint16_t values[], uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats){
+    glycemic_stats(values, size, thresholds, stats);
+}
+
 // claculate AVG of History array
 float HBA1C::calculateGlucoseMeanFromHistory(uint16_t values[], uint16_t size){
-    
-    float sum = 0;
-    for (int i = 0; i < size; i++) {
-        if(values[i] != 0){
-            sum += values[i];
-        }
-    }
-    return sum / size;
+    GlycemicStats stats;
+    glycemic_stats(values, size, GlycemicThresholds(), stats);
+    return stats.mean;
 }
 
 uint32_t HBA1C::processJsonFile(const char* filename, uint32_t &count) {
@@ -336,26 +306,37 @@ uint32_t HBA1C::processJsonFile(const char* filename, uint32_t &count) {
     return sum;
 }
 
+uint32_t HBA1C::processLogFile(const char* filename, uint32_t &count) {
+    GlucoseSum result = {0, 0};
+    glucose_log.read_segment(filename, [](const GlucoseRecord &record, void *context) {
+        GlucoseSum *sum = (GlucoseSum *)context;
+        sum->sum += record.value;
+        sum->count++;
+        return true;
+    }, &result);
+
+    count += result.count;
+    logger.debug("📄 Segment %s verarbeitet: %d Werte gefunden.", filename, result.count);
+    return result.sum;
+}
+
 float HBA1C::calculateGlucoseMeanFromJson(const char* filename) {
     uint32_t sum = 0;
     uint32_t count = 0;
 
     if (strcmp(filename, "*") == 0) {
-        // **Alle JSON-Dateien im LittleFS durchsuchen**
-        File root = LittleFS.open("/");
-        if (!root || !root.isDirectory()) {
-            logger.debug("❌ Fehler: Konnte Root-Verzeichnis nicht öffnen!");
-            return 0.0;
-        }
-
-        File file = root.openNextFile();
-        while (file) {
-            String currentFile = file.name();
-            if (currentFile.endsWith(".json")) {
-                sum += processJsonFile(currentFile.c_str(), count);
-            }
-            file = root.openNextFile();
-        }
+        // **Alle Segmente und Archive des Glucose-Logs (Manifest, kein Verzeichnis-Scan)**
+        struct Total { uint32_t sum; uint32_t count; } total = {0, 0};
+        glucose_log.range(0, glucose_log.last_timestamp(), [](const GlucoseRecord &record, void *context) {
+            Total *total = (Total *)context;
+            total->sum += record.value;
+            total->count++;
+            return true;
+        }, &total);
+        sum = total.sum;
+        count = total.count;
+    } else if (String(filename).endsWith(".log")) {
+        sum += processLogFile(filename, count);
     } else {
         // **Nur die angegebene Datei verarbeiten**
         if (!LittleFS.exists(filename)) {
@@ -377,74 +358,15 @@ float HBA1C::calculateGlucoseMeanFromJson(const char* filename) {
 }
 
 float HBA1C::calculateGlucoseMeanForLast7Days() {
-    uint32_t sum = 0;
-    uint32_t count = 0;
-
-    File root = LittleFS.open("/");
-    if (!root || !root.isDirectory()) {
-        logger.notice("❌ Fehler: Konnte Root-Verzeichnis nicht öffnen!");
-        return 0.0;
-    }
-
-    time_t now = time(nullptr);
-    struct tm *now_tm = localtime(&now);
-
-    File file = root.openNextFile();
-    while (file) {
-        String filename = file.name();
-        
-        // **Falls der Dateiname kein ".json" hat, überspringen**
-        if (!filename.endsWith(".json")) {
-            file = root.openNextFile();
-            continue;
-        }
-
-        // **Falls der Dateiname nicht mit "/" beginnt, fügen wir es hinzu**
-        String filepath = filename;
-        if (!filepath.startsWith("/")) {
-            filepath = "/" + filepath;
-        }
-
-        if (filename == "config.json") {
-            file = root.openNextFile();
-            continue;
-        }
-
-        // **Datumsformat extrahieren (YYYY-MM-DD.json)**
-        int year, month, day;
-        if (sscanf(filename.c_str(), "%4d-%2d-%2d.json", &year, &month, &day) != 3) {
-            logger.notice("⚠️  Datei %s hat kein gültiges Datumsformat!", filename.c_str());
-            file = root.openNextFile();
-            continue;
-        }
-
-        // **Datei-Datum in time_t umwandeln**
-        struct tm file_tm = {0};
-        file_tm.tm_year = year - 1900;
-        file_tm.tm_mon  = month - 1;
-        file_tm.tm_mday = day;
-        time_t file_time = mktime(&file_tm);
-
-        // **Prüfen, ob Datei innerhalb der letzten 7 Tage liegt**
-        double diff_days = difftime(now, file_time) / (60 * 60 * 24);
-        if (diff_days >= 0 && diff_days <= 7) {
-            logger.notice("📂 Einbeziehen: %s (vor %.0f Tagen)", filepath.c_str(), diff_days);
-            sum += processJsonFile(filepath.c_str(), count);
-        } else {
-            logger.notice("📂 Ignoriert: %s (vor %.0f Tagen)", filepath.c_str(), diff_days);
-        }
-
-        file = root.openNextFile();
-    }
-
-    if (count == 0) {
+    // **Tageszusammenfassungen im RAM, kein Lesen vom Flash**
+    GlucoseStatistics statistics;
+    if (!glucose_log.statistics(7, statistics)) {
         logger.notice("⚠️  Keine Glucose-Daten in den letzten 7 Tagen gefunden!");
         return 0.0;
     }
 
-    float mean = (float)sum / count;
-    logger.notice("📊 Durchschnittlicher Glucosewert der letzten 7 Tage: %.2f mg/dL (aus %d Werten)", mean, count);
-    return mean;
+    logger.notice("📊 Durchschnittlicher Glucosewert der letzten 7 Tage: %.2f mg/dL (aus %d Werten, %d Tage)", statistics.mean, statistics.count, statistics.days);
+    return statistics.mean;
 }
 
 // Funktion zur Berechnung des aktuellen HbA1c
@@ -454,22 +376,28 @@ float HBA1C::calculate_hba1c(float mean_glucose) {
 
 // Funktion zur Berechnung der Time in Range (70-180 mg/dL)
 float HBA1C::calculate_time_in_range(uint16_t values[], uint16_t size, int min_range, int max_range) {
-    int count = 0;
-    for (int i = 0; i < size; i++) {
-        if (values[i] >= min_range && values[i] <= max_range) {
-            count++;
-        }
-    }
-    return (count / (double)size) * 100.0;
+    GlycemicThresholds thresholds;
+    thresholds.very_low = min_range;
+    thresholds.low = min_range;
+    thresholds.high = max_range;
+    thresholds.very_high = max_range;
+    GlycemicStats stats;
+    glycemic_stats(values, size, thresholds, stats);
+    return stats.in_range;
 }
 
 // Funktion zur Berechnung der Standardabweichung
 float HBA1C::calculate_standard_deviation(uint16_t values[], uint16_t size, float mean) {
+    // Lücken (0) zählen nicht
     double sum = 0;
+    uint16_t count = 0;
     for (int i = 0; i < size; i++) {
-        sum += pow(values[i] - mean, 2);
+        if (values[i] == 0 || values[i] > GLYCEMICSTATS_MAX_VALUE) continue;
+        double delta = values[i] - mean;
+        sum += delta * delta;
+        count++;
     }
-    return sqrt(sum / size);
+    return count ? sqrt(sum / count) : 0;
 }
 
 // Funktion zur Berechnung des Variationskoeffizienten (CV %)
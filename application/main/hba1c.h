@@ -16,12 +16,14 @@
 #include <uuid/console.h>
 #include <uuid/telnet.h>
 #include <uuid/log.h>
+#include "glucoselog.h"
+#include "glycemicstats.h"
 
 #define MAX_ENTRIES 300         ///< Maximum of 24 hours with 5-minute intervals (288 = 12*24) + some extra
 #define JSON_BUFFER_SIZE 12000  ///< Buffer size for JSON storage
 
 extern DynamicJsonDocument* globalJsonDoc;
-extern char today_json_filename[20];
+extern char today_log_filename[GLUCOSELOG_PATH_SIZE];
 
 /**
  * @class HBA1C
@@ -29,6 +31,14 @@ extern char today_json_filename[20];
  */
 class HBA1C {
     public:
+        GlucoseLog glucose_log;     ///< Binary day segments below /glucose
+
+        /**
+         * @brief Open the glucose log (imports JSON day files of older versions).
+         * @return False if LittleFS is not usable.
+         */
+        bool begin();
+
         /**
          * @brief Debug function to print raw JSON file contents.
          * @param filename Path of the JSON file.
@@ -36,13 +46,13 @@ class HBA1C {
         void debugRawFileContents(const char* filename);
 
         /**
-         * @brief Print JSON file contents via Telnet.
-         * @param filename Path of the JSON file.
+         * @brief Print JSON file or glucose log segment contents via Telnet.
+         * @param filename Path of the JSON file or segment (*.log).
          */
         void printJsonFileTelnet(const char* filename);
 
         /**
-         * @brief List all available JSON files in LittleFS via Telnet.
+         * @brief List all available JSON files and glucose log segments in LittleFS via Telnet.
          */
         void listJsonFilesTelnet();
 
@@ -54,8 +64,8 @@ class HBA1C {
         bool deleteJsonFile(const char* filename);
 
         /**
-         * @brief Add a new glucose value to the JSON data storage.
-         * @param timestamp Unix timestamp of the measurement.
+         * @brief Append a new glucose value to the glucose log.
+         * @param timestamp Unix timestamp of the measurement (values not newer than the last one are skipped).
          * @param glucose Glucose level in mg/dL.
          */
         void addGlucoseValue(time_t timestamp, uint16_t glucose);
@@ -66,7 +76,7 @@ class HBA1C {
         void checkNewDay();
 
         /**
-         * @brief Update the filename for the current day's JSON file.
+         * @brief Update the filename for the current day's glucose log segment.
          */
         void updateFilename();
 
@@ -79,27 +89,44 @@ class HBA1C {
         uint32_t processJsonFile(const char* filename, uint32_t &count);
 
         /**
-         * @brief Create test JSON files with random glucose data.
+         * @brief Sum up the glucose values of a glucose log segment.
+         * @param filename Path of the segment.
+         * @param count Reference to store the number of entries.
+         * @return The total sum of glucose values.
+         */
+        uint32_t processLogFile(const char* filename, uint32_t &count);
+
+        /**
+         * @brief Create test JSON files with random glucose data and import them into the glucose log.
          */
         void createTestJsonFiles();
 
         /**
-         * @brief Calculate the average glucose value from a JSON file.
-         * @param filename Path of the JSON file.
+         * @brief Calculate the average glucose value from a JSON file or glucose log segment.
+         * @param filename Path of the file, "*" for all segments.
          * @return The mean glucose value.
          */
         float calculateGlucoseMeanFromJson(const char* filename);
 
+        /**
+         * @brief Calculate all statistics of a glucose array in one pass (gaps are skipped).
+         * @param values Array of glucose values.
+         * @param size Size of the array.
+         * @param thresholds Range limits for TBR/TIR/TAR.
+         * @param stats Destination.
+         */
+        void calculate_statistics(const uint16_t values[], uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats);
+
         /**
          * @brief Calculate the average glucose value from an array.
          * @param values Array of glucose values.
          * @param size Size of the array.
-         * @return The mean glucose value.
+         * @return The mean glucose value (gaps are skipped).
          */
         float calculateGlucoseMeanFromHistory(uint16_t values[], uint16_t size);
 
         /**
-         * @brief Calculate the average glucose value from the last 7 days.
+         * @brief Calculate the average glucose value from the last 7 days (day summaries, no flash reads).
          * @return The mean glucose value over the past week.
          */
         float calculateGlucoseMeanForLast7Days();
@@ -117,7 +144,7 @@ class HBA1C {
          * @param size Size of the array.
          * @param min_range Minimum range value.
          * @param max_range Maximum range value.
-         * @return The percentage of values within the range.
+         * @return The percentage of values within the range (of the values without gaps).
          */
         float calculate_time_in_range(uint16_t values[], uint16_t size, int min_range, int max_range);
 
@@ -126,7 +153,7 @@ class HBA1C {
          * @param values Array of glucose values.
          * @param size Size of the array.
          * @param mean Mean glucose value.
-         * @return The standard deviation.
+         * @return The standard deviation (gaps are skipped).
          */
         float calculate_standard_deviation(uint16_t values[], uint16_t size, float mean);
 
@@ -138,21 +165,6 @@ class HBA1C {
          */
         float calculate_coefficient_of_variation(float std_dev, float mean);
 
-    private:
-        /**
-         * @brief Load JSON data from file into a given JSON document.
-         * @param filename Path of the JSON file.
-         * @param jsonDoc Reference to the JSON document to store data.
-         */
-        void loadJsonFromFile(const char* filename, DynamicJsonDocument &jsonDoc);
-
-        /**
-         * @brief Save a JSON document to a file.
-         * @param filename Path of the JSON file.
-         * @param jsonDoc Reference to the JSON document to save.
-         */
-        void saveJsonToFile(const char* filename, DynamicJsonDocument &jsonDoc);
-
 };
 
 #endif // HBA1C_H
\ No newline at end of file
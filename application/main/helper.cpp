@@ -74,62 +74,87 @@ void HELPER::printLocalTime(bool mode){
     }
 }
 
-//------------------------------------[covert to millis]----------------------------
-uint32_t HELPER::convertToMillis(uint8_t hours, uint8_t minutes, uint8_t seconds) {
-    return (hours * 3600UL + minutes * 60UL + seconds) * 1000UL;
+//------------------------[LibreLinkUp timestamp conversion]--------------------------------
+/* String timecode = "12/15/2024 4:52:16 PM";
+    long unixtime = convertStrToUnixTime(timecode, HELPER::getUtcOffset(time(NULL)));
+*/
+long HELPER::convertStrToUnixTime(const char *datetime, int32_t utc_offset) {
+    return parseTimestamp(datetime, utc_offset);
 }
 
-//------------------[Hauptfunktion zum Synchronisieren mit einem 5-Sekunden-Offset]--------------
-int32_t HELPER::synchronizeWithServer(uint8_t serverHours, uint8_t serverMinutes, uint8_t serverSeconds, 
-                                      uint8_t localHours, uint8_t localMinutes, uint8_t localSeconds) {
-    
-    int32_t timeDifferenceMs = 0;
-
-    // Server- und lokale Zeit in Millisekunden umrechnen
-    uint32_t serverTimeMs = convertToMillis(serverHours, serverMinutes, serverSeconds);
-    uint32_t localTimeMs  = convertToMillis(localHours, localMinutes, localSeconds);
-    
-    // calculate timedifference
-    timeDifferenceMs = serverTimeMs - localTimeMs;
-    //logger.notice("Timedifference from LibreLinkup Timestamp to ESP32 LocalTime: %dms",timeDifferenceMs);
-    
-    return timeDifferenceMs;
+// read unsigned decimal number (max. 4 digits), returns NULL if there is no digit
+static inline const char *parse_number(const char *p, int &value) {
+    const char *start = p;
+    int v = 0;
+    while ((unsigned)(*p - '0') < 10 && p - start < 4) {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    value = v;
+    return (p == start) ? NULL : p;
 }
 
-//------------------------[get flash ID functions]--------------------------------
-/* String timecode = "12/15/2024 4:52:16 PM";
-    long unixtime = convertToUnixTime(timecode);
-*/
-long HELPER::convertStrToUnixTime(const String& datetime) {
-    struct tm timeinfo = {0};
-
-    // Parse the date and time from the input string
-    int month, day, year, hour, minute, second;
-    char meridian[3];
-    if (sscanf(datetime.c_str(), "%d/%d/%d %d:%d:%d %2s", &month, &day, &year, &hour, &minute, &second, meridian) != 7) {
-        Serial.println("Error parsing date/time");
-        return -1;
+bool HELPER::parseTimestampFields(const char *str, Timestamp_Fields &fields) {
+    const char *p = str;
+
+    // "M/D/YYYY h:mm:ss"
+    if ((p = parse_number(p, fields.month))  == NULL || *p++ != '/') return false;
+    if ((p = parse_number(p, fields.day))    == NULL || *p++ != '/') return false;
+    if ((p = parse_number(p, fields.year))   == NULL || *p++ != ' ') return false;
+    if ((p = parse_number(p, fields.hour))   == NULL || *p++ != ':') return false;
+    if ((p = parse_number(p, fields.minute)) == NULL || *p++ != ':') return false;
+    if ((p = parse_number(p, fields.second)) == NULL) return false;
+
+    // optional " AM" / " PM"
+    if (*p == ' ') {
+        p++;
+        bool pm = (p[0] == 'P' || p[0] == 'p');
+        if (!(pm || p[0] == 'A' || p[0] == 'a') || (p[1] != 'M' && p[1] != 'm')) return false;
+        // 12 AM -> 0, 1..11 PM -> 13..23
+        if (fields.hour == 12) fields.hour = 0;
+        if (pm) fields.hour += 12;
     }
+    return true;
+}
 
-    // Adjust for PM
-    if (strcmp(meridian, "PM") == 0 && hour != 12) {
-        hour += 12;
-    } else if (strcmp(meridian, "AM") == 0 && hour == 12) {
-        hour = 0;
+// days since 1970-01-01 (Howard Hinnant, days_from_civil)
+int64_t HELPER::civilToUnixTime(const Timestamp_Fields &fields) {
+    int y = fields.year - (fields.month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (fields.month + (fields.month > 2 ? -3 : 9)) + 2) / 5 + fields.day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + (int64_t)doe - 719468;
+
+    return days * 86400 + fields.hour * 3600 + fields.minute * 60 + fields.second;
+}
+
+time_t HELPER::parseTimestamp(const char *str, int32_t utc_offset) {
+    Timestamp_Fields fields;
+
+    if (!parseTimestampFields(str, fields)) return -1;
+    if (fields.month < 1 || fields.month > 12 || fields.day < 1 || fields.day > 31 ||
+        fields.hour > 23 || fields.minute > 59 || fields.second > 60 || fields.year < 1970) {
+        return -1;
     }
+    return (time_t)(civilToUnixTime(fields) - utc_offset);
+}
 
-    // Fill the tm structure
-    timeinfo.tm_year = year - 1900; // Years since 1900
-    timeinfo.tm_mon  = month - 1;    // Months since January (0-11)
-    timeinfo.tm_mday = day;
-    timeinfo.tm_hour = hour;
-    timeinfo.tm_min  = minute;
-    timeinfo.tm_sec  = second;
+int32_t HELPER::getUtcOffset(time_t t) {
+    struct tm local;
+    localtime_r(&t, &local);
 
-    // Convert to Unix time
-    return mktime(&timeinfo);
+    Timestamp_Fields fields = {local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                               local.tm_hour, local.tm_min, local.tm_sec};
+    return (int32_t)(civilToUnixTime(fields) - (int64_t)t);
 }
 
+uint32_t HELPER::fnv1a(const char *str, uint32_t hash) {
+    do {
+        hash = (hash ^ (uint8_t)*str) * HELPER_FNV1A_PRIME;
+    } while (*str++);
+    return hash;
+}
 
 // Funktion zur Umwandlung von Unix-Timestamp in "HH:MM"
 // format_time(labels[i], sizeof(labels[i]), timecode_array[i]);
@@ -244,4 +269,15 @@ Json_Buffer_Info HELPER::getBufferSize(JsonDocument* doc) {
     info.usedCapacity = doc->memoryUsage();
     info.totalCapacity = doc->capacity();
     return info;
-}
\ No newline at end of file
+}
+
+//------------------------[get heap fragmentation]--------------------------------
+// only internal RAM: small allocations (String, TLS) end up there, not in PSRAM
+Heap_Info HELPER::getHeapInfo(void) {
+    Heap_Info info;
+    info.free_size     = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    info.largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    info.minimum_free  = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    info.fragmentation = (info.free_size > 0) ? 100 - (uint8_t)((uint64_t)info.largest_block * 100 / info.free_size) : 0;
+    return info;
+}
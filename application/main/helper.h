@@ -21,6 +21,9 @@
 #include <uuid/telnet.h>
 #include <uuid/log.h>
 
+#define HELPER_FNV1A_INIT   2166136261u     ///< FNV-1a 32 bit offset basis
+#define HELPER_FNV1A_PRIME  16777619u       ///< FNV-1a 32 bit prime
+
 /**
  * @struct Json_Buffer_Info
  * @brief Structure containing information about the JSON buffer usage.
@@ -30,15 +33,36 @@ struct Json_Buffer_Info {
     size_t totalCapacity;   ///< Total allocated capacity of the buffer.
 };
 
+/**
+ * @struct Heap_Info
+ * @brief Free internal heap and its fragmentation
+ */
+struct Heap_Info {
+    size_t free_size;       ///< Free internal heap in bytes.
+    size_t largest_block;   ///< Largest allocatable block in bytes.
+    size_t minimum_free;    ///< Lowest free heap since boot in bytes.
+    uint8_t fragmentation;  ///< 100 - largest_block * 100 / free_size (0 = not fragmented).
+};
+
+/**
+ * @struct Timestamp_Fields
+ * @brief Date and time fields of a LibreLinkUp timestamp ("M/D/YYYY h:mm:ss AM").
+ */
+struct Timestamp_Fields {
+    int year;       ///< 4-digit year (0 for an empty timestamp)
+    int month;      ///< Month (1-12)
+    int day;        ///< Day of month (1-31)
+    int hour;       ///< Hour (0-23, AM/PM already applied)
+    int minute;     ///< Minute (0-59)
+    int second;     ///< Second (0-59)
+};
+
 /**
  * @class HELPER
  * @brief Utility class providing various helper functions for the ESP32 environment.
  */
 class HELPER {
     public:
-        int32_t timedifference = 0;  ///< Time difference between local and server time in milliseconds.
-        const int TIME_DIFF_THRESHOLD = -60000; ///< Threshold for time synchronization.
-
         /**
          * @brief Creates a JSON document in PSRAM.
          * @param size The size of the JSON document in bytes.
@@ -65,28 +89,6 @@ class HELPER {
          */
         void printLocalTime(bool mode);
 
-        /**
-         * @brief Converts hours, minutes, and seconds into milliseconds.
-         * @param hours Number of hours.
-         * @param minutes Number of minutes.
-         * @param seconds Number of seconds.
-         * @return Equivalent time in milliseconds.
-         */
-        uint32_t convertToMillis(uint8_t hours, uint8_t minutes, uint8_t seconds);
-
-        /**
-         * @brief Synchronizes local time with the server time.
-         * @param serverHours Server-provided hours.
-         * @param serverMinutes Server-provided minutes.
-         * @param serverSeconds Server-provided seconds.
-         * @param localHours Local device hours.
-         * @param localMinutes Local device minutes.
-         * @param localSeconds Local device seconds.
-         * @return The calculated time difference in milliseconds.
-         */
-        int32_t synchronizeWithServer(uint8_t serverHours, uint8_t serverMinutes, uint8_t serverSeconds, 
-                                      uint8_t localHours, uint8_t localMinutes, uint8_t localSeconds);
-
         /**
          * @brief convertion of Unix-Timestamp to "HH:MM"
          * @return 
@@ -113,10 +115,54 @@ class HELPER {
 
         /**
          * @brief Converts a string representation of date and time to Unix timestamp.
-         * @param datetime The date and time string.
-         * @return Corresponding Unix timestamp.
+         * @param datetime The date and time string ("M/D/YYYY h:mm:ss AM").
+         * @param utc_offset Offset of the local time in the string to UTC in seconds.
+         * @return Corresponding Unix timestamp, -1 on error.
+         */
+        long convertStrToUnixTime(const char *datetime, int32_t utc_offset);
+
+        /**
+         * @brief Parses a LibreLinkUp timestamp ("M/D/YYYY h:mm:ss AM") without heap, locale or sscanf.
+         *
+         * AM/PM is optional (24h format without it). Zero fields are accepted
+         * ("0/0/0000 12:00:00 AM" of an inactive sensor).
+         * @param str Timestamp string.
+         * @param fields Parsed fields.
+         * @return True if the string has the expected format.
+         */
+        static bool parseTimestampFields(const char *str, Timestamp_Fields &fields);
+
+        /**
+         * @brief Converts date and time fields to Unix time (days-from-civil, no mktime/TZ).
+         * @param fields Date and time fields, interpreted as UTC.
+         * @return Seconds since 1970-01-01 00:00:00 UTC.
          */
-        long convertStrToUnixTime(const String& datetime);
+        static int64_t civilToUnixTime(const Timestamp_Fields &fields);
+
+        /**
+         * @brief Parses a LibreLinkUp timestamp directly to Unix time.
+         * @param str Timestamp string (local time).
+         * @param utc_offset Offset of the local time to UTC in seconds (see getUtcOffset()).
+         * @return Unix timestamp, -1 if the format or a field is invalid.
+         */
+        static time_t parseTimestamp(const char *str, int32_t utc_offset);
+
+        /**
+         * @brief Calculates the UTC offset of the configured timezone (incl. DST) at a given time.
+         * @param t Unix time.
+         * @return Offset local time - UTC in seconds.
+         */
+        static int32_t getUtcOffset(time_t t);
+
+        /**
+         * @brief Continues a 32 bit FNV-1a hash over a string and its terminating zero.
+         *
+         * The zero separates consecutive values ("1","23" differs from "12","3").
+         * @param str String to add.
+         * @param hash Hash of the previous values, HELPER_FNV1A_INIT for the first one.
+         * @return New hash.
+         */
+        static uint32_t fnv1a(const char *str, uint32_t hash = HELPER_FNV1A_INIT);
 
         /**
          * @brief Retrieves information about the JSON buffer usage.
@@ -124,6 +170,12 @@ class HELPER {
          * @return Json_Buffer_Info structure containing buffer details.
          */
         Json_Buffer_Info getBufferSize(JsonDocument* doc);
+
+        /**
+         * @brief Retrieves free size and fragmentation of the internal heap.
+         * @return Heap_Info structure containing heap details.
+         */
+        static Heap_Info getHeapInfo(void);
 };
 
 #endif // HELPER_H
@@ -0,0 +1,161 @@
+#include "httpstream.h"
+
+void HttpBodyStream::begin(Stream &stream, int32_t content_length, bool chunked) {
+    _stream = &stream;
+    _bytes = 0;
+    _wait_us = 0;
+    _chunked = chunked;
+    _unlimited = false;
+    _crlf_pending = false;
+    _eof = false;
+    _complete = false;
+    _remaining = 0;
+
+    if (chunked) {
+        // size of first chunk is read on first access
+    } else if (content_length >= 0) {
+        _remaining = content_length;
+        if (content_length == 0) {
+            _eof = true;
+            _complete = true;
+        }
+    } else {
+        _unlimited = true;  // body ends when the server closes the connection
+    }
+}
+
+void HttpBodyStream::end() {
+    _stream = nullptr;
+    _eof = true;
+    _complete = false;
+}
+
+bool HttpBodyStream::drain() {
+    if (_stream == nullptr || _unlimited) return false;   // end of body unknown, connection can not be reused
+
+    char buffer[64];
+    while (!_eof) {
+        if (readBytes(buffer, sizeof(buffer)) == 0) break;
+    }
+    return _complete;
+}
+
+int HttpBodyStream::available() {
+    if (_eof || _stream == nullptr) return 0;
+    int available = _stream->available();
+    if (_unlimited) return available;
+    if ((uint32_t)available > _remaining) available = _remaining;
+    return available;
+}
+
+int HttpBodyStream::read() {
+    if (!ensure()) return -1;
+    uint32_t start = micros();
+    int c = _stream->read();
+    _wait_us += micros() - start;
+    if (c >= 0) consume(1);
+    return c;
+}
+
+int HttpBodyStream::peek() {
+    if (!ensure()) return -1;
+    return _stream->peek();
+}
+
+size_t HttpBodyStream::readBytes(char *buffer, size_t length) {
+    size_t total = 0;
+
+    while (total < length) {
+        if (!ensure()) break;
+
+        size_t len = length - total;
+        if (!_unlimited && len > _remaining) len = _remaining;
+
+        uint32_t start = micros();
+        size_t received = _stream->readBytes(buffer + total, len);
+        _wait_us += micros() - start;
+        if (received == 0) {
+            if (_unlimited) _eof = _complete = true; // connection closed
+            break;
+        }
+        consume(received);
+        total += received;
+    }
+    return total;
+}
+
+// make sure body data can be read from the current position
+bool HttpBodyStream::ensure() {
+    if (_eof || _stream == nullptr) return false;
+    if (_unlimited || _remaining > 0) return true;
+    if (_chunked) return next_chunk();
+    return false;
+}
+
+// read next chunk header, returns false at the end of the body
+bool HttpBodyStream::next_chunk() {
+    char line[24];
+
+    if (_crlf_pending) {
+        // CRLF after the data of the previous chunk
+        if (!read_line(line, sizeof(line))) return false;
+        _crlf_pending = false;
+    }
+
+    if (!read_line(line, sizeof(line))) return false;
+    char *end;
+    _remaining = strtoul(line, &end, 16);   // chunk extensions after ';' are ignored
+    if (end == line) {
+        // no chunk size: framing lost, the connection must not be reused
+        _eof = true;
+        return false;
+    }
+
+    if (_remaining == 0) {
+        // last chunk, skip optional trailer headers up to the empty line,
+        // without it the rest of the body is still on the connection
+        bool terminated = false;
+        while (read_line(line, sizeof(line))) {
+            if (line[0] == '\0') {
+                terminated = true;
+                break;
+            }
+        }
+        _eof = true;
+        _complete = terminated;
+        return false;
+    }
+    _crlf_pending = true;
+    return true;
+}
+
+// read one CRLF terminated line (truncated to size), false on timeout
+bool HttpBodyStream::read_line(char *line, size_t size) {
+    size_t len = 0;
+    char c;
+
+    uint32_t start = micros();
+    while (true) {
+        if (_stream->readBytes(&c, 1) != 1) {
+            _wait_us += micros() - start;
+            _eof = true;    // timeout or connection lost inside chunk framing
+            return false;
+        }
+        if (c == '\n') break;
+        if (c != '\r' && len < size - 1) line[len++] = c;
+    }
+    line[len] = '\0';
+    _wait_us += micros() - start;
+    return true;
+}
+
+void HttpBodyStream::consume(size_t length) {
+    _bytes += length;
+    if (_unlimited) return;
+
+    _remaining -= length;
+    if (_remaining == 0 && !_chunked) {
+        _eof = true;
+        _complete = true;
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file httpstream.h
+ * @brief HTTP/1.1 response body stream for keep-alive connections
+ *
+ * HTTPClient::getStream() returns the raw socket. With HTTP/1.1 the body can
+ * be chunked and must be read completely before the connection can be reused
+ * for the next request. HttpBodyStream removes the chunk framing and stops
+ * exactly at the end of the body.
+ */
+
+#ifndef HTTPSTREAM_H
+#define HTTPSTREAM_H
+
+#include <Arduino.h>
+
+/**
+ * @class HttpBodyStream
+ * @brief Read-only view on the body of one HTTP response
+ */
+class HttpBodyStream : public Stream {
+public:
+    /**
+     * @brief Start reading a new response body
+     * @param stream Raw connection stream (HTTPClient::getStream())
+     * @param content_length Content-Length or -1 if unknown
+     * @param chunked true for "Transfer-Encoding: chunked"
+     */
+    void begin(Stream &stream, int32_t content_length, bool chunked);
+
+    /**
+     * @brief Detach from the connection (no body available)
+     */
+    void end();
+
+    /**
+     * @brief Read and discard the rest of the body
+     * @return true if the body end was reached (connection reusable)
+     */
+    bool drain();
+
+    /**
+     * @brief Check if the complete body was read
+     * @return true if body end reached
+     */
+    bool complete() const { return _complete; }
+
+    uint32_t bytes() const { return _bytes; }   ///< Body bytes read since begin()
+    uint32_t wait_time() const { return _wait_us; }   ///< Microseconds spent in reads of the connection since begin()
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    bool ensure();
+    bool next_chunk();
+    bool read_line(char *line, size_t size);
+    void consume(size_t length);
+
+    Stream *_stream = nullptr;
+    uint32_t _remaining = 0;    ///< bytes left in body (identity) or current chunk
+    uint32_t _bytes = 0;
+    uint32_t _wait_us = 0;      ///< time in _stream reads (network and TLS)
+    bool _chunked = false;
+    bool _unlimited = false;    ///< no length known, body ends with connection close
+    bool _crlf_pending = false; ///< CRLF after chunk data not read yet
+    bool _eof = true;           ///< no more body data
+    bool _complete = false;     ///< body end reached regularly
+};
+
+#endif // HTTPSTREAM_H
@@ -0,0 +1,208 @@
+#include "inflatestream.h"
+
+#include "esp32s3/rom/miniz.h"    // tinfl in ROM
+
+#define GZIP_FEXTRA     0x04
+#define GZIP_FNAME      0x08
+#define GZIP_FCOMMENT   0x10
+#define GZIP_FHCRC      0x02
+
+static_assert(INFLATE_WINDOW_SIZE == TINFL_LZ_DICT_SIZE, "window has to match tinfl");
+
+// decoder state, window and input buffer in one PSRAM block
+struct InflateStream::State {
+    tinfl_decompressor decomp;
+    uint8_t window[INFLATE_WINDOW_SIZE];
+    uint8_t input[INFLATE_INPUT_SIZE];
+};
+
+uint8_t InflateStream::encoding(const char *content_encoding) {
+    if (content_encoding == NULL) return INFLATE_IDENTITY;
+    while (*content_encoding == ' ') content_encoding++;
+
+    if (strcasecmp(content_encoding, "gzip") == 0 || strcasecmp(content_encoding, "x-gzip") == 0) return INFLATE_GZIP;
+    if (strcasecmp(content_encoding, "deflate") == 0) return INFLATE_DEFLATE;
+    return INFLATE_IDENTITY;
+}
+
+bool InflateStream::begin(Stream &source, uint8_t encoding) {
+    end();
+
+    _state = (State *)heap_caps_malloc(sizeof(State), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (_state == nullptr) return false;
+    tinfl_init(&_state->decomp);
+
+    _source = &source;
+    _encoding = encoding;
+    _trailer = 0;
+    _in_pos = _in_len = 0;
+    _out_pos = _out_end = 0;
+    _dict_pos = 0;
+    _bytes = 0;
+    _header_done = false;
+    _source_eof = false;
+    _done = false;
+    _complete = false;
+    _failed = false;
+    return true;
+}
+
+void InflateStream::end() {
+    if (_state != nullptr) heap_caps_free(_state);
+    _state = nullptr;
+    _source = nullptr;
+    _out_pos = _out_end = 0;
+    _done = true;
+    _complete = false;
+}
+
+bool InflateStream::drain() {
+    while (fill()) {
+        _out_pos = _out_end;
+    }
+    return _complete;
+}
+
+int InflateStream::available() {
+    return _out_end - _out_pos;
+}
+
+int InflateStream::read() {
+    if (!fill()) return -1;
+    return _state->window[_out_pos++];
+}
+
+int InflateStream::peek() {
+    if (!fill()) return -1;
+    return _state->window[_out_pos];
+}
+
+size_t InflateStream::readBytes(char *buffer, size_t length) {
+    size_t total = 0;
+
+    while (total < length && fill()) {
+        size_t len = _out_end - _out_pos;
+        if (len > length - total) len = length - total;
+        memcpy(buffer + total, _state->window + _out_pos, len);
+        _out_pos += len;
+        total += len;
+    }
+    return total;
+}
+
+// decompress the next block into the window, false if no more data follows
+bool InflateStream::fill() {
+    while (_out_pos == _out_end) {
+        if (_done) return false;
+
+        if (!_header_done) {
+            if (!header()) {
+                _done = _failed = true;
+                return false;
+            }
+            _header_done = true;
+        }
+        if (_in_pos == _in_len) refill();
+
+        // tinfl sees raw deflate data, header and trailer are handled here
+        size_t in_size = _in_len - _in_pos;
+        size_t out_size = INFLATE_WINDOW_SIZE - _dict_pos;
+        tinfl_status status = tinfl_decompress(&_state->decomp, _state->input + _in_pos, &in_size,
+                                               _state->window, _state->window + _dict_pos, &out_size,
+                                               _source_eof ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        _in_pos += in_size;
+        _out_pos = _dict_pos;
+        _out_end = _dict_pos + out_size;
+        _dict_pos = (_dict_pos + out_size) & (INFLATE_WINDOW_SIZE - 1);
+        _bytes += out_size;
+
+        if (status == TINFL_STATUS_DONE) {
+            _done = true;
+            _complete = trailer();
+            _failed = !_complete;
+        } else if (status < 0 || (status == TINFL_STATUS_NEEDS_MORE_INPUT && _source_eof)) {
+            _done = _failed = true;     // corrupt data, or body ended (timeout) inside the deflate stream
+        }
+    }
+    return true;
+}
+
+// next block of compressed data, false at the end of the source
+bool InflateStream::refill() {
+    if (_source_eof) return false;
+    _in_pos = 0;
+    _in_len = _source->readBytes((char *)_state->input, INFLATE_INPUT_SIZE);
+    if (_in_len == 0) _source_eof = true;
+    return _in_len > 0;
+}
+
+int InflateStream::next_input() {
+    if (_in_pos == _in_len && !refill()) return -1;
+    return _state->input[_in_pos++];
+}
+
+// skip the gzip (RFC 1952) or zlib (RFC 1950) header in front of the deflate data
+bool InflateStream::header() {
+    if (_encoding == INFLATE_GZIP) {
+        uint8_t h[10];
+        for (uint8_t i = 0; i < sizeof(h); i++) {
+            int c = next_input();
+            if (c < 0) return false;
+            h[i] = c;
+        }
+        if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8) return false;   // magic, CM = deflate
+
+        uint8_t flags = h[3];
+        if (flags & GZIP_FEXTRA) {
+            int lo = next_input();
+            int hi = next_input();
+            if (hi < 0) return false;
+            for (uint16_t n = lo | (hi << 8); n > 0; n--) {
+                if (next_input() < 0) return false;
+            }
+        }
+        if (flags & GZIP_FNAME) {
+            int c;
+            while ((c = next_input()) > 0) {}
+            if (c < 0) return false;
+        }
+        if (flags & GZIP_FCOMMENT) {
+            int c;
+            while ((c = next_input()) > 0) {}
+            if (c < 0) return false;
+        }
+        if ((flags & GZIP_FHCRC) && (next_input() < 0 || next_input() < 0)) return false;
+
+        _trailer = 8;   // CRC32, ISIZE
+        return true;
+    }
+
+    // "deflate" should be zlib, but some servers send raw deflate data
+    while (_in_len < 2 && !_source_eof) {
+        size_t received = _source->readBytes((char *)_state->input + _in_len, INFLATE_INPUT_SIZE - _in_len);
+        if (received == 0) _source_eof = true;
+        _in_len += received;
+    }
+    if (_in_len < 2) return false;
+
+    uint8_t cmf = _state->input[0];
+    uint8_t flg = _state->input[1];
+    if ((cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0) {
+        if (flg & 0x20) return false;   // preset dictionary not supported
+        _in_pos = 2;
+        _trailer = 4;   // Adler-32
+    }
+    return true;
+}
+
+// gzip: ISIZE has to match the decompressed length, the checksums are not verified (TLS protects the transfer)
+bool InflateStream::trailer() {
+    uint32_t isize = 0;
+
+    for (uint8_t i = 0; i < _trailer; i++) {
+        int c = next_input();
+        if (c < 0) return false;
+        if (i >= 4) isize |= (uint32_t)c << (8 * (i - 4));
+    }
+    return _encoding != INFLATE_GZIP || isize == _bytes;
+}
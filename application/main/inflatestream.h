@@ -0,0 +1,105 @@
+/**
+ * @file inflatestream.h
+ * @brief Streaming gzip/deflate decoder for HTTP response bodies
+ *
+ * Decompresses a "Content-Encoding: gzip" or "deflate" body while it is read,
+ * so the JSON parser sees plain text without the response ever being stored.
+ * The inflater is tinfl from the ESP32-S3 ROM (miniz), no flash is used for it.
+ * Deflate back-references reach up to 32 KB, so the output window has to be
+ * that large; it is allocated in PSRAM together with the decoder state for one
+ * response and freed by end().
+ */
+
+#ifndef INFLATESTREAM_H
+#define INFLATESTREAM_H
+
+#include <Arduino.h>
+
+/**
+ * @defgroup inflate_config Inflate Configuration
+ * @{
+ */
+#define INFLATE_WINDOW_SIZE 32768   ///< Deflate window (largest back-reference distance)
+#define INFLATE_INPUT_SIZE  256     ///< Compressed bytes read from the source per refill
+/** @} */
+
+/**
+ * @enum InflateEncoding
+ * @brief Content-Encoding of the source stream
+ */
+enum InflateEncoding : uint8_t {
+    INFLATE_IDENTITY = 0,   ///< not compressed
+    INFLATE_GZIP     = 1,   ///< gzip (RFC 1952)
+    INFLATE_DEFLATE  = 2,   ///< zlib (RFC 1950), raw deflate is accepted as well
+};
+
+/**
+ * @class InflateStream
+ * @brief Read-only stream with the decompressed data of another stream
+ */
+class InflateStream : public Stream {
+public:
+    /**
+     * @brief Parse a Content-Encoding header value
+     * @param content_encoding Header value ("gzip", "deflate", "" ...)
+     * @return InflateEncoding, INFLATE_IDENTITY for unknown values
+     */
+    static uint8_t encoding(const char *content_encoding);
+
+    /**
+     * @brief Start decompressing a new body
+     * @param source Compressed data (HttpBodyStream)
+     * @param encoding INFLATE_GZIP or INFLATE_DEFLATE
+     * @return false if the decoder memory could not be allocated
+     */
+    bool begin(Stream &source, uint8_t encoding);
+
+    /**
+     * @brief Free the decoder memory
+     */
+    void end();
+
+    /**
+     * @brief Read and discard the rest of the data, including the gzip trailer
+     * @return true if the compressed stream ended regularly
+     */
+    bool drain();
+
+    bool complete() const { return _complete; }     ///< End of the compressed stream reached without error
+    bool failed() const { return _failed; }         ///< Corrupt or truncated compressed data
+    uint32_t bytes() const { return _bytes; }       ///< Decompressed bytes since begin()
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    struct State;
+
+    bool fill();
+    bool refill();
+    bool header();
+    bool trailer();
+    int next_input();
+
+    Stream *_source = nullptr;
+    State *_state = nullptr;
+    uint8_t _encoding = INFLATE_IDENTITY;
+    uint8_t _trailer = 0;       ///< bytes after the deflate data (gzip 8, zlib 4, raw 0)
+    uint16_t _in_pos = 0;       ///< next unused byte in the input buffer
+    uint16_t _in_len = 0;       ///< valid bytes in the input buffer
+    uint16_t _out_pos = 0;      ///< next unread byte in the window
+    uint16_t _out_end = 0;      ///< end of the decompressed data not read yet
+    uint16_t _dict_pos = 0;     ///< write position of the decoder in the window
+    uint32_t _bytes = 0;
+    bool _header_done = false;
+    bool _source_eof = false;
+    bool _done = true;          ///< no more output
+    bool _complete = false;
+    bool _failed = false;
+};
+
+#endif // INFLATESTREAM_H
@@ -0,0 +1,304 @@
+#include "jsonstream.h"
+
+JsonStreamParser::JsonStreamParser(JsonStreamListener &listener) : _listener(listener) {
+    reset();
+}
+
+void JsonStreamParser::reset() {
+    _depth = 0;
+    _state = ST_VALUE;
+    _status = JSONSTREAM_BUSY;
+    _string_is_key = false;
+    _truncated = false;
+    _len = 0;
+    _unicode_digits = 0;
+    _unicode = 0;
+    _bytes = 0;
+    _value[0] = '\0';
+}
+
+uint8_t JsonStreamParser::feed(const char *data, size_t len) {
+    for (size_t i = 0; i < len && _status == JSONSTREAM_BUSY; i++) {
+        // process() returns false if the character terminated a number/literal
+        // and has to be evaluated again in the following state
+        while (!process(data[i])) {}
+        _bytes++;
+    }
+    return _status;
+}
+
+uint8_t JsonStreamParser::parse(Stream &stream) {
+    char buffer[JSONSTREAM_READ_CHUNK];
+
+    while (_status == JSONSTREAM_BUSY) {
+        size_t len = stream.available();
+        if (len > sizeof(buffer)) len = sizeof(buffer);
+        if (len == 0) len = 1;  // block with stream timeout until the next byte arrives
+
+        len = stream.readBytes(buffer, len);
+        if (len == 0) {
+            _status = JSONSTREAM_ERROR; // timeout, document incomplete
+            break;
+        }
+        feed(buffer, len);
+    }
+    return _status;
+}
+
+bool JsonStreamParser::match(const char *path) const {
+    uint8_t level = 0;
+    const char *p = path;
+
+    while (*p != '\0') {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        if (level >= _depth) return false;
+        const Frame &frame = _frames[level];
+
+        if (*p == '[') {
+            if (!frame.is_array) return false;
+            p++;
+            if (*p != ']') {
+                int16_t index = 0;
+                while (*p >= '0' && *p <= '9') index = index * 10 + (*p++ - '0');
+                if (index != frame.index) return false;
+            }
+            if (*p != ']') return false;
+            p++;
+        } else {
+            if (frame.is_array) return false;
+            const char *k = frame.key;
+            while (*p != '\0' && *p != '.' && *p != '[') {
+                if (*k++ != *p++) return false;
+            }
+            if (*k != '\0') return false;
+        }
+        level++;
+    }
+    return level == _depth;
+}
+
+int16_t JsonStreamParser::index(uint8_t level) const {
+    if (level >= _depth || !_frames[level].is_array) return -1;
+    return _frames[level].index;
+}
+
+void JsonStreamParser::push(bool is_array) {
+    if (_depth >= JSONSTREAM_MAX_DEPTH) {
+        _state = ST_END;
+        _status = JSONSTREAM_ERROR;
+        return;
+    }
+    Frame &frame = _frames[_depth++];
+    frame.is_array = is_array;
+    frame.empty = true;
+    frame.index = 0;
+    frame.key[0] = '\0';
+    _state = is_array ? ST_VALUE : ST_KEY;
+}
+
+void JsonStreamParser::pop() {
+    _depth--;
+    _listener.end(*this);
+    if (_depth == 0) {
+        _state = ST_END;
+        _status = JSONSTREAM_DONE;
+    } else {
+        _state = ST_AFTER_VALUE;
+    }
+}
+
+void JsonStreamParser::emit(JsonStreamType type) {
+    _value[_len] = '\0';
+    _listener.value(*this, type, _value);
+    if (_depth == 0) {
+        // scalar root value
+        _state = ST_END;
+        _status = JSONSTREAM_DONE;
+    } else {
+        _state = ST_AFTER_VALUE;
+    }
+}
+
+void JsonStreamParser::append(char c) {
+    char *buffer = _value;
+    uint8_t size = JSONSTREAM_VALUE_SIZE;
+    if (_string_is_key) {
+        buffer = _frames[_depth - 1].key;
+        size = JSONSTREAM_KEY_SIZE;
+    }
+    if (_len < size - 1) {
+        buffer[_len++] = c;
+    } else {
+        _truncated = true;
+    }
+}
+
+void JsonStreamParser::append_utf8(uint16_t code) {
+    if (code < 0x80) {
+        append((char)code);
+    } else if (code < 0x800) {
+        append((char)(0xC0 | (code >> 6)));
+        append((char)(0x80 | (code & 0x3F)));
+    } else {
+        append((char)(0xE0 | (code >> 12)));
+        append((char)(0x80 | ((code >> 6) & 0x3F)));
+        append((char)(0x80 | (code & 0x3F)));
+    }
+}
+
+bool JsonStreamParser::process(char c) {
+    switch (_state) {
+    case ST_VALUE:
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return true;
+        if (_depth > 0) {
+            Frame &frame = _frames[_depth - 1];
+            if (frame.is_array && frame.empty && c == ']') {
+                pop();
+                return true;
+            }
+            frame.empty = false;
+        }
+        _len = 0;
+        if (c == '{') {
+            push(false);
+        } else if (c == '[') {
+            push(true);
+        } else if (c == '"') {
+            _string_is_key = false;
+            _state = ST_STRING;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            append(c);
+            _state = ST_NUMBER;
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            append(c);
+            _state = ST_LITERAL;
+        } else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+        }
+        return true;
+
+    case ST_KEY:
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return true;
+        if (c == '}') {
+            pop();
+        } else if (c == '"') {
+            _frames[_depth - 1].empty = false;
+            _string_is_key = true;
+            _len = 0;
+            _state = ST_STRING;
+        } else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+        }
+        return true;
+
+    case ST_COLON:
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return true;
+        if (c == ':') {
+            _state = ST_VALUE;
+        } else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+        }
+        return true;
+
+    case ST_AFTER_VALUE: {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return true;
+        Frame &frame = _frames[_depth - 1];
+        if (c == ',') {
+            if (frame.is_array) {
+                frame.index++;
+                _state = ST_VALUE;
+            } else {
+                _state = ST_KEY;
+            }
+        } else if ((c == ']' && frame.is_array) || (c == '}' && !frame.is_array)) {
+            pop();
+        } else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+        }
+        return true;
+    }
+
+    case ST_STRING:
+        if (c == '"') {
+            if (_string_is_key) {
+                _frames[_depth - 1].key[_len] = '\0';
+                _string_is_key = false;
+                _state = ST_COLON;
+            } else {
+                emit(JSONSTREAM_STRING);
+            }
+        } else if (c == '\\') {
+            _state = ST_STRING_ESCAPE;
+        } else {
+            append(c);
+        }
+        return true;
+
+    case ST_STRING_ESCAPE:
+        _state = ST_STRING;
+        switch (c) {
+        case 'b': append('\b'); break;
+        case 'f': append('\f'); break;
+        case 'n': append('\n'); break;
+        case 'r': append('\r'); break;
+        case 't': append('\t'); break;
+        case 'u':
+            _unicode = 0;
+            _unicode_digits = 0;
+            _state = ST_STRING_UNICODE;
+            break;
+        default:  append(c); break;  // '"', '\\', '/'
+        }
+        return true;
+
+    case ST_STRING_UNICODE:
+        _unicode <<= 4;
+        if (c >= '0' && c <= '9')      _unicode |= c - '0';
+        else if (c >= 'a' && c <= 'f') _unicode |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') _unicode |= c - 'A' + 10;
+        else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+            return true;
+        }
+        if (++_unicode_digits == 4) {
+            append_utf8(_unicode);
+            _state = ST_STRING;
+        }
+        return true;
+
+    case ST_NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+            append(c);
+            return true;
+        }
+        emit(JSONSTREAM_NUMBER);
+        return _status != JSONSTREAM_BUSY;  // re-evaluate terminator
+
+    case ST_LITERAL:
+        if (c >= 'a' && c <= 'z') {
+            append(c);
+            return true;
+        }
+        _value[_len] = '\0';
+        if (strcmp(_value, "true") == 0 || strcmp(_value, "false") == 0) {
+            emit(JSONSTREAM_BOOL);
+        } else if (strcmp(_value, "null") == 0) {
+            emit(JSONSTREAM_NULL);
+        } else {
+            _state = ST_END;
+            _status = JSONSTREAM_ERROR;
+        }
+        return _status != JSONSTREAM_BUSY;
+
+    default:
+        return true;
+    }
+}
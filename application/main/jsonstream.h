@@ -0,0 +1,171 @@
+/**
+ * @file jsonstream.h
+ * @brief Streaming (SAX-style) JSON tokenizer for ESP32
+ *
+ * Parses JSON byte by byte without building a document. Every scalar value is
+ * reported to a listener together with its path, so the caller can copy the
+ * fields it needs directly into its own structures while the bytes arrive.
+ */
+
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+#include <Arduino.h>
+
+/**
+ * @defgroup jsonstream_constants Tokenizer Limits
+ * @brief Fixed buffer sizes, no heap is used while parsing
+ * @{
+ */
+#define JSONSTREAM_MAX_DEPTH   8    ///< Maximum nesting depth of objects/arrays
+#define JSONSTREAM_KEY_SIZE    24   ///< Maximum key length incl. terminator (longer keys are truncated)
+#define JSONSTREAM_VALUE_SIZE  64   ///< Maximum scalar length incl. terminator (longer values are truncated)
+#define JSONSTREAM_READ_CHUNK  128  ///< Bytes read from a Stream per iteration
+/** @} */
+
+/**
+ * @enum JsonStreamType
+ * @brief Type of a reported scalar value
+ */
+enum JsonStreamType : uint8_t {
+    JSONSTREAM_NULL   = 0, ///< null literal
+    JSONSTREAM_BOOL   = 1, ///< true / false literal
+    JSONSTREAM_NUMBER = 2, ///< number, reported as text
+    JSONSTREAM_STRING = 3, ///< string, unescaped (UTF-8)
+};
+
+/**
+ * @enum JsonStreamStatus
+ * @brief Parser state returned by feed() and parse()
+ */
+enum JsonStreamStatus : uint8_t {
+    JSONSTREAM_BUSY  = 0, ///< document not complete yet
+    JSONSTREAM_DONE  = 1, ///< root value complete
+    JSONSTREAM_ERROR = 2, ///< malformed input or stream timeout
+};
+
+class JsonStreamParser;
+
+/**
+ * @class JsonStreamListener
+ * @brief Receives values from JsonStreamParser
+ */
+class JsonStreamListener {
+public:
+    virtual ~JsonStreamListener() {}
+
+    /**
+     * @brief Called for every scalar value
+     * @param parser Parser, use match() to check the path of the value
+     * @param type Value type
+     * @param value Null-terminated value text ("null", "true", "123", unescaped string)
+     */
+    virtual void value(JsonStreamParser &parser, JsonStreamType type, const char *value) = 0;
+
+    /**
+     * @brief Called after an object or array has been closed
+     * @param parser Parser, match() refers to the path of the closed container
+     */
+    virtual void end(JsonStreamParser &parser) { (void)parser; }
+};
+
+/**
+ * @class JsonStreamParser
+ * @brief Single pass JSON tokenizer with path tracking
+ *
+ * Paths are written as dotted keys with "[]" for any array index or "[n]" for
+ * a fixed index, e.g. "data.graphData[].Timestamp" or "data.activeSensors[0].sensor.pt".
+ */
+class JsonStreamParser {
+public:
+    /**
+     * @brief Create parser
+     * @param listener Receiver of the parsed values
+     */
+    explicit JsonStreamParser(JsonStreamListener &listener);
+
+    /**
+     * @brief Reset parser for a new document
+     */
+    void reset();
+
+    /**
+     * @brief Feed a chunk of raw JSON bytes
+     * @param data Input bytes
+     * @param len Number of bytes
+     * @return JsonStreamStatus after the chunk
+     */
+    uint8_t feed(const char *data, size_t len);
+
+    /**
+     * @brief Read and parse a complete document from a stream
+     *
+     * Reads until the root value is complete; stops on error or when the
+     * stream timeout expires without data.
+     * @param stream Input stream (e.g. HTTPClient::getStream())
+     * @return JsonStreamStatus
+     */
+    uint8_t parse(Stream &stream);
+
+    /**
+     * @brief Check if the current value path matches a pattern
+     * @param path Pattern like "data.graphData[].ValueInMgPerDl"
+     * @return true if path matches
+     */
+    bool match(const char *path) const;
+
+    /**
+     * @brief Array index at a given nesting level
+     * @param level Nesting level (0 = root container)
+     * @return Current index or -1 if level is not an array
+     */
+    int16_t index(uint8_t level) const;
+
+    uint8_t depth() const { return _depth; }        ///< Current nesting depth
+    uint8_t status() const { return _status; }      ///< Current JsonStreamStatus
+    uint32_t bytes() const { return _bytes; }       ///< Bytes consumed since reset()
+    bool truncated() const { return _truncated; }   ///< A key or value exceeded its buffer
+
+private:
+    struct Frame {
+        bool is_array;                      ///< array or object
+        bool empty;                         ///< no member seen yet
+        int16_t index;                      ///< current array index
+        char key[JSONSTREAM_KEY_SIZE];      ///< current object key
+    };
+
+    enum State : uint8_t {
+        ST_VALUE,           ///< expecting a value
+        ST_KEY,             ///< expecting a key or '}'
+        ST_COLON,           ///< expecting ':'
+        ST_AFTER_VALUE,     ///< expecting ',' or closing bracket
+        ST_STRING,          ///< inside a string
+        ST_STRING_ESCAPE,   ///< after backslash
+        ST_STRING_UNICODE,  ///< inside \uXXXX
+        ST_NUMBER,          ///< inside a number
+        ST_LITERAL,         ///< inside true/false/null
+        ST_END,             ///< root complete or error
+    };
+
+    bool process(char c);
+    void push(bool is_array);
+    void pop();
+    void emit(JsonStreamType type);
+    void append(char c);
+    void append_utf8(uint16_t code);
+
+    JsonStreamListener &_listener;
+    Frame _frames[JSONSTREAM_MAX_DEPTH];
+    char _value[JSONSTREAM_VALUE_SIZE];
+    uint8_t _depth;
+    uint8_t _state;
+    uint8_t _status;
+    bool _string_is_key;
+    bool _truncated;
+    uint8_t _len;
+    uint8_t _unicode_digits;
+    uint16_t _unicode;
+    uint32_t _bytes;
+};
+
+#endif // JSONSTREAM_H
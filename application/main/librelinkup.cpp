@@ -15,6 +15,7 @@ extern HELPER helper;
 #include "settings.h"
 extern SETTINGS settings;                   // Deklariert die globale Instanz aus main.cpp
 
+#include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 
@@ -22,30 +23,227 @@ extern SETTINGS settings;                   // Deklariert die globale Instanz au
 
 #include <FS.h>
 #include <LittleFS.h>
+#include <Preferences.h>
 #include <string.h>
 
-// Globale JSON-Pointer
-#define LIBRELINKUP_JSON_BUFFER_SIZE        12000 //6144
-#define LIBRELINKUP_FILTER_JSON_BUFFER_SIZE 1024
-
+#include "jsonstream.h"
+#include "httpstream.h"
+#include "inflatestream.h"
 
-// DynamicJsonDocument mit dem PSRAM-Speicher initialisieren
-DynamicJsonDocument* json_librelinkup = new DynamicJsonDocument(LIBRELINKUP_JSON_BUFFER_SIZE);
-DynamicJsonDocument* json_filter = new DynamicJsonDocument(LIBRELINKUP_FILTER_JSON_BUFFER_SIZE);
+// JSON Buffer Größen (nur noch temporär für auth/tou, /connections und /graph werden gestreamt)
+#define LIBRELINKUP_JSON_BUFFER_SIZE        2048
+#define LIBRELINKUP_FILTER_JSON_BUFFER_SIZE 1024
 
-/*
-// Aufräumen falls nötig
-  json_librelinkup->~DynamicJsonDocument(); // Destruktor manuell aufrufen
-  heap_caps_free(psramPtr_librelinkup);
-*/
+// connect to a cached address, SNI and the certificate check still use the host name
+class LLUClientSecure : public WiFiClientSecure {
+public:
+    int connect_address(IPAddress ip, uint16_t port, const char *host){
+        return WiFiClientSecure::connect(ip, port, host, _CA_cert, _cert, _private_key);
+    }
+};
 
-WiFiClientSecure *llu_client = new WiFiClientSecure;
+LLUClientSecure *llu_client = new LLUClientSecure;
 HTTPClient https;
+HttpBodyStream llu_body;                    // body of the current response (chunked / content-length)
+InflateStream llu_inflate;                  // decompressed body if the server sent gzip / deflate
+static Stream *llu_response = &llu_body;    // what the parsers read: llu_body or llu_inflate
+static bool llu_response_open = false;      // a response body is attached (byte counters valid)
 
 //------------------------[uuid logger]-----------------------------------
 static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
 //------------------------------------------------------------------------
 
+/* LLU_GraphListener
+ *
+ * collects the needed values of the /graph response while it is streamed and
+ * copies them into the LIBRELINKUP data structures with commit() once the
+ * response is complete, a truncated response leaves the last values untouched.
+ * Missing fields behave like before with ArduinoJson (String "null", number 0).
+ * With a ring (patient not on screen) only the graph points are appended to it.
+ * All used values are added to a FNV-1a hash, so an unchanged response can be
+ * detected without comparing the data structures afterwards.
+ */
+class LLU_GraphListener : public JsonStreamListener {
+public:
+    explicit LLU_GraphListener(LIBRELINKUP &llu, LIBRELINKUP::History *ring = NULL) : _llu(llu), _ring(ring) {}
+
+    // default values for fields which are missing in the response
+    void preset(){
+        _glucose = _llu.llu_glucose_data;
+        _sensor  = _llu.llu_sensor_data;
+
+        _glucose.glucoseMeasurement          = 0;
+        _glucose.trendArrow                  = 0;
+        _glucose.measurement_color           = 0;
+        _glucose.str_TrendMessage            = "null";
+        _glucose.str_measurement_timestamp   = "null";
+        _glucose.measurement_unixtime        = 0;
+
+        _glucose.glucosetargetLow            = 0;
+        _glucose.glucosetargetHigh           = 0;
+        _glucose.glucoseAlarmLow             = 0;
+        _glucose.glucoseAlarmHigh            = 0;
+        _glucose.glucosefixedLowAlarmValues  = 0;
+
+        _connection_country                  = "null";
+        _connection_status                   = 0;
+        _sensor.sensor_sn_non_active         = "null";
+        _sensor.sensor_id_non_active         = "null";
+        _sensor.sensor_non_activ_unixtime    = 0;
+
+        _sensor.sensor_id                    = "null";
+        _sensor.sensor_sn                    = "null";
+        _sensor.sensor_state                 = 0;
+        _sensor.sensor_activation_time       = 0;
+    }
+
+    // copy the values of the complete response into the data structures
+    void commit(){
+        _llu.llu_glucose_data                     = _glucose;
+        _llu.llu_sensor_data                      = _sensor;
+        _llu.llu_login_data.connection_country    = _connection_country;
+        _llu.llu_login_data.connection_status     = _connection_status;
+
+        // add current glucosemeasurement to last position (142)
+        _llu.llu_sensor_history_data.graph_data[((LIBRELINKUP::GRAPHDATAARRAYSIZE+LIBRELINKUP::GRAPHDATAARRAYSIZE_PLUS_ONE)-1)] = _llu.llu_glucose_data.glucoseMeasurement;
+    }
+
+    // end of a graphData point
+    void end(JsonStreamParser &parser) override {
+        if(parser.match("data.graphData[]")){
+            // known points (older or equal to the newest stored one) are rejected by history_append()
+            if(_point_timestamp != 0 && _point_value != 0){
+                bool appended = (_ring != NULL) ? LIBRELINKUP::ring_append(*_ring, _point_timestamp, _point_value)
+                                                : _llu.history_append(_point_timestamp, _point_value);
+                if(appended) _new_points++;
+            }
+            _point_timestamp = 0;
+            _point_value = 0;
+        }
+    }
+
+    uint8_t new_points() const { return _new_points; }
+    uint32_t hash() const { return _hash; }
+
+    void value(JsonStreamParser &parser, JsonStreamType type, const char *value) override {
+        (void)type;
+
+        // historical glucose data (timestamp and value), collected per point and appended in end()
+        if(parser.match("data.graphData[].FactoryTimestamp")){
+            // FactoryTimestamp is UTC, so the history key does not depend on timezone/DST
+            time_t timestamp = HELPER::parseTimestamp(value, 0);
+            _point_timestamp = (timestamp > 0) ? (uint32_t)timestamp : 0;
+        }else if(parser.match("data.graphData[].ValueInMgPerDl")){
+            _point_value = atoi(value);
+        }
+
+        else if(_ring != NULL)                                                      return;   // history only
+
+        else if(parser.match("data.connection.glucoseMeasurement.ValueInMgPerDl"))  _glucose.glucoseMeasurement = atoi(value);
+        else if(parser.match("data.connection.glucoseMeasurement.TrendArrow"))      _glucose.trendArrow = atoi(value);
+        else if(parser.match("data.connection.glucoseMeasurement.MeasurementColor"))_glucose.measurement_color = atoi(value);
+        else if(parser.match("data.connection.glucoseMeasurement.TrendMessage"))    _glucose.str_TrendMessage = value;
+        else if(parser.match("data.connection.glucoseMeasurement.Timestamp"))       _glucose.str_measurement_timestamp = value;
+        else if(parser.match("data.connection.glucoseMeasurement.FactoryTimestamp")){
+            time_t timestamp = HELPER::parseTimestamp(value, 0);
+            _glucose.measurement_unixtime = (timestamp > 0) ? (uint32_t)timestamp : 0;
+        }
+
+        else if(parser.match("data.connection.targetLow"))                          _glucose.glucosetargetLow = atoi(value);
+        else if(parser.match("data.connection.targetHigh"))                         _glucose.glucosetargetHigh = atoi(value);
+        else if(parser.match("data.connection.patientDevice.ll"))                   _glucose.glucoseAlarmLow = atoi(value);
+        else if(parser.match("data.connection.patientDevice.hl"))                   _glucose.glucoseAlarmHigh = atoi(value);
+        else if(parser.match("data.connection.patientDevice.fixedLowAlarmValues.mgdl")) _glucose.glucosefixedLowAlarmValues = atoi(value);
+
+        else if(parser.match("data.connection.country"))                            _connection_country = value;
+        else if(parser.match("data.connection.status"))                             _connection_status = atoi(value);
+        else if(parser.match("data.connection.sensor.sn"))                          _sensor.sensor_sn_non_active = value;
+        else if(parser.match("data.connection.sensor.deviceId"))                    _sensor.sensor_id_non_active = value;
+        else if(parser.match("data.connection.sensor.a"))                           _sensor.sensor_non_activ_unixtime = strtoul(value, NULL, 10);
+
+        else if(parser.match("data.activeSensors[0].sensor.deviceId"))              _sensor.sensor_id = value;
+        else if(parser.match("data.activeSensors[0].sensor.sn"))                    _sensor.sensor_sn = value;
+        else if(parser.match("data.activeSensors[0].sensor.pt"))                    _sensor.sensor_state = atoi(value);
+        else if(parser.match("data.activeSensors[0].sensor.a"))                     _sensor.sensor_activation_time = strtoul(value, NULL, 10);
+
+        else return;    // not used, e.g. the ticket that changes with every response
+
+        _hash = HELPER::fnv1a(value, _hash);
+    }
+
+private:
+    LIBRELINKUP &_llu;
+    LIBRELINKUP::History *_ring;    // NULL = active patient (llu_history and all other data)
+    uint32_t _point_timestamp = 0;  // current graphData point
+    uint16_t _point_value = 0;
+    uint8_t _new_points = 0;        // points appended to the history during this response
+    uint32_t _hash = HELPER_FNV1A_INIT;  // all used values in response order
+    decltype(LIBRELINKUP::llu_glucose_data) _glucose;   // values of this response, copied by commit()
+    decltype(LIBRELINKUP::llu_sensor_data) _sensor;
+    decltype(LIBRELINKUP::llu_login_data.connection_country) _connection_country;
+    int16_t _connection_status = 0;
+};
+
+/* LLU_ConnectionsListener
+ *
+ * reads the latest measurement of every followed patient from the
+ * /llu/connections response (data[n] -> llu_patients[n]).
+ */
+class LLU_ConnectionsListener : public JsonStreamListener {
+public:
+    explicit LLU_ConnectionsListener(LIBRELINKUP &llu) : _llu(llu) {}
+
+    uint8_t count() const { return _count; }
+
+    void value(JsonStreamParser &parser, JsonStreamType type, const char *value) override {
+        (void)type;
+
+        // data[] is the only array at nesting level 1 (ticket is an object)
+        int16_t slot = parser.index(1);
+        if(slot < 0){
+            return;
+        }
+        if(slot >= LLU_MAX_PATIENTS){
+            _skipped = true;
+            return;
+        }
+        LIBRELINKUP::Patient &patient = _llu.llu_patients[slot];
+
+        // first value of a new data[] element, missing fields are 0
+        if(slot >= _count){
+            _count = slot + 1;
+            patient.glucoseMeasurement   = 0;
+            patient.trendArrow           = 0;
+            patient.measurement_color    = 0;
+            patient.measurement_unixtime = 0;
+        }
+
+        if(parser.match("data[].patientId")){
+            // other patient at this position -> history belongs to somebody else
+            if(patient.patient_id != value){
+                LIBRELINKUP::ring_clear(patient.history);
+                patient.patient_id = value;
+            }
+        }
+        else if(parser.match("data[].firstName"))                           patient.first_name = value;
+        else if(parser.match("data[].lastName"))                            patient.last_name = value;
+        else if(parser.match("data[].glucoseMeasurement.ValueInMgPerDl"))   patient.glucoseMeasurement = atoi(value);
+        else if(parser.match("data[].glucoseMeasurement.TrendArrow"))       patient.trendArrow = atoi(value);
+        else if(parser.match("data[].glucoseMeasurement.MeasurementColor")) patient.measurement_color = atoi(value);
+        else if(parser.match("data[].glucoseMeasurement.FactoryTimestamp")){
+            time_t timestamp = HELPER::parseTimestamp(value, 0);
+            patient.measurement_unixtime = (timestamp > 0) ? (uint32_t)timestamp : 0;
+        }
+    }
+
+    bool skipped() const { return _skipped; }
+
+private:
+    LIBRELINKUP &_llu;
+    uint8_t _count = 0;             // data[] elements seen (max. LLU_MAX_PATIENTS)
+    bool _skipped = false;          // more patients than LLU_MAX_PATIENTS
+};
+
 /* convertToMillis 
  * 
  * Parameter:   uint8_t hours, 
@@ -71,20 +269,35 @@ uint32_t LIBRELINKUP::convertToMillis(uint8_t hours, uint8_t minutes, uint8_t se
  */
 uint8_t LIBRELINKUP::begin(uint8_t use_cert){
     
-    // setup http client
-    https.useHTTP10(true);
+    // setup http client: HTTP/1.1 keep-alive, the TLS connection stays open between the polls
+    static const char *collect_headers[] = {"Transfer-Encoding", "Content-Encoding"};
+    https.useHTTP10(false);
+    https.setReuse(true);
+    https.collectHeaders(collect_headers, sizeof(collect_headers) / sizeof(collect_headers[0]));
     llu_client->setTimeout(10000); //10 sec timeout
 
+    stage_stats.load();
+    load_region();
+
+    // local test server (llu_server) has its own self signed certificate
+    if(use_cert != 0 && base_url != LLU_DEFAULT_BASE_URL){
+        logger.warning("API server %s: certificate is not verified", base_url.c_str());
+        use_cert = 0;
+    }
+
     if(use_cert == 0){
         llu_client->setInsecure();
     }else if(use_cert == 1){
         llu_client->setCACert(API_ROOT_CA);
-    }else if(use_cert == 2){  
-        if(setCAfromfile(*llu_client, path_root_ca_googler4) == 0){    //if cert is not available, or path wrong... DL again
+    }else if(use_cert == 2){
+        // all downloaded roots as one pre-parsed bundle, cached in LittleFS
+        if(setCAbundle(false) == 0){    //no root available... DL again
             DBGprint_LLU;Serial.printf("download GoogleTrustService Root R4 certificate\r\n");
-            download_root_ca_to_file(url_check_GoogleTrustRootR4, path_root_ca_googler4);
+            download_root_ca_to_file(url_dl_GoogleTrustRootR4, path_root_ca_googler4);
+            if(setCAbundle(true) == 0){
+                setCAfromfile(*llu_client, path_root_ca_googler4); // try to set cert again
+            }
         }
-        setCAfromfile(*llu_client, path_root_ca_googler4); // try to set cert again
     }
 
     return 1;
@@ -92,10 +305,10 @@ uint8_t LIBRELINKUP::begin(uint8_t use_cert){
 
 //sha256 account-id calculation as String
 
-String LIBRELINKUP::account_id_sha256(String user_id){
+FixedString<64> LIBRELINKUP::account_id_sha256(const char *user_id){
     // change input to byte array
-    const char *data = user_id.c_str();
-    size_t len = user_id.length();
+    const char *data = user_id;
+    size_t len = strlen(user_id);
 
     // Buffer 32 Byte for SHA-256 Hash
     unsigned char hash[32];
@@ -104,13 +317,15 @@ String LIBRELINKUP::account_id_sha256(String user_id){
     mbedtls_sha256(reinterpret_cast<const unsigned char*>(data), len, hash, 0);
 
     // create Hex-String
-    String hashString;
+    static const char hex[] = "0123456789abcdef";
+    char hash_hex[65];
     for (int i = 0; i < 32; i++) {
-        if (hash[i] < 0x10) hashString += '0'; // add leading zeros
-        hashString += String(hash[i], HEX);    // transform Byte to Hex
+        hash_hex[i * 2]     = hex[hash[i] >> 4];   // transform Byte to Hex (with leading zero)
+        hash_hex[i * 2 + 1] = hex[hash[i] & 0x0F];
     }
-    
-    return hashString;
+    hash_hex[64] = '\0';
+
+    return FixedString<64>(hash_hex);
 }
 
 // check clients 0= not connected
@@ -259,7 +474,7 @@ int LIBRELINKUP::get_remaining_warmup_time(time_t unix_activation_time) {
 
 // check glucose api.libreview.io valid timestamp with ESP32 local time 
 // (0= error or not valid; 1=valid; 2=timecode "00:00:00 00.00.0000" 3= no activated sensor)        
-uint8_t LIBRELINKUP::check_valid_timestamp(String librelinkup_timestamp, uint8_t print_mode){
+uint8_t LIBRELINKUP::check_valid_timestamp(const char *librelinkup_timestamp, uint8_t print_mode){
 
     uint8_t result = 0;
     struct tm timeinfo;
@@ -293,26 +508,20 @@ uint8_t LIBRELINKUP::check_valid_timestamp(String librelinkup_timestamp, uint8_t
     //--------------------------------------------------
     
     // get LLU json timestamp time as int ------------------
-    int hour_librelinkup_timestamp   = 0;
-    int minute_librelinkup_timestamp = 0;
-    int second_librelinkup_timestamp = 0;
-    int day_librelinkup_timestamp    = 0;
-    int month_librelinkup_timestamp  = 0;
-    int year_librelinkup_timestamp   = 0;
-    char meridian[3];
-    
-    if (sscanf(librelinkup_timestamp.c_str(), "%d/%d/%d %d:%d:%d %2s", &librelinkuptimecode.month, &librelinkuptimecode.day, &librelinkuptimecode.year, &librelinkuptimecode.hour, &librelinkuptimecode.minute, &librelinkuptimecode.second, meridian) != 7) {
+    Timestamp_Fields fields;
+
+    if (!HELPER::parseTimestampFields(librelinkup_timestamp, fields)) {
         DBGprint_LLU;Serial.println("Error parsing date/time");
         logger.debug("Error parsing date/time");
 
         return SENSOR_TIMECODE_ERROR;
     }
-    // Adjust for PM
-    if (strcmp(meridian, "PM") == 0 && librelinkuptimecode.hour != 12) {
-        librelinkuptimecode.hour += 12;
-    } else if (strcmp(meridian, "AM") == 0 && librelinkuptimecode.hour == 12) {
-        librelinkuptimecode.hour = 0;
-    }
+    librelinkuptimecode.month  = fields.month;
+    librelinkuptimecode.day    = fields.day;
+    librelinkuptimecode.year   = fields.year;
+    librelinkuptimecode.hour   = fields.hour;
+    librelinkuptimecode.minute = fields.minute;
+    librelinkuptimecode.second = fields.second;
     //---------------------------------------------------------
 
     if(print_mode == 1){      
@@ -339,7 +548,7 @@ uint8_t LIBRELINKUP::check_valid_timestamp(String librelinkup_timestamp, uint8_t
         
         DBGprint_LLU;Serial.println("TimeCode Filter: LibreLinkUp -> 00.00.0000 00:00:00");
         logger.notice("TimeCode Filter: LibreLinkUp -> 00.00.0000 00:00:00");
-        logger.notice("LLU API Timestamp: %s",librelinkup_timestamp.c_str());
+        logger.notice("LLU API Timestamp: %s",librelinkup_timestamp);
         logger.notice("LLU API token: %s",llu_login_data.user_token.c_str());
         result = SENSOR_NOT_ACTIVE;
         
@@ -385,58 +594,172 @@ uint8_t LIBRELINKUP::check_graphdata(void){
     return count_valid_graph_data;
 }
 
+// append point to a history ring buffer, only points newer than the newest stored point
+bool LIBRELINKUP::ring_append(History &ring, uint32_t timestamp, uint16_t value){
+
+    if(ring.count > 0 && timestamp <= ring_newest(ring)){
+        return false;
+    }
+
+    if(ring.count < GRAPHDATAARRAYSIZE){
+        uint8_t pos = (ring.head + ring.count) % GRAPHDATAARRAYSIZE;
+        ring.value[pos] = value;
+        ring.timestamp[pos] = timestamp;
+        ring.count++;
+    }else{
+        // overwrite oldest point
+        ring.value[ring.head] = value;
+        ring.timestamp[ring.head] = timestamp;
+        ring.head = (ring.head + 1) % GRAPHDATAARRAYSIZE;
+    }
+    ring.seq++;
+
+    return true;
+}
+
+// newest timestamp of a history ring, 0 if empty
+uint32_t LIBRELINKUP::ring_newest(const History &ring){
+    if(ring.count == 0){
+        return 0;
+    }
+    return ring.timestamp[(ring.head + ring.count - 1) % GRAPHDATAARRAYSIZE];
+}
+
+// delete all points of a history ring, the sequence number continues
+void LIBRELINKUP::ring_clear(History &ring){
+    ring.head = 0;
+    ring.count = 0;
+}
+
+// append point to the history of the active patient and keep the linear view in sync
+bool LIBRELINKUP::history_append(uint32_t timestamp, uint16_t value){
+
+    bool full = (llu_history.count == GRAPHDATAARRAYSIZE);
+    if(!ring_append(llu_history, timestamp, value)){
+        return false;
+    }
+
+    if(!full){
+        llu_sensor_history_data.graph_data[llu_history.count - 1] = value;
+        llu_sensor_history_data.timestamp[llu_history.count - 1] = timestamp;
+    }else{
+        // linear view: shift one point to the left
+        memmove(&llu_sensor_history_data.graph_data[0], &llu_sensor_history_data.graph_data[1], (GRAPHDATAARRAYSIZE - 1) * sizeof(uint16_t));
+        memmove(&llu_sensor_history_data.timestamp[0], &llu_sensor_history_data.timestamp[1], (GRAPHDATAARRAYSIZE - 1) * sizeof(uint32_t));
+        llu_sensor_history_data.graph_data[GRAPHDATAARRAYSIZE - 1] = value;
+        llu_sensor_history_data.timestamp[GRAPHDATAARRAYSIZE - 1] = timestamp;
+    }
+
+    return true;
+}
+
+// delete history, the sequence number continues so consumers see the new points
+void LIBRELINKUP::history_clear(void){
+    ring_clear(llu_history);
+    graph_hash = 0;
+
+    memset(llu_sensor_history_data.graph_data,0,sizeof(llu_sensor_history_data.graph_data));
+    memset(llu_sensor_history_data.timestamp,0,sizeof(llu_sensor_history_data.timestamp));
+}
+
+// copy points with a sequence number > seq (oldest first)
+uint8_t LIBRELINKUP::get_new_points_since(uint32_t seq, uint16_t *values, uint32_t *timestamps, uint8_t max_points){
+
+    if(seq >= llu_history.seq){
+        return 0;
+    }
+
+    uint32_t new_points = llu_history.seq - seq;
+    if(new_points > llu_history.count) new_points = llu_history.count;    // older points already evicted
+
+    if(values == NULL && timestamps == NULL){
+        return new_points;
+    }
+    uint8_t first = llu_history.count - new_points;
+    if(new_points > max_points) new_points = max_points;   // rest with the next call (seq + returned count)
+    for(uint8_t i=0;i<new_points;i++){
+        uint8_t pos = (llu_history.head + first + i) % GRAPHDATAARRAYSIZE;
+        if(values != NULL)     values[i] = llu_history.value[pos];
+        if(timestamps != NULL) timestamps[i] = llu_history.timestamp[pos];
+    }
+
+    return new_points;
+}
+
 // get auth data from api.libreview.io
 uint16_t LIBRELINKUP::auth_user(String user_email, String user_password){
     
     uint8_t result = 0;
 
-    if (https.begin(*llu_client, base_url + url_user_auth)) {
-        delay(10);        
-        //Serial.println("Connected to: " + url);
+    // temporary JSON documents, only allocated during this request
+    DynamicJsonDocument json_librelinkup(LIBRELINKUP_JSON_BUFFER_SIZE);
+    DynamicJsonDocument json_filter(LIBRELINKUP_FILTER_JSON_BUFFER_SIZE);
 
-        https.addHeader("User-Agent", "Mozilla/5.0");
-        https.addHeader("Content-Type", "application/json");
-        https.addHeader("version", "4.7.0");
-        https.addHeader("product", "llu.ios");
-        https.addHeader("Connection", "keep-alive");
-        https.addHeader("Pragma", "no-cache");
-        https.addHeader("Cache-Control", "no-cache");
+    // JSON data to send with HTTP POST
+    String httpRequestData = "{\"email\":\"" + user_email + "\",\"password\":\"" + user_password + "\"}";
 
-        // JSON data to send with HTTP POST
-        String httpRequestData = "{\"email\":\"" + user_email + "\",\"password\":\"" + user_password + "\"}";           
-        
-        // Send HTTP POST request
-        int code = https.POST(httpRequestData);
+    // Send HTTP POST request
+    int code = request("POST", url_user_auth, httpRequestData, LLU_HEADERS_LOGIN);
+    if (code != 0) {
         //DBGprint_LLU;Serial.printf("HTTP Code: [%d]\r\n", code);
         logger.debug("HTTP Code: [%d]\r\n", code);
 
         if (code > 0) {
             if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
                 
+                // The filter: it contains "true" for each value we want to keep
+                json_filter["status"] = true;
+                json_filter["data"]["user"]["id"] = true;
+                json_filter["data"]["user"]["country"] = true;
+                json_filter["data"]["authTicket"]["token"] = true;
+                json_filter["data"]["authTicket"]["expires"] = true;
+                json_filter["data"]["redirect"] = true;
+                json_filter["data"]["region"] = true;
+
                 //Parse response
-                deserializeJson((*json_librelinkup), https.getStream());
+                deserializeJson(json_librelinkup, *llu_response, DeserializationOption::Filter(json_filter));
                     
                 //Read values
-                //serializeJsonPretty(*json_librelinkup, Serial);Serial.println();
-
-                llu_login_data.user_login_status   = (*json_librelinkup)["status"].as<uint8_t>();
-                llu_login_data.user_country        = (*json_librelinkup)["data"]["user"]["country"].as<String>();
-                llu_login_data.user_id             = (*json_librelinkup)["data"]["user"]["id"].as<String>();
-                llu_login_data.user_token          = (*json_librelinkup)["data"]["authTicket"]["token"].as<String>();
-                llu_login_data.user_token_expires  = (*json_librelinkup)["data"]["authTicket"]["expires"].as<uint32_t>();
+                //serializeJsonPretty(json_librelinkup, Serial);Serial.println();
+
+                llu_login_data.user_login_status   = json_librelinkup["status"].as<uint8_t>();
+                llu_login_data.user_country        = json_librelinkup["data"]["user"]["country"].as<const char*>();
+                llu_login_data.user_id             = json_librelinkup["data"]["user"]["id"].as<const char*>();
+                llu_login_data.user_token          = json_librelinkup["data"]["authTicket"]["token"].as<const char*>();
+                if(llu_login_data.user_token.truncated()){
+                    logger.err("auth token longer than %d characters", llu_login_data.user_token.capacity());
+                }
+                llu_login_data.user_token_expires  = json_librelinkup["data"]["authTicket"]["expires"].as<uint32_t>();
                 
                 // calculate SHA256 Hash for Account-ID header
-                llu_login_data.account_id = account_id_sha256(llu_login_data.user_id);
+                llu_login_data.account_id = account_id_sha256(llu_login_data.user_id.c_str());
+                llu_login_data.token_from_cache = 0;
+
+                // account of another region: no token, login again at the regional host
+                if(json_librelinkup["data"]["redirect"].as<bool>()){
+                    const char *redirect_region = json_librelinkup["data"]["region"].as<const char*>();
+                    if(redirect_region == NULL) redirect_region = "";
+                    logger.notice("LLU login redirect to region %s", redirect_region);
+                    if(region != redirect_region && set_region(redirect_region)){
+                        save_region();
+                        login_redirected = true;     // ensure_connection() opens the regional host
+                    }
+                }
+
+                // keep the token over reboots / OTA restarts
+                if(llu_login_data.user_login_status == 0 && has_token()){
+                    save_token();
+                }
 
                 Serial.println();
                 DBGprint_LLU;Serial.println("LibreLinkUp Authentification for:");
                 DBGprint_LLU;Serial.print("user_email        : ");Serial.println(settings.config.login_email);
-                DBGprint_LLU;Serial.print("user_country      : ");Serial.println(llu_login_data.user_country);
-                DBGprint_LLU;Serial.print("user_id           : ");Serial.println(llu_login_data.user_id);
-                DBGprint_LLU;Serial.print("user_token        : ");Serial.println(llu_login_data.user_token);
+                DBGprint_LLU;Serial.print("user_country      : ");Serial.println(llu_login_data.user_country.c_str());
+                DBGprint_LLU;Serial.print("user_id           : ");Serial.println(llu_login_data.user_id.c_str());
+                DBGprint_LLU;Serial.print("user_token        : ");Serial.println(llu_login_data.user_token.c_str());
                 DBGprint_LLU;Serial.print("token_exp.        : ");Serial.println(llu_login_data.user_token_expires);
                 DBGprint_LLU;Serial.print("user_login_status : ");Serial.println(llu_login_data.user_login_status);
-                DBGprint_LLU;Serial.print("account-id        : ");Serial.println(llu_login_data.account_id);
+                DBGprint_LLU;Serial.print("account-id        : ");Serial.println(llu_login_data.account_id.c_str());
 
                 logger.debug("LibreLinkUp Authentification for:");
                 logger.debug("user_email        : %s",settings.config.login_email.c_str());
@@ -448,25 +771,18 @@ uint16_t LIBRELINKUP::auth_user(String user_email, String user_password){
                 logger.debug("account-id        : %s",llu_login_data.account_id.c_str());
 
                 Json_Buffer_Info buffer_info;
-                buffer_info = helper.getBufferSize(&(*json_librelinkup));
+                buffer_info = helper.getBufferSize(&json_librelinkup);
                 logger.debug("auth json_librelinkup: Used Bytes / Total Capacity: %d / %d", buffer_info.usedCapacity, buffer_info.totalCapacity);
 
-                json_librelinkup->clear();                                          //clears the data object
+                json_librelinkup.clear();                                          //clears the data object
             }
         }
         else {
             DBGprint_LLU; Serial.printf("[HTTP] POST... failed, error: %s\r\n", https.errorToString(code).c_str());
             logger.debug("[HTTP] POST... failed, error: %s\r\n", https.errorToString(code).c_str());
         }
-        // Free resources
-        https.end();
-        //check if client is still connected
-        if(llu_client->connected()){
-            DBGprint_LLU;Serial.printf("LLU client connected: %d\r\n",llu_client->connected());
-            logger.debug("LLU client connected: %d\r\n",llu_client->connected());
-            llu_client->flush();
-            llu_client->stop();
-        }
+        // Free resources, connection stays open for the next request
+        end_request();
         result = 1;
     }
     
@@ -478,43 +794,40 @@ uint16_t LIBRELINKUP::tou_user(void){
     
     uint8_t result = 0;
 
-    if (https.begin(*llu_client, base_url + url_user_tou)) {
-        delay(10);        
-        //Serial.println("Connected to: " + url);
+    // temporary JSON documents, only allocated during this request
+    DynamicJsonDocument json_librelinkup(LIBRELINKUP_JSON_BUFFER_SIZE);
+    DynamicJsonDocument json_filter(LIBRELINKUP_FILTER_JSON_BUFFER_SIZE);
 
-        https.addHeader("User-Agent", "Mozilla/5.0");
-        https.addHeader("Content-Type", "application/json");
-        https.addHeader("version", "4.7.0");
-        https.addHeader("product", "llu.ios");
-        https.addHeader("Connection", "keep-alive");
-        https.addHeader("Pragma", "no-cache");
-        https.addHeader("Cache-Control", "no-cache");
-        https.addHeader("Authorization","Bearer " + llu_login_data.user_token + "");
+    // JSON data to send with HTTP POST
+    String httpRequestData = "";
 
-        // JSON data to send with HTTP POST
-        String httpRequestData = "";           
-        
-        // Send HTTP POST request
-        int code = https.POST(httpRequestData);
+    // Send HTTP POST request
+    int code = request("POST", url_user_tou, httpRequestData, LLU_HEADERS_TOU);
+    if (code != 0) {
         DBGprint_LLU;Serial.printf("HTTP Code: [%d]\r\n", code);
 
         if (code > 0) {
             if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
                 
+                // The filter: it contains "true" for each value we want to keep
+                json_filter["status"] = true;
+                json_filter["data"]["user"]["id"] = true;
+                json_filter["data"]["user"]["country"] = true;
+
                 //Parse response
-                deserializeJson((*json_librelinkup), https.getStream());
+                deserializeJson(json_librelinkup, *llu_response, DeserializationOption::Filter(json_filter));
                     
                 //Read values
-                //serializeJsonPretty(*json_librelinkup, Serial);Serial.println();
+                //serializeJsonPretty(json_librelinkup, Serial);Serial.println();
 
-                llu_login_data.user_login_status   = (*json_librelinkup)["status"].as<uint8_t>();
-                llu_login_data.user_id             = (*json_librelinkup)["data"]["user"]["id"].as<String>();
-                llu_login_data.user_country        = (*json_librelinkup)["data"]["user"]["country"].as<String>();
+                llu_login_data.user_login_status   = json_librelinkup["status"].as<uint8_t>();
+                llu_login_data.user_id             = json_librelinkup["data"]["user"]["id"].as<const char*>();
+                llu_login_data.user_country        = json_librelinkup["data"]["user"]["country"].as<const char*>();
                 
                 Serial.println();
                 DBGprint_LLU;Serial.print("LibreLinkUp Accept Terms for: ");Serial.println(settings.config.login_email);
-                DBGprint_LLU;Serial.print("user_id           : ");Serial.println(llu_login_data.user_id);
-                DBGprint_LLU;Serial.print("user_country      : ");Serial.println(llu_login_data.user_country);
+                DBGprint_LLU;Serial.print("user_id           : ");Serial.println(llu_login_data.user_id.c_str());
+                DBGprint_LLU;Serial.print("user_country      : ");Serial.println(llu_login_data.user_country.c_str());
                 DBGprint_LLU;Serial.print("user_login_status : ");Serial.println(llu_login_data.user_login_status);
                 Serial.println();
 
@@ -524,308 +837,399 @@ uint16_t LIBRELINKUP::tou_user(void){
                 logger.debug("user_login_status : %d",llu_login_data.user_login_status);
 
                 Json_Buffer_Info buffer_info;
-                buffer_info = helper.getBufferSize(&(*json_librelinkup));
+                buffer_info = helper.getBufferSize(&json_librelinkup);
                 logger.debug("tou json_librelinkup: Used Bytes / Total Capacity: %d / %d", buffer_info.usedCapacity, buffer_info.totalCapacity);
 
-                json_librelinkup->clear();                                          //clears the data object
+                json_librelinkup.clear();                                          //clears the data object
             }
         }
         else {
             DBGprint_LLU; Serial.printf("[HTTP] POST... failed, error: %s\r\n", https.errorToString(code).c_str());
             logger.debug("[HTTP] POST... failed, error: %s\r\n", https.errorToString(code).c_str());
         }
-        // Free resources
-        https.end();
-        //check if client is still connected
-        if(llu_client->connected()){
-            DBGprint_LLU;Serial.printf("LLU client connected: %d\r\n",llu_client->connected());
-            llu_client->flush();
-            llu_client->stop();
-        }
+        // Free resources, connection stays open for the next request
+        end_request();
         result = 1;
     }
     
     return result;
 }
 
-// get graph glycose data from api.libreview.io
+// session state machine: token from memory, NVS cache or full auth flow.
+// at most LLU_SESSION_MAX_STEPS states per call, a failed login waits in LLU_SESSION_BACKOFF
+uint8_t LIBRELINKUP::ensure_token(void){
+
+    uint8_t redirects = 0;
+    for(uint8_t step = 0; step < LLU_SESSION_MAX_STEPS; step++){
+        switch(llu_session.state){
+
+            case LLU_SESSION_READY: {
+                if(!has_token()){
+                    llu_session.state = LLU_SESSION_LOGGED_OUT;
+                    break;
+                }
+                // renew before the server rejects it, only with a valid clock
+                time_t now = time(NULL);
+                if(now > LLU_CLOCK_VALID && llu_login_data.user_token_expires != 0 &&
+                   (time_t)llu_login_data.user_token_expires < now + LLU_TOKEN_REFRESH_MARGIN){
+                    logger.notice("LLU token expires soon -> renew");
+                    llu_login_data.user_token = "";
+                    llu_session.state = LLU_SESSION_AUTHENTICATING;
+                    break;
+                }
+                llu_session.failures = 0;
+                return 1;
+            }
+
+            case LLU_SESSION_LOGGED_OUT:
+                llu_session.state = (has_token() || load_token()) ? LLU_SESSION_READY : LLU_SESSION_AUTHENTICATING;
+                break;
+
+            case LLU_SESSION_AUTHENTICATING:
+                logger.debug("Auth User: no user_id available!");
+                DBGprint_LLU;Serial.println("Auth User: no user_id available!");
+                llu_session.logins++;
+                login_redirected = false;
+                auth_user(settings.config.login_email,settings.config.login_password);
+                if(login_redirected && redirects++ == 0){
+                    break;      // same state, login at the regional host
+                }
+                if(llu_login_data.user_login_status == 4){
+                    DBGprint_LLU;Serial.println("LLU Login: Tou required");
+                    logger.debug("LLU Login: Tou required");
+                    llu_session.state = LLU_SESSION_TOU_PENDING;
+                }else if(has_token()){
+                    llu_session.state = LLU_SESSION_READY;
+                }else{
+                    session_backoff("login failed");
+                    return 0;
+                }
+                break;
+
+            case LLU_SESSION_TOU_PENDING:
+                tou_user();
+                if(llu_login_data.user_login_status == 4 || !has_token()){
+                    session_backoff("terms of use not accepted");
+                    return 0;
+                }
+                llu_session.tou++;
+                llu_session.state = LLU_SESSION_READY;
+                break;
+
+            case LLU_SESSION_BACKOFF:
+                if(session_backoff_in() > 0){
+                    return 0;
+                }
+                llu_session.state = LLU_SESSION_LOGGED_OUT;
+                break;
+
+            default:
+                llu_session.state = LLU_SESSION_LOGGED_OUT;
+                break;
+        }
+    }
+
+    return 0;
+}
+
+void LIBRELINKUP::session_invalidate(const char *reason){
+
+    logger.notice("LLU session invalidated (%s) -> new login", reason);
+    clear_token();
+    llu_session.state = LLU_SESSION_LOGGED_OUT;
+}
+
+// wait LLU_SESSION_BACKOFF_MIN * 2^failures before the next login
+void LIBRELINKUP::session_backoff(const char *reason){
+
+    uint32_t delay = LLU_SESSION_BACKOFF_MIN;
+    for(uint8_t i = 0; i < llu_session.failures && delay < LLU_SESSION_BACKOFF_MAX; i++){
+        delay *= 2;
+    }
+    if(delay > LLU_SESSION_BACKOFF_MAX){
+        delay = LLU_SESSION_BACKOFF_MAX;
+    }
+    if(llu_session.failures < UINT8_MAX){
+        llu_session.failures++;
+    }
+    llu_session.backoff_until = millis() + delay;
+    llu_session.state = LLU_SESSION_BACKOFF;
+    logger.notice("LLU %s -> next login in %ds (failures: %d)", reason, delay / 1000, llu_session.failures);
+}
+
+uint32_t LIBRELINKUP::session_backoff_in(void) const {
+
+    if(llu_session.state != LLU_SESSION_BACKOFF){
+        return 0;
+    }
+    int32_t remaining = (int32_t)(llu_session.backoff_until - millis());
+    return (remaining > 0) ? remaining : 0;
+}
+
+const char *LIBRELINKUP::session_name(uint8_t state){
+
+    static const char *const names[] = {"logged out", "authenticating", "tou pending", "ready", "backoff"};
+    return (state < sizeof(names) / sizeof(names[0])) ? names[state] : "?";
+}
+
+bool LIBRELINKUP::has_token(void){
+    return llu_login_data.user_id != "" && llu_login_data.user_id != "null" &&
+           llu_login_data.user_token != "" && llu_login_data.user_token != "null";
+}
+
+// read cached token from NVS, bound to the configured login email
+uint8_t LIBRELINKUP::load_token(void){
+
+    uint8_t result = 0;
+    Preferences prefs;
+
+    if(!prefs.begin(LLU_TOKEN_NAMESPACE, true)){
+        return result;                      // nothing cached yet
+    }
+
+    if(prefs.getUChar("version", 0) == LLU_TOKEN_VERSION &&
+       account_id_sha256(settings.config.login_email.c_str()) == prefs.getString("email_sha256", "")){
+
+        uint32_t expires = prefs.getUInt("expires", 0);
+        time_t now = time(NULL);
+
+        // without SNTP the expiry can not be checked, a rejected token falls back to auth_user()
+        if(now < LLU_CLOCK_VALID || (time_t)expires > now + LLU_TOKEN_REFRESH_MARGIN){
+            llu_login_data.user_id            = prefs.getString("user_id", "");
+            llu_login_data.user_token         = prefs.getString("token", "");
+            llu_login_data.user_country       = prefs.getString("country", "");
+            llu_login_data.user_token_expires = expires;
+            llu_login_data.account_id         = account_id_sha256(llu_login_data.user_id.c_str());
+            llu_login_data.user_login_status  = 0;
+            llu_login_data.token_from_cache   = 1;
+            result = has_token() ? 1 : 0;
+            logger.notice("LLU token loaded from cache (expires: %d)", expires);
+        }else{
+            logger.notice("LLU cached token expired");
+        }
+    }
+    prefs.end();
+
+    return result;
+}
+
+void LIBRELINKUP::save_token(void){
+
+    Preferences prefs;
+    if(!prefs.begin(LLU_TOKEN_NAMESPACE, false)){
+        logger.err("LLU token cache: NVS not available");
+        return;
+    }
+    prefs.putUChar("version", LLU_TOKEN_VERSION);
+    prefs.putString("email_sha256", account_id_sha256(settings.config.login_email.c_str()).c_str());
+    prefs.putString("user_id", llu_login_data.user_id.c_str());
+    prefs.putString("token", llu_login_data.user_token.c_str());
+    prefs.putString("country", llu_login_data.user_country.c_str());
+    prefs.putUInt("expires", llu_login_data.user_token_expires);
+    prefs.end();
+
+    logger.debug("LLU token cached (expires: %d)", llu_login_data.user_token_expires);
+}
+
+void LIBRELINKUP::clear_token(void){
+
+    llu_login_data.user_token = "";
+    llu_login_data.user_token_expires = 0;
+    llu_login_data.token_from_cache = 0;
+
+    Preferences prefs;
+    if(prefs.begin(LLU_TOKEN_NAMESPACE, false)){
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+// get all followed patients from api.libreview.io (latest measurement of every patient)
 uint16_t LIBRELINKUP::get_connection_data(void){
     
     int8_t result = 0;
-    
-    // resets previuos timestamp
-    llu_glucose_data.str_measurement_timestamp = "";
-    
+
     // get user ID and Token, if AuthToken not already pulled 
-    if(llu_login_data.user_id == "" || llu_login_data.user_token == "" || llu_login_data.user_token == "null" /*strcmp(user_token.c_str(), "null") == 0*/){
-        logger.debug("Auth User: no user_id available!");
-        DBGprint_LLU;Serial.println("Auth User: no user_id available!");
-        auth_user(settings.config.login_email,settings.config.login_password);
-        if(llu_login_data.user_login_status == 4){
-            DBGprint_LLU;Serial.println("LLU Login: Tou required");
-            tou_user();
-        }
+    if(!ensure_token()){
+        return 0;
     }
 
-    // get API graph data from LibreView server 
-    if(https.begin(*llu_client, base_url + url_connection)) {
-        delay(10);        
+    // get API connection data from LibreView server (keep-alive connection)
+    int code = request("GET", url_connection, "", LLU_HEADERS_API);
+    if(code != 0) {
 
-        https.addHeader("User-Agent", "Mozilla/5.0");
-        https.addHeader("Content-Type", "application/json");
-        https.addHeader("version", "4.12.0");
-        https.addHeader("product", "llu.ios");
-        https.addHeader("Connection", "keep-alive");
-        //https.addHeader("Accept-Encoding", "gzip, deflate, br");
-        https.addHeader("Pragma", "no-cache");
-        https.addHeader("Cache-Control", "no-cache");
-        https.addHeader("Authorization","Bearer " + llu_login_data.user_token);
-        https.addHeader("Account-ID", llu_login_data.account_id);
+        if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
 
-        int code = https.GET();
-        //DBGprint_LLU;Serial.printf("HTTP Code: [%d]\r\n", code);
+            // parse response directly from the TLS stream into llu_patients
+            LLU_ConnectionsListener connections_listener(*this);
+            JsonStreamParser parser(connections_listener);
 
-        if (code > 0) {
-            if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
+            uint8_t parse_status = parser.parse(*llu_response);
+            if(parse_status != JSONSTREAM_DONE){
+                logger.err("connections stream parse error after %d bytes", parser.bytes());
+            }else{
+                llu_patient_count = connections_listener.count();
+                if(llu_active_patient >= llu_patient_count){
+                    llu_active_patient = 0;
+                }
+                if(connections_listener.skipped()){
+                    logger.warning("more than %d patients, only the first %d are followed", LLU_MAX_PATIENTS, LLU_MAX_PATIENTS);
+                }
+                logger.debug("connections stream: %d bytes parsed, %d patients", parser.bytes(), llu_patient_count);
+                result = 1;
+            }
+        }
+        else if (code < 0) {
+            logger.debug("[HTTP] GET... failed, error: %s", https.errorToString(code).c_str());
+        }
+        // Free https resources, connection stays open for the next request
+        end_request();
+    }
 
-                // The filter: it contains "true" for each value we want to keep
-                (*json_filter)["data"][0]["glucoseMeasurement"]["Timestamp"] = true;
-                (*json_filter)["data"][0]["glucoseMeasurement"]["ValueInMgPerDl"] = true;
-                (*json_filter)["data"][0]["glucoseMeasurement"]["TrendArrow"] = true;
-                (*json_filter)["data"][0]["glucoseMeasurement"]["TrendMessage"] = true;
-                (*json_filter)["data"][0]["glucoseMeasurement"]["MeasurementColor"] = true;
-                
-                /*
-                (*json_filter)["data"][0]["targetLow"] = true;
-                (*json_filter)["data"][0]["targetHigh"] = true;
-
-                (*json_filter)["data"][0]["sensor"]["deviceId"] = true;
-                (*json_filter)["data"][0]["sensor"]["sn"] = true;
-                (*json_filter)["data"][0]["sensor"]["a"] = true;
-                (*json_filter)["data"][0]["sensor"]["pt"] = true;
-
-                (*json_filter)["data"][0]["patientDevice"]["ll"] = true;
-                (*json_filter)["data"][0]["patientDevice"]["hl"] = true;
-                (*json_filter)["data"][0]["patientDevice"]["fixedLowAlarmValues"]["mgdl"] = true;
-                
-                (*json_filter)["ticket"]["token"] = true;
-                (*json_filter)["ticket"]["expires"] = true;
-                */
+    return result;
+}
 
-                // Deserialize the document with json_filter setting. keep buffer size in mind.
-                deserializeJson((*json_librelinkup), https.getStream(), DeserializationOption::Filter(*json_filter));
-                
-                // Print the result
-                //serializeJsonPretty(((*json_librelinkup)), Serial); Serial.println();
-
-                llu_glucose_data.glucoseMeasurement          = (*json_librelinkup)["data"][0]["glucoseMeasurement"]["ValueInMgPerDl"].as<int>();
-                llu_glucose_data.trendArrow                  = (*json_librelinkup)["data"][0]["glucoseMeasurement"]["TrendArrow"].as<int>();
-                llu_glucose_data.measurement_color           = (*json_librelinkup)["data"][0]["glucoseMeasurement"]["MeasurementColor"].as<int>();
-                llu_glucose_data.str_TrendMessage            = (*json_librelinkup)["data"][0]["glucoseMeasurement"]["TrendMessage"].as<String>();
-                llu_glucose_data.str_measurement_timestamp   = (*json_librelinkup)["data"][0]["glucoseMeasurement"]["Timestamp"].as<String>();
-
-                /*
-                glucosetargetLow            = (*json_librelinkup)["data"][0]["targetLow"].as<int>();
-                glucosetargetHigh           = (*json_librelinkup)["data"][0]["targetHigh"].as<int>();
-                glucoseAlarmLow             = (*json_librelinkup)["data"][0]["patientDevice"]["ll"].as<int>();
-                glucoseAlarmHigh            = (*json_librelinkup)["data"][0]["patientDevice"]["hl"].as<int>();
-                glucosefixedLowAlarmValues  = (*json_librelinkup)["data"][0]["patientDevice"]["fixedLowAlarmValues"]["mgdl"].as<int>();
-
-                sensor_id                   = (*json_librelinkup)["data"][0]["sensor"]["deviceId"].as<String>();
-                sensor_sn                   = (*json_librelinkup)["data"][0]["sensor"]["sn"].as<String>();
-                sensor_state                = (*json_librelinkup)["data"][0]["sensor"]["pt"].as<int>();
-                sensor_activation_time      = (*json_librelinkup)["data"][0]["sensor"]["a"].as<int>();
-                
-                user_token                  = (*json_librelinkup)["ticket"]["token"].as<String>();
-                user_token_expires          = (*json_librelinkup)["ticket"]["expires"].as<uint32_t>();
-                */
+// get graph glycose data of a patient which is not on screen, only the history is updated
+uint16_t LIBRELINKUP::get_patient_graph(uint8_t patient){
 
-                //DBGprint_LLU;Serial.print("glucoseMeasurement: ");Serial.print(glucoseMeasurement);
-                
-                if(llu_glucose_data.trendArrow == 0){
-                    llu_glucose_data.str_trendArrow = "no Data";
-                }else if(llu_glucose_data.trendArrow == 1){
-                    llu_glucose_data.str_trendArrow = "↓";
-                }else if(llu_glucose_data.trendArrow == 2){
-                    llu_glucose_data.str_trendArrow = "↘";
-                }else if(llu_glucose_data.trendArrow == 3){
-                    llu_glucose_data.str_trendArrow = "→";
-                }else if(llu_glucose_data.trendArrow == 4){
-                    llu_glucose_data.str_trendArrow = "↗";
-                }else if(llu_glucose_data.trendArrow == 5){
-                    llu_glucose_data.str_trendArrow = "↑";
-                }
-                
-                json_filter->clear();
-                json_librelinkup->clear();                                          //clears the data object
+    int8_t result = 0;
 
+    if(patient >= llu_patient_count || patient == llu_active_patient || llu_patients[patient].patient_id.isEmpty()){
+        return 0;
+    }
+
+    if(!ensure_token()){
+        return 0;
+    }
+
+    FixedString<64> patient_url_graph;
+    patient_url_graph.printf("/llu/connections/%s/graph", llu_patients[patient].patient_id.c_str());
+
+    int code = request("GET", patient_url_graph.c_str(), "", LLU_HEADERS_API);
+    if(code != 0) {
+        if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
+            LLU_GraphListener graph_listener(*this, &llu_patients[patient].history);
+            JsonStreamParser parser(graph_listener);
+
+            uint8_t parse_status = parser.parse(*llu_response);
+            if(parse_status != JSONSTREAM_DONE){
+                logger.err("graph stream (patient %d) parse error after %d bytes", patient, parser.bytes());
+            }else{
+                logger.debug("graph stream (patient %d): %d bytes parsed, %d new history points", patient, parser.bytes(), graph_listener.new_points());
+                result = 1;
             }
-            result = 1;
-        }
-        else {
-            DBGprint_LLU; Serial.printf("[HTTP] GET... failed, error: %s\r\n", https.errorToString(code).c_str());
-            result = 0;
-                        
-            if (code == HTTP_CODE_UNAUTHORIZED){    //Token Auth Error handling
-                DBGprint_LLU; Serial.println("Error, wrong Token -> reauthorization...");
-                auth_user(settings.config.login_email,settings.config.login_password);             
-                json_filter->clear();
-                json_librelinkup->clear();
-            }
+        }else{
+            // token errors are handled by the next request of the active patient
+            logger.debug("graph (patient %d): HTTP %d", patient, code);
         }
-        // Free https resources
-        https.end();
+        end_request();
+    }
 
-    }else{
-        result = 0;
+    return result;
+}
+
+// a patient not on screen needs /graph only if a new history point is available
+bool LIBRELINKUP::patient_graph_due(uint8_t patient){
+
+    if(patient >= llu_patient_count || patient == llu_active_patient || llu_patients[patient].patient_id.isEmpty()){
+        return false;
     }
+    const Patient &p = llu_patients[patient];
+    if(p.history.count == 0){
+        return true;
+    }
+    return p.measurement_unixtime >= ring_newest(p.history) + LLU_GRAPH_POINT_INTERVAL;
+}
 
-    //check if client is still connected
-    if(llu_client->connected()){
-        DBGprint_LLU;Serial.printf("LLU client still connected: %d\r\n",llu_client->connected());
-        llu_client->flush();
-        llu_client->stop();
+// switch the patient on screen, the history of both patients is kept
+bool LIBRELINKUP::set_active_patient(uint8_t patient){
+
+    if(patient >= llu_patient_count){
+        return false;
+    }
+    if(patient == llu_active_patient){
+        return true;
     }
 
-    return result;
+    // the sequence number keeps counting, so consumers see all points of the new patient as new
+    uint32_t seq = llu_history.seq;
+    llu_patients[llu_active_patient].history = llu_history;
+    llu_history = llu_patients[patient].history;
+    llu_history.seq = seq + llu_history.count;
+    llu_active_patient = patient;
+
+    // rebuild linear view (oldest point first)
+    memset(llu_sensor_history_data.graph_data,0,sizeof(llu_sensor_history_data.graph_data));
+    memset(llu_sensor_history_data.timestamp,0,sizeof(llu_sensor_history_data.timestamp));
+    for(uint8_t i=0;i<llu_history.count;i++){
+        uint8_t pos = (llu_history.head + i) % GRAPHDATAARRAYSIZE;
+        llu_sensor_history_data.graph_data[i] = llu_history.value[pos];
+        llu_sensor_history_data.timestamp[i] = llu_history.timestamp[pos];
+    }
+
+    // latest known values until the next /graph request of the new patient
+    llu_glucose_data.glucoseMeasurement   = llu_patients[patient].glucoseMeasurement;
+    llu_glucose_data.trendArrow           = llu_patients[patient].trendArrow;
+    llu_glucose_data.measurement_color    = llu_patients[patient].measurement_color;
+    llu_glucose_data.measurement_unixtime = llu_patients[patient].measurement_unixtime;
+
+    // history already belongs to the new patient, get_graph_data() must not clear it
+    url_graph.printf("/llu/connections/%s/graph", llu_patients[patient].patient_id.c_str());
+
+    // the next /graph of the new patient counts as changed, even if it matches a previous one of it
+    graph_hash = 0;
+    graph_changed = true;
+
+    logger.info("active patient %d: %s %s", patient, llu_patients[patient].first_name.c_str(), llu_patients[patient].last_name.c_str());
+    return true;
 }
 
 // get graph glycose data from api.libreview.io
 uint16_t LIBRELINKUP::get_graph_data(void){
 
     int8_t result = 0;
+    bool stream_error = false;
     uint32_t https_api_time_measure = millis();
 
-    check_client();
+    // a failed request leaves partial data, the next response counts as changed
+    uint32_t previous_hash = graph_hash;
+    graph_hash = 0;
+    graph_changed = true;
 
-    // resets previuos timestamp
-    llu_glucose_data.str_measurement_timestamp = "";
-    // delete all historical glucose data
-    memset(llu_sensor_history_data.graph_data,0,GRAPHDATAARRAYSIZE);
-    memset(llu_sensor_history_data.timestamp,0,GRAPHDATAARRAYSIZE);
+    check_client();
 
-    // get user ID and Token, if AuthToken not already pulled 
-    if(llu_login_data.user_id == "" || llu_login_data.user_token == "" || llu_login_data.user_token == "null"){
-        logger.debug("Auth User: no user_id available!");
-        DBGprint_LLU;Serial.println("Auth User: no user_id available!");
-        auth_user(settings.config.login_email,settings.config.login_password);
-        if(llu_login_data.user_login_status == 4){
-            DBGprint_LLU;Serial.println("LLU Login: Tou required");
-            logger.debug("LLU Login: Tou required");
-            tou_user();
-        }
+    // get user ID and Token, if AuthToken not already pulled (no login during a backoff)
+    if(!ensure_token()){
+        return 0;
     }
 
-    // create API url 
-    url_graph = "/llu/connections/" + llu_login_data.user_id + "/graph";
-
-    // get API graph data from LibreView server 
-    if(https.begin(*llu_client, base_url + url_graph)) {
-        delay(10);        
-
-        //https.addHeader("User-Agent", "Mozilla/5.0");
-        https.addHeader("Content-Type", "application/json");
-        https.addHeader("version", "4.12.0");
-        https.addHeader("product", "llu.ios");
-        //https.addHeader("Connection", "keep-alive");
-        //https.addHeader("Accept-Encoding", "gzip, deflate, br");
-        //https.addHeader("Pragma", "no-cache");
-        //https.addHeader("Cache-Control", "no-cache");
-        https.addHeader("Authorization","Bearer " + llu_login_data.user_token);
-        https.addHeader("Account-ID", llu_login_data.account_id);
+    // create API url of the patient on screen (own account if no connections are known),
+    // the history belongs to the previous patient if the patient changed
+    const char *patient_id = llu_login_data.user_id.c_str();
+    if(llu_active_patient < llu_patient_count && !llu_patients[llu_active_patient].patient_id.isEmpty()){
+        patient_id = llu_patients[llu_active_patient].patient_id.c_str();
+    }
+    FixedString<64> new_url_graph;
+    new_url_graph.printf("/llu/connections/%s/graph", patient_id);
+    if(new_url_graph != url_graph){
+        history_clear();
+        previous_hash = 0;
+        url_graph = new_url_graph;
+    }
 
-        int code = https.GET();
+    // get API graph data from LibreView server (keep-alive connection)
+    int code = request("GET", url_graph.c_str(), "", LLU_HEADERS_API);
+    if(code != 0) {
         //DBGprint_LLU;Serial.printf("HTTP Code: [%d]\r\n", code);
 
         if (code > 0) {
             if (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) {
 
-                // The filter: it contains "true" for each value we want to keep
-                (*json_filter)["data"]["connection"]["targetLow"] = true;
-                (*json_filter)["data"]["connection"]["targetHigh"] = true;
-                
-                (*json_filter)["data"]["connection"]["glucoseMeasurement"]["ValueInMgPerDl"] = true;
-                (*json_filter)["data"]["connection"]["glucoseMeasurement"]["TrendArrow"] = true;
-                (*json_filter)["data"]["connection"]["glucoseMeasurement"]["TrendMessage"] = true;
-                (*json_filter)["data"]["connection"]["glucoseMeasurement"]["MeasurementColor"] = true;
-                (*json_filter)["data"]["connection"]["glucoseMeasurement"]["Timestamp"] = true;
-                
-                (*json_filter)["data"]["connection"]["patientDevice"]["ll"] = true;
-                (*json_filter)["data"]["connection"]["patientDevice"]["hl"] = true;
-                (*json_filter)["data"]["connection"]["patientDevice"]["fixedLowAlarmValues"]["mgdl"] = true;
-                
-                (*json_filter)["data"]["connection"]["status"] = true;
-                (*json_filter)["data"]["connection"]["country"] = true;
-                (*json_filter)["data"]["connection"]["sensor"]["sn"] = true;
-                (*json_filter)["data"]["connection"]["sensor"]["deviceId"] = true;
-                (*json_filter)["data"]["connection"]["sensor"]["a"] = true;
-                
-                (*json_filter)["data"]["activeSensors"][0]["sensor"]["deviceId"] = true;
-                (*json_filter)["data"]["activeSensors"][0]["sensor"]["sn"] = true;
-                (*json_filter)["data"]["activeSensors"][0]["sensor"]["a"] = true;
-                (*json_filter)["data"]["activeSensors"][0]["sensor"]["pt"] = true;
-
-                /*
-                (*json_filter)["ticket"]["token"] = true; // token does not change. 
-                (*json_filter)["ticket"]["expires"] = true;
-                */
-
-                (*json_filter)["data"]["graphData"][0]["ValueInMgPerDl"] = true;
-                (*json_filter)["data"]["graphData"][0]["Timestamp"] = true;
-                /*
-                (*json_filter)["data"]["graphData"][0]["MeasurementColor"] = true;
-                (*json_filter)["data"]["graphData"][0]["isHigh"] = true;
-                (*json_filter)["data"]["graphData"][0]["isLow"] = true;
-                */
-
-                // Deserialize the document with json_filter setting. keep buffer size in mind.
-                deserializeJson((*json_librelinkup), https.getStream(), DeserializationOption::Filter(*json_filter));
-                
-                // Print the result
-                //serializeJsonPretty((*json_librelinkup), Serial); Serial.println();
-
-                llu_glucose_data.glucoseMeasurement          = (*json_librelinkup)["data"]["connection"]["glucoseMeasurement"]["ValueInMgPerDl"].as<int>();
-                llu_glucose_data.trendArrow                  = (*json_librelinkup)["data"]["connection"]["glucoseMeasurement"]["TrendArrow"].as<int>();
-                llu_glucose_data.measurement_color           = (*json_librelinkup)["data"]["connection"]["glucoseMeasurement"]["MeasurementColor"].as<int>();
-                llu_glucose_data.str_TrendMessage            = (*json_librelinkup)["data"]["connection"]["glucoseMeasurement"]["TrendMessage"].as<String>();
-                llu_glucose_data.str_measurement_timestamp   = (*json_librelinkup)["data"]["connection"]["glucoseMeasurement"]["Timestamp"].as<String>();
-
-                llu_glucose_data.glucosetargetLow            = (*json_librelinkup)["data"]["connection"]["targetLow"].as<int>();
-                llu_glucose_data.glucosetargetHigh           = (*json_librelinkup)["data"]["connection"]["targetHigh"].as<int>();
-                llu_glucose_data.glucoseAlarmLow             = (*json_librelinkup)["data"]["connection"]["patientDevice"]["ll"].as<int>();
-                llu_glucose_data.glucoseAlarmHigh            = (*json_librelinkup)["data"]["connection"]["patientDevice"]["hl"].as<int>();
-                llu_glucose_data.glucosefixedLowAlarmValues  = (*json_librelinkup)["data"]["connection"]["patientDevice"]["fixedLowAlarmValues"]["mgdl"].as<int>();
-
-                llu_login_data.connection_country          = (*json_librelinkup)["data"]["connection"]["country"].as<String>();
-                llu_login_data.connection_status           = (*json_librelinkup)["data"]["connection"]["status"].as<int>();
-                llu_sensor_data.sensor_sn_non_active        = (*json_librelinkup)["data"]["connection"]["sensor"]["sn"].as<String>();
-                llu_sensor_data.sensor_id_non_active        = (*json_librelinkup)["data"]["connection"]["sensor"]["deviceId"].as<String>();
-                llu_sensor_data.sensor_non_activ_unixtime   = (*json_librelinkup)["data"]["connection"]["sensor"]["a"].as<uint32_t>();
-                
-                llu_sensor_data.sensor_id                   = (*json_librelinkup)["data"]["activeSensors"][0]["sensor"]["deviceId"].as<String>();
-                llu_sensor_data.sensor_sn                   = (*json_librelinkup)["data"]["activeSensors"][0]["sensor"]["sn"].as<String>();
-                llu_sensor_data.sensor_state                = (*json_librelinkup)["data"]["activeSensors"][0]["sensor"]["pt"].as<int>();
-                llu_sensor_data.sensor_activation_time      = (*json_librelinkup)["data"]["activeSensors"][0]["sensor"]["a"].as<int>();
-                /*
-                user_token                  = (*json_librelinkup)["ticket"]["token"].as<String>();     // token does not change.
-                user_token_expires          = (*json_librelinkup)["ticket"]["expires"].as<uint32_t>();
-                */
-                
-                // get historical glucose data (timestamp and value)
-                for(uint8_t i=0;i<GRAPHDATAARRAYSIZE;i++){
-                    llu_sensor_history_data.graph_data[i] = (*json_librelinkup)["data"]["graphData"][i]["ValueInMgPerDl"].as<uint16_t>();
-                    if(llu_sensor_history_data.graph_data[i] == 0){
-                        llu_sensor_history_data.timestamp[i] = 0;
-                    }else{
-                        String timestampStr = (*json_librelinkup)["data"]["graphData"][i]["Timestamp"].as<String>();
-                        time_t ts = parseTimestamp(timestampStr.c_str());
-                        llu_sensor_history_data.timestamp[i]  = ts;
-                    }
-                    //DBGprint_LLU;Serial.print("librelinkup_graph_data:");Serial.println(graph_data[i]);
+                // incomplete data is handled like a failed request
+                stream_error = (parse_graph(*llu_response) != JSONSTREAM_DONE);
+                if(!stream_error){
+                    graph_changed = (graph_hash != previous_hash);
                 }
-                
-                // add current glucosemeasurement to last position (142)
-                llu_sensor_history_data.graph_data[((GRAPHDATAARRAYSIZE+GRAPHDATAARRAYSIZE_PLUS_ONE)-1)] = llu_glucose_data.glucoseMeasurement;
 
                 //DBGprint_LLU;Serial.print("glucoseMeasurement: ");Serial.print(glucoseMeasurement);
                 if(llu_glucose_data.trendArrow == 0){
@@ -841,50 +1245,198 @@ uint16_t LIBRELINKUP::get_graph_data(void){
                 }else if(llu_glucose_data.trendArrow == 5){
                     llu_glucose_data.str_trendArrow = "↑";
                 }
-                
-                Json_Buffer_Info buffer_info;
-                buffer_info = helper.getBufferSize(&(*json_filter));
-                logger.debug("json_filter     : Used Bytes / Total Capacity: %d / %d", buffer_info.usedCapacity, buffer_info.totalCapacity);
-
-                buffer_info = helper.getBufferSize(&(*json_librelinkup));
-                logger.debug("json_librelinkup: Used Bytes / Total Capacity: %d / %d", buffer_info.usedCapacity, buffer_info.totalCapacity);
-
-                json_filter->clear();
-                json_librelinkup->clear();                                          //clears the data object
             }
-            result = 1;
-            https_llu_api_fetch_time = millis() - https_api_time_measure;
+            result = (code == HTTP_CODE_OK || code == HTTP_CODE_MOVED_PERMANENTLY) && !stream_error ? 1 : 0;
+            https_llu_api_fetch_time     = millis() - https_api_time_measure;
+            https_llu_api_handshake_time = request_handshake_time;
+            https_llu_api_transfer_time  = https_llu_api_fetch_time - https_llu_api_handshake_time;
+            stage_stats.record(LLU_STAGE_FETCH, https_llu_api_fetch_time);
         }
         else {
             DBGprint_LLU; Serial.printf("[HTTP] GET... failed, error: %s\r\n", https.errorToString(code).c_str());
             logger.debug("[HTTP] GET... failed, error: %s\r\n", https.errorToString(code).c_str());
             result = 0;
-                        
-            if (code == HTTP_CODE_UNAUTHORIZED){    //Token Auth Error handling
-                DBGprint_LLU; Serial.println("Error, wrong Token -> reauthorization...");
-                logger.debug("Error, wrong Token -> reauthorization...");
-                json_filter->clear();
-                json_librelinkup->clear();
-                auth_user(settings.config.login_email,settings.config.login_password);
-                result = get_graph_data();
-            }
         }
-        // Free https resources
-        https.end();
+        // Free https resources, connection stays open for the next poll
+        end_request();
+        https_llu_api_wire_bytes = llu_connection.last_wire_bytes;
+        https_llu_api_body_bytes = llu_connection.last_body_bytes;
 
     }else{
         result = 0;
     }
 
-    //check if client is still connected
-    if(llu_client->connected()){
-        DBGprint_LLU;Serial.printf("LLU client still connected: %d\r\n",llu_client->connected());
-        logger.debug("LLU client still connected: %d\r\n",llu_client->connected());
-        llu_client->flush();
-        llu_client->stop();
+    return result;
+}
+
+// parse the response directly from the stream into the data structures (no JSON document)
+uint8_t LIBRELINKUP::parse_graph(Stream &stream){
+
+    LLU_GraphListener graph_listener(*this);
+    JsonStreamParser parser(graph_listener);
+
+    llu_utc_offset = HELPER::getUtcOffset(time(NULL)); // Timestamps are local time of the account
+    graph_listener.preset();
+    uint8_t parse_status = parser.parse(stream);
+
+    if(parse_status != JSONSTREAM_DONE){
+        DBGprint_LLU;Serial.printf("graph stream parse error after %d bytes\r\n", parser.bytes());
+        logger.err("graph stream parse error after %d bytes", parser.bytes());
+    }else{
+        graph_listener.commit();
+        graph_hash = graph_listener.hash();
+    }
+    if(parser.truncated()){
+        logger.debug("graph stream: truncated key/value");
     }
+    logger.debug("graph stream: %d bytes parsed, %d new history points (seq %d)", parser.bytes(), graph_listener.new_points(), llu_history.seq);
 
-    return result;
+    return parse_status;
+}
+
+// API server, "https://host[:port][/prefix]" (prefix is used by the mock server to select a scenario)
+bool LIBRELINKUP::set_base_url(const char *url){
+
+    base_url = LLU_DEFAULT_BASE_URL;
+    httpsPort = 443;
+
+    if(url == NULL || url[0] == '\0'){
+        return true;
+    }
+    if(strncmp(url, "https://", 8) != 0){
+        logger.err("llu_server %s: only https:// is supported", url);
+        return false;
+    }
+
+    const char *host = url + 8;
+    size_t host_len = strcspn(host, "/:");
+    uint32_t port = 443;
+    if(host[host_len] == ':'){
+        char *end = NULL;
+        port = strtoul(host + host_len + 1, &end, 10);
+        if(end == host + host_len + 1 || (*end != '\0' && *end != '/')){
+            port = 0;
+        }
+    }
+    if(host_len == 0 || host_len >= sizeof(llu_connection.host) || port == 0 || port > 65535){
+        logger.err("llu_server %s: invalid url", url);
+        return false;
+    }
+
+    // without trailing '/', the API paths start with '/'
+    size_t len = strlen(url);
+    while(len > 8 && url[len - 1] == '/') len--;
+    if(!base_url.assign(url, len)){
+        logger.err("llu_server %s: url longer than %d characters", url, base_url.capacity());
+        base_url = LLU_DEFAULT_BASE_URL;
+        return false;
+    }
+    httpsPort = port;
+
+    logger.notice("API server: %s (port %d)", base_url.c_str(), httpsPort);
+    return true;
+}
+
+// regional host of base_url (login redirect)
+bool LIBRELINKUP::set_region(const char *new_region){
+
+    region.clear();
+    api_url = base_url;
+    if(new_region == NULL || new_region[0] == '\0'){
+        return true;
+    }
+
+    // becomes part of the host name
+    bool valid = strlen(new_region) <= region.capacity();
+    for(const char *c = new_region; valid && *c != '\0'; c++){
+        valid = isalnum((unsigned char)*c);
+    }
+
+    FixedString<63> url;
+    const char *host = base_url.c_str() + 8;      // set_base_url() only accepts "https://"
+    if(valid && strncmp(host, "api.", 4) == 0){
+        valid = url.printf("https://api-%s.%s", new_region, host + 4);
+    }else if(valid && strchr(host, '/') != NULL){
+        valid = url.printf("%s-%s", base_url.c_str(), new_region);     // mock server: scenario prefix
+    }else{
+        valid = false;
+    }
+    if(!valid){
+        logger.err("region %s: no regional url for %s", new_region, base_url.c_str());
+        return false;
+    }
+
+    region = new_region;
+    api_url = url;
+    logger.notice("API region %s: %s", region.c_str(), api_url.c_str());
+    return true;
+}
+
+void LIBRELINKUP::clear_region(void){
+
+    set_region(NULL);
+    close_connection();
+
+    Preferences prefs;
+    if(prefs.begin(LLU_REGION_NAMESPACE, false)){
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+// region of a previous login redirect, bound to the login email and the configured server
+void LIBRELINKUP::load_region(void){
+
+    set_region(NULL);
+
+    Preferences prefs;
+    if(!prefs.begin(LLU_REGION_NAMESPACE, true)){
+        return;                             // no redirect yet
+    }
+    if(account_id_sha256(settings.config.login_email.c_str()) == prefs.getString("email_sha256", "") &&
+       base_url == prefs.getString("base_url", "")){
+        set_region(prefs.getString("region", "").c_str());
+    }
+    prefs.end();
+}
+
+void LIBRELINKUP::save_region(void){
+
+    Preferences prefs;
+    if(!prefs.begin(LLU_REGION_NAMESPACE, false)){
+        logger.err("LLU region: NVS not available");
+        return;
+    }
+    prefs.putString("email_sha256", account_id_sha256(settings.config.login_email.c_str()).c_str());
+    prefs.putString("base_url", base_url.c_str());
+    prefs.putString("region", region.c_str());
+    prefs.end();
+}
+
+// round-trip time per API host, a new host takes the slot with the fewest requests
+void LIBRELINKUP::record_rtt(const char *host, uint32_t ms){
+
+    uint8_t slot = 0;
+    for(uint8_t i = 0; i < LLU_HOST_STATS; i++){
+        if(strcmp(llu_hosts[i].host, host) == 0){
+            slot = i;
+            break;
+        }
+        if(llu_hosts[i].requests < llu_hosts[slot].requests){
+            slot = i;
+        }
+    }
+
+    LLU_HostRtt &h = llu_hosts[slot];
+    if(strcmp(h.host, host) != 0){
+        h = LLU_HostRtt{};
+        strlcpy(h.host, host, sizeof(h.host));
+    }
+    h.avg = (h.requests == 0) ? ms : h.avg + ((int32_t)ms - (int32_t)h.avg) / 8;
+    h.min = (h.requests == 0 || ms < h.min) ? ms : h.min;
+    h.max = (ms > h.max) ? ms : h.max;
+    h.last = ms;
+    h.requests++;
 }
 
 // get WiFiClientSecure client pointer
@@ -893,11 +1445,206 @@ WiFiClientSecure & LIBRELINKUP::get_wifisecureclient(void){
     return *llu_client;
 }
 
+// open TLS connection to the API host, or reuse the open keep-alive connection
+uint8_t LIBRELINKUP::ensure_connection(void){
+
+    // host part of api_url ("https://api-eu.libreview.io" -> "api-eu.libreview.io")
+    char host[sizeof(llu_connection.host)];
+    const char *start = strstr(api_url.c_str(), "://");
+    start = (start != NULL) ? start + 3 : api_url.c_str();
+    size_t len = strcspn(start, "/:");
+    if(len >= sizeof(host)) len = sizeof(host) - 1;
+    memcpy(host, start, len);
+    host[len] = '\0';
+
+    if(llu_client->connected() && strcmp(host, llu_connection.host) == 0){
+        llu_connection.reused++;
+        return LLU_CONNECTION_REUSED;
+    }
+
+    // new TLS connection (DNS + TCP + handshake)
+    llu_client->stop();
+    llu_connection.host[0] = '\0';
+
+    // resolved here to measure DNS on its own, the address is reused for LLU_DNS_TTL
+    uint32_t handshake_time_measure = millis();
+    uint32_t dns_time = 0;
+    if(strcmp(host, llu_dns.host) != 0 || millis() - llu_dns.resolved_at >= LLU_DNS_TTL * 1000UL){
+        llu_dns.host[0] = '\0';
+        if(!WiFi.hostByName(host, llu_dns.address)){
+            logger.err("DNS lookup of %s failed", host);
+            return LLU_CONNECTION_FAILED;
+        }
+        strcpy(llu_dns.host, host);
+        llu_dns.resolved_at = millis();
+        llu_dns.lookups++;
+        dns_time = llu_dns.resolved_at - handshake_time_measure;
+        stage_stats.record(LLU_STAGE_DNS, dns_time);
+    }else{
+        llu_dns.hits++;
+    }
+
+    if(!llu_client->connect_address(llu_dns.address, httpsPort, host)){
+        DBGprint_LLU;Serial.printf("TLS connect to %s failed\r\n", host);
+        logger.err("TLS connect to %s (%s) failed", host, llu_dns.address.toString().c_str());
+        llu_dns.host[0] = '\0';           // address may be outdated, look it up again
+        return LLU_CONNECTION_FAILED;
+    }
+    uint32_t handshake_time = millis() - handshake_time_measure;
+    stage_stats.record(LLU_STAGE_CONNECT, handshake_time - dns_time);
+    request_handshake_time += handshake_time;
+
+    strcpy(llu_connection.host, host);
+    llu_connection.handshakes++;
+    logger.debug("TLS connection to %s: %dms (DNS: %dms, handshakes: %d)", host, handshake_time, dns_time, llu_connection.handshakes);
+
+    return LLU_CONNECTION_NEW;
+}
+
+// close keep-alive connection
+void LIBRELINKUP::close_connection(void){
+
+    llu_client->stop();
+    llu_connection.host[0] = '\0';
+}
+
+// send API request, a rejected token is replaced once (no recursion: the login requests use other headers)
+int LIBRELINKUP::request(const char *type, const char *url, const String &payload, uint8_t headers){
+
+    int code = send_request(type, url, payload, headers);
+    if(code != HTTP_CODE_UNAUTHORIZED || headers != LLU_HEADERS_API){
+        return code;
+    }
+
+    // cached or expired token rejected -> new login and one retry
+    DBGprint_LLU; Serial.println("Error, wrong Token -> reauthorization...");
+    llu_session.rejected++;
+    end_request();
+    session_invalidate("token rejected");
+    if(!ensure_token()){
+        return code;
+    }
+    code = send_request(type, url, payload, headers);
+    if(code == HTTP_CODE_UNAUTHORIZED){
+        session_backoff("new token rejected");
+    }
+    return code;
+}
+
+// send one request, retry once if the reused keep-alive connection was closed by the server
+int LIBRELINKUP::send_request(const char *type, const char *url, const String &payload, uint8_t headers){
+
+    int code = 0;
+    request_handshake_time = 0;
+    llu_body.end();
+    llu_inflate.end();
+    llu_response = &llu_body;
+    llu_response_open = false;
+
+    for(uint8_t attempt = 0; attempt < 2; attempt++){
+
+        uint8_t connection = ensure_connection();
+        if(connection == LLU_CONNECTION_FAILED){
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+
+        char full_url[160];
+        snprintf(full_url, sizeof(full_url), "%s%s", api_url.c_str(), url);
+        if(!https.begin(*llu_client, full_url)){
+            return 0;
+        }
+
+        https.addHeader("Content-Type", "application/json");
+        https.addHeader("product", "llu.ios");
+        https.addHeader("Pragma", "no-cache");
+        https.addHeader("Cache-Control", "no-cache");
+        https.addHeader("Accept-Encoding", "gzip, deflate");
+        if(headers == LLU_HEADERS_API){
+            https.addHeader("version", "4.12.0");
+            https.addHeader("Authorization", String("Bearer ") + llu_login_data.user_token.c_str());
+            https.addHeader("Account-ID", llu_login_data.account_id.c_str());
+        }else{
+            https.addHeader("version", "4.7.0");
+            if(headers == LLU_HEADERS_TOU){
+                https.addHeader("Authorization", String("Bearer ") + llu_login_data.user_token.c_str());
+            }
+        }
+
+        uint32_t ttfb_time_measure = millis();
+        code = (strcmp(type, "POST") == 0) ? https.POST(payload) : https.GET();
+        if(code > 0){
+            uint32_t rtt = millis() - ttfb_time_measure;
+            stage_stats.record(LLU_STAGE_TTFB, rtt);
+            record_rtt(llu_connection.host, rtt);
+        }
+
+        if(code > 0 || connection != LLU_CONNECTION_REUSED){
+            break;
+        }
+
+        // keep-alive connection was closed by the server in the meantime -> reconnect once
+        logger.debug("keep-alive connection lost (%s) -> reconnect", https.errorToString(code).c_str());
+        https.end();
+        close_connection();
+        llu_connection.reconnects++;
+    }
+
+    if(code > 0){
+        llu_body.begin(https.getStream(), https.getSize(), https.header("Transfer-Encoding").equalsIgnoreCase("chunked"));
+        llu_response_open = true;
+        request_headers_time = micros();
+
+        // compressed body: the parsers read the decompressed data
+        uint8_t encoding = InflateStream::encoding(https.header("Content-Encoding").c_str());
+        if(encoding != INFLATE_IDENTITY){
+            if(!llu_inflate.begin(llu_body, encoding)){
+                logger.err("no memory for the inflate window (%d bytes)", INFLATE_WINDOW_SIZE);
+                return HTTPC_ERROR_TOO_LESS_RAM;
+            }
+            llu_response = &llu_inflate;
+        }
+    }
+    return code;
+}
+
+// finish request. The rest of the body has to be read, otherwise the connection can not be reused
+void LIBRELINKUP::end_request(void){
+
+    bool compressed = (llu_response == &llu_inflate);
+    if(compressed && !llu_inflate.drain()){
+        logger.err("compressed response corrupt or incomplete (%d bytes received)", llu_body.bytes());
+    }
+    if(!llu_body.drain()){
+        close_connection();
+    }
+
+    // bytes on the wire (HTTP body) and after decompression
+    if(llu_response_open){
+        // body: waiting for the connection, parse: everything else until the body is consumed
+        uint32_t body_time = micros() - request_headers_time;
+        uint32_t wait_time = llu_body.wait_time();
+        stage_stats.record(LLU_STAGE_BODY, (wait_time + 500) / 1000);
+        stage_stats.record(LLU_STAGE_PARSE, (body_time > wait_time) ? (body_time - wait_time + 500) / 1000 : 0);
+
+        llu_connection.last_wire_bytes = llu_body.bytes();
+        llu_connection.last_body_bytes = compressed ? llu_inflate.bytes() : llu_body.bytes();
+        llu_connection.wire_bytes += llu_connection.last_wire_bytes;
+        llu_connection.body_bytes += llu_connection.last_body_bytes;
+        if(compressed) llu_connection.compressed++;
+    }
+
+    llu_inflate.end();
+    llu_response = &llu_body;
+    llu_response_open = false;
+    llu_body.end();
+    https.end();
+}
+
 //check connection to server
 void LIBRELINKUP::check_https_connection(const char* url){
         
-    // Test server connection
-    // get API graph data from LibreView server 
+    // Test server connection (not the API host -> no keep-alive connection)
+    close_connection();
     if(https.begin(*llu_client, url)) {
         delay(10);        
 
@@ -919,6 +1666,7 @@ void LIBRELINKUP::check_https_connection(const char* url){
         }
         // Free https resources
         https.end();
+        close_connection();
     }
 
 }
@@ -945,6 +1693,24 @@ bool LIBRELINKUP::setCAfromfile(WiFiClientSecure &client, const char* ca_file){
     }
 }
 
+// set all root certificates from the PEM files as bundle
+uint16_t LIBRELINKUP::setCAbundle(bool rebuild){
+
+    const char *ca_files[] = {path_root_ca_googler4, path_root_ca_dcgrg2, path_root_ca_baltimore};
+    uint8_t ca_count = sizeof(ca_files) / sizeof(ca_files[0]);
+
+    uint16_t roots = rebuild ? trust_store.rebuild(LittleFS, ca_files, ca_count) : trust_store.begin(LittleFS, ca_files, ca_count);
+    if(roots == 0){
+        return 0;
+    }
+
+    // the client prefers a PEM root over the bundle, so clear it first
+    llu_client->setCACert(NULL);
+    llu_client->setCACertBundle(trust_store.bundle());
+    logger.notice("set CA bundle -> %d roots", roots);
+    return roots;
+}
+
 // get root certificate from file
 void LIBRELINKUP::showCAfromfile(const char* ca_file){
     
@@ -994,6 +1760,7 @@ uint16_t LIBRELINKUP::download_root_ca_to_file(const char* download_url, const c
         return 0;
     }
 
+    close_connection();
     llu_client->setInsecure();
     DBGprint_LLU;Serial.print("download CA started...");
     logger.notice("download CA started...");
@@ -1014,6 +1781,7 @@ uint16_t LIBRELINKUP::download_root_ca_to_file(const char* download_url, const c
                 https.writeToStream(&file);
             }
             result = 1;
+            trust_store.invalidate(LittleFS);    // bundle is built again with the new file
             file.close();
             Serial.println("finished");
             logger.notice("finished");
@@ -1026,6 +1794,7 @@ uint16_t LIBRELINKUP::download_root_ca_to_file(const char* download_url, const c
         }
         // Free https resources
         https.end();
+        close_connection();
 
     }else{
         result = 0;
@@ -1052,59 +1821,3 @@ bool LIBRELINKUP::read2String(fs::FS &fs, const char *path, char *myString, size
     file.close();
     return true;
 }
-
-// String-Timestamp in time_t umwandeln
-/*
-time_t LIBRELINKUP::parseTimestamp(const char* timestampStr) {
-    struct tm tm_time;
-    memset(&tm_time, 0, sizeof(struct tm));
-    strptime(timestampStr, "%m/%d/%Y %I:%M:%S %p", &tm_time);
-    return mktime(&tm_time);
-}
-*/
-
-time_t LIBRELINKUP::parseTimestamp(const char* timestampStr) {
-    setlocale(LC_TIME, "C"); // Erzwingt die C-Standard-Locale für AM/PM-Interpretation
-
-    struct tm tm_time;
-    memset(&tm_time, 0, sizeof(struct tm));
-
-    // Parst Datum + Zeit OHNE AM/PM-Interpretation
-    char timeStr[50];
-    strncpy(timeStr, timestampStr, sizeof(timeStr) - 1);
-    timeStr[sizeof(timeStr) - 1] = '\0';
-
-    // Prüfe auf AM oder PM
-    int is_pm = strstr(timeStr, "PM") != NULL;
-
-    // Entferne AM/PM aus dem String für strptime
-    char clean_timeStr[50];
-    strncpy(clean_timeStr, timeStr, sizeof(clean_timeStr) - 1);
-    clean_timeStr[sizeof(clean_timeStr) - 1] = '\0';
-    char* am_pm = strstr(clean_timeStr, "AM");
-    if (!am_pm) am_pm = strstr(clean_timeStr, "PM");
-    if (am_pm) *am_pm = '\0'; // AM/PM entfernen
-
-    // Parse nur Datum + Uhrzeit
-    char* ret = strptime(clean_timeStr, "%m/%d/%Y %I:%M:%S", &tm_time);
-    if (!ret) {
-        printf("⚠️ strptime() konnte den String nicht parsen.\n");
-        return -1;
-    }
-
-    // Manuelle AM/PM Anpassung
-    if (is_pm && tm_time.tm_hour != 12) {
-        tm_time.tm_hour += 12; // PM → +12 Stunden
-    } else if (!is_pm && tm_time.tm_hour == 12) {
-        tm_time.tm_hour = 0; // 12 AM → 00:00 Uhr
-    }
-
-    tm_time.tm_isdst = -1; // Sommerzeit automatisch erkennen
-
-    time_t timestamp = mktime(&tm_time);
-
-    // Debug-Ausgabe
-    //printf("Input: %s → Parsed Time: %02d:%02d:%02d | Unix: %ld\n", timestampStr, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, timestamp);
-
-    return timestamp;
-}
\ No newline at end of file
@@ -21,6 +21,9 @@
 #include <ArduinoJson.h>            ///< JSON parsing and generation
 #include <StreamUtils.h>            ///< Stream utility extensions
 #include <FS.h>                     ///< Filesystem operations
+#include "fixedstring.h"            ///< Inline strings without heap
+#include "truststore.h"             ///< Cached root certificate bundle
+#include "stagestats.h"             ///< Fetch stage latency histograms
 
 #include <memory>                   ///< Smart pointers
 #include <string>                   ///< String operations
@@ -39,6 +42,19 @@
 #define VERSION_LIBRELINKUP_LIB 1.0 ///< Library version identifier
 #define DBGprint_LLU Serial.printf("[%08dms][%s][%s] ",millis(),__FILE__,__func__); ///< Debug output formatter
 #define LIBRELINKUP_DEBUG 0         ///< Global debug flag (0=disabled)
+#define LLU_TOKEN_NAMESPACE "llu_token" ///< NVS namespace of the cached auth token
+#define LLU_TOKEN_VERSION 1         ///< Layout version of the cached token
+#define LLU_TOKEN_REFRESH_MARGIN 86400  ///< Renew the token this many seconds before it expires
+#define LLU_CLOCK_VALID 1700000000  ///< Unix time below = SNTP not synced yet
+#define LLU_MAX_PATIENTS 4          ///< Followed patients tracked from /llu/connections
+#define LLU_GRAPH_POINT_INTERVAL 300    ///< Seconds between two /graph history points
+#define LLU_DEFAULT_BASE_URL "https://api.libreview.io" ///< LibreView API (no llu_server configured)
+#define LLU_SESSION_MAX_STEPS 7     ///< States run per ensure_token() call (backoff, cache, auth, regional auth, tou, ready)
+#define LLU_SESSION_BACKOFF_MIN 30000   ///< Wait after the first failed login in ms, doubles per failure
+#define LLU_SESSION_BACKOFF_MAX 900000  ///< Upper limit of the login backoff in ms
+#define LLU_REGION_NAMESPACE "llu_region"   ///< NVS namespace of the region from the login redirect
+#define LLU_DNS_TTL 300             ///< Seconds a resolved API host address is reused
+#define LLU_HOST_STATS 3            ///< API hosts with round-trip statistics (global, regional, spare)
 /** @} */
 
 /**
@@ -72,8 +88,53 @@ enum SensorState : uint8_t {
     SENSOR_SHUT_DOWN = 5,     ///< Manual deactivation
     SENSOR_FAILURE = 6,       ///< Hardware malfunction
 };
+
+/**
+ * @enum ConnectionState
+ * @brief Result of the keep-alive connection check
+ */
+enum ConnectionState : uint8_t {
+    LLU_CONNECTION_FAILED = 0, ///< TLS connect failed
+    LLU_CONNECTION_NEW    = 1, ///< New TLS handshake done
+    LLU_CONNECTION_REUSED = 2, ///< Open keep-alive connection reused
+};
+
+/**
+ * @enum RequestHeaders
+ * @brief Header set of an API request
+ */
+enum RequestHeaders : uint8_t {
+    LLU_HEADERS_LOGIN = 0, ///< login (no token)
+    LLU_HEADERS_TOU   = 1, ///< terms of use (token)
+    LLU_HEADERS_API   = 2, ///< connections / graph (token + Account-ID)
+};
+
+/**
+ * @enum SessionState
+ * @brief Login state of the LibreLinkUp session (ensure_token())
+ */
+enum SessionState : uint8_t {
+    LLU_SESSION_LOGGED_OUT     = 0, ///< no token, the NVS cache is tried first
+    LLU_SESSION_AUTHENTICATING = 1, ///< login request with email / password
+    LLU_SESSION_TOU_PENDING    = 2, ///< login needs the terms of use accepted
+    LLU_SESSION_READY          = 3, ///< token available
+    LLU_SESSION_BACKOFF        = 4, ///< login failed, no request until backoff_until
+};
 /** @} */
 
+/**
+ * @struct LLU_HostRtt
+ * @brief Round-trip times (request sent until response headers) of one API host
+ */
+struct LLU_HostRtt {
+    char host[64];          ///< API host ("" = unused)
+    uint32_t requests;      ///< Requests with a response
+    uint32_t last;          ///< Last round-trip time in ms
+    uint32_t avg;           ///< Moving average (1/8 weight of a new sample) in ms
+    uint32_t min;           ///< Fastest request in ms
+    uint32_t max;           ///< Slowest request in ms
+};
+
 /**
  * @defgroup constants Library Constants
  * @brief Global configuration of Glucose data
@@ -127,6 +188,76 @@ private:
      */
     uint32_t convertToMillis(uint8_t hours, uint8_t minutes, uint8_t seconds);
 
+    /**
+     * @brief Open TLS connection to the API host or reuse the open one
+     * @return ConnectionState
+     */
+    uint8_t ensure_connection(void);
+
+    /**
+     * @brief Send API request on the keep-alive connection
+     *
+     * A reused connection which was closed by the server is reconnected once.
+     * An API request rejected with 401 is sent once more after a new login
+     * (session_invalidate(), ensure_token()).
+     * On success the response body is available via the body stream.
+     * @param type "GET" or "POST"
+     * @param url API path (appended to base_url)
+     * @param payload POST payload
+     * @param headers RequestHeaders set
+     * @return HTTP status code (<0 connection error, 0 invalid url)
+     */
+    int request(const char *type, const char *url, const String &payload, uint8_t headers);
+
+    /**
+     * @brief Send one request on the keep-alive connection (no token handling)
+     */
+    int send_request(const char *type, const char *url, const String &payload, uint8_t headers);
+
+    /**
+     * @brief Finish request, keeps the connection open if the body was read completely
+     */
+    void end_request(void);
+
+    /**
+     * @brief Load the auth token cached in NVS
+     *
+     * The cache is only used if it belongs to the configured login email and
+     * does not expire within LLU_TOKEN_REFRESH_MARGIN.
+     * @return 1 if a token was loaded, 0 otherwise
+     */
+    uint8_t load_token(void);
+
+    /**
+     * @brief Store the current auth token in NVS
+     */
+    void save_token(void);
+
+    uint32_t request_handshake_time = 0;    ///< handshake time of the current request
+    uint32_t request_headers_time = 0;      ///< micros() when the response headers of the current request were read
+
+    /**
+     * @brief Login failed: wait before the next try, doubles up to LLU_SESSION_BACKOFF_MAX
+     */
+    void session_backoff(const char *reason);
+
+    /**
+     * @brief Restore the region of a previous login redirect (same login email and base_url)
+     */
+    void load_region(void);
+
+    /**
+     * @brief Store the region in NVS
+     */
+    void save_region(void);
+
+    /**
+     * @brief Add a round-trip time to the statistics of an API host
+     */
+    void record_rtt(const char *host, uint32_t ms);
+
+    bool login_redirected = false;          ///< last auth_user() switched to a regional host
+
 public:
 
     /**
@@ -134,9 +265,45 @@ public:
      * @brief Request timing measurements
      * @{
      */
-    uint32_t https_llu_api_fetch_time = 0; ///< Time taken for last API fetch in milliseconds
+    uint32_t https_llu_api_fetch_time = 0;      ///< Time taken for last API fetch in milliseconds
+    uint32_t https_llu_api_handshake_time = 0;  ///< TLS handshake part of last fetch (0 = connection reused)
+    uint32_t https_llu_api_transfer_time = 0;   ///< Request/response part of last fetch
+    uint32_t https_llu_api_wire_bytes = 0;      ///< /graph body bytes of last fetch on the wire
+    uint32_t https_llu_api_body_bytes = 0;      ///< /graph body bytes of last fetch after decompression
+    int32_t llu_utc_offset = 0;                 ///< UTC offset (incl. DST) of the Timestamp strings, set per fetch
+    StageStats stage_stats;                     ///< Latency histograms of the request stages (per request)
     /** @} */
 
+    /**
+     * @struct llu_connection
+     * @brief Keep-alive connection statistics
+     */
+    struct {
+        char host[64] = "";             ///< Host of the open connection
+        uint32_t handshakes = 0;        ///< TLS handshakes done
+        uint32_t reused = 0;            ///< Requests sent on a reused connection
+        uint32_t reconnects = 0;        ///< Reconnects after a lost keep-alive connection
+        uint32_t compressed = 0;        ///< Responses received with gzip / deflate
+        uint32_t wire_bytes = 0;        ///< Response body bytes received (compressed)
+        uint32_t body_bytes = 0;        ///< Response body bytes after decompression
+        uint32_t last_wire_bytes = 0;   ///< Body bytes of the last response on the wire
+        uint32_t last_body_bytes = 0;   ///< Body bytes of the last response after decompression
+    } llu_connection;
+
+    /**
+     * @struct llu_dns
+     * @brief Address of the API host, reused for LLU_DNS_TTL seconds
+     */
+    struct {
+        char host[64] = "";             ///< Resolved host ("" = nothing cached)
+        IPAddress address;              ///< Address of host
+        uint32_t resolved_at = 0;       ///< millis() of the lookup
+        uint32_t lookups = 0;           ///< DNS lookups done
+        uint32_t hits = 0;              ///< Connections opened with the cached address
+    } llu_dns;
+
+    LLU_HostRtt llu_hosts[LLU_HOST_STATS] = {};     ///< Round-trip times per API host
+
     /**
      * @defgroup config Timing Constants
      * @brief Time-related configuration parameters
@@ -167,9 +334,12 @@ public:
     const char* path_root_ca_dcgrg2 = "/rootCA_DCGRG2.pem";   ///< DigiCert storage path
     const char* path_root_ca_googler4 = "/rootCA_GoogleR4.pem"; ///< Google Trust storage path
 
-    const char *base_url = "https://api.libreview.io"; ///< API base URL
-    const int httpsPort = 443;  
-                           ///< HTTPS default port
+    TrustStore trust_store;                                 ///< Root certificates of the PEM files as DER bundle
+
+    FixedString<63> base_url = LLU_DEFAULT_BASE_URL;   ///< API base URL (may contain a port and a path prefix)
+    FixedString<63> api_url = LLU_DEFAULT_BASE_URL;    ///< URL of the requests: base_url or its regional host
+    FixedString<8> region;                              ///< Region of the login redirect ("" = base_url)
+    uint16_t httpsPort = 443;                           ///< Port of base_url
     /** @} */
 
     /**
@@ -177,19 +347,33 @@ public:
     * @brief Struct for Credentials and session management
     */
     struct {
-        String email = "";                      ///< Account email
-        String password = "";                   ///< Account password
-        String user_id = "";                    ///< User identifier
-        String account_id = "";                 ///< Account identifier
-        String user_country = "";               ///< User region
-        String user_token = "";                 ///< Session token
-        String connection_country = "";         ///< Connection region
+        FixedString<64> email;                  ///< Account email
+        FixedString<64> password;               ///< Account password
+        FixedString<40> user_id;                ///< User identifier (UUID)
+        FixedString<64> account_id;             ///< Account identifier (SHA-256 hex)
+        FixedString<8> user_country;            ///< User region
+        FixedString<1024> user_token;           ///< Session token (JWT)
+        FixedString<8> connection_country;      ///< Connection region
         int16_t connection_status = 0;          ///< API connection state
         uint32_t user_token_expires = 0;        ///< Token expiration timestamp
         uint8_t user_login_status = 0;          ///< Authentication state
+        uint8_t token_from_cache = 0;           ///< 1 = token was loaded from NVS
     } llu_login_data;
     /** @} */
 
+    /**
+    * @struct llu_session
+    * @brief Login state machine of ensure_token()
+    */
+    struct {
+        uint8_t state = LLU_SESSION_LOGGED_OUT; ///< SessionState
+        uint8_t failures = 0;                   ///< Failed logins in a row (backoff exponent)
+        uint32_t backoff_until = 0;             ///< millis() of the next login try in LLU_SESSION_BACKOFF
+        uint32_t logins = 0;                    ///< Login requests sent
+        uint32_t tou = 0;                       ///< Terms of use accepted
+        uint32_t rejected = 0;                  ///< Requests rejected with 401
+    } llu_session;
+
     
     /**
     * @struct llu_sensor_history_values
@@ -199,6 +383,52 @@ public:
         uint16_t graph_data[GRAPHDATAARRAYSIZE+GRAPHDATAARRAYSIZE_PLUS_ONE] = {0}; ///< Glucose history buffer
         uint32_t timestamp[GRAPHDATAARRAYSIZE+GRAPHDATAARRAYSIZE_PLUS_ONE] = {0};  ///< Glucose history buffer    
     } llu_sensor_history_data;
+
+    /**
+    * @struct llu_history
+    * @brief Ring buffer of the graph points, keyed by timestamp
+    *
+    * Only points newer than the newest stored one are appended, the oldest
+    * point is evicted when the buffer is full. Every appended point gets the
+    * next sequence number, so consumers can ask for the points added since the
+    * sequence number they have seen last (get_new_points_since()).
+    * llu_sensor_history_data is kept as linear view (oldest first) for the
+    * chart and the statistics.
+    */
+    struct History {
+        uint16_t value[GRAPHDATAARRAYSIZE] = {0};     ///< Glucose values
+        uint32_t timestamp[GRAPHDATAARRAYSIZE] = {0}; ///< Unix timestamps (UTC)
+        uint8_t head = 0;                             ///< Index of the oldest point
+        uint8_t count = 0;                            ///< Number of stored points
+        uint32_t seq = 0;                             ///< Sequence number of the newest point (0 = empty)
+    };
+    History llu_history;                              ///< History of the active patient
+
+    uint32_t graph_hash = 0;                          ///< FNV-1a hash of the used /graph values (0 = unknown)
+    bool graph_changed = true;                        ///< Last /graph differs from the one before (or failed)
+
+    /**
+    * @struct llu_patients
+    * @brief Followed patients, all read from one /llu/connections response
+    *
+    * The active patient (on screen) is fetched with /graph on every poll, its
+    * history lives in llu_history. The other patients keep their own history
+    * ring here and get a /graph request only when their measurement is a full
+    * history interval newer than their newest history point.
+    */
+    struct Patient {
+        FixedString<40> patient_id;                   ///< patientId, used in the /graph url
+        FixedString<23> first_name;                   ///< First name
+        FixedString<23> last_name;                    ///< Last name
+        uint16_t glucoseMeasurement = 0;              ///< Latest measurement (mg/dL)
+        uint8_t trendArrow = 0;                       ///< Trend direction code
+        uint8_t measurement_color = 0;                ///< Display color code
+        uint32_t measurement_unixtime = 0;            ///< FactoryTimestamp of the measurement (UTC)
+        History history;                              ///< History while the patient is not the active one
+    };
+    Patient llu_patients[LLU_MAX_PATIENTS];
+    uint8_t llu_patient_count = 0;                    ///< Patients in the last /llu/connections response
+    uint8_t llu_active_patient = 0;                   ///< Patient shown on screen
     /** @} */
 
     /**
@@ -206,10 +436,10 @@ public:
      * @brief Glucose measurements and status
      * @{
      */
-    String url_graph = "/llu/connections/" + llu_login_data.user_id + "/graph"; ///< Graph data endpoint
-    String url_connection = "/llu/connections"; ///< Connections endpoint
-    String url_user_auth = "/llu/auth/login";    ///< Authentication endpoint
-    String url_user_tou = "/auth/continue/tou";  ///< Terms of use endpoint
+    FixedString<64> url_graph;                          ///< Graph data endpoint ("/llu/connections/<user_id>/graph")
+    const char *url_connection = "/llu/connections";    ///< Connections endpoint
+    const char *url_user_auth = "/llu/auth/login";      ///< Authentication endpoint
+    const char *url_user_tou = "/auth/continue/tou";    ///< Terms of use endpoint
 
     //uint16_t graph_data[GRAPHDATAARRAYSIZE+GRAPHDATAARRAYSIZE_PLUS_ONE] = {0}; ///< Glucose history buffer
     //uint32_t timestamp[GRAPHDATAARRAYSIZE+GRAPHDATAARRAYSIZE_PLUS_ONE] = {0};  ///< Glucose history buffer
@@ -218,9 +448,10 @@ public:
         uint16_t glucoseMeasurement = 0;        ///< Current measurement (mg/dL)
         uint8_t trendArrow = 0;                 ///< Trend direction code
         uint8_t measurement_color = 0;          ///< Display color code
-        String str_TrendMessage = "";           ///< Trend interpretation
-        String str_measurement_timestamp = "";  ///< Formatted timestamp
-        String str_trendArrow = "";             ///< Trend direction text
+        FixedString<39> str_TrendMessage;       ///< Trend interpretation
+        FixedString<23> str_measurement_timestamp; ///< Formatted timestamp
+        uint32_t measurement_unixtime = 0;      ///< FactoryTimestamp of the measurement (UTC, Unix)
+        FixedString<11> str_trendArrow;         ///< Trend direction text (UTF-8)
 
         uint16_t glucosetargetLow = 0;          ///< Lower target range
         uint16_t glucosetargetHigh = 0;         ///< Upper target range
@@ -232,12 +463,12 @@ public:
 
     struct {
         uint8_t sensor_state = 0;               ///< Current sensor state
-        String sensor_sn_non_active = "";       ///< Inactive sensor serial
-        String sensor_id_non_active = "";       ///< Inactive sensor ID
+        FixedString<15> sensor_sn_non_active;   ///< Inactive sensor serial
+        FixedString<39> sensor_id_non_active;   ///< Inactive sensor ID
         uint32_t sensor_non_activ_unixtime = 0; ///< Last activation attempt
         
-        String sensor_id = "";                  ///< Active sensor ID
-        String sensor_sn = "";                  ///< Active sensor serialsensor_state                = (*json_librelinkup)["data"]["activeSensors"][0]["sensor"]["pt"].as<int>();
+        FixedString<39> sensor_id;              ///< Active sensor ID
+        FixedString<15> sensor_sn;              ///< Active sensor serial
         uint32_t sensor_activation_time = 0;    ///< Activation timestamp                
     } llu_sensor_data;
         
@@ -320,6 +551,32 @@ public:
      */
     uint8_t begin(uint8_t use_cert);
 
+    /**
+     * @brief Use another API server, e.g. the local mock server (tools/llu_mock)
+     *
+     * Call before begin(). A server other than the LibreView API is used
+     * without certificate verification.
+     * @param url "https://host[:port][/prefix]", NULL or "" = LibreView API
+     * @return false if the url is not valid (LibreView API is used)
+     */
+    bool set_base_url(const char *url);
+
+    /**
+     * @brief Send the requests to the regional host of the account
+     *
+     * LibreView: "https://api.libreview.io" -> "https://api-<region>.libreview.io".
+     * Another server (mock) gets the region appended to its path prefix
+     * ("https://host:port/redirect" -> "https://host:port/redirect-eu").
+     * @param region Region of the login redirect, NULL or "" = base_url
+     * @return false if no regional url can be built (base_url is used)
+     */
+    bool set_region(const char *region);
+
+    /**
+     * @brief Forget the region (also in NVS), the next login is sent to base_url
+     */
+    void clear_region(void);
+
     /**
      * @brief Get current epoch time
      * @return Current Unix timestamp in seconds
@@ -329,9 +586,9 @@ public:
     /**
      * @brief Generate SHA256 hash of account ID
      * @param user_id User identifier
-     * @return Hashed account ID string
+     * @return Hashed account ID (64 hex characters)
      */
-    String account_id_sha256(String user_id);
+    FixedString<64> account_id_sha256(const char *user_id);
 
     /**
      * @brief Validate graph data integrity
@@ -341,6 +598,49 @@ public:
      */
     uint8_t check_graphdata(void);
 
+    /**
+     * @brief Append a graph point to the history ring buffer
+     * @param timestamp Unix timestamp (UTC) of the point
+     * @param value Glucose value
+     * @return true if appended, false if the point is not newer than the newest stored point
+     */
+    bool history_append(uint32_t timestamp, uint16_t value);
+
+    /**
+     * @brief Append a point to any history ring (no linear view)
+     * @param ring History ring buffer
+     * @param timestamp Unix timestamp (UTC) of the point
+     * @param value Glucose value
+     * @return true if appended, false if the point is not newer than the newest stored point
+     */
+    static bool ring_append(History &ring, uint32_t timestamp, uint16_t value);
+
+    /**
+     * @brief Timestamp of the newest point of a history ring
+     * @return Unix timestamp, 0 if the ring is empty
+     */
+    static uint32_t ring_newest(const History &ring);
+
+    /**
+     * @brief Delete all points of a history ring, the sequence number continues
+     */
+    static void ring_clear(History &ring);
+
+    /**
+     * @brief Delete all history points (e.g. after an account change)
+     */
+    void history_clear(void);
+
+    /**
+     * @brief Get the history points added after a sequence number
+     * @param seq Last sequence number seen by the caller (0 = all points)
+     * @param values Output buffer for the values (oldest first), may be NULL
+     * @param timestamps Output buffer for the timestamps, may be NULL
+     * @param max_points Size of the output buffers
+     * @return Number of new points (points evicted in the meantime are not included)
+     */
+    uint8_t get_new_points_since(uint32_t seq, uint16_t *values, uint32_t *timestamps, uint8_t max_points);
+
     /**
      * @brief Authenticate user credentials
      * @param user_email Account email
@@ -359,17 +659,103 @@ public:
     uint16_t tou_user(void);
 
     /**
-     * @brief Retrieve connection metadata
-     * @return HTTP status code
+     * @brief Make sure an auth token is available
+     *
+     * Runs the session state machine (llu_session) for at most
+     * LLU_SESSION_MAX_STEPS states: the token in memory, then the token
+     * cached in NVS and only then the full auth (and tou) flow. A token which
+     * expires within LLU_TOKEN_REFRESH_MARGIN is renewed proactively. A failed
+     * login enters LLU_SESSION_BACKOFF, no login is sent until it ends.
+     * @return 1 if a token is available, 0 otherwise
+     */
+    uint8_t ensure_token(void);
+
+    /**
+     * @brief Forget the token, the next ensure_token() logs in again (no backoff)
+     * @param reason Log message
+     */
+    void session_invalidate(const char *reason);
+
+    /**
+     * @brief ms until the next login try, 0 if not in LLU_SESSION_BACKOFF
+     */
+    uint32_t session_backoff_in(void) const;
+
+    /**
+     * @brief Short name of a SessionState for logs and console
+     */
+    static const char *session_name(uint8_t state);
+
+    /**
+     * @brief Check for a usable token in memory
+     * @return true if user_id and user_token are set
+     */
+    bool has_token(void);
+
+    /**
+     * @brief Forget the token in memory and in NVS (e.g. rejected with 401)
+     */
+    void clear_token(void);
+
+    /**
+     * @brief Read all followed patients from /llu/connections
+     *
+     * The response is streamed into llu_patients (latest measurement of every
+     * patient). A patient whose patientId changed at its position loses its
+     * history.
+     * @return 1 on success, 0 on error
      */
     uint16_t get_connection_data(void);
 
+    /**
+     * @brief Fetch /graph of a patient which is not on screen
+     *
+     * Only the graph points are parsed and appended to the history ring of
+     * the patient, the glucose/sensor data of the active patient is not touched.
+     * @param patient Index in llu_patients
+     * @return 1 on success, 0 on error
+     */
+    uint16_t get_patient_graph(uint8_t patient);
+
+    /**
+     * @brief Check if a patient which is not on screen needs a /graph request
+     * @param patient Index in llu_patients
+     * @return true if the measurement is a history interval newer than the newest history point
+     */
+    bool patient_graph_due(uint8_t patient);
+
+    /**
+     * @brief Switch the patient on screen
+     *
+     * Keeps the history of the previous patient in llu_patients and rebuilds
+     * the linear view from the history of the new one.
+     * @param patient Index in llu_patients
+     * @return false if the index is not valid
+     */
+    bool set_active_patient(uint8_t patient);
+
     /**
      * @brief Fetch glucose graph data
+     *
+     * The response is parsed while streaming (jsonstream.h) directly into
+     * llu_glucose_data and llu_sensor_data. Only graph points newer than the
+     * newest stored point are appended to llu_history. graph_changed tells if
+     * the used values differ from the previous response.
      * @return HTTP status code
      */
     uint16_t get_graph_data(void);
 
+    /**
+     * @brief Parse a /graph response body
+     *
+     * Used by get_graph_data() on the response stream and by the host
+     * harness on a recorded body. Fills llu_glucose_data, llu_sensor_data
+     * and llu_history like a fetch, graph_hash is set if the body is complete.
+     * @param stream Response body
+     * @return JsonStreamParser::parse() status (JSONSTREAM_DONE if complete)
+     */
+    uint8_t parse_graph(Stream &stream);
+
     /**
      * @brief Download root certificate
      * @param download_url Certificate source URL
@@ -386,6 +772,13 @@ public:
      */
     bool setCAfromfile(WiFiClientSecure &client, const char* ca_file);
 
+    /**
+     * @brief Configure WiFiClientSecure with all stored root certificates
+     * @param rebuild Read the PEM files again instead of the cached bundle
+     * @return Number of root certificates, 0 = nothing configured
+     */
+    uint16_t setCAbundle(bool rebuild);
+
     /**
      * @brief Display certificate contents
      * @param ca_file Certificate file path
@@ -417,7 +810,7 @@ public:
      * - 2: Verbose
      * @return TimeCodeState validation result
      */
-    uint8_t check_valid_timestamp(String librelinkup_timestamp, uint8_t print_mode);
+    uint8_t check_valid_timestamp(const char *librelinkup_timestamp, uint8_t print_mode);
 
     /**
      * @brief Map sensor state code to enum
@@ -448,17 +841,15 @@ public:
     bool check_client();
 
     /**
-     * @brief Get secure client reference
-     * @return WiFiClientSecure instance
+     * @brief Close the keep-alive connection
      */
-    WiFiClientSecure & get_wifisecureclient(void);
-    /** @} */
+    void close_connection(void);
 
     /**
-     * @brief converts TimeStamp String in UnixTime format
-     * @return TimeStamp in UnixTime format
+     * @brief Get secure client reference
+     * @return WiFiClientSecure instance
      */
-    time_t parseTimestamp(const char* timestampStr);
+    WiFiClientSecure & get_wifisecureclient(void);
     /** @} */
 };
 
@@ -0,0 +1,322 @@
+#include "llutask.h"
+#include "helper.h"
+#include <WiFi.h>
+
+extern LIBRELINKUP librelinkup;
+extern HELPER helper;
+extern bool ota_in_progress;
+extern uint8_t esp_status_counter_wifi_restart;
+extern uint8_t esp_status_counter_llu_reauth;
+extern uint8_t esp_status_counter_llu_retou;
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+void LLUTASK::begin(void){
+    _mutex = xSemaphoreCreateMutex();
+
+    xTaskCreatePinnedToCore(
+        task,                   // Task-Funktion
+        "LLUTask",              // Name des Tasks
+        LLUTASK_STACK_SIZE,     // Stack-Größe
+        this,                   // Parameter
+        LLUTASK_PRIORITY,       // Priorität
+        &_handle,               // Task-Handle
+        LLUTASK_CORE            // Core 0, LVGL läuft auf Core 1
+    );
+}
+
+void LLUTASK::request_fetch(void){
+    if(_handle != NULL){
+        xTaskNotifyGive(_handle);
+    }
+}
+
+// single flight: a running fetch is joined, otherwise one is requested
+bool LLUTASK::fetch_and_wait(uint32_t timeout_ms){
+    if(_handle == NULL) return false;
+
+    uint32_t done = _fetches_done.load(std::memory_order_acquire);
+    if(!_busy){
+        request_fetch();
+    }
+
+    uint32_t start = millis();
+    while(_fetches_done.load(std::memory_order_acquire) == done){
+        if(millis() - start > timeout_ms) return false;
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    return true;
+}
+
+bool LLUTASK::lock(uint32_t timeout_ms){
+    if(_mutex == NULL) return true;     // task not started, nobody else uses LIBRELINKUP
+    return xSemaphoreTake(_mutex, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void LLUTASK::unlock(void){
+    if(_mutex != NULL) xSemaphoreGive(_mutex);
+}
+
+uint32_t LLUTASK::next_fetch_in(void) const {
+    int32_t remaining = (int32_t)(_next_fetch - millis());
+    return (remaining > 0) ? remaining : 0;
+}
+
+// copy newest snapshot, never waits for the network task
+bool LLUTASK::get_snapshot(LLU_Snapshot &snapshot){
+    for(;;){
+        uint32_t seq = _seq.load(std::memory_order_acquire);
+        uint32_t stable = seq & ~1UL;   // while writing (odd) the previous buffer is still valid
+
+        if(stable == _read_seq){
+            return false;               // nothing new
+        }
+        memcpy(&snapshot, &_buffer[(stable >> 1) & 1], sizeof(LLU_Snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // the task starts to overwrite this buffer at seq = stable + 3
+        if(_seq.load(std::memory_order_relaxed) - stable <= 2){
+            _read_seq = stable;
+            return true;
+        }
+        snapshot_retries++;
+    }
+}
+
+bool LLUTASK::wait_first_snapshot(uint32_t timeout_ms){
+    uint32_t start = millis();
+    while(_seq.load(std::memory_order_acquire) < 2){
+        if(millis() - start > timeout_ms) return false;
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return true;
+}
+
+void LLUTASK::task(void *parameter){
+    static_cast<LLUTASK *>(parameter)->run();
+}
+
+void LLUTASK::run(void){
+    logger.notice("LLU network task started on core %d", xPortGetCoreID());
+    _next_fetch = millis();     // first fetch immediately
+
+    while(1){
+        int32_t wait = (int32_t)(_next_fetch - millis());
+        if(wait > 0){
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));  // wakes up early on request_fetch()
+        }
+        _next_fetch = millis() + LLUTASK_FETCH_INTERVAL;   // fallback, fetch() plans the real delay
+
+        if(ota_in_progress == 1){
+            continue;
+        }
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _busy = true;
+        fetch();
+        librelinkup.stage_stats.save_if_due();
+        _busy = false;
+        _fetches_done.fetch_add(1, std::memory_order_release);
+        xSemaphoreGive(_mutex);
+    }
+}
+
+// fetch glucose data and publish the result (network task)
+void LLUTASK::fetch(void){
+
+    if(WiFi.status() != WL_CONNECTED){
+        static uint8_t counter_internet_offline = 0;
+        if(++counter_internet_offline == 5){
+            counter_internet_offline = 0;
+            logger.notice("Client offline -> reconnect to WiFi");
+            esp_status_counter_wifi_restart++;
+            WiFi.disconnect();
+            WiFi.reconnect();
+        }
+        _next_fetch = millis() + scheduler.on_error();
+        publish(LLU_FETCH_OFFLINE);
+        return;
+    }
+
+    // one /llu/connections request covers the latest measurement of all followed patients,
+    // with a single patient it is only needed now and then to notice new patients
+    if(!_connections_valid || librelinkup.llu_patient_count > 1 ||
+       millis() - _connections_time >= LLUTASK_CONNECTIONS_REFRESH){
+        if(librelinkup.get_connection_data() != 0){
+            _connections_valid = true;
+            _connections_time = millis();
+        }else{
+            logger.notice("API Error: get connection data");   // /graph of the known patient still works
+        }
+    }
+
+    if(librelinkup.get_graph_data() == 0){
+        logger.notice("API Error: get graph data");
+        // no fetch before the next login is allowed
+        uint32_t delay = scheduler.on_error();
+        uint32_t backoff = librelinkup.session_backoff_in();
+        _next_fetch = millis() + ((backoff > delay) ? backoff : delay);
+        publish(LLU_FETCH_API_ERROR);
+        return;
+    }
+
+    fetch_followed_patient();
+
+    logger.debug("LLU API fetch time: %dms (handshake: %dms, transfer: %dms), %d bytes (%d on the wire)", librelinkup.https_llu_api_fetch_time,
+                 librelinkup.https_llu_api_handshake_time, librelinkup.https_llu_api_transfer_time,
+                 librelinkup.https_llu_api_body_bytes, librelinkup.https_llu_api_wire_bytes);
+
+    // Sensorstatus und Zeitstempel auslesen, bei unveränderter /graph Antwort nur das Alter des Messwerts
+    if(librelinkup.graph_changed){
+        librelinkup.llu_status.sensor_state = librelinkup.check_sensor_lifetime(librelinkup.llu_sensor_data.sensor_non_activ_unixtime);
+        librelinkup.llu_status.last_timestamp_unixtime = helper.convertStrToUnixTime(librelinkup.llu_glucose_data.str_measurement_timestamp.c_str(), librelinkup.llu_utc_offset);
+    }
+    librelinkup.llu_status.timestamp_status = librelinkup.check_valid_timestamp(librelinkup.llu_glucose_data.str_measurement_timestamp.c_str(), 1);
+
+    // Set TrendMessage based on sensor status
+    update_trend_message();
+
+    if(librelinkup.llu_status.timestamp_status != SENSOR_TIMECODE_VALID){
+        handle_invalid_timestamp();
+    }
+
+    // plan the next fetch shortly after the next measurement is expected
+    _next_fetch = millis() + scheduler.on_success(librelinkup.llu_glucose_data.measurement_unixtime,
+                                                  librelinkup.llu_status.sensor_state,
+                                                  librelinkup.llu_sensor_data.sensor_non_activ_unixtime,
+                                                  time(NULL));
+
+    // nothing new for the UI: no redraw, storage or MQTT update
+    if(!librelinkup.graph_changed && _published_status == LLU_FETCH_OK &&
+       librelinkup.llu_status.timestamp_status == _published_timestamp_status){
+        unchanged_fetches++;
+        logger.debug("graph data unchanged (%08x) -> no snapshot", librelinkup.graph_hash);
+        return;
+    }
+
+    publish(LLU_FETCH_OK);
+}
+
+// /graph for at most one patient not on screen, only if a new history point is available
+void LLUTASK::fetch_followed_patient(void){
+
+    uint8_t count = librelinkup.llu_patient_count;
+    for(uint8_t i = 1; i <= count; i++){
+        uint8_t patient = (_followed_patient + i) % count;
+        if(librelinkup.patient_graph_due(patient)){
+            _followed_patient = patient;
+            if(librelinkup.get_patient_graph(patient) == 0){
+                logger.notice("API Error: get graph data of patient %d", patient);
+            }
+            return;
+        }
+    }
+}
+
+// re-auth if there is no valid sensor data for several fetches
+void LLUTASK::handle_invalid_timestamp(void){
+
+    static uint8_t invalid_timestamp_counter = 0;
+    if (librelinkup.llu_status.timestamp_status == SENSOR_TIMECODE_ERROR &&
+        librelinkup.llu_status.sensor_state == SENSOR_NOT_AVAILABLE) {
+
+        if (++invalid_timestamp_counter == 5) {
+            esp_status_counter_llu_reauth++;
+            uint32_t tou = librelinkup.llu_session.tou;
+            librelinkup.session_invalidate("no valid timestamp");
+            librelinkup.ensure_token();
+            if (librelinkup.llu_session.tou != tou) {
+                esp_status_counter_llu_retou++;
+            }
+        }
+
+        if (invalid_timestamp_counter == 10) {
+            invalid_timestamp_counter = 0;
+            logger.notice("invalid_timestamp_counter out of range! -> call restart");
+            // esp_restart();
+        }
+    }
+}
+
+void LLUTASK::update_trend_message(void){
+    int remaining_time = 0;
+
+    switch (librelinkup.llu_status.sensor_state) {
+        case SENSOR_EXPIRED:
+            librelinkup.llu_glucose_data.str_TrendMessage = "sensor expired!";
+            logger.notice("sensor expired!");
+            break;
+        case SENSOR_NOT_AVAILABLE:
+            librelinkup.llu_glucose_data.str_TrendMessage = "no active sensor";
+            logger.notice("no active sensor");
+            break;
+        case SENSOR_STARTING:
+            remaining_time = librelinkup.get_remaining_warmup_time(librelinkup.llu_sensor_data.sensor_non_activ_unixtime);
+            librelinkup.llu_glucose_data.str_TrendMessage.printf("sensor ready in %d min", remaining_time);
+            logger.notice("Sensor in starting phase!");
+            break;
+        case SENSOR_READY:
+            librelinkup.llu_glucose_data.str_TrendMessage = "";
+            break;
+    }
+}
+
+// write the snapshot into the buffer the UI is not reading
+void LLUTASK::publish(uint8_t fetch_status){
+
+    uint32_t seq = _seq.load(std::memory_order_relaxed);
+    LLU_Snapshot &s = _buffer[((seq >> 1) + 1) & 1];
+
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.fetch_count                   = ++_fetch_count;
+    s.fetch_status                  = fetch_status;
+    _published_status               = fetch_status;
+    _published_timestamp_status     = librelinkup.llu_status.timestamp_status;
+
+    s.glucoseMeasurement            = librelinkup.llu_glucose_data.glucoseMeasurement;
+    s.trendArrow                    = librelinkup.llu_glucose_data.trendArrow;
+    s.measurement_color             = librelinkup.llu_glucose_data.measurement_color;
+    strlcpy(s.str_trendArrow, librelinkup.llu_glucose_data.str_trendArrow.c_str(), sizeof(s.str_trendArrow));
+    strlcpy(s.str_TrendMessage, librelinkup.llu_glucose_data.str_TrendMessage.c_str(), sizeof(s.str_TrendMessage));
+    strlcpy(s.str_measurement_timestamp, librelinkup.llu_glucose_data.str_measurement_timestamp.c_str(), sizeof(s.str_measurement_timestamp));
+    s.glucosetargetLow              = librelinkup.llu_glucose_data.glucosetargetLow;
+    s.glucosetargetHigh             = librelinkup.llu_glucose_data.glucosetargetHigh;
+    s.glucoseAlarmLow               = librelinkup.llu_glucose_data.glucoseAlarmLow;
+
+    s.timestamp_status              = librelinkup.llu_status.timestamp_status;
+    s.sensor_state                  = librelinkup.llu_status.sensor_state;
+    s.sensor_pt                     = librelinkup.llu_sensor_data.sensor_state;
+    s.last_timestamp_unixtime       = librelinkup.llu_status.last_timestamp_unixtime;
+    s.measurement_unixtime          = librelinkup.llu_glucose_data.measurement_unixtime;
+    s.sensor_non_activ_unixtime     = librelinkup.llu_sensor_data.sensor_non_activ_unixtime;
+    s.sensor_valid_days             = librelinkup.sensor_livetime.sensor_valid_days;
+    s.sensor_valid_hours            = librelinkup.sensor_livetime.sensor_valid_hours;
+    s.sensor_valid_minutes          = librelinkup.sensor_livetime.sensor_valid_minutes;
+    strlcpy(s.sensor_id, librelinkup.llu_sensor_data.sensor_id.c_str(), sizeof(s.sensor_id));
+    strlcpy(s.sensor_sn, librelinkup.llu_sensor_data.sensor_sn.c_str(), sizeof(s.sensor_sn));
+
+    s.data_count                    = librelinkup.check_graphdata();
+    s.history_seq                   = librelinkup.llu_history.seq;
+    memcpy(s.graph_data, librelinkup.llu_sensor_history_data.graph_data, sizeof(s.graph_data));
+    memcpy(s.timestamp, librelinkup.llu_sensor_history_data.timestamp, sizeof(s.timestamp));
+
+    s.fetch_time                    = librelinkup.https_llu_api_fetch_time;
+    s.handshake_time                = librelinkup.https_llu_api_handshake_time;
+    s.transfer_time                 = librelinkup.https_llu_api_transfer_time;
+
+    s.patient_count                 = librelinkup.llu_patient_count;
+    s.active_patient                = librelinkup.llu_active_patient;
+    s.patient_name[0]               = '\0';
+    s.patient_id[0]                 = '\0';
+    if(s.active_patient < s.patient_count){
+        const LIBRELINKUP::Patient &patient = librelinkup.llu_patients[s.active_patient];
+        snprintf(s.patient_name, sizeof(s.patient_name), "%s %s", patient.first_name.c_str(), patient.last_name.c_str());
+        strlcpy(s.patient_id, patient.patient_id.c_str(), sizeof(s.patient_id));
+    }
+
+    _seq.store(seq + 2, std::memory_order_release);
+}
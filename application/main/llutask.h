@@ -0,0 +1,175 @@
+/**
+ * @file llutask.h
+ * @brief LibreLinkUp network task with snapshot handoff to the UI
+ *
+ * The LibreLinkUp fetch (DNS, TLS, body read) runs in its own FreeRTOS task.
+ * After every fetch the task publishes an immutable snapshot of the glucose,
+ * sensor and history data. The UI copies the newest snapshot on its next frame
+ * and never waits for the network.
+ */
+
+#ifndef LLUTASK_H
+#define LLUTASK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "librelinkup.h"
+#include "pollscheduler.h"
+
+/**
+ * @defgroup llutask_constants Network Task Settings
+ * @{
+ */
+#define LLUTASK_STACK_SIZE      8192    ///< Stack size (TLS handshake needs ~6 KB)
+#define LLUTASK_PRIORITY        1       ///< Same priority as the Arduino loop task
+#define LLUTASK_CORE            0       ///< Network core, LVGL runs on core 1
+#define LLUTASK_FETCH_INTERVAL  60000   ///< Fallback interval if no fetch planned the next one
+#define LLUTASK_CONNECTIONS_REFRESH 3600000 ///< /llu/connections interval with only one patient
+/** @} */
+
+/**
+ * @enum LLU_FetchStatus
+ * @brief Result of the fetch that produced a snapshot
+ */
+enum LLU_FetchStatus : uint8_t {
+    LLU_FETCH_NONE      = 0, ///< no fetch done yet
+    LLU_FETCH_OK        = 1, ///< data received
+    LLU_FETCH_API_ERROR = 2, ///< request failed, data of the last successful fetch
+    LLU_FETCH_OFFLINE   = 3, ///< WiFi not connected, data of the last successful fetch
+};
+
+/**
+ * @struct LLU_Snapshot
+ * @brief Copy of everything the UI needs from one fetch (no heap, no String)
+ */
+struct LLU_Snapshot {
+    uint32_t fetch_count;                   ///< Number of the fetch that produced this snapshot
+    uint8_t fetch_status;                   ///< LLU_FetchStatus
+
+    uint16_t glucoseMeasurement;            ///< Current measurement (mg/dL)
+    uint8_t trendArrow;                     ///< Trend direction code
+    uint8_t measurement_color;              ///< Display color code
+    char str_trendArrow[12];                ///< Trend direction text (UTF-8)
+    char str_TrendMessage[40];              ///< Trend message / sensor status text
+    char str_measurement_timestamp[24];     ///< LibreLinkUp timestamp of the measurement
+    uint16_t glucosetargetLow;              ///< Lower target range
+    uint16_t glucosetargetHigh;             ///< Upper target range
+    uint16_t glucoseAlarmLow;               ///< Low glucose threshold
+
+    uint8_t timestamp_status;               ///< check_valid_timestamp() result
+    uint8_t sensor_state;                   ///< check_sensor_lifetime() result
+    uint8_t sensor_pt;                      ///< Sensor state reported by the API
+    uint32_t last_timestamp_unixtime;       ///< Measurement time (Unix, account local Timestamp)
+    uint32_t measurement_unixtime;          ///< Measurement time (Unix, FactoryTimestamp like the history)
+    uint32_t sensor_non_activ_unixtime;     ///< Activation time of the new sensor
+    uint32_t sensor_valid_days;             ///< Sensor lifetime left
+    uint32_t sensor_valid_hours;
+    uint32_t sensor_valid_minutes;
+    char sensor_id[40];                     ///< Active sensor ID
+    char sensor_sn[16];                     ///< Active sensor serial
+
+    uint8_t data_count;                     ///< Valid history points (check_graphdata())
+    uint32_t history_seq;                   ///< llu_history.seq of the newest point
+    uint16_t graph_data[LIBRELINKUP::GRAPHDATAARRAYSIZE + LIBRELINKUP::GRAPHDATAARRAYSIZE_PLUS_ONE];  ///< History view, oldest first
+    uint32_t timestamp[LIBRELINKUP::GRAPHDATAARRAYSIZE + LIBRELINKUP::GRAPHDATAARRAYSIZE_PLUS_ONE];   ///< History timestamps
+
+    uint32_t fetch_time;                    ///< Duration of the fetch in ms
+    uint32_t handshake_time;                ///< TLS handshake part
+    uint32_t transfer_time;                 ///< Request/response part
+
+    uint8_t patient_count;                  ///< Followed patients (0 = connections not read yet)
+    uint8_t active_patient;                 ///< Patient shown on screen
+    char patient_name[48];                  ///< First and last name of the active patient
+    char patient_id[40];                    ///< patientId of the active patient (empty = connections not read yet)
+};
+
+/**
+ * @class LLUTASK
+ * @brief Runs the LibreLinkUp fetch in a FreeRTOS task
+ *
+ * The snapshot is handed over through a double buffer with a sequence
+ * counter: the task always writes the buffer the UI does not read, the UI
+ * checks the counter after copying and repeats the copy only if the task has
+ * started to overwrite the same buffer again in the meantime.
+ */
+class LLUTASK {
+public:
+    /**
+     * @brief Create mutex and start the network task
+     */
+    void begin(void);
+
+    /**
+     * @brief Trigger a fetch now instead of waiting for the interval
+     */
+    void request_fetch(void);
+
+    /**
+     * @brief Wait for the result of a fetch (single flight)
+     *
+     * A fetch in progress is joined, otherwise one is requested. Several
+     * callers waiting at the same time share one request to the server.
+     * @param timeout_ms Maximum wait time
+     * @return true if a fetch was completed, LIBRELINKUP holds its result
+     */
+    bool fetch_and_wait(uint32_t timeout_ms = 30000);
+
+    /**
+     * @brief Copy the newest snapshot if it was not read yet (UI task)
+     * @param snapshot Destination
+     * @return true if a new snapshot was copied
+     */
+    bool get_snapshot(LLU_Snapshot &snapshot);
+
+    /**
+     * @brief Wait for the first snapshot (setup only)
+     * @param timeout_ms Maximum wait time
+     * @return true if a snapshot is available
+     */
+    bool wait_first_snapshot(uint32_t timeout_ms);
+
+    /**
+     * @brief Get exclusive access to LIBRELINKUP (telnet commands)
+     * @param timeout_ms Maximum wait time
+     * @return true if locked
+     */
+    bool lock(uint32_t timeout_ms = 30000);
+
+    /**
+     * @brief Release the LIBRELINKUP lock
+     */
+    void unlock(void);
+
+    bool busy(void) const { return _busy; }     ///< Fetch in progress
+    uint32_t next_fetch_in(void) const;         ///< ms until the next planned fetch
+    uint32_t snapshot_retries = 0;              ///< Snapshot copies repeated by the reader
+    uint32_t unchanged_fetches = 0;             ///< Fetches without a new snapshot (same /graph data)
+    POLLSCHEDULER scheduler;                    ///< Plans the next fetch (network task only)
+
+private:
+    static void task(void *parameter);
+    void run(void);
+    void fetch(void);
+    void fetch_followed_patient(void);
+    void handle_invalid_timestamp(void);
+    void update_trend_message(void);
+    void publish(uint8_t fetch_status);
+
+    SemaphoreHandle_t _mutex = NULL;
+    TaskHandle_t _handle = NULL;
+    volatile bool _busy = false;
+    volatile uint32_t _next_fetch = 0;          ///< millis() of the next planned fetch
+    uint32_t _fetch_count = 0;
+    std::atomic<uint32_t> _fetches_done{0};     ///< completed fetches (fetch_and_wait())
+    uint32_t _connections_time = 0;             ///< millis() of the last /llu/connections request
+    bool _connections_valid = false;            ///< llu_patients read at least once
+    uint8_t _followed_patient = 0;              ///< round robin over the patients not on screen
+    uint8_t _published_status = 0xff;           ///< fetch_status of the last snapshot (0xff = none yet)
+    uint8_t _published_timestamp_status = 0;    ///< timestamp_status of the last snapshot
+
+    LLU_Snapshot _buffer[2];                    ///< double buffer, index = (seq >> 1) & 1
+    std::atomic<uint32_t> _seq{0};              ///< even: stable, odd: writing the other buffer
+    uint32_t _read_seq = 0;                     ///< seq of the last snapshot copied by the UI
+};
+
+#endif // LLUTASK_H
@@ -217,6 +217,12 @@ HBA1C hba1c;
 
 LIBRELINKUP librelinkup;
 
+//------------------------------[ LibreLinkUp network task ]----------------------------
+#include "llutask.h"
+
+LLUTASK llu_task;                       ///< fetches in its own task (core 0)
+LLU_Snapshot llu_view;                  ///< last snapshot, only used by the UI
+
 int16_t glucose_delta = 0;              ///< Change from last reading
 uint16_t glucoseMeasurement_backup = 0; ///< Previous measurement
 
@@ -490,6 +496,8 @@ void onOTAStart() {
     Serial.println("OTA update started!");
     logger.notice("OTA Update Progress has started");
     ota_in_progress = 1;
+    // the new firmware may place the RTC journal elsewhere
+    hba1c.glucose_log.flush();
 }
 
 void onOTAProgress(size_t current, size_t final) {
@@ -560,9 +568,6 @@ uint64_t g_timer_30000ms_backup = 0;            //Timer3 backup time
 const uint64_t timer_10000ms = 10000;           //Timer4 10000ms
 uint64_t g_timer_10000ms_backup = 0;            //Timer4 backup time
 
-const uint64_t timer_60000ms = 60000;           //Timer4 60000ms
-uint64_t g_timer_60000ms_backup = 0;            //Timer4 backup time
-
 const uint64_t timer_120000ms = 120000;         //Timer4 120000ms
 uint64_t g_timer_120000ms_backup = 0;           //Timer4 backup time
 
@@ -607,6 +612,8 @@ PubSubClient mqtt_client(mqttClient);
 
 DynamicJsonDocument json_mqtt(256);
 
+#define MQTT_STATS_INTERVAL 900000     // publish interval of the stage histograms in ms
+
 void setup_mqtt(void);
 //------------------------------------------------------------------------------
 
@@ -638,6 +645,8 @@ void esp_status(){
     logger.notice("Größter freier Block: %d Bytes", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
     logger.notice("Interner RAM (DMA-fähig): %d Bytes", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
     logger.notice("PSRAM verfügbar: %d Bytes", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    Heap_Info heap = HELPER::getHeapInfo();
+    logger.notice("Fragmentierung (intern): %d%% (größter Block %d / frei %d Bytes)", heap.fragmentation, heap.largest_block, heap.free_size);
     logger.notice("==============================");
     //logger.notice("ESP32 bootcount : %d",trgb.getBootCount());
     logger.notice("Wifi Reconnects : %d",esp_status_counter_wifi_restart);
@@ -673,8 +682,8 @@ uint8_t set_trgb_backlight_brightness(uint8_t value)
 //--------------------------[mqtt configuration]--------------------------------
 void mqtt_publish(){
     
-    json_mqtt["glucoseMeasurement"] = librelinkup.llu_glucose_data.glucoseMeasurement;
-    json_mqtt["trendArrow"]         = librelinkup.llu_glucose_data.trendArrow;
+    json_mqtt["glucoseMeasurement"] = llu_view.glucoseMeasurement;
+    json_mqtt["trendArrow"]         = llu_view.trendArrow;
     json_mqtt["brightness"]         = settings.config.brightness;
     json_mqtt["mqtt_mode"]          = settings.config.mqtt_mode;
     json_mqtt["ota_server"]         = settings.config.ota_update;
@@ -704,10 +713,46 @@ void mqtt_publish(){
     mqtt_client.publish((mqtt.mqtt_base + mqtt.mqtt_client_name + mqtt.mqtt_client_network).c_str(), mqtt.mqtt_buffer);      //send to server
 }
 
+// fetch stage histograms, one topic per stage: librelinkup/stats/<stage>
+void mqtt_publish_stats(){
+
+    for (uint8_t stage = 0; stage < LLU_STAGE_COUNT; stage++) {
+        json_mqtt["n"]   = librelinkup.stage_stats.count(stage);
+        json_mqtt["p50"] = librelinkup.stage_stats.percentile(stage, 50);
+        json_mqtt["p90"] = librelinkup.stage_stats.percentile(stage, 90);
+        json_mqtt["p99"] = librelinkup.stage_stats.percentile(stage, 99);
+        json_mqtt["max"] = librelinkup.stage_stats.max(stage);
+
+        serializeJson(json_mqtt, mqtt.mqtt_buffer);             //do serialation and copy into buffer
+        json_mqtt.clear();                                      //clears the data object
+        mqtt_client.publish((mqtt.mqtt_base + mqtt.mqtt_client_name + mqtt.mqtt_client_stats + "/" + StageStats::stage_name(stage)).c_str(), mqtt.mqtt_buffer);
+    }
+
+    // flash writes of the glucose log (wa = written / payload in percent)
+    json_mqtt["appends"] = hba1c.glucose_log.stats.appends;
+    json_mqtt["payload"] = hba1c.glucose_log.stats.payload_bytes;
+    json_mqtt["written"] = hba1c.glucose_log.stats.written_bytes;
+    json_mqtt["wa"]      = hba1c.glucose_log.write_amplification();
+    json_mqtt["staged"]  = hba1c.glucose_log.staged();
+    json_mqtt["flushes"] = hba1c.glucose_log.stats.flushes;
+    json_mqtt["backfilled"] = hba1c.glucose_log.stats.backfilled;
+
+    serializeJson(json_mqtt, mqtt.mqtt_buffer);
+    json_mqtt.clear();
+    mqtt_client.publish((mqtt.mqtt_base + mqtt.mqtt_client_name + mqtt.mqtt_client_stats + "/glucoselog").c_str(), mqtt.mqtt_buffer);
+}
+
 void update_mqtt_publish(){
     //publish mqtt data to mqtt broker
     if (settings.config.mqtt_mode == 1) {
         mqtt_publish();
+
+        // histograms change slowly, every MQTT_STATS_INTERVAL is enough
+        static uint32_t stats_published = 0;
+        if (stats_published == 0 || millis() - stats_published >= MQTT_STATS_INTERVAL) {
+            stats_published = millis();
+            mqtt_publish_stats();
+        }
     }
 }
 
@@ -858,9 +903,9 @@ static void highlight_last_point() {
     const uint8_t y_pos_offset = 12;
 
     // **Letzten gespeicherten Wert aus dem Array holen**
-    int16_t last_value = librelinkup.llu_sensor_history_data.graph_data[librelinkup.GRAPHDATAARRAYSIZE + librelinkup.GRAPHDATAARRAYSIZE_PLUS_ONE - 1];
+    int16_t last_value = llu_view.graph_data[librelinkup.GRAPHDATAARRAYSIZE + librelinkup.GRAPHDATAARRAYSIZE_PLUS_ONE - 1];
     
-    if (last_value == LV_CHART_POINT_NONE || librelinkup.llu_sensor_history_data.graph_data[librelinkup.GRAPHDATAARRAYSIZE + librelinkup.GRAPHDATAARRAYSIZE_PLUS_ONE - 1] == 0){
+    if (last_value == LV_CHART_POINT_NONE || llu_view.graph_data[librelinkup.GRAPHDATAARRAYSIZE + librelinkup.GRAPHDATAARRAYSIZE_PLUS_ONE - 1] == 0){
         lv_obj_add_flag(ui_Chart_Glucose_5Min_last_point_marker, LV_OBJ_FLAG_HIDDEN); // hide object
         return;  // Falls kein Wert vorhanden, nichts tun
     }else{
@@ -880,7 +925,7 @@ static void highlight_last_point() {
     lv_coord_t y_pos = (chart_height - ((last_value - y_min) * chart_height) / (y_max - y_min)) - y_pos_offset;
     
     // **Set marker color
-    if(last_value >= librelinkup.llu_glucose_data.glucosetargetHigh || last_value <= librelinkup.llu_glucose_data.glucoseAlarmLow){
+    if(last_value >= llu_view.glucosetargetHigh || last_value <= llu_view.glucoseAlarmLow){
         lv_obj_set_style_bg_color(ui_Chart_Glucose_5Min_last_point_marker, lv_palette_main(LV_PALETTE_RED), 0);
     }else{
         lv_obj_set_style_bg_color(ui_Chart_Glucose_5Min_last_point_marker, lv_palette_main(LV_PALETTE_GREEN), 0);
@@ -1058,7 +1103,7 @@ static void touch_event_cb(lv_event_t * e) {
     if (index < 0) index = 0;
 
     // **Y-Wert aus der Chart-Serie holen**
-    int16_t value = librelinkup.llu_sensor_history_data.graph_data[index];
+    int16_t value = llu_view.graph_data[index];
 
     // Falls kein gültiger Wert → Marker verstecken
     if (value == LV_CHART_POINT_NONE || value == 0) {
@@ -1081,7 +1126,7 @@ static void touch_event_cb(lv_event_t * e) {
     const uint8_t y_pos_offset = 6;
 
     // **Marker-Farbe setzen**
-    if (value >= librelinkup.llu_glucose_data.glucosetargetHigh || value <= librelinkup.llu_glucose_data.glucoseAlarmLow) {
+    if (value >= llu_view.glucosetargetHigh || value <= llu_view.glucoseAlarmLow) {
         lv_obj_set_style_bg_color(ui_Chart_Glucose_5Min_last_point_marker, lv_palette_main(LV_PALETTE_RED), 0);
     } else {
         lv_obj_set_style_bg_color(ui_Chart_Glucose_5Min_last_point_marker, lv_palette_main(LV_PALETTE_GREEN), 0);
@@ -1095,10 +1140,10 @@ static void touch_event_cb(lv_event_t * e) {
 
     // **Y-Wert als Label anzeigen**
     uint8_t mode = 1;
-    uint8_t color = (value >= librelinkup.llu_glucose_data.glucosetargetHigh || value <= librelinkup.llu_glucose_data.glucoseAlarmLow) ? LV_PALETTE_RED : LV_PALETTE_GREEN;
+    uint8_t color = (value >= llu_view.glucosetargetHigh || value <= llu_view.glucoseAlarmLow) ? LV_PALETTE_RED : LV_PALETTE_GREEN;
     uint16_t glucose_value = value;
     
-    draw_labels(mode, color, glucose_value, librelinkup.llu_glucose_data.str_trendArrow, librelinkup.llu_glucose_data.str_TrendMessage, 0);
+    draw_labels(mode, color, glucose_value, llu_view.str_trendArrow, llu_view.str_TrendMessage, 0);
     
     // **Debugging-Ausgabe**
     logger.notice("Touch X (rel): %d, Index: %d, Value: %d, Y: %d", relative_x, index, value, y_pos);
@@ -1139,17 +1184,17 @@ void lcd_status_indication(bool on_off, uint8_t color){
 void draw_chart_sensor_valid(){
 
     // draw valid days chart
-    if(librelinkup.sensor_livetime.sensor_valid_days > 0 && librelinkup.sensor_livetime.sensor_valid_hours >= 0){
+    if(llu_view.sensor_valid_days > 0 && llu_view.sensor_valid_hours >= 0){
         switch_sensor_valid_progress_bar(&dayBar, 0);
-        update_chart_valid_values(&dayBar,librelinkup.sensor_livetime.sensor_valid_days +1);
+        update_chart_valid_values(&dayBar,llu_view.sensor_valid_days +1);
     }
-    else if(librelinkup.sensor_livetime.sensor_valid_days == 0 && (librelinkup.sensor_livetime.sensor_valid_hours > 0 && librelinkup.sensor_livetime.sensor_valid_hours < 24)){
+    else if(llu_view.sensor_valid_days == 0 && (llu_view.sensor_valid_hours > 0 && llu_view.sensor_valid_hours < 24)){
         switch_sensor_valid_progress_bar(&hourBar, 1);
-        update_chart_valid_values(&hourBar, librelinkup.sensor_livetime.sensor_valid_hours +1);   
+        update_chart_valid_values(&hourBar, llu_view.sensor_valid_hours +1);   
     }
-    else if(librelinkup.sensor_livetime.sensor_valid_days == 0 && librelinkup.sensor_livetime.sensor_valid_hours == 0 && librelinkup.sensor_livetime.sensor_valid_minutes < 60){
+    else if(llu_view.sensor_valid_days == 0 && llu_view.sensor_valid_hours == 0 && llu_view.sensor_valid_minutes < 60){
         switch_sensor_valid_progress_bar(&minuteBar, 2);
-        update_chart_valid_values(&minuteBar, librelinkup.sensor_livetime.sensor_valid_minutes +1);
+        update_chart_valid_values(&minuteBar, llu_view.sensor_valid_minutes +1);
     }
     
     lv_timer_handler();delay(5);
@@ -1174,12 +1219,12 @@ void add_axis_labels() {
      
     // ✅ X-Achse: Nur drei Labels (Anfang, Mitte, Ende)
     static char labels[3][6]; // "HH:MM" + Null-Terminator
-    uint8_t data_count = librelinkup.check_graphdata();
+    uint8_t data_count = llu_view.data_count;
     
     // Ersten, mittleren und letzten Zeitstempel ermitteln
-    uint32_t first_timestamp = librelinkup.llu_sensor_history_data.timestamp[0];
-    uint32_t middle_timestamp = librelinkup.llu_sensor_history_data.timestamp[data_count / 2];
-    uint32_t last_timestamp = librelinkup.llu_sensor_history_data.timestamp[data_count - 1];
+    uint32_t first_timestamp = llu_view.timestamp[0];
+    uint32_t middle_timestamp = llu_view.timestamp[data_count / 2];
+    uint32_t last_timestamp = llu_view.timestamp[data_count - 1];
 
     // Zeitstempel formatieren
     helper.format_time(labels[0], sizeof(labels[0]), first_timestamp);  // Erster Zeitstempel
@@ -1201,14 +1246,14 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
     if (mode == 0 || mode == 3) {
         // Draw limit lines
         lv_chart_set_x_start_point(ui_Chart_Glucose_5Min, glucoseValueSeries_5Min, 0);
-        lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_upperlimit, librelinkup.llu_glucose_data.glucosetargetHigh);
-        lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_lowerlimit, librelinkup.llu_glucose_data.glucosetargetLow);
+        lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_upperlimit, llu_view.glucosetargetHigh);
+        lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_lowerlimit, llu_view.glucosetargetLow);
     }
 
     if (mode == 1 || mode == 3) {
         uint16_t glucose_value = 0;
         static uint8_t data_count_backup = 0;
-        uint8_t data_count = librelinkup.check_graphdata();
+        uint8_t data_count = llu_view.data_count;
         
         // Alle bisherigen Punkte löschen
         lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_5Min, LV_CHART_POINT_NONE);
@@ -1216,9 +1261,9 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
         lv_chart_set_all_value(ui_Chart_Glucose_5Min, glucoseValueSeries_last, LV_CHART_POINT_NONE);
 
         // Durch alle historischen Daten iterieren
-        uint32_t sensor_active_time = (librelinkup.sensor_livetime.sensor_valid_days * 24 * 60 * 60) + 
-                                      (librelinkup.sensor_livetime.sensor_valid_hours * 60 * 60) + 
-                                      (librelinkup.sensor_livetime.sensor_valid_minutes * 60);
+        uint32_t sensor_active_time = (llu_view.sensor_valid_days * 24 * 60 * 60) + 
+                                      (llu_view.sensor_valid_hours * 60 * 60) + 
+                                      (llu_view.sensor_valid_minutes * 60);
         
         if (sensor_active_time <= librelinkup.TIMEFULLGRAPHDATA) {
             for (int i = 0; i < librelinkup.GRAPHDATAARRAYSIZE; i++) {
@@ -1226,10 +1271,10 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
 
                 if (index < 0 || index >= librelinkup.GRAPHDATAARRAYSIZE) continue;  // Sicherheitsprüfung
 
-                glucose_value = librelinkup.llu_sensor_history_data.graph_data[index];
+                glucose_value = llu_view.graph_data[index];
 
                 if (glucose_value != 0) {
-                    if (glucose_value > librelinkup.llu_glucose_data.glucosetargetHigh || glucose_value < librelinkup.llu_glucose_data.glucosetargetLow) {
+                    if (glucose_value > llu_view.glucosetargetHigh || glucose_value < llu_view.glucosetargetLow) {
                         lv_chart_set_value_by_id(ui_Chart_Glucose_5Min, glucoseValueSeries_alert, index, glucose_value);
                     } else {
                         lv_chart_set_value_by_id(ui_Chart_Glucose_5Min, glucoseValueSeries_5Min, index, glucose_value);
@@ -1245,10 +1290,10 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
             
             for (int i = 0; i < data_count; i++) {
                 uint8_t index = (data_count-1)-i;
-                glucose_value = librelinkup.llu_sensor_history_data.graph_data[index];
+                glucose_value = llu_view.graph_data[index];
                 
                 if(glucose_value != 0){
-                    if(glucose_value > librelinkup.llu_glucose_data.glucosetargetHigh || glucose_value < librelinkup.llu_glucose_data.glucosetargetLow){
+                    if(glucose_value > llu_view.glucosetargetHigh || glucose_value < llu_view.glucosetargetLow){
                         lv_chart_set_value_by_id(ui_Chart_Glucose_5Min, glucoseValueSeries_alert, 
                                             (librelinkup.GRAPHDATAARRAYSIZE-1)-i, glucose_value);
                     }else {
@@ -1262,10 +1307,10 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
         // Aktuellen Messwert setzen bei Index 141
         uint16_t last_index = librelinkup.GRAPHDATAARRAYSIZE;  // Index 141 ist jetzt der aktuelle Messwert
 
-        if (librelinkup.llu_status.timestamp_status == SENSOR_TIMECODE_VALID) {
-            librelinkup.llu_sensor_history_data.graph_data[last_index] = librelinkup.llu_glucose_data.glucoseMeasurement;
+        if (llu_view.timestamp_status == SENSOR_TIMECODE_VALID) {
+            llu_view.graph_data[last_index] = llu_view.glucoseMeasurement;
 
-            lv_chart_set_value_by_id(ui_Chart_Glucose_5Min, glucoseValueSeries_5Min, last_index, librelinkup.llu_glucose_data.glucoseMeasurement);
+            lv_chart_set_value_by_id(ui_Chart_Glucose_5Min, glucoseValueSeries_5Min, last_index, llu_view.glucoseMeasurement);
 
             // Highlight den letzten Punkt
             highlight_last_point();
@@ -1283,7 +1328,7 @@ void draw_chart_glucose_data(uint8_t mode, bool fiveminuteupdate) {
     }
 }
 
-void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glucose_value, String _trendarrow, String _trendmessage, int16_t delta){
+void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glucose_value, const char *_trendarrow, const char *_trendmessage, int16_t delta){
     
     if(mode == 0){
         if(_glucose_measurement_color == COLOR_WHITE){
@@ -1318,7 +1363,7 @@ void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glu
         char buf_label1[4];
         snprintf(buf_label1, 4, "%d", _glucose_value);
         lv_label_set_text(ui_Label_GlucoseValue, buf_label1);
-        lv_label_set_text(ui_Label_GlucoseTrendArrow, _trendarrow.c_str());
+        lv_label_set_text(ui_Label_GlucoseTrendArrow, _trendarrow);
         
         char buf_label3[14];
         if(delta == 0){
@@ -1331,31 +1376,23 @@ void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glu
         lv_label_set_text(ui_Label_GlucoseDelta, buf_label3);
     }
     // Show Glucose TrendMessage, if available
-    if(strcmp(_trendmessage.c_str(), "null") != 0){
-        lv_label_set_text(ui_Label_GlucoseTrendMessage, _trendmessage.c_str());
+    if(strcmp(_trendmessage, "null") != 0){
+        lv_label_set_text(ui_Label_GlucoseTrendMessage, _trendmessage);
     }else{
         lv_label_set_text(ui_Label_GlucoseTrendMessage, "" );
     }
 }
 
 void handle_internet_disconnection() {
-    static uint8_t counter_internet_offline = 0;
-    if (++counter_internet_offline == 5) {
-        counter_internet_offline = 0;
-        logger.notice("Client offline -> reconnect to WiFi");
-        esp_status_counter_wifi_restart++;
-        WiFi.disconnect();
-        WiFi.reconnect();
-    }
-    draw_labels(false, librelinkup.llu_glucose_data.measurement_color, librelinkup.llu_glucose_data.glucoseMeasurement,
-                librelinkup.llu_glucose_data.str_trendArrow, librelinkup.llu_glucose_data.str_TrendMessage, 0);
+    // WiFi reconnect is done by the network task (llutask.cpp)
+    draw_labels(false, llu_view.measurement_color, llu_view.glucoseMeasurement,
+                llu_view.str_trendArrow, llu_view.str_TrendMessage, 0);
 }
 
 void handle_llu_api_error() {
     internet_status = 2;
     lcd_status_indication(0, 1);
     librelinkup.sensor_reconnect = 1;
-    logger.notice("API Error: get graph data");
 }
 
 void handle_sensor_reconnect() {
@@ -1367,169 +1404,178 @@ void handle_sensor_reconnect() {
 
 void handle_invalid_timestamp() {
     
-    draw_labels(false, librelinkup.llu_glucose_data.measurement_color, librelinkup.llu_glucose_data.glucoseMeasurement,
-                    librelinkup.llu_glucose_data.str_trendArrow, librelinkup.llu_glucose_data.str_TrendMessage, 0);
+    draw_labels(false, llu_view.measurement_color, llu_view.glucoseMeasurement,
+                    llu_view.str_trendArrow, llu_view.str_TrendMessage, 0);
 
-    if (librelinkup.llu_status.timestamp_status == SENSOR_TIMECODE_OUT_OF_RANGE) {
+    if (llu_view.timestamp_status == SENSOR_TIMECODE_OUT_OF_RANGE) {
         logger.notice("glucoseMeasurement: no valid sensor data");
         librelinkup.sensor_reconnect = 1;
     }
-
-    static uint8_t invalid_timestamp_counter = 0;
-    if (librelinkup.llu_status.timestamp_status == SENSOR_TIMECODE_ERROR &&
-        librelinkup.llu_status.sensor_state == SENSOR_NOT_AVAILABLE) {
-        
-        if (++invalid_timestamp_counter == 5) {
-            esp_status_counter_llu_reauth++;
-            logger.notice("LLU Re-auth...");
-            librelinkup.auth_user(settings.config.login_email, settings.config.login_password);
-            if (librelinkup.llu_login_data.user_login_status == 4) {
-                esp_status_counter_llu_retou++;
-                librelinkup.tou_user();
-            }
-        }
-
-        if (invalid_timestamp_counter == 10) {
-            invalid_timestamp_counter = 0;
-            logger.notice("invalid_timestamp_counter out of range! -> call restart");
-            // esp_restart();
-        }
-    }
-}
-
-void synchronize_time_offset() {
-    helper.timedifference = helper.synchronizeWithServer(librelinkup.librelinkuptimecode.hour,
-                                                         librelinkup.librelinkuptimecode.minute,
-                                                         librelinkup.librelinkuptimecode.second,
-                                                         librelinkup.localtime.hour,
-                                                         librelinkup.localtime.minute,
-                                                         librelinkup.localtime.second);
-    g_timer_60000ms_backup = (helper.timedifference < helper.TIME_DIFF_THRESHOLD) ? millis()
-                                                              : millis() + (helper.timedifference + librelinkup.https_llu_api_fetch_time);
-}
-
-void update_trend_message() {
-    char buffer[30];  // Puffer für den String
-    int remaining_time = 0;
-
-    switch (librelinkup.llu_status.sensor_state) {
-        case SENSOR_EXPIRED:
-            librelinkup.llu_glucose_data.str_TrendMessage = "sensor expired!";
-            logger.notice("sensor expired!");
-            break;
-        case SENSOR_NOT_AVAILABLE:
-            librelinkup.llu_glucose_data.str_TrendMessage = "no active sensor";
-            logger.notice("no active sensor");
-            break;
-        case SENSOR_STARTING:
-            remaining_time = librelinkup.get_remaining_warmup_time(librelinkup.llu_sensor_data.sensor_non_activ_unixtime);
-            sprintf(buffer, "sensor ready in %d min", remaining_time);
-            librelinkup.llu_glucose_data.str_TrendMessage = buffer;
-            logger.notice("Sensor in starting phase!");
-            break;
-        case SENSOR_READY:
-            librelinkup.llu_glucose_data.str_TrendMessage = "";
-            break;
-    }
+    // re-auth after several invalid timestamps is done by the network task (llutask.cpp)
 }
 
 void update_five_minute_counter() {
     
     static uint8_t five_minute_chart_update_counter = 5;            // counter that redraws the glucose chat ever 5 minutes
+    static uint32_t chart_history_seq = 0;                          // newest history point already drawn
     
     // Zähler dekrementieren
     five_minute_chart_update_counter--;
 
+    // new 5 minute point in the history since the last chart update?
+    uint32_t new_points = llu_view.history_seq - chart_history_seq;
+
     // Debug-Log zur Überprüfung
-    logger.debug("five_minute_chart_update_counter: %d", five_minute_chart_update_counter);
+    logger.debug("five_minute_chart_update_counter: %d, new history points: %d", five_minute_chart_update_counter, new_points);
 
-    // Wenn der Zähler auf 0 fällt, Chart-Update durchführen
-    if (five_minute_chart_update_counter <= 0) {  
+    // Chart-Update bei neuem Verlaufspunkt, sonst spätestens wenn der Zähler auf 0 fällt
+    if (new_points > 0 || five_minute_chart_update_counter <= 0) {  
         five_minute_chart_update_counter = 5;  // Zurücksetzen auf 5 Minuten
+        chart_history_seq = llu_view.history_seq;
         logger.debug("Triggering 5-minute chart update...");
         draw_chart_glucose_data(1, true);  // Führe das 5-Minuten-Update aus
         
-        if(librelinkup.llu_status.sensor_state == SENSOR_READY){
+        if(llu_view.sensor_state == SENSOR_READY){
             update_glucose_json_logging();
             glucose_statistics(); // print glucose statistics
         }
     }
 }
 
+// applies a new snapshot of the network task to the UI, returns immediately if there is none
 void update_glucose_data() {
     
-    if (WiFi.status() != WL_CONNECTED) {
-        handle_internet_disconnection();
+    if (!llu_task.get_snapshot(llu_view)) {
         return;
     }
+    uint32_t render_time_measure = micros();
 
     glucose_delta = 0;
-    lcd_status_indication(1, 1);
 
-    if (librelinkup.get_graph_data() == 0) {
+    if (llu_view.fetch_status == LLU_FETCH_OFFLINE) {
+        handle_internet_disconnection();
+        return;
+    }
+
+    if (llu_view.fetch_status == LLU_FETCH_API_ERROR) {
         handle_llu_api_error();
         return;
     }
 
     lcd_status_indication(0, 1);
 
-    logger.debug("LLU API fetch time: %dms", librelinkup.https_llu_api_fetch_time);
-
-    // Sensorstatus und Zeitstempel auslesen
-    librelinkup.llu_status.sensor_state = librelinkup.check_sensor_lifetime(librelinkup.llu_sensor_data.sensor_non_activ_unixtime);
-    librelinkup.llu_status.timestamp_status = librelinkup.check_valid_timestamp(librelinkup.llu_glucose_data.str_measurement_timestamp, 1);
-    librelinkup.llu_status.last_timestamp_unixtime = helper.convertStrToUnixTime(librelinkup.llu_glucose_data.str_measurement_timestamp);
-
-    // Set TrendMessage based on sensor status
-    update_trend_message();
+    // other patient on screen: no delta to the value of the previous patient
+    static uint8_t shown_patient = 0;
+    if (llu_view.active_patient != shown_patient) {
+        shown_patient = llu_view.active_patient;
+        glucoseMeasurement_backup = llu_view.glucoseMeasurement;
+        logger.notice("patient on screen: %d %s", shown_patient, llu_view.patient_name);
+    }
     
     // check if LLU Timestamp is valid and process data
-    if (librelinkup.llu_status.timestamp_status == SENSOR_TIMECODE_VALID) {
-        
-        synchronize_time_offset();
+    if (llu_view.timestamp_status == SENSOR_TIMECODE_VALID) {
 
         if (librelinkup.sensor_reconnect == 1) {
             handle_sensor_reconnect();
         } else {
-            glucose_delta = librelinkup.llu_glucose_data.glucoseMeasurement - glucoseMeasurement_backup;
+            glucose_delta = llu_view.glucoseMeasurement - glucoseMeasurement_backup;
         }
 
-        logger.notice("glucoseMeasurement: %d %s ∆: %d", librelinkup.llu_glucose_data.glucoseMeasurement,
-                      librelinkup.llu_glucose_data.str_trendArrow.c_str(), glucose_delta);
+        logger.notice("glucoseMeasurement: %d %s ∆: %d", llu_view.glucoseMeasurement,
+                      llu_view.str_trendArrow, glucose_delta);
 
         draw_chart_sensor_valid();
-        draw_labels(true, librelinkup.llu_glucose_data.measurement_color, librelinkup.llu_glucose_data.glucoseMeasurement,
-                    librelinkup.llu_glucose_data.str_trendArrow, librelinkup.llu_glucose_data.str_TrendMessage, glucose_delta);
+        draw_labels(true, llu_view.measurement_color, llu_view.glucoseMeasurement,
+                    llu_view.str_trendArrow, llu_view.str_TrendMessage, glucose_delta);
         draw_chart_glucose_data(3, false);
 
-        glucoseMeasurement_backup = librelinkup.llu_glucose_data.glucoseMeasurement;
+        glucoseMeasurement_backup = llu_view.glucoseMeasurement;
     } else {
         handle_invalid_timestamp();
-        draw_labels(false, librelinkup.llu_glucose_data.measurement_color, librelinkup.llu_glucose_data.glucoseMeasurement,
-                librelinkup.llu_glucose_data.str_trendArrow, librelinkup.llu_glucose_data.str_TrendMessage, 0);
     }
+
+    //decrease update counter -1 and update if five_minute_chart_update_counter == 0
+    update_five_minute_counter();
+
+    librelinkup.stage_stats.record(LLU_STAGE_RENDER, (micros() - render_time_measure + 500) / 1000);
+
+    //publish mqtt data to mqtt broker
+    update_mqtt_publish();
 }
 
 void update_glucose_json_logging(){
-    uint32_t unixtime_now = librelinkup.get_epoch_time();
-    hba1c.addGlucoseValue(unixtime_now, librelinkup.llu_glucose_data.glucoseMeasurement);
-    logger.debug("addGlucoseValue to LittleFS: %d / %d", unixtime_now, librelinkup.llu_glucose_data.glucoseMeasurement );
+    // the log belongs to one patient, values and history of a followed patient on screen are not stored
+    if (!glucose_log_patient_on_screen()) {
+        return;
+    }
+
+    // 12h history first: fills the gap of a reboot or outage, merged by the flush task (known points are skipped)
+    hba1c.glucose_log.backfill(llu_view.timestamp, llu_view.graph_data, librelinkup.GRAPHDATAARRAYSIZE);
+
+    // FactoryTimestamp (UTC) like the history points: the same measurement fetched twice is stored once,
+    // independent of the time zone of the account and DST switches
+    uint32_t measurement_time = llu_view.measurement_unixtime;
+    if (measurement_time == 0) {
+        logger.debug("addGlucoseValue: no FactoryTimestamp, value not stored");
+        return;
+    }
+    hba1c.addGlucoseValue(measurement_time, llu_view.glucoseMeasurement);
+    logger.debug("addGlucoseValue to LittleFS: %d / %d", measurement_time, llu_view.glucoseMeasurement );
+}
+
+bool glucose_log_patient_on_screen(){
+    // connections not read yet: the history is the one of the own account
+    if (llu_view.patient_id[0] == '\0') {
+        return true;
+    }
+
+    // first patient on screen after an update or a new log
+    if (settings.config.glucose_log_patient.isEmpty()) {
+        settings.config.glucose_log_patient = llu_view.patient_id;
+        settings.saveConfiguration(settings.config_filename, settings.config);
+        logger.notice("glucose log: values of %s (%s) are stored", llu_view.patient_name, llu_view.patient_id);
+    }
+    return settings.config.glucose_log_patient == llu_view.patient_id;
 }
 
 void glucose_statistics(){
-    uint8_t data_count = librelinkup.check_graphdata();
-    float mean_glucose_value_from_history = hba1c.calculateGlucoseMeanFromHistory(librelinkup.llu_sensor_history_data.graph_data, data_count);
-    float mean_glucose_value_from_json = hba1c.calculateGlucoseMeanFromJson(today_json_filename);
-    float mean_glucose_weekly_value_from_json = hba1c.calculateGlucoseMeanForLast7Days();
-    float std_dev = hba1c.calculate_standard_deviation(librelinkup.llu_sensor_history_data.graph_data, data_count, mean_glucose_value_from_history);
-    logger.notice("========== Glucose Statistics =============", mean_glucose_value_from_history);
-    logger.notice("current glucose value        : %d mg/dl", librelinkup.llu_glucose_data.glucoseMeasurement);
-    logger.notice("mean of histroy glucose value: %.0f mg/dl", mean_glucose_value_from_history);
+    uint8_t data_count = llu_view.data_count;
+
+    // one pass over the history, gaps are skipped
+    GlycemicThresholds thresholds;
+    thresholds.very_low = settings.config.tir_very_low;
+    thresholds.low = settings.config.tir_low;
+    thresholds.high = settings.config.tir_high;
+    thresholds.very_high = settings.config.tir_very_high;
+    GlycemicStats stats;
+    hba1c.calculate_statistics(llu_view.graph_data, data_count, thresholds, stats);
+
+    // the flush task updates the day summaries, they are skipped while it writes (next call in 5 minutes)
+    bool summaries = hba1c.glucose_log.lock(0);
+    float mean_glucose_weekly_value_from_json = summaries ? hba1c.calculateGlucoseMeanForLast7Days() : 0;
+    logger.notice("========== Glucose Statistics =============");
+    logger.notice("current glucose value        : %d mg/dl", llu_view.glucoseMeasurement);
+    logger.notice("mean of histroy glucose value: %.0f mg/dl (%d values, %d gaps)", stats.mean, stats.count, stats.gaps);
     logger.notice("mean of weekly glucose value : %.0f mg/dl", mean_glucose_weekly_value_from_json);
-    logger.notice("HbA1c-Value of histroy data  : %.2f %%", hba1c.calculate_hba1c(mean_glucose_value_from_history));
-    logger.notice("TIR-Value of histroy data    : %.2f %%", hba1c.calculate_time_in_range(librelinkup.llu_sensor_history_data.graph_data, data_count, 70, 180));
-    logger.notice("Std-Dev of histroy data      : %.2f σ", std_dev);
-    logger.notice("Glukosevariabilität          : %.2f cv", hba1c.calculate_coefficient_of_variation(std_dev, mean_glucose_value_from_history));
+    logger.notice("HbA1c-Value of histroy data  : %.2f %%, GMI %.2f %%", hba1c.calculate_hba1c(stats.mean), stats.gmi);
+    logger.notice("TIR-Value of histroy data    : %.2f %% (%d-%d mg/dl)", stats.in_range, thresholds.low, thresholds.high);
+    logger.notice("TBR / TAR of histroy data    : %.1f / %.1f %% | %.1f / %.1f %%", stats.very_low, stats.low, stats.high, stats.very_high);
+    logger.notice("Min / Max of histroy data    : %d / %d mg/dl", stats.min, stats.max);
+    logger.notice("Std-Dev of histroy data      : %.2f σ", stats.sd);
+    logger.notice("Glukosevariabilität          : %.2f cv", stats.cv);
+
+    // day summaries of the glucose log (no flash reads)
+    static const uint16_t periods[] = {7, 14, 30, 90};
+    for (uint16_t days : periods) {
+        GlucoseStatistics statistics;
+        if (summaries && hba1c.glucose_log.statistics(days, statistics)) {
+            logger.notice("%2d days (%2d with data)      : mean %.0f mg/dl, SD %.1f, CV %.1f %%, GMI %.2f %%, TIR %.1f %%",
+                          days, statistics.days, statistics.mean, statistics.sd, statistics.cv, statistics.gmi, statistics.tir[2]);
+        }
+    }
+    if (summaries) {
+        hba1c.glucose_log.unlock();
+    }
     logger.notice("===========================================");
 }   
 
@@ -1746,7 +1792,9 @@ void setup_librelinkup(){
   if(settings.config.login_email == "" || settings.config.login_password == ""){
     lv_disp_load_scr(ui_Login_screen);
   }
+  librelinkup.set_base_url(settings.config.llu_server.c_str());
   librelinkup.begin(2);
+  llu_task.begin();
 }
 
 // setup mqtt connection
@@ -1849,6 +1897,10 @@ void setup()
     //Setup Telnet
     setup_uuid_console();
 
+    //Setup glucose log (after WiFi: needs the timezone)
+    hba1c.glucose_log.set_retention(settings.config.glucose_raw_days, settings.config.glucose_rollup_months);
+    hba1c.begin();
+
     //Setup WireGuard
     setup_wg(settings.config.wg_mode);
 
@@ -1895,18 +1947,14 @@ void setup()
     
 //---------------------------------------------------------------------------------------------
     
-    //get first glycose data
+    //wait for the first glycose data of the network task (draws chart, logging and mqtt publish)
+    lv_label_set_text(ui_Label_WelcomeInfo, "LibreLinkUp\nloading data..." );
+    lv_timer_handler();
+    if (!llu_task.wait_first_snapshot(30000)) {
+        logger.notice("no LibreLinkUp data after 30s, continue without data");
+    }
     update_glucose_data();
 
-    //decrease update counter -1 and update if five_minute_chart_update_counter == 0
-    update_five_minute_counter();
-        
-    //publish mqtt data to mqtt broker
-    update_mqtt_publish();
-    
-    //writes first logging data
-    update_glucose_json_logging();
-
     //--------------------------------------------------------------------------------------
     // Change to main screen
     lv_disp_load_scr(ui_Main_screen);
@@ -1920,12 +1968,24 @@ void loop()
      
     //LVGL update
     lv_timer_handler();delay(1);                /* let the GUI do its work */
+
+    //apply new glucose data of the network task (non blocking)
+    if(ota_in_progress == 0){
+        update_glucose_data();
+    }
     
     //-------------------[Software Timer]-----------------------  
     
     if(millis() - g_timer_250ms_backup > timer_250ms){
         g_timer_250ms_backup = millis(); 
 
+        // LibreLinkUp activity indicator while the network task fetches
+        static bool llu_busy_shown = false;
+        if(llu_task.busy() != llu_busy_shown){
+            llu_busy_shown = !llu_busy_shown;
+            lcd_status_indication(llu_busy_shown, 1);
+        }
+
         if(ota_in_progress == 1 && lv_screen_active() != ui_FWUpdate_screen){
             lv_disp_load_scr(ui_FWUpdate_screen);
             lv_label_set_text(ui_Label_FWUpdateInfo, "Firmware Update in progress..." );
@@ -1938,46 +1998,45 @@ void loop()
         if(ota_in_progress == 0){
             //check and update debug screen
             if (lv_scr_act() == ui_Debug_screen){
-                uint64_t time_delta = (59 - (((millis() - g_timer_60000ms_backup)))/1000); //-59 seconds
-                String internet_data_refresh_in = "Data Refresh in: " + String(time_delta) + "sec.";
-                lv_label_set_text(ui_Label_DebugDataRefresh, internet_data_refresh_in.c_str() );
-
-                String esp32_time_date = "ESP32 Time: " + helper.get_esp_time_date();
-                lv_label_set_text(ui_Label_DebugTime, esp32_time_date.c_str() );
-                String ip_address = "IP: " + WiFi.localIP().toString();
-                lv_label_set_text(ui_Label_DebugIP, ip_address.c_str());
-                String sensor_sn = "Sensor SN: " + librelinkup.llu_sensor_data.sensor_sn;
-                String sensor_id = "Sensor: " + librelinkup.llu_sensor_data.sensor_id;
-                lv_label_set_text(ui_Label_DebugSensor, sensor_id.c_str() );
-                
-                String sensor_valid_time = "Valid: ";
-                char buf_label1[35];
-                snprintf(buf_label1, 35, "%dDays %dHours %dMinutes",librelinkup.sensor_livetime.sensor_valid_days,librelinkup.sensor_livetime.sensor_valid_hours, librelinkup.sensor_livetime.sensor_valid_minutes);
-                sensor_valid_time = sensor_valid_time + buf_label1;
-                lv_label_set_text(ui_Label_DebugSensorTimestamp, sensor_valid_time.c_str() );
-
-                String str_sensor_state = "Sensor State: ";
-                char buf_label2[35];
-                if(librelinkup.llu_sensor_data.sensor_state == 0){
-                    snprintf(buf_label2, 35, "%d => unknown",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 1){
-                    snprintf(buf_label2, 35, "%d => not startet yet",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 2){
-                    snprintf(buf_label2, 35, "%d => starting phase",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 3){
-                    snprintf(buf_label2, 35, "%d => ready",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 4){
-                    snprintf(buf_label2, 35, "%d => expired",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 5){
-                    snprintf(buf_label2, 35, "%d => shut down",librelinkup.llu_sensor_data.sensor_state);
-                }else if(librelinkup.llu_sensor_data.sensor_state == 6){
-                    snprintf(buf_label2, 35, "%d => has failure",librelinkup.llu_sensor_data.sensor_state);
+                // labels are formatted on the stack, no String concatenation every second
+                char buf_label[64];
+                snprintf(buf_label, sizeof(buf_label), "Data Refresh in: %usec.", llu_task.next_fetch_in() / 1000);
+                lv_label_set_text(ui_Label_DebugDataRefresh, buf_label);
+
+                snprintf(buf_label, sizeof(buf_label), "ESP32 Time: %s", helper.get_esp_time_date().c_str());
+                lv_label_set_text(ui_Label_DebugTime, buf_label);
+                IPAddress ip = WiFi.localIP();
+                snprintf(buf_label, sizeof(buf_label), "IP: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+                lv_label_set_text(ui_Label_DebugIP, buf_label);
+                if (llu_view.patient_count > 1) {
+                    snprintf(buf_label, sizeof(buf_label), "Sensor: %s (%s)", llu_view.sensor_id, llu_view.patient_name);
+                } else {
+                    snprintf(buf_label, sizeof(buf_label), "Sensor: %s", llu_view.sensor_id);
                 }
-                str_sensor_state = str_sensor_state + buf_label2;
-                lv_label_set_text(ui_Label_DebugSensorState, str_sensor_state.c_str() );
+                lv_label_set_text(ui_Label_DebugSensor, buf_label);
+
+                snprintf(buf_label, sizeof(buf_label), "Valid: %dDays %dHours %dMinutes",llu_view.sensor_valid_days,llu_view.sensor_valid_hours, llu_view.sensor_valid_minutes);
+                lv_label_set_text(ui_Label_DebugSensorTimestamp, buf_label);
+
+                char buf_label2[35] = "";
+                if(llu_view.sensor_pt == 0){
+                    snprintf(buf_label2, 35, "%d => unknown",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 1){
+                    snprintf(buf_label2, 35, "%d => not startet yet",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 2){
+                    snprintf(buf_label2, 35, "%d => starting phase",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 3){
+                    snprintf(buf_label2, 35, "%d => ready",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 4){
+                    snprintf(buf_label2, 35, "%d => expired",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 5){
+                    snprintf(buf_label2, 35, "%d => shut down",llu_view.sensor_pt);
+                }else if(llu_view.sensor_pt == 6){
+                    snprintf(buf_label2, 35, "%d => has failure",llu_view.sensor_pt);
+                }
+                snprintf(buf_label, sizeof(buf_label), "Sensor State: %s", buf_label2);
+                lv_label_set_text(ui_Label_DebugSensorState, buf_label);
 
-                String str_sensor_value = "Sensor Value: ";
-                char buf_label_value[35];
                 char buf_label_delta[14];
 
                 if(glucose_delta == 0){
@@ -1987,8 +2046,8 @@ void loop()
                 }else if(glucose_delta < 0){
                     snprintf(buf_label_delta, 14, "%d mg/dL", glucose_delta);
                 }
-                str_sensor_value = str_sensor_value + String(librelinkup.llu_glucose_data.glucoseMeasurement) + librelinkup.llu_glucose_data.str_trendArrow + " " + buf_label_delta;
-                lv_label_set_text(ui_Label_DebugSensorValue, str_sensor_value.c_str()); 
+                snprintf(buf_label, sizeof(buf_label), "Sensor Value: %d%s %s", llu_view.glucoseMeasurement, llu_view.str_trendArrow, buf_label_delta);
+                lv_label_set_text(ui_Label_DebugSensorValue, buf_label);
             }
         }
     }
@@ -2021,20 +2080,6 @@ void loop()
       g_timer_10000ms_backup = millis(); 
     }
     
-    if(millis() - g_timer_60000ms_backup > timer_60000ms){
-        g_timer_60000ms_backup = millis();
-    
-        //fetch data from LibreLinkUp server if system has internet access
-        if(ota_in_progress == 0){
-            update_glucose_data();
-        
-            //decrease update counter -1 and update if five_minute_chart_update_counter == 0
-            update_five_minute_counter();
-        
-            //publish mqtt data to mqtt broker
-            update_mqtt_publish();
-        }
-    }
 
     if(millis() - g_timer_120000ms_backup > timer_120000ms){
       g_timer_120000ms_backup = millis();
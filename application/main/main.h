@@ -88,23 +88,13 @@ void handle_llu_api_error();
  */
 void handle_internet_disconnection();
 
-/**
- * @brief Synchronizes the time offset with the server.
- */
-void synchronize_time_offset();
-
-/**
- * @brief Updates the trend message based on glucose levels.
- */
-void update_trend_message();
-
 /**
  * @brief Updates the five-minute glucose data counter.
  */
 void update_five_minute_counter();
 
 /**
- * @brief Updates glucose measurement data.
+ * @brief Applies a new snapshot of the LibreLinkUp network task to the UI.
  */
 void update_glucose_data();
 
@@ -113,11 +103,18 @@ void update_glucose_data();
  */
 void update_glucose_json_logging();
 
+/**
+ * @brief Checks if the patient on screen is the one the glucose log belongs to.
+ *
+ * The first patient on screen is stored in the settings (glucose_log_patient).
+ */
+bool glucose_log_patient_on_screen();
+
 /**
  * @brief Calculates and logs glucose statistics.
  */
 void glucose_statistics();
 
-void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glucose_value, String _trendarrow, String _trendmessage, int16_t delta);
+void draw_labels(uint8_t mode, uint8_t _glucose_measurement_color, uint16_t _glucose_value, const char *_trendarrow, const char *_trendmessage, int16_t delta);
 
 #endif // MAIN_H
\ No newline at end of file
@@ -62,6 +62,7 @@ public:
     String mqtt_subscibe_toppic = "/cmd"; ///< Subscription topic for commands
     String mqtt_subscibe_rec_toppic = "/cmd_rec"; ///< Subscription topic for received commands
     String mqtt_client_network = "/network"; ///< Topic for network information
+    String mqtt_client_stats = "/stats"; ///< Topic prefix for the fetch stage histograms (/stats/<stage>)
     String mqtt_incomming_cmd = ""; ///< Incoming MQTT command buffer
 
     bool configured = false; ///< Indicates if the MQTT client is configured
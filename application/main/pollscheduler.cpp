@@ -0,0 +1,101 @@
+#include "pollscheduler.h"
+#include "librelinkup.h"
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+uint32_t POLLSCHEDULER::on_success(uint32_t measurement_time, uint8_t sensor_state, uint32_t activation_time, time_t now){
+
+    _errors = 0;
+
+    // Sensor in warm-up: nothing new before the end of the warm-up
+    if(sensor_state == SENSOR_STARTING && activation_time > 0 && now > POLL_CLOCK_VALID){
+        int64_t remaining = (int64_t)activation_time + POLL_WARMUP_TIME - now;
+        uint32_t delay_ms = (remaining > 0) ? (uint32_t)remaining * 1000UL + _margin_ms : 0;
+        if(delay_ms > POLL_QUIET_MS) delay_ms = POLL_QUIET_MS;
+        return plan(delay_ms, POLL_REASON_STARTING);
+    }
+    // Sensor expired or missing: only check now and then for a new sensor
+    if(sensor_state == SENSOR_EXPIRED || sensor_state == SENSOR_NOT_AVAILABLE){
+        return plan(POLL_QUIET_MS, POLL_REASON_QUIET);
+    }
+    if(measurement_time == 0 || now < POLL_CLOCK_VALID){
+        return plan(POLL_PERIOD_DEFAULT_MS, POLL_REASON_DEFAULT);
+    }
+
+    if(measurement_time > _last_measurement){
+        // new value: learn the period, values may have been skipped (n periods)
+        if(_last_measurement != 0){
+            uint32_t delta_ms = (measurement_time - _last_measurement) * 1000UL;
+            uint32_t n = (delta_ms + _period_ms / 2) / _period_ms;
+            if(n == 0) n = 1;
+            uint32_t sample = delta_ms / n;
+            if(sample >= POLL_PERIOD_MIN_MS && sample <= POLL_PERIOD_MAX_MS){
+                // EWMA, alpha = 1/4
+                _period_ms = (uint32_t)((int32_t)_period_ms + ((int32_t)sample - (int32_t)_period_ms) / 4);
+            }
+        }
+        _last_measurement = measurement_time;
+        _stale = 0;
+        if(_margin_ms > POLL_MARGIN_MIN_MS + POLL_MARGIN_STEP_DOWN_MS) _margin_ms -= POLL_MARGIN_STEP_DOWN_MS;
+        else _margin_ms = POLL_MARGIN_MIN_MS;
+    }else{
+        // fetched too early, the server did not have the next value yet
+        stale_fetches++;
+        _margin_ms += POLL_MARGIN_STEP_UP_MS;
+        if(_margin_ms > POLL_MARGIN_MAX_MS) _margin_ms = POLL_MARGIN_MAX_MS;
+    }
+
+    // next expected measurement after now
+    int64_t now_ms = (int64_t)now * 1000;
+    int64_t next_ms = (int64_t)_last_measurement * 1000 + _period_ms;
+
+    if(next_ms + _margin_ms <= now_ms && _stale < POLL_STALE_RETRIES &&
+       now_ms - next_ms < (int64_t)_period_ms / 2){
+        // value is overdue but not yet a full period late -> short retry
+        _stale++;
+        return plan(POLL_STALE_RETRY_MS, POLL_REASON_STALE_RETRY);
+    }
+    while(next_ms + _margin_ms <= now_ms){
+        next_ms += _period_ms;
+    }
+    return plan((uint32_t)(next_ms + _margin_ms - now_ms), POLL_REASON_MEASUREMENT);
+}
+
+uint32_t POLLSCHEDULER::on_error(void){
+    if(_errors < 255) _errors++;
+
+    uint32_t delay_ms = POLL_BACKOFF_BASE_MS;
+    for(uint8_t i = 1; i < _errors && delay_ms < POLL_BACKOFF_MAX_MS; i++){
+        delay_ms *= 2;
+    }
+    if(delay_ms > POLL_BACKOFF_MAX_MS) delay_ms = POLL_BACKOFF_MAX_MS;
+
+    // +/- jitter, so several panels do not retry in lockstep
+    uint32_t jitter = delay_ms / 100 * POLL_BACKOFF_JITTER_PCT;
+    delay_ms = delay_ms - jitter + (esp_random() % (2 * jitter + 1));
+
+    return plan(delay_ms, POLL_REASON_BACKOFF);
+}
+
+const char *POLLSCHEDULER::reason_name(uint8_t reason){
+    switch(reason){
+        case POLL_REASON_MEASUREMENT:   return "measurement";
+        case POLL_REASON_STALE_RETRY:   return "stale retry";
+        case POLL_REASON_BACKOFF:       return "error backoff";
+        case POLL_REASON_STARTING:      return "sensor warm-up";
+        case POLL_REASON_QUIET:         return "no sensor";
+        default:                        return "default";
+    }
+}
+
+uint32_t POLLSCHEDULER::plan(uint32_t delay_ms, uint8_t reason){
+    if(delay_ms < POLL_DELAY_MIN_MS) delay_ms = POLL_DELAY_MIN_MS;
+    if(delay_ms > POLL_BACKOFF_MAX_MS) delay_ms = POLL_BACKOFF_MAX_MS;
+
+    _last_delay = delay_ms;
+    _reason = reason;
+    logger.debug("next fetch in %dms (%s, period %dms, margin %dms)", delay_ms, reason_name(reason), _period_ms, _margin_ms);
+    return delay_ms;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file pollscheduler.h
+ * @brief Measurement-cadence-aware poll scheduler for the LibreLinkUp fetch
+ *
+ * The sensor reports a new value roughly every minute, but with its own phase.
+ * The scheduler learns period and phase from the measurement timestamps and
+ * plans the next fetch shortly after the next value is expected. All
+ * calculations use Unix time (UTC), millis() is only used by the caller to
+ * wait for the returned delay.
+ */
+
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+
+#include <Arduino.h>
+
+/**
+ * @defgroup pollscheduler_constants Poll Scheduler Settings
+ * @{
+ */
+#define POLL_PERIOD_DEFAULT_MS      60000   ///< Initial measurement period
+#define POLL_PERIOD_MIN_MS          30000   ///< Period samples below are ignored
+#define POLL_PERIOD_MAX_MS          600000  ///< Period samples above are ignored
+#define POLL_MARGIN_DEFAULT_MS      10000   ///< Initial delay after the expected measurement
+#define POLL_MARGIN_MIN_MS          2000    ///< Lower limit of the margin
+#define POLL_MARGIN_MAX_MS          45000   ///< Upper limit of the margin
+#define POLL_MARGIN_STEP_DOWN_MS    500     ///< Margin decrease if a new value was found
+#define POLL_MARGIN_STEP_UP_MS      3000    ///< Margin increase if the value was not there yet
+#define POLL_STALE_RETRY_MS         5000    ///< Retry delay if the expected value is late
+#define POLL_STALE_RETRIES          3       ///< Retries per expected value
+#define POLL_BACKOFF_BASE_MS        15000   ///< First retry delay after an error
+#define POLL_BACKOFF_MAX_MS         600000  ///< Upper limit of the error backoff
+#define POLL_BACKOFF_JITTER_PCT     20      ///< +/- jitter of the error backoff in percent
+#define POLL_QUIET_MS               300000  ///< Interval while no sensor delivers data
+#define POLL_DELAY_MIN_MS           5000    ///< Lower limit of every delay
+#define POLL_WARMUP_TIME            3600    ///< Sensor warm-up time in seconds
+#define POLL_CLOCK_VALID            1700000000  ///< Unix time below = SNTP not synced yet
+/** @} */
+
+/**
+ * @enum POLL_Reason
+ * @brief Why the scheduler chose the last delay
+ */
+enum POLL_Reason : uint8_t {
+    POLL_REASON_DEFAULT     = 0, ///< no measurement time or clock not synced, default period
+    POLL_REASON_MEASUREMENT = 1, ///< next expected measurement plus margin
+    POLL_REASON_STALE_RETRY = 2, ///< expected value not there yet, short retry
+    POLL_REASON_BACKOFF     = 3, ///< fetch failed, exponential backoff with jitter
+    POLL_REASON_STARTING    = 4, ///< sensor warm-up, wait for the end of the warm-up
+    POLL_REASON_QUIET       = 5, ///< sensor expired / not available
+};
+
+/**
+ * @class POLLSCHEDULER
+ * @brief Plans the next LibreLinkUp fetch
+ */
+class POLLSCHEDULER {
+public:
+    /**
+     * @brief Delay after a successful fetch
+     * @param measurement_time FactoryTimestamp of the current measurement (UTC, 0 = unknown)
+     * @param sensor_state check_sensor_lifetime() result
+     * @param activation_time Activation time of the new sensor (Unix)
+     * @param now Current Unix time
+     * @return Delay until the next fetch in ms
+     */
+    uint32_t on_success(uint32_t measurement_time, uint8_t sensor_state, uint32_t activation_time, time_t now);
+
+    /**
+     * @brief Delay after a failed fetch (offline or API error)
+     * @return Delay until the next fetch in ms
+     */
+    uint32_t on_error(void);
+
+    /**
+     * @brief Text of a POLL_Reason for logs and the console
+     */
+    static const char *reason_name(uint8_t reason);
+
+    uint32_t period_ms(void) const { return _period_ms; }       ///< Learned measurement period
+    uint32_t margin_ms(void) const { return _margin_ms; }       ///< Current delay after the expected value
+    uint32_t last_measurement(void) const { return _last_measurement; }  ///< Newest measurement time (Unix)
+    uint32_t last_delay(void) const { return _last_delay; }     ///< Last planned delay in ms
+    uint8_t reason(void) const { return _reason; }              ///< POLL_Reason of the last delay
+    uint8_t errors(void) const { return _errors; }              ///< Consecutive failed fetches
+    uint32_t stale_fetches = 0;                                 ///< Fetches without a new value
+
+private:
+    uint32_t plan(uint32_t delay_ms, uint8_t reason);
+
+    uint32_t _period_ms = POLL_PERIOD_DEFAULT_MS;
+    uint32_t _margin_ms = POLL_MARGIN_DEFAULT_MS;
+    uint32_t _last_measurement = 0;
+    uint32_t _last_delay = 0;
+    uint8_t _reason = POLL_REASON_DEFAULT;
+    uint8_t _errors = 0;
+    uint8_t _stale = 0;             ///< retries for the current expected value
+};
+
+#endif // POLLSCHEDULER_H
@@ -29,7 +29,7 @@ static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
  * @param config Reference to the Config object where the loaded configuration values are stored.
  */
 void SETTINGS::loadConfiguration(const char* filename, Config &config) {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1536);
 
     // Open file for reading
     File file = LittleFS.open(filename, FILE_READ);
@@ -63,11 +63,19 @@ void SETTINGS::loadConfiguration(const char* filename, Config &config) {
     config.wgEndpointPort = doc["wgEndpointPort"];
     config.wgAllowedIPs   = doc["wgAllowedIPs"].as<String>();
     config.sleep_timer    = doc["sleep_timer"];
+    config.llu_server     = doc["llu_server"] | "";
+    config.tir_very_low   = doc["tir_very_low"] | 54;
+    config.tir_low        = doc["tir_low"] | 70;
+    config.tir_high       = doc["tir_high"] | 180;
+    config.tir_very_high  = doc["tir_very_high"] | 250;
+    config.glucose_raw_days = doc["glucose_raw_days"] | 365;
+    config.glucose_rollup_months = doc["glucose_rollup_months"] | 24;
+    config.glucose_log_patient = doc["glucose_log_patient"] | "";
     
     file.close();
     doc.clear();
     
-    Serial.printf("load:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d}",
+    Serial.printf("load:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d, llu_server:%s}",
        config.login_email.c_str(),
        config.login_password.c_str(),
        config.wifi_bssid.c_str(),
@@ -89,9 +97,10 @@ void SETTINGS::loadConfiguration(const char* filename, Config &config) {
        config.wgEndpoint.c_str(),
        config.wgEndpointPort,
        config.wgAllowedIPs.c_str(),
-       config.sleep_timer);
+       config.sleep_timer,
+       config.llu_server.c_str());
     /*  
-    logger.notice("load:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d}",
+    logger.notice("load:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d, llu_server:%s}",
        config.login_email.c_str(),
        config.login_password.c_str(),
        config.wifi_bssid.c_str(),
@@ -113,7 +122,8 @@ void SETTINGS::loadConfiguration(const char* filename, Config &config) {
        config.wgEndpoint.c_str(),
        config.wgEndpointPort,
        config.wgAllowedIPs.c_str(),
-       config.sleep_timer);
+       config.sleep_timer,
+       config.llu_server.c_str());
     */
 }
 
@@ -127,7 +137,7 @@ void SETTINGS::loadConfiguration(const char* filename, Config &config) {
  * @param config The Config object containing the configuration data to be saved.
  */
 void SETTINGS::saveConfiguration(const char *filename, Config &config) {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1536);
     
     // Delete existing file to prevent appending
     LittleFS.remove(filename);
@@ -162,6 +172,14 @@ void SETTINGS::saveConfiguration(const char *filename, Config &config) {
     doc["wgEndpointPort"] = config.wgEndpointPort;
     doc["wgAllowedIPs"]   = config.wgAllowedIPs.c_str();
     doc["sleep_timer"]    = config.sleep_timer;
+    doc["llu_server"]     = config.llu_server.c_str();
+    doc["tir_very_low"]   = config.tir_very_low;
+    doc["tir_low"]        = config.tir_low;
+    doc["tir_high"]       = config.tir_high;
+    doc["tir_very_high"]  = config.tir_very_high;
+    doc["glucose_raw_days"] = config.glucose_raw_days;
+    doc["glucose_rollup_months"] = config.glucose_rollup_months;
+    doc["glucose_log_patient"] = config.glucose_log_patient.c_str();
 
     // Serialize JSON to file
     if (serializeJson(doc, file) == 0) {
@@ -171,7 +189,7 @@ void SETTINGS::saveConfiguration(const char *filename, Config &config) {
     file.close();
     doc.clear();
 
-    Serial.printf("save:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d}",
+    Serial.printf("save:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d, llu_server:%s}",
        config.login_email.c_str(),
        config.login_password.c_str(),
        config.wifi_bssid.c_str(),
@@ -193,10 +211,11 @@ void SETTINGS::saveConfiguration(const char *filename, Config &config) {
        config.wgEndpoint.c_str(),
        config.wgEndpointPort,
        config.wgAllowedIPs.c_str(),
-       config.sleep_timer);
+       config.sleep_timer,
+       config.llu_server.c_str());
 
     /*
-    logger.notice("save:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d}",
+    logger.notice("save:{login_email:%s, login_password:%s, wifi_bssid:%s, wifi_password:%s, timezone:%d, ota_update:%d, wg_mode:%d, mqtt_mode:%d, brightness:%d, telnet_port:%d, mqttServer:%s, mqtt_port:%d, mqttUsername:%s, mqttPassword:%s, wgPrivateKey:%s, wgPublicKey:%s, wgPresharedKey:%s, wgIpAddress:%s, wgEndpoint:%s, wgEndpointPort:%d, wgAllowedIPs:%s, sleep_timer:%d, llu_server:%s}",
        config.login_email.c_str(),
        config.login_password.c_str(),
        config.wifi_bssid.c_str(),
@@ -218,6 +237,7 @@ void SETTINGS::saveConfiguration(const char *filename, Config &config) {
        config.wgEndpoint.c_str(),
        config.wgEndpointPort,
        config.wgAllowedIPs.c_str(),
-       config.sleep_timer);
+       config.sleep_timer,
+       config.llu_server.c_str());
     */
 }
@@ -71,6 +71,18 @@ class SETTINGS {
             String wgAllowedIPs = "";         /**< WireGuard allowed IPs */
 
             uint64_t sleep_timer = 3600000;   /**< Sleep timer in milliseconds (default: 1 hour) */
+            String llu_server = "";           /**< LibreLinkUp API base URL, empty = https://api.libreview.io (tools/llu_mock) */
+
+            // Glucose statistics ranges (mg/dL)
+            uint16_t tir_very_low = 54;       /**< Time below range level 2: below */
+            uint16_t tir_low = 70;            /**< Time in range: from */
+            uint16_t tir_high = 180;          /**< Time in range: up to */
+            uint16_t tir_very_high = 250;     /**< Time above range level 2: above */
+
+            // Glucose log retention
+            uint16_t glucose_raw_days = 365;  /**< Days the single values are kept */
+            uint8_t glucose_rollup_months = 24; /**< Months the hour and day statistics are kept */
+            String glucose_log_patient = "";  /**< patientId the glucose log belongs to, empty = first patient on screen */
         };
 
         /**
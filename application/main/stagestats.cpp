@@ -0,0 +1,110 @@
+#include "stagestats.h"
+
+#include <Preferences.h>
+#include <uuid/log.h>
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+// upper bucket limits in ms, roughly logarithmic from a cached DNS lookup to a request timeout
+static const uint32_t BUCKET_LIMITS[STAGESTATS_BUCKETS] = {
+    1, 2, 5, 10, 20, 50, 75, 100, 150, 200, 300, 500, 750, 1000, 1500, 2000, 3000, 5000, 10000, UINT32_MAX
+};
+
+static const char *const STAGE_NAMES[LLU_STAGE_COUNT] = {
+    "dns", "connect", "ttfb", "body", "parse", "fetch", "render"
+};
+
+void StageStats::record(uint8_t stage, uint32_t ms) {
+    if (stage >= LLU_STAGE_COUNT) return;
+
+    Histogram &h = _stage[stage];
+    uint8_t bucket = 0;
+    while (ms > BUCKET_LIMITS[bucket]) bucket++;    // last limit is UINT32_MAX
+    h.buckets[bucket]++;
+    h.count++;
+    if (ms > h.max) h.max = ms;
+    _dirty = true;
+}
+
+uint32_t StageStats::percentile(uint8_t stage, uint8_t percent) const {
+    if (stage >= LLU_STAGE_COUNT || _stage[stage].count == 0) return 0;
+
+    const Histogram &h = _stage[stage];
+    uint64_t rank = ((uint64_t)h.count * percent + 99) / 100;   // samples up to the percentile
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < STAGESTATS_BUCKETS; i++) {
+        seen += h.buckets[i];
+        if (seen >= rank) return (BUCKET_LIMITS[i] < h.max) ? BUCKET_LIMITS[i] : h.max;
+    }
+    return h.max;
+}
+
+uint32_t StageStats::bucket(uint8_t stage, uint8_t bucket) const {
+    if (stage >= LLU_STAGE_COUNT || bucket >= STAGESTATS_BUCKETS) return 0;
+    return _stage[stage].buckets[bucket];
+}
+
+uint32_t StageStats::bucket_limit(uint8_t bucket) {
+    return (bucket < STAGESTATS_BUCKETS) ? BUCKET_LIMITS[bucket] : UINT32_MAX;
+}
+
+const char *StageStats::stage_name(uint8_t stage) {
+    return (stage < LLU_STAGE_COUNT) ? STAGE_NAMES[stage] : "?";
+}
+
+void StageStats::reset(void) {
+    memset(_stage, 0, sizeof(_stage));
+    _dirty = false;
+
+    Preferences prefs;
+    if (prefs.begin(STAGESTATS_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+bool StageStats::load(void) {
+    Preferences prefs;
+    if (!prefs.begin(STAGESTATS_NAMESPACE, true)) {
+        return false;                       // nothing stored yet
+    }
+
+    bool result = false;
+    if (prefs.getUChar("version", 0) == STAGESTATS_VERSION && prefs.getBytesLength("hist") == sizeof(_stage)) {
+        result = prefs.getBytes("hist", _stage, sizeof(_stage)) == sizeof(_stage);
+    }
+    prefs.end();
+
+    if (!result) {
+        memset(_stage, 0, sizeof(_stage));
+        return false;
+    }
+    _saved_at = millis();
+    logger.debug("stage histograms loaded (%d fetches)", _stage[LLU_STAGE_FETCH].count);
+    return true;
+}
+
+void StageStats::save_if_due(void) {
+    if (_dirty && millis() - _saved_at >= STAGESTATS_SAVE_INTERVAL) {
+        save();
+    }
+}
+
+bool StageStats::save(void) {
+    _saved_at = millis();
+
+    Preferences prefs;
+    if (!prefs.begin(STAGESTATS_NAMESPACE, false)) {
+        logger.err("stage histograms: NVS not available");
+        return false;
+    }
+    prefs.putUChar("version", STAGESTATS_VERSION);
+    bool result = prefs.putBytes("hist", _stage, sizeof(_stage)) == sizeof(_stage);
+    prefs.end();
+
+    _dirty = !result;
+    return result;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file stagestats.h
+ * @brief Latency histograms of the LibreLinkUp fetch stages
+ *
+ * Every stage of a request (DNS, connect, time to first byte, body, parse)
+ * and the UI update feed a histogram with fixed bucket limits. Percentiles
+ * are read from the buckets, so recording is a few compares and one
+ * increment. The histograms are kept in NVS and survive restarts.
+ *
+ * Each stage is recorded by one task only (network task or UI loop), the
+ * readers (console, MQTT) may see a sample that is recorded at that moment.
+ */
+
+#ifndef STAGESTATS_H
+#define STAGESTATS_H
+
+#include <Arduino.h>
+
+/**
+ * @defgroup stagestats_config Stage Statistics Settings
+ * @{
+ */
+#define STAGESTATS_BUCKETS          20              ///< Buckets per stage, the last one has no upper limit
+#define STAGESTATS_NAMESPACE        "llu_stages"    ///< NVS namespace
+#define STAGESTATS_VERSION          1               ///< NVS layout version, other versions are discarded
+#define STAGESTATS_SAVE_INTERVAL    3600000         ///< NVS write interval in ms
+/** @} */
+
+/**
+ * @enum LLU_Stage
+ * @brief Measured stages
+ */
+enum LLU_Stage : uint8_t {
+    LLU_STAGE_DNS       = 0, ///< host name lookup of a new connection
+    LLU_STAGE_CONNECT   = 1, ///< TCP connect and TLS handshake of a new connection
+    LLU_STAGE_TTFB      = 2, ///< request sent until the response headers are read
+    LLU_STAGE_BODY      = 3, ///< waiting for body data (network and TLS decryption)
+    LLU_STAGE_PARSE     = 4, ///< decompression and JSON parsing of the body
+    LLU_STAGE_FETCH     = 5, ///< whole /graph request (https_llu_api_fetch_time)
+    LLU_STAGE_RENDER    = 6, ///< update_glucose_data() with a new snapshot
+    LLU_STAGE_COUNT     = 7
+};
+
+/**
+ * @class StageStats
+ * @brief Fixed-bucket latency histogram per LLU_Stage
+ */
+class StageStats {
+public:
+    /**
+     * @brief Add one sample
+     * @param stage LLU_Stage
+     * @param ms Duration in milliseconds
+     */
+    void record(uint8_t stage, uint32_t ms);
+
+    /**
+     * @brief Percentile from the buckets
+     * @param stage LLU_Stage
+     * @param percent 1-100
+     * @return Upper limit of the bucket (max() for the last bucket), 0 without samples
+     */
+    uint32_t percentile(uint8_t stage, uint8_t percent) const;
+
+    uint32_t count(uint8_t stage) const { return (stage < LLU_STAGE_COUNT) ? _stage[stage].count : 0; }  ///< Samples
+    uint32_t max(uint8_t stage) const { return (stage < LLU_STAGE_COUNT) ? _stage[stage].max : 0; }      ///< Slowest sample in ms
+
+    /**
+     * @brief Samples in one bucket
+     */
+    uint32_t bucket(uint8_t stage, uint8_t bucket) const;
+
+    /**
+     * @brief Upper limit of a bucket in ms (UINT32_MAX for the last one)
+     */
+    static uint32_t bucket_limit(uint8_t bucket);
+
+    /**
+     * @brief Short name of a LLU_Stage for logs, console and MQTT
+     */
+    static const char *stage_name(uint8_t stage);
+
+    /**
+     * @brief Remove all samples (also in NVS)
+     */
+    void reset(void);
+
+    /**
+     * @brief Read the histograms from NVS
+     * @return false if nothing (valid) is stored
+     */
+    bool load(void);
+
+    /**
+     * @brief Write the histograms to NVS if new samples are there and
+     *        STAGESTATS_SAVE_INTERVAL has passed since the last write
+     */
+    void save_if_due(void);
+
+    /**
+     * @brief Write the histograms to NVS
+     */
+    bool save(void);
+
+private:
+    struct Histogram {
+        uint32_t buckets[STAGESTATS_BUCKETS];
+        uint32_t count;
+        uint32_t max;
+    };
+
+    Histogram _stage[LLU_STAGE_COUNT] = {};
+    uint32_t _saved_at = 0;         ///< millis() of the last NVS write
+    bool _dirty = false;            ///< samples since the last NVS write
+};
+
+#endif // STAGESTATS_H
@@ -0,0 +1,323 @@
+#include "truststore.h"
+
+#include <uuid/log.h>
+
+//------------------------[uuid logger]-----------------------------------
+static uuid::log::Logger logger{F(__FILE__), uuid::log::Facility::CONSOLE};
+//------------------------------------------------------------------------
+
+#define BUNDLE_HEADER   2   // uint16 count
+#define ENTRY_HEADER    4   // uint16 name_len, uint16 key_len
+
+#define DER_SEQUENCE    0x30
+#define DER_SET         0x31
+#define DER_OID         0x06
+#define DER_VERSION     0xa0   // [0] EXPLICIT version of tbsCertificate
+
+static const char PEM_BEGIN[] = "-----BEGIN CERTIFICATE-----";
+static const char PEM_END[]   = "-----END CERTIFICATE-----";
+
+// read one DER tag/length header, p points to the content afterwards
+static bool der_header(const uint8_t *&p, const uint8_t *end, uint8_t &tag, size_t &length) {
+    if (end - p < 2) return false;
+    tag = *p++;
+    size_t len = *p++;
+    if (len & 0x80) {
+        uint8_t n = len & 0x7f;
+        if (n == 0 || n > 3 || end - p < n) return false;
+        len = 0;
+        while (n--) len = (len << 8) | *p++;
+    }
+    if ((size_t)(end - p) < len) return false;
+    length = len;
+    return true;
+}
+
+// skip one element, false if it has not the expected tag
+static bool der_skip(const uint8_t *&p, const uint8_t *end, uint8_t expected) {
+    uint8_t tag;
+    size_t length;
+    if (!der_header(p, end, tag, length) || tag != expected) return false;
+    p += length;
+    return true;
+}
+
+static uint16_t get16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static void put16(uint8_t *p, uint16_t v) { p[0] = v >> 8; p[1] = v & 0xff; }
+
+// DER names are compared like the bundle verify callback does it
+static int compare_names(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len) {
+    int result = memcmp(a, b, (a_len < b_len) ? a_len : b_len);
+    if (result != 0) return result;
+    return (a_len < b_len) ? -1 : (a_len > b_len) ? 1 : 0;
+}
+
+static int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// base64 body of a PEM block to DER, whitespace is skipped
+static size_t base64_decode(const char *text, size_t length, uint8_t *out, size_t size) {
+    uint32_t bits = 0;
+    uint8_t count = 0;
+    size_t written = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '=') break;
+        int value = base64_value(text[i]);
+        if (value < 0) continue;
+        bits = (bits << 6) | value;
+        if (++count == 4) {
+            if (written + 3 > size) return 0;
+            out[written++] = bits >> 16;
+            out[written++] = bits >> 8;
+            out[written++] = bits;
+            bits = count = 0;
+        }
+    }
+    if (count == 3) {
+        if (written + 2 > size) return 0;
+        out[written++] = bits >> 10;
+        out[written++] = bits >> 2;
+    } else if (count == 2) {
+        if (written + 1 > size) return 0;
+        out[written++] = bits >> 4;
+    }
+    return written;
+}
+
+TrustStore::~TrustStore() {
+    if (_buffer != nullptr) heap_caps_free(_buffer);
+}
+
+uint16_t TrustStore::begin(fs::FS &fs, const char *const *pem_files, uint8_t count) {
+    if (!allocate()) return 0;
+
+    File cache = fs.open(TRUSTSTORE_CACHE_FILE, "r");
+    if (cache) {
+        size_t length = cache.size();
+        if (length <= TRUSTSTORE_MAX_SIZE && cache.read(_buffer, length) == length && load(_buffer, length)) {
+            cache.close();
+            _from_cache = true;
+            logger.debug("CA bundle: %d roots (%d bytes) from cache", _count, _size);
+            return _count;
+        }
+        cache.close();
+        logger.warning("CA bundle cache invalid, rebuilding");
+    }
+    return rebuild(fs, pem_files, count);
+}
+
+uint16_t TrustStore::rebuild(fs::FS &fs, const char *const *pem_files, uint8_t count) {
+    if (!allocate()) return 0;
+    clear();
+
+    for (uint8_t i = 0; i < count; i++) {
+        File file = fs.open(pem_files[i], "r");
+        if (!file) continue;
+
+        // the PEM text is only needed while it is parsed
+        size_t length = file.size();
+        char *pem = (length > 0 && length <= TRUSTSTORE_MAX_PEM) ? (char *)heap_caps_malloc(length, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : nullptr;
+        if (pem == nullptr) {
+            logger.warning("CA bundle: %s skipped (%d bytes)", pem_files[i], length);
+            file.close();
+            continue;
+        }
+        length = file.read((uint8_t *)pem, length);
+        file.close();
+        uint16_t added = add_pem(pem, length);
+        heap_caps_free(pem);
+        logger.debug("CA bundle: %d roots from %s", added, pem_files[i]);
+    }
+
+    _from_cache = false;
+    if (_count > 0 && !save(fs)) {
+        logger.warning("CA bundle: cache %s not written", TRUSTSTORE_CACHE_FILE);
+    }
+    logger.notice("CA bundle: %d roots (%d bytes) built from PEM", _count, _size);
+    return _count;
+}
+
+void TrustStore::invalidate(fs::FS &fs) {
+    fs.remove(TRUSTSTORE_CACHE_FILE);
+}
+
+void TrustStore::clear() {
+    _count = 0;
+    _size = BUNDLE_HEADER;
+    _from_cache = false;
+    if (_buffer != nullptr) put16(_buffer, 0);
+}
+
+uint16_t TrustStore::add_pem(const char *pem, size_t length) {
+    uint16_t added = 0;
+    const char *end = pem + length;
+    uint8_t *der = (uint8_t *)heap_caps_malloc(TRUSTSTORE_MAX_DER, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (der == nullptr) return 0;
+
+    const char *p = pem;
+    while (p < end) {
+        const char *begin = (const char *)memmem(p, end - p, PEM_BEGIN, sizeof(PEM_BEGIN) - 1);
+        if (begin == nullptr) break;
+        begin += sizeof(PEM_BEGIN) - 1;
+        const char *stop = (const char *)memmem(begin, end - begin, PEM_END, sizeof(PEM_END) - 1);
+        if (stop == nullptr) break;
+
+        size_t der_length = base64_decode(begin, stop - begin, der, TRUSTSTORE_MAX_DER);
+        if (der_length > 0 && add_der(der, der_length)) added++;
+        p = stop + sizeof(PEM_END) - 1;
+    }
+    heap_caps_free(der);
+    return added;
+}
+
+bool TrustStore::add_der(const uint8_t *der, size_t length) {
+    if (!allocate()) return false;
+
+    // Certificate ::= SEQUENCE { tbsCertificate SEQUENCE { [0] version, serial, signature,
+    //                            issuer, validity, subject, subjectPublicKeyInfo, ... } ... }
+    const uint8_t *p = der;
+    const uint8_t *end = der + length;
+    uint8_t tag;
+    size_t len;
+    if (!der_header(p, end, tag, len) || tag != DER_SEQUENCE) return false;
+    if (!der_header(p, end, tag, len) || tag != DER_SEQUENCE) return false;
+    end = p + len;
+
+    if (p < end && *p == DER_VERSION && !der_skip(p, end, DER_VERSION)) return false;
+    if (!der_skip(p, end, 0x02)) return false;              // serialNumber
+    if (!der_skip(p, end, DER_SEQUENCE)) return false;      // signature algorithm
+    if (!der_skip(p, end, DER_SEQUENCE)) return false;      // issuer
+    if (!der_skip(p, end, DER_SEQUENCE)) return false;      // validity
+
+    const uint8_t *name = p;
+    if (!der_skip(p, end, DER_SEQUENCE)) return false;      // subject
+    size_t name_len = p - name;
+    const uint8_t *key = p;
+    if (!der_skip(p, end, DER_SEQUENCE)) return false;      // subjectPublicKeyInfo
+    size_t key_len = p - key;
+
+    // sorted insert, the verify callback does a binary search over the subjects
+    uint8_t *pos = _buffer + BUNDLE_HEADER;
+    for (uint16_t i = 0; i < _count; i++) {
+        int result = compare_names(name, name_len, pos + ENTRY_HEADER, get16(pos));
+        if (result == 0) return false;      // same root from another file
+        if (result < 0) break;
+        pos += ENTRY_HEADER + get16(pos) + get16(pos + 2);
+    }
+
+    size_t entry_len = ENTRY_HEADER + name_len + key_len;
+    if (_count >= TRUSTSTORE_MAX_ROOTS || _size + entry_len > TRUSTSTORE_MAX_SIZE) {
+        logger.warning("CA bundle full, certificate skipped");
+        return false;
+    }
+    memmove(pos + entry_len, pos, _buffer + _size - pos);
+    put16(pos, name_len);
+    put16(pos + 2, key_len);
+    memcpy(pos + ENTRY_HEADER, name, name_len);
+    memcpy(pos + ENTRY_HEADER + name_len, key, key_len);
+
+    _size += entry_len;
+    _count++;
+    put16(_buffer, _count);
+    return true;
+}
+
+bool TrustStore::load(const uint8_t *bundle, size_t length) {
+    if (!allocate() || length < BUNDLE_HEADER || length > TRUSTSTORE_MAX_SIZE) return false;
+
+    // check the entry lengths before the bundle is used
+    uint16_t count = get16(bundle);
+    if (count == 0 || count > TRUSTSTORE_MAX_ROOTS) return false;
+    size_t pos = BUNDLE_HEADER;
+    for (uint16_t i = 0; i < count; i++) {
+        if (pos + ENTRY_HEADER > length) return false;
+        pos += ENTRY_HEADER + get16(bundle + pos) + get16(bundle + pos + 2);
+    }
+    if (pos != length) return false;
+
+    if (bundle != _buffer) memcpy(_buffer, bundle, length);
+    _size = length;
+    _count = count;
+    return true;
+}
+
+int TrustStore::find(const uint8_t *name, size_t length) const {
+    int start = 0;
+    int end = (int)_count - 1;
+
+    while (start <= end) {
+        int middle = (start + end) / 2;
+        const uint8_t *e = entry(middle);
+        int result = compare_names(name, length, e + ENTRY_HEADER, get16(e));
+        if (result == 0) return middle;
+        if (result < 0) end = middle - 1;
+        else start = middle + 1;
+    }
+    return -1;
+}
+
+void TrustStore::common_name(uint16_t index, char *buffer, size_t size) const {
+    strlcpy(buffer, "?", size);
+    const uint8_t *e = entry(index);
+    if (e == nullptr) return;
+
+    // Name ::= SEQUENCE OF SET OF SEQUENCE { type OID, value string }
+    static const uint8_t OID_CN[] = {0x55, 0x04, 0x03};
+    const uint8_t *p = e + ENTRY_HEADER;
+    const uint8_t *end = p + get16(e);
+    uint8_t tag;
+    size_t len;
+    if (!der_header(p, end, tag, len) || tag != DER_SEQUENCE) return;
+
+    while (p < end) {
+        const uint8_t *rdn_end;
+        if (!der_header(p, end, tag, len) || tag != DER_SET) return;
+        rdn_end = p + len;
+        if (!der_header(p, rdn_end, tag, len) || tag != DER_SEQUENCE) return;
+        if (!der_header(p, rdn_end, tag, len) || tag != DER_OID) return;
+        bool cn = (len == sizeof(OID_CN) && memcmp(p, OID_CN, len) == 0);
+        p += len;
+        if (!der_header(p, rdn_end, tag, len)) return;
+        if (cn) {
+            size_t n = (len < size - 1) ? len : size - 1;
+            memcpy(buffer, p, n);
+            buffer[n] = '\0';
+            return;
+        }
+        p = rdn_end;
+    }
+}
+
+// buffer in PSRAM, WiFiClientSecure keeps pointers into it
+bool TrustStore::allocate() {
+    if (_buffer != nullptr) return true;
+    _buffer = (uint8_t *)heap_caps_malloc(TRUSTSTORE_MAX_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (_buffer == nullptr) {
+        logger.err("no memory for the CA bundle");
+        return false;
+    }
+    clear();
+    return true;
+}
+
+const uint8_t *TrustStore::entry(uint16_t index) const {
+    if (index >= _count) return nullptr;
+    const uint8_t *p = _buffer + BUNDLE_HEADER;
+    while (index--) p += ENTRY_HEADER + get16(p) + get16(p + 2);
+    return p;
+}
+
+bool TrustStore::save(fs::FS &fs) {
+    File cache = fs.open(TRUSTSTORE_CACHE_FILE, "w");
+    if (!cache) return false;
+    size_t written = cache.write(_buffer, _size);
+    cache.close();
+    return written == _size;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file truststore.h
+ * @brief Root certificates as pre-parsed DER bundle for WiFiClientSecure
+ *
+ * WiFiClientSecure::setCACert() keeps the PEM text and mbedTLS parses it again
+ * on every TLS handshake. The trust store converts the PEM roots once into the
+ * certificate bundle format of esp_crt_bundle (subject and public key in DER,
+ * sorted by subject). During the handshake the bundle verify callback finds
+ * the root by the issuer of the server certificate with a binary search and
+ * only parses that public key.
+ *
+ * The bundle is cached in LittleFS (TRUSTSTORE_CACHE_FILE), so the PEM files
+ * are only read again after a new root was downloaded (invalidate()).
+ *
+ * Bundle format: uint16 count, then per root uint16 name_len, uint16 key_len,
+ * subject name (DER), SubjectPublicKeyInfo (DER), all big endian.
+ */
+
+#ifndef TRUSTSTORE_H
+#define TRUSTSTORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+/**
+ * @defgroup truststore_config Trust Store Configuration
+ * @{
+ */
+#define TRUSTSTORE_CACHE_FILE   "/ca_bundle.bin"    ///< Cached bundle in LittleFS
+#define TRUSTSTORE_MAX_SIZE     4096                ///< Bundle buffer in PSRAM (a root needs 150-650 bytes)
+#define TRUSTSTORE_MAX_ROOTS    16                  ///< Roots in the bundle
+#define TRUSTSTORE_MAX_DER      2048                ///< Largest certificate (DER) accepted from a PEM file
+#define TRUSTSTORE_MAX_PEM      16384               ///< Largest PEM file read
+/** @} */
+
+/**
+ * @class TrustStore
+ * @brief Certificate bundle built from PEM roots, cached as DER
+ */
+class TrustStore {
+public:
+    ~TrustStore();
+
+    /**
+     * @brief Load the cached bundle, or build it from the PEM files and cache it
+     * @param fs File system with the PEM files and the cache
+     * @param pem_files PEM files with one or more certificates each (missing files are skipped)
+     * @param count Number of PEM files
+     * @return Number of roots in the bundle
+     */
+    uint16_t begin(fs::FS &fs, const char *const *pem_files, uint8_t count);
+
+    /**
+     * @brief Build the bundle from the PEM files and replace the cache
+     * @return Number of roots in the bundle
+     */
+    uint16_t rebuild(fs::FS &fs, const char *const *pem_files, uint8_t count);
+
+    /**
+     * @brief Delete the cache, the next begin() reads the PEM files again
+     */
+    void invalidate(fs::FS &fs);
+
+    /**
+     * @brief Add all certificates of a PEM text
+     * @param pem PEM text (BEGIN/END CERTIFICATE blocks, other text is ignored)
+     * @param length Length of pem
+     * @return Number of certificates added (duplicates are not added twice)
+     */
+    uint16_t add_pem(const char *pem, size_t length);
+
+    /**
+     * @brief Add one certificate
+     * @param der Certificate in DER
+     * @param length Length of der
+     * @return false if the certificate can not be parsed or the bundle is full
+     */
+    bool add_der(const uint8_t *der, size_t length);
+
+    /**
+     * @brief Use a bundle from memory (cache file content)
+     * @return false if the data is not a valid bundle
+     */
+    bool load(const uint8_t *bundle, size_t length);
+
+    /**
+     * @brief Remove all roots
+     */
+    void clear();
+
+    /**
+     * @brief Root with this subject, same search as the esp_crt_bundle verify callback
+     * @param name Issuer name (DER) of a certificate
+     * @param length Length of name
+     * @return Index of the root or -1
+     */
+    int find(const uint8_t *name, size_t length) const;
+
+    /**
+     * @brief Common name of a root for display
+     * @param index Root index (sorted by subject)
+     * @param buffer Output, "?" if the subject has no CN
+     * @param size Size of buffer
+     */
+    void common_name(uint16_t index, char *buffer, size_t size) const;
+
+    /**
+     * @brief Bundle for WiFiClientSecure::setCACertBundle()
+     * @return Bundle or NULL if empty. Stays valid until the next change.
+     */
+    const uint8_t *bundle() const { return (_count > 0) ? _buffer : NULL; }
+
+    uint16_t count() const { return _count; }           ///< Roots in the bundle
+    size_t size() const { return _size; }               ///< Bundle bytes
+    bool from_cache() const { return _from_cache; }     ///< Bundle was loaded from TRUSTSTORE_CACHE_FILE
+
+private:
+    bool allocate();
+    const uint8_t *entry(uint16_t index) const;
+    bool save(fs::FS &fs);
+
+    uint8_t *_buffer = nullptr;
+    size_t _size = 0;
+    uint16_t _count = 0;
+    bool _from_cache = false;
+};
+
+#endif // TRUSTSTORE_H
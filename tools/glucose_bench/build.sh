@@ -0,0 +1,17 @@
+#!/bin/sh
+# Builds the host benchmark of the glycemic statistics kernels from the
+# unchanged firmware source (glycemicstats.cpp has no Arduino dependencies).
+#
+#   ./build.sh
+
+set -e
+cd "$(dirname "$0")"
+
+MAIN=../../application/main
+
+${CXX:-g++} -std=gnu++17 -O2 -g \
+    -I"$MAIN" \
+    -o glucose_bench \
+    glucose_bench.cpp "$MAIN/glycemicstats.cpp"
+
+echo "built $(pwd)/glucose_bench"
@@ -0,0 +1,97 @@
+// Host benchmark of the glycemic statistics kernels (application/main/glycemicstats.cpp).
+//
+//   glucose_bench [--repeat N]
+//
+// Compares the scalar Welford kernel, the unrolled integer kernel and the
+// former four-pass HBA1C functions on the history array (142 values) and on
+// one and 90 days of 5 minute values, each with 5% gaps. Exit code 1 if the
+// two kernels do not agree.
+
+#include "glycemicstats.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef void (*Kernel)(const uint16_t *, uint16_t, const GlycemicThresholds &, GlycemicStats &);
+
+// former HBA1C::calculateGlucoseMeanFromHistory / calculate_standard_deviation / calculate_time_in_range / CV
+static void legacy_four_pass(const uint16_t *values, uint16_t size, const GlycemicThresholds &thresholds, GlycemicStats &stats) {
+    memset(&stats, 0, sizeof(stats));
+    float sum = 0;
+    for (int i = 0; i < size; i++) {
+        if (values[i] != 0) sum += values[i];
+    }
+    stats.mean = sum / size;
+
+    double squares = 0;
+    for (int i = 0; i < size; i++) {
+        squares += pow(values[i] - stats.mean, 2);
+    }
+    stats.sd = sqrt(squares / size);
+
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+        if (values[i] >= thresholds.low && values[i] <= thresholds.high) count++;
+    }
+    stats.in_range = (count / (double)size) * 100.0;
+    stats.cv = (stats.sd / stats.mean) * 100.0;
+}
+
+static std::vector<uint16_t> make_values(size_t size, unsigned seed) {
+    std::vector<uint16_t> values(size);
+    srand(seed);
+    int glucose = 120;
+    for (size_t i = 0; i < size; i++) {
+        glucose += rand() % 21 - 10;
+        glucose = glucose < 40 ? 40 : glucose > 400 ? 400 : glucose;
+        values[i] = (rand() % 20 == 0) ? 0 : glucose;
+    }
+    return values;
+}
+
+static double run(Kernel kernel, const std::vector<uint16_t> &values, int repeat, GlycemicStats &stats) {
+    GlycemicThresholds thresholds;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) {
+        kernel(values.data(), values.size(), thresholds, stats);
+        __asm__ volatile("" : : "r"(&stats) : "memory");
+    }
+    auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / repeat / values.size();
+}
+
+static bool same(const GlycemicStats &a, const GlycemicStats &b) {
+    return a.count == b.count && a.gaps == b.gaps && a.min == b.min && a.max == b.max &&
+           fabsf(a.mean - b.mean) < 0.01f && fabsf(a.sd - b.sd) < 0.01f && fabsf(a.cv - b.cv) < 0.01f &&
+           a.very_low == b.very_low && a.low == b.low && a.in_range == b.in_range && a.high == b.high && a.very_high == b.very_high;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+    }
+
+    struct { const char *name; size_t size; } sets[] = {{"history", 142}, {"1 day", 288}, {"90 days", 90 * 288}};
+    int failed = 0;
+
+    printf("%-8s %7s | %-9s %9s %9s %9s | %s\n", "data", "values", "ns/value", "welford", "unrolled", "4-pass", "mean / SD / TIR (unrolled vs 4-pass)");
+    for (auto &set : sets) {
+        std::vector<uint16_t> values = make_values(set.size, (unsigned)set.size);
+        int n = (int)(repeat * 142 / set.size) + 1;
+        GlycemicStats welford, unrolled, legacy;
+        double t_welford = run(glycemic_stats_welford, values, n, welford);
+        double t_unrolled = run(glycemic_stats_unrolled, values, n, unrolled);
+        double t_legacy = run(legacy_four_pass, values, n, legacy);
+        bool ok = same(welford, unrolled);
+        failed += !ok;
+        printf("%-8s %7zu | %-9s %9.2f %9.2f %9.2f | %.1f/%.1f/%.1f%% vs %.1f/%.1f/%.1f%%%s\n", set.name, set.size, "",
+               t_welford, t_unrolled, t_legacy, unrolled.mean, unrolled.sd, unrolled.in_range,
+               legacy.mean, legacy.sd, legacy.in_range, ok ? "" : "  KERNELS DIFFER");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds the host replay harness from the unchanged firmware sources.
+#
+#   ./build.sh [ARDUINOJSON_SRC]
+#
+# ArduinoJson is taken from the PlatformIO library folder of a firmware build
+# (.pio/libdeps/main/ArduinoJson/src) unless a path is given.
+
+set -e
+cd "$(dirname "$0")"
+
+MAIN=../../../application/main
+ARDUINOJSON=${1:-${ARDUINOJSON:-../../../.pio/libdeps/main/ArduinoJson/src}}
+
+if [ ! -f "$ARDUINOJSON/ArduinoJson.h" ]; then
+    echo "ArduinoJson.h not found in $ARDUINOJSON"
+    echo "build the firmware once with PlatformIO or pass the ArduinoJson src folder"
+    exit 1
+fi
+
+${CXX:-g++} -std=gnu++17 -O2 -g \
+    -Ishim -I"$ARDUINOJSON" -I"$MAIN" \
+    -o llu_replay \
+    llu_replay.cpp shim/shim.cpp \
+    "$MAIN/librelinkup.cpp" "$MAIN/helper.cpp" "$MAIN/jsonstream.cpp" "$MAIN/httpstream.cpp" \
+    "$MAIN/inflatestream.cpp" "$MAIN/truststore.cpp" "$MAIN/stagestats.cpp" -lz
+
+echo "built $(pwd)/llu_replay"
@@ -0,0 +1,370 @@
+/*
+ * llu_replay - runs the LibreLinkUp client path of the firmware on Linux
+ *
+ * librelinkup.cpp, helper.cpp, jsonstream.cpp and httpstream.cpp are compiled
+ * unchanged against the host shim and talk to llu_mock_server.py. For every
+ * scenario the harness logs in, reads /llu/connections and /graph and reports
+ * time, body size (on the wire and decompressed), peak heap and whether the
+ * result matches the scenario.
+ *
+ *   ./llu_replay [--host 127.0.0.1] [--port 8080] [--repeat N] [--stages] [scenario ...]
+ *   ./llu_replay --parse FILE [--points N] [--repeat N]
+ *
+ * --stages prints the stage histograms (StageStats) of every scenario.
+ *
+ * --parse runs only the /graph parser (JsonStreamParser and LLU_GraphListener
+ * through LIBRELINKUP::parse_graph()) on a response body in memory, without
+ * the mock server. graphData of the file is replaced by N points (default
+ * 141) ending now, like llu_mock_server.py does. It reports the parse time, the body size and the peak heap and malloc calls.
+ *
+ * Exit code: number of failed scenarios (or parse runs).
+ */
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+
+#include "librelinkup.h"
+#include "helper.h"
+#include "settings.h"
+#include "heap_trace.h"
+#include "jsonstream.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+HELPER helper;
+SETTINGS settings;
+LIBRELINKUP librelinkup;
+
+// firmware globals referenced by the client path
+int16_t glucose_delta = 0;
+uint16_t glucoseMeasurement_backup = 0;
+
+#define REPLAY_MOCK_VALUE       123     ///< ValueInMgPerDl of mock-patient-1 (responses/*.json)
+#define REPLAY_MEASUREMENT_AGE  600     ///< Mock measurements are at most this old (s)
+#define REPLAY_GRAPH_POINTS     141     ///< graphData points of a normal /graph response (llu_mock_server.py)
+#define REPLAY_GRAPH_INTERVAL   300     ///< Seconds between two graphData points
+
+/** expected outcome of a scenario of llu_mock_server.py */
+struct Scenario {
+    const char *name;
+    uint8_t auth;           ///< ensure_token() result
+    uint8_t connections;    ///< get_connection_data() result
+    uint8_t graph;          ///< get_graph_data() result
+    uint8_t patients;       ///< followed patients after /llu/connections
+};
+
+static const Scenario scenarios[] = {
+    {"ok",                1, 1, 1, 1},
+    {"chunked",           1, 1, 1, 1},
+    {"tiny_chunks",       1, 1, 1, 1},
+    {"slow",              1, 1, 1, 1},
+    {"truncated",         1, 0, 0, 0},
+    {"truncated_chunked", 1, 0, 0, 0},
+    {"unauthorized",      1, 1, 1, 1},
+    {"rate_limited",      1, 0, 0, 0},
+    {"server_error",      1, 0, 0, 0},
+    {"unavailable",       0, 0, 0, 0},
+    {"large",             1, 1, 1, 1},
+    {"multi_patient",     1, 1, 1, 3},
+    {"identity",          1, 1, 1, 1},
+    {"deflate",           1, 1, 1, 1},
+    {"redirect",          1, 1, 1, 1},
+};
+
+/** measurement of one client call */
+struct Call {
+    uint16_t result = 0;
+    uint32_t time_us = 0;
+    uint32_t bytes = 0;     ///< body bytes on the wire
+    uint32_t raw = 0;       ///< body bytes after decompression
+};
+
+template <class F>
+static Call measure(F call) {
+    Call c;
+    unsigned long start = micros();
+    c.result = call();
+    c.time_us = micros() - start;
+    c.bytes = librelinkup.llu_connection.last_wire_bytes;
+    c.raw = librelinkup.llu_connection.last_body_bytes;
+    return c;
+}
+
+static bool mock_reset(const char *host, uint16_t port) {
+    WiFiClient client;
+    HTTPClient http;
+    char url[96];
+    snprintf(url, sizeof(url), "http://%s:%u/_mock/reset", host, port);
+    if (!http.begin(client, url)) return false;
+    int code = http.POST("");
+    client.stop();
+    return code == HTTP_CODE_OK;
+}
+
+static std::vector<std::string> failures;
+
+static void check(bool ok, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void check(bool ok, const char *format, ...) {
+    if (ok) return;
+    char buffer[160];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+    failures.push_back(buffer);
+}
+
+static bool run(const Scenario &s, const char *host, uint16_t port, int repeat, bool show_stages) {
+    Call auth, connections, graph, patient_graph;
+    size_t peak = 0, allocations = 0;
+    StageStats stages;      // collected over all repeats
+
+    for (int i = 0; i < repeat; i++) {
+        mock_reset(host, port);
+        Preferences::reset_all();
+
+        // fresh client state, like after a reboot
+        librelinkup.close_connection();
+        librelinkup = LIBRELINKUP();
+        char base_url[96];
+        snprintf(base_url, sizeof(base_url), "https://%s:%u/%s", host, port, s.name);
+        librelinkup.set_base_url(base_url);
+        librelinkup.begin(0);
+        librelinkup.stage_stats = stages;
+
+        size_t baseline = heap_trace_current();
+        heap_trace_reset_peak();
+
+        Call a = measure([] { return (uint16_t)librelinkup.ensure_token(); });
+        Call c = measure([] { return librelinkup.get_connection_data(); });
+        Call g = measure([] { return librelinkup.get_graph_data(); });
+        Call p;
+        if (librelinkup.llu_patient_count > 1) {
+            p = measure([] { return librelinkup.get_patient_graph(1); });
+        }
+
+        stages = librelinkup.stage_stats;
+        peak = std::max(peak, heap_trace_peak() - baseline);
+        allocations = std::max(allocations, heap_trace_allocations());
+
+        // keep the slowest run, a regression shows up as the worst case
+        if (i == 0 || a.time_us > auth.time_us) auth = a;
+        if (i == 0 || c.time_us > connections.time_us) connections = c;
+        if (i == 0 || g.time_us > graph.time_us) graph = g;
+        if (i == 0 || p.time_us > patient_graph.time_us) patient_graph = p;
+    }
+
+    failures.clear();
+    check(auth.result == s.auth, "auth %d, expected %d", auth.result, s.auth);
+    check(connections.result == s.connections, "connections %d, expected %d", connections.result, s.connections);
+    check(graph.result == s.graph, "graph %d, expected %d", graph.result, s.graph);
+    check(librelinkup.llu_patient_count == s.patients, "%d patients, expected %d", librelinkup.llu_patient_count, s.patients);
+
+    uint8_t points = librelinkup.check_graphdata();
+    if (s.graph) {
+        uint32_t now = time(NULL);
+        uint32_t measurement = librelinkup.llu_glucose_data.measurement_unixtime;
+        uint32_t newest = LIBRELINKUP::ring_newest(librelinkup.llu_history);
+        check(points == LIBRELINKUP::GRAPHDATAARRAYSIZE, "%d history points, expected %d", points, LIBRELINKUP::GRAPHDATAARRAYSIZE);
+        check(librelinkup.llu_glucose_data.glucoseMeasurement == REPLAY_MOCK_VALUE, "value %d, expected %d",
+              librelinkup.llu_glucose_data.glucoseMeasurement, REPLAY_MOCK_VALUE);
+        check(measurement + REPLAY_MEASUREMENT_AGE > now && measurement <= now + 60, "measurement time %u, now %u", measurement, now);
+        check(newest != 0 && newest <= measurement && newest + LLU_GRAPH_POINT_INTERVAL > measurement,
+              "newest history point %u, measurement %u", newest, measurement);
+        for (uint8_t i = 1; i < points; i++) {
+            if (librelinkup.llu_sensor_history_data.timestamp[i] <= librelinkup.llu_sensor_history_data.timestamp[i - 1]) {
+                check(false, "history not ascending at %d", i);
+                break;
+            }
+        }
+    }
+    if (s.patients > 1) {
+        check(patient_graph.result == 1, "graph of patient 1: %d", patient_graph.result);
+        check(librelinkup.llu_patients[1].history.count == LIBRELINKUP::GRAPHDATAARRAYSIZE, "patient 1: %d history points",
+              librelinkup.llu_patients[1].history.count);
+    }
+
+    printf("%-18s %4d %5d %5d %4d %6d %9.1f %9.1f %8u %8u %8zu %7zu  %s\n", s.name, auth.result, connections.result,
+           graph.result, points, librelinkup.llu_glucose_data.glucoseMeasurement, connections.time_us / 1000.0,
+           graph.time_us / 1000.0, graph.bytes, graph.raw, peak, allocations, failures.empty() ? "ok" : "FAIL");
+    for (auto &f : failures) {
+        printf("    %s\n", f.c_str());
+    }
+    if (show_stages) {
+        for (uint8_t stage = 0; stage < LLU_STAGE_COUNT; stage++) {
+            if (stages.count(stage) == 0) continue;
+            printf("    %-8s n %4u  p50 %5u  p90 %5u  p99 %5u  max %5u ms\n", StageStats::stage_name(stage), stages.count(stage),
+                   stages.percentile(stage, 50), stages.percentile(stage, 90), stages.percentile(stage, 99), stages.max(stage));
+        }
+    }
+    return failures.empty();
+}
+
+/** response body in memory (--parse) */
+class BodyStream : public Stream {
+public:
+    explicit BodyStream(const std::string &body) : _body(body) {}
+    int available() override { return _body.size() - _pos; }
+    int read() override { return _pos < _body.size() ? (uint8_t)_body[_pos++] : -1; }
+    int peek() override { return _pos < _body.size() ? (uint8_t)_body[_pos] : -1; }
+    size_t readBytes(char *buffer, size_t length) override {
+        size_t count = std::min(length, _body.size() - _pos);
+        memcpy(buffer, _body.data() + _pos, count);
+        _pos += count;
+        return count;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    const std::string &_body;
+    size_t _pos = 0;
+};
+
+// LibreLinkUp timestamp format: 10/17/2026 1:45:00 PM (llu_mock_server.py llu_timestamp())
+static std::string llu_timestamp(const struct tm &t) {
+    char buffer[32];
+    int hour = t.tm_hour % 12;
+    snprintf(buffer, sizeof(buffer), "%d/%d/%d %d:%02d:%02d %s", t.tm_mon + 1, t.tm_mday, t.tm_year + 1900,
+             hour == 0 ? 12 : hour, t.tm_min, t.tm_sec, t.tm_hour < 12 ? "AM" : "PM");
+    return buffer;
+}
+
+// graph.json with N graphData points ending now (llu_mock_server.py graph()), the rest of the file unchanged
+static bool make_graph_body(const char *path, int points, std::string &body) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) body.append(buffer, len);
+    fclose(file);
+
+    // "graphData": [ ... ] (points are objects without nested arrays)
+    size_t key = body.find("\"graphData\"");
+    size_t open = (key == std::string::npos) ? key : body.find('[', key);
+    size_t close = (open == std::string::npos) ? open : body.find(']', open);
+    if (close == std::string::npos) return false;
+
+    time_t now = time(NULL);
+    time_t newest = now - now % REPLAY_GRAPH_INTERVAL;
+    std::string graph = "[";
+    for (int i = 0; i < points; i++) {
+        int value = (int)(140 + 50 * sin(i / 9.0) + 15 * sin(i / 2.3));
+        time_t t = newest - (time_t)(points - 1 - i) * REPLAY_GRAPH_INTERVAL;
+        struct tm utc, local;
+        char item[256];
+        snprintf(item, sizeof(item), "%s{\"FactoryTimestamp\":\"%s\",\"Timestamp\":\"%s\",\"type\":0,\"ValueInMgPerDl\":%d,"
+                 "\"MeasurementColor\":1,\"GlucoseUnits\":1,\"Value\":%d,\"isHigh\":false,\"isLow\":false}",
+                 i ? "," : "", llu_timestamp(*gmtime_r(&t, &utc)).c_str(), llu_timestamp(*localtime_r(&t, &local)).c_str(), value, value);
+        graph += item;
+    }
+    graph += "]";
+    body.replace(open, close - open + 1, graph);
+    return true;
+}
+
+static bool parse(const char *path, int points, int repeat) {
+    std::string body;
+    if (!make_graph_body(path, points, body)) {
+        fprintf(stderr, "%s: not a /graph response or too large\n", path);
+        return false;
+    }
+
+    uint8_t status = 0;
+    uint32_t best_us = 0, worst_us = 0;
+    size_t peak = 0, allocations = 0;
+    for (int i = 0; i < repeat; i++) {
+        Preferences::reset_all();
+        librelinkup = LIBRELINKUP();
+        librelinkup.begin(0);
+        BodyStream stream(body);
+
+        size_t baseline = heap_trace_current();
+        heap_trace_reset_peak();
+        unsigned long start = micros();
+        status = librelinkup.parse_graph(stream);
+        uint32_t time_us = micros() - start;
+        peak = std::max(peak, heap_trace_peak() - baseline);
+        allocations = std::max(allocations, heap_trace_allocations());
+
+        if (i == 0 || time_us < best_us) best_us = time_us;
+        if (i == 0 || time_us > worst_us) worst_us = time_us;
+    }
+
+    failures.clear();
+    uint8_t history = librelinkup.check_graphdata();
+    uint8_t expected = std::min(points, (int)LIBRELINKUP::GRAPHDATAARRAYSIZE);
+    check(status == JSONSTREAM_DONE, "parse status %d, expected %d", status, JSONSTREAM_DONE);
+    check(history == expected, "%d history points, expected %d", history, expected);
+    check(librelinkup.llu_glucose_data.glucoseMeasurement == REPLAY_MOCK_VALUE, "value %d, expected %d",
+          librelinkup.llu_glucose_data.glucoseMeasurement, REPLAY_MOCK_VALUE);
+
+    // a body truncated before the current value keeps the values of the complete one
+    std::string truncated = body.substr(0, body.find("\"glucoseMeasurement\""));
+    BodyStream truncated_stream(truncated);
+    std::string sensor_sn = librelinkup.llu_sensor_data.sensor_sn.c_str();
+    uint32_t measurement = librelinkup.llu_glucose_data.measurement_unixtime;
+    check(librelinkup.parse_graph(truncated_stream) != JSONSTREAM_DONE, "truncated body parsed as complete");
+    check(librelinkup.llu_glucose_data.glucoseMeasurement == REPLAY_MOCK_VALUE && librelinkup.llu_glucose_data.measurement_unixtime == measurement &&
+          sensor_sn == librelinkup.llu_sensor_data.sensor_sn.c_str(), "truncated body changed the value to %d, sensor %s",
+          librelinkup.llu_glucose_data.glucoseMeasurement, librelinkup.llu_sensor_data.sensor_sn.c_str());
+
+    printf("%-6s %4s %6s %8s %9s %9s %8s %8s %7s\n", "points", "hist", "value", "body_B", "best_ms", "worst_ms", "MB/s",
+           "peak_B", "allocs");
+    printf("%6d %4d %6d %8zu %9.3f %9.3f %8.1f %8zu %7zu  %s\n", points, history, librelinkup.llu_glucose_data.glucoseMeasurement,
+           body.size(), best_us / 1000.0, worst_us / 1000.0, best_us ? body.size() / (double)best_us : 0.0, peak, allocations,
+           failures.empty() ? "ok" : "FAIL");
+    for (auto &f : failures) {
+        printf("    %s\n", f.c_str());
+    }
+    return failures.empty();
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1";
+    uint16_t port = 8080;
+    int repeat = 1;
+    bool show_stages = false;
+    const char *parse_file = NULL;
+    int points = REPLAY_GRAPH_POINTS;
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--stages") == 0) show_stages = true;
+        else if (strcmp(argv[i], "--parse") == 0 && i + 1 < argc) parse_file = argv[++i];
+        else if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) points = std::max(0, atoi(argv[++i]));
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--host HOST] [--port PORT] [--repeat N] [--stages] [scenario ...]\n"
+                            "       %s --parse FILE [--points N] [--repeat N]\n", argv[0], argv[0]);
+            return 255;
+        } else selected.push_back(argv[i]);
+    }
+
+    if (parse_file != NULL) {
+        return parse(parse_file, points, repeat) ? 0 : 1;
+    }
+
+    settings.config.login_email = "mock@example.com";
+    settings.config.login_password = "mock";
+
+    if (!mock_reset(host, port)) {
+        fprintf(stderr, "llu mock server not reachable on %s:%u (tools/llu_mock/llu_mock_server.py)\n", host, port);
+        return 255;
+    }
+
+    printf("%-18s %4s %5s %5s %4s %6s %9s %9s %8s %8s %8s %7s\n", "scenario", "auth", "conn", "graph", "pts", "value",
+           "conn_ms", "graph_ms", "wire_B", "body_B", "peak_B", "allocs");
+
+    int failed = 0;
+    for (const Scenario &s : scenarios) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), s.name) == selected.end()) continue;
+        if (!run(s, host, port, repeat, show_stages)) failed++;
+    }
+    return failed;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for the host replay harness
+ *
+ * Only what the LibreLinkUp client path (librelinkup, helper, jsonstream,
+ * httpstream) needs to build and run on Linux.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <string>
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_ATTR
+#define HEX 16
+#define DEC 10
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper *>(x))
+#define FPSTR(x) (reinterpret_cast<const __FlashStringHelper *>(x))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+long random(long max);
+long random(long min, long max);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+uint32_t esp_random(void);
+
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+class String {
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(const __FlashStringHelper *s) : _s(reinterpret_cast<const char *>(s)) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(unsigned int v, unsigned char base) { char b[36]; snprintf(b, sizeof(b), base == 16 ? "%x" : "%u", v); _s = b; }
+    String(unsigned long v, unsigned char base) { char b[36]; snprintf(b, sizeof(b), base == 16 ? "%lx" : "%lu", v); _s = b; }
+    String(double v, unsigned int digits = 2) { char b[40]; snprintf(b, sizeof(b), "%.*f", digits, v); _s = b; }
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    String &operator+=(const String &o) { _s += o._s; return *this; }
+    String &operator+=(const char *o) { _s += o; return *this; }
+    String &operator+=(char o) { _s += o; return *this; }
+    bool operator==(const String &o) const { return _s == o._s; }
+    bool operator==(const char *o) const { return _s == o; }
+    bool operator!=(const String &o) const { return _s != o._s; }
+    bool operator!=(const char *o) const { return _s != o; }
+    char operator[](unsigned int i) const { return _s[i]; }
+
+    bool equalsIgnoreCase(const String &o) const {
+        return _s.size() == o._s.size() && strncasecmp(_s.c_str(), o._s.c_str(), _s.size()) == 0;
+    }
+    bool startsWith(const String &p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    bool endsWith(const String &p) const {
+        return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { size_t p = _s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+    String substring(unsigned int from) const { return String(_s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const { return String(_s.substr(from, to - from)); }
+    void toUpperCase() { for (auto &c : _s) c = toupper((unsigned char)c); }
+    long toInt() const { return atol(_s.c_str()); }
+    void trim() {
+        size_t a = _s.find_first_not_of(" \t\r\n");
+        size_t b = _s.find_last_not_of(" \t\r\n");
+        _s = (a == std::string::npos) ? "" : _s.substr(a, b - a + 1);
+    }
+
+private:
+    std::string _s;
+};
+
+inline String operator+(const String &a, const String &b) { String r(a); r += b; return r; }
+inline String operator+(const String &a, const char *b) { String r(a); r += b; return r; }
+inline String operator+(const char *a, const String &b) { String r(a); r += b; return r; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+    size_t write(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+    size_t write(const char *s, size_t size) { return write(reinterpret_cast<const uint8_t *>(s), size); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(struct tm *t, const char *format = NULL) {
+        char b[64];
+        strftime(b, sizeof(b), format ? format : "%c", t);
+        return write(b);
+    }
+    size_t println(void) { return write("\r\n"); }
+    template <class T> size_t println(const T &v) { return print(v) + println(); }
+    size_t println(struct tm *t, const char *format = NULL) { return print(t, format) + println(); }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char *buffer, size_t length) {
+        size_t count = 0;
+        while (count < length) {
+            int c = read();
+            if (c < 0) break;
+            buffer[count++] = (char)c;
+        }
+        return count;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes(reinterpret_cast<char *>(buffer), length); }
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout(void) const { return _timeout; }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+/** Serial output goes to stdout only with LLU_REPLAY_SERIAL=1 */
+class HardwareSerial : public Stream {
+public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void begin(unsigned long) {}
+};
+extern HardwareSerial Serial;
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+class EspClass {
+public:
+    uint32_t getFreeHeap(void) { return heap_caps_get_free_size(MALLOC_CAP_DEFAULT); }
+    uint32_t getMaxAllocHeap(void) { return heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT); }
+    uint32_t getMinFreeHeap(void) { return heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT); }
+    uint32_t getHeapSize(void) { return 320 * 1024; }
+    uint32_t getFreePsram(void) { return 0; }
+    uint32_t getPsramSize(void) { return 0; }
+    uint64_t getEfuseMac(void) { return 0x0000AABBCCDDEEFFULL; }
+    void restart(void) { exit(0); }
+};
+extern EspClass ESP;
+
+#include "IPAddress.h"
@@ -0,0 +1,58 @@
+/**
+ * @file FS.h
+ * @brief Empty file system, the harness does not use LittleFS
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t *, size_t) override { return 0; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t read(uint8_t *, size_t) { return 0; }
+    bool seek(uint32_t, SeekMode = SeekSet) { return false; }
+    size_t position() const { return 0; }
+    size_t size() const { return 0; }
+    void close() {}
+    operator bool() const { return false; }
+    const char *name() const { return ""; }
+    const char *path() const { return ""; }
+    bool isDirectory() { return false; }
+    File openNextFile(const char * = FILE_READ) { return File(); }
+    time_t getLastWrite() { return 0; }
+};
+
+class FS {
+public:
+    File open(const char *, const char * = FILE_READ, bool = false) { return File(); }
+    File open(const String &, const char * = FILE_READ, bool = false) { return File(); }
+    bool exists(const char *) { return false; }
+    bool exists(const String &) { return false; }
+    bool remove(const char *) { return false; }
+    bool remove(const String &) { return false; }
+    bool rename(const char *, const char *) { return false; }
+    bool mkdir(const char *) { return false; }
+    bool rmdir(const char *) { return false; }
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,62 @@
+/**
+ * @file HTTPClient.h
+ * @brief HTTP/1.1 client with the subset of the arduino-esp32 HTTPClient API used by LIBRELINKUP
+ *
+ * Like the original it reuses an already connected client (keep-alive) and
+ * leaves reading the body to the caller (getStream() / getSize()).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <string>
+#include <vector>
+
+#define HTTP_CODE_OK                    200
+#define HTTP_CODE_MOVED_PERMANENTLY     301
+#define HTTP_CODE_UNAUTHORIZED          401
+#define HTTP_CODE_TOO_MANY_REQUESTS     429
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient &client, const String &url);
+    void end(void);
+
+    void useHTTP10(bool http10) { (void)http10; }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void collectHeaders(const char *names[], size_t count);
+    void addHeader(const String &name, const String &value, bool first = false, bool replace = true);
+
+    int GET(void) { return send("GET", String()); }
+    int POST(const String &payload) { return send("POST", payload); }
+
+    WiFiClient &getStream(void) { return *_client; }
+    int getSize(void) const { return _size; }
+    String header(const char *name) const;
+    int writeToStream(Stream *stream);
+
+    static String errorToString(int error);
+
+private:
+    int send(const char *type, const String &payload);
+    bool read_line(std::string &line);
+
+    WiFiClient *_client = nullptr;
+    std::string _host;
+    uint16_t _port = 80;
+    std::string _path;
+    std::string _request_headers;
+    bool _reuse = true;
+    int _size = -1;
+    std::vector<std::pair<std::string, std::string>> _collected;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _addr[i]; }
+    uint8_t &operator[](int i) { return _addr[i]; }
+    bool fromString(const char *s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+        _addr[0] = a; _addr[1] = b; _addr[2] = c; _addr[3] = d;
+        return true;
+    }
+    bool fromString(const String &s) { return fromString(s.c_str()); }
+    String toString() const {
+        char b[16];
+        snprintf(b, sizeof(b), "%u.%u.%u.%u", _addr[0], _addr[1], _addr[2], _addr[3]);
+        return String(b);
+    }
+
+private:
+    uint8_t _addr[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+public:
+    bool begin(bool = false) { return true; }
+    size_t totalBytes(void) { return 0; }
+    size_t usedBytes(void) { return 0; }
+};
+extern LittleFSFS LittleFS;
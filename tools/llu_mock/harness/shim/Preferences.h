@@ -0,0 +1,57 @@
+/**
+ * @file Preferences.h
+ * @brief In-memory NVS for the harness (cleared by Preferences::reset_all())
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool read_only = false) { _ns = name; (void)read_only; return true; }
+    void end(void) {}
+    bool clear(void) { store().erase(_ns); return true; }
+    bool remove(const char *key) { return store()[_ns].erase(key) > 0; }
+    bool isKey(const char *key) { return store()[_ns].count(key) > 0; }
+
+    size_t putUChar(const char *key, uint8_t v) { return put(key, std::to_string(v), 1); }
+    size_t putUShort(const char *key, uint16_t v) { return put(key, std::to_string(v), 2); }
+    size_t putUInt(const char *key, uint32_t v) { return put(key, std::to_string(v), 4); }
+    size_t putULong(const char *key, uint32_t v) { return put(key, std::to_string(v), 4); }
+    size_t putString(const char *key, const char *v) { return put(key, v, strlen(v)); }
+    size_t putString(const char *key, const String &v) { return put(key, v.c_str(), v.length()); }
+    size_t putBytes(const char *key, const void *v, size_t len) {
+        return put(key, std::string(static_cast<const char *>(v), len), len);
+    }
+
+    uint8_t getUChar(const char *key, uint8_t d = 0) { return isKey(key) ? strtoul(get(key).c_str(), NULL, 10) : d; }
+    uint16_t getUShort(const char *key, uint16_t d = 0) { return isKey(key) ? strtoul(get(key).c_str(), NULL, 10) : d; }
+    uint32_t getUInt(const char *key, uint32_t d = 0) { return isKey(key) ? strtoul(get(key).c_str(), NULL, 10) : d; }
+    uint32_t getULong(const char *key, uint32_t d = 0) { return isKey(key) ? strtoul(get(key).c_str(), NULL, 10) : d; }
+    String getString(const char *key, const String &d = String()) { return isKey(key) ? String(get(key)) : d; }
+    size_t getString(const char *key, char *buffer, size_t size) {
+        if (!isKey(key) || size == 0) return 0;
+        strlcpy(buffer, get(key).c_str(), size);
+        return strlen(buffer) + 1;
+    }
+    size_t getBytesLength(const char *key) { return isKey(key) ? get(key).size() : 0; }
+    size_t getBytes(const char *key, void *buffer, size_t size) {
+        if (!isKey(key)) return 0;
+        size_t len = std::min(size, get(key).size());
+        memcpy(buffer, get(key).data(), len);
+        return len;
+    }
+
+    static void reset_all(void) { store().clear(); }
+
+private:
+    typedef std::map<std::string, std::map<std::string, std::string>> Store;
+    static Store &store(void) { static Store s; return s; }
+    size_t put(const char *key, const std::string &v, size_t len) { store()[_ns][key] = v; return len; }
+    const std::string &get(const char *key) { return store()[_ns][key]; }
+
+    std::string _ns;
+};
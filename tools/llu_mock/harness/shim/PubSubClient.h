@@ -0,0 +1,9 @@
+#pragma once
+
+#include <WiFiClient.h>
+
+class PubSubClient {
+public:
+    PubSubClient() {}
+    explicit PubSubClient(WiFiClient &) {}
+};
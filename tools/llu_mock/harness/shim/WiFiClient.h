@@ -0,0 +1,49 @@
+/**
+ * @file WiFiClient.h
+ * @brief Plain TCP client (POSIX sockets) with Arduino Stream semantics
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class WiFiClient : public Stream {
+public:
+    virtual ~WiFiClient() { stop(); }
+
+    virtual int connect(const char *host, uint16_t port);
+    virtual int connect(IPAddress ip, uint16_t port);
+    virtual void stop(void);
+    virtual uint8_t connected(void);
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+
+    operator bool() { return connected(); }
+
+private:
+    bool wait_readable(unsigned long timeout_ms);
+
+    int _fd = -1;
+    int _peeked = -1;
+};
+
+/** WiFi stub, the harness is always "connected" */
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class WiFiClass {
+public:
+    wl_status_t status(void) { return WL_CONNECTED; }
+    IPAddress localIP(void) { return IPAddress(127, 0, 0, 1); }
+    int RSSI(void) { return -50; }
+    bool disconnect(bool = false) { return true; }
+    bool reconnect(void) { return true; }
+    int hostByName(const char *host, IPAddress &result);
+};
+extern WiFiClass WiFi;
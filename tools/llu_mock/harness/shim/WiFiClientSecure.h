@@ -0,0 +1,28 @@
+/**
+ * @file WiFiClientSecure.h
+ * @brief The harness talks plain HTTP to the mock server, TLS settings are ignored
+ */
+
+#pragma once
+
+#include <WiFiClient.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure(void) {}
+    void setCACert(const char *) {}
+    void setCACertBundle(const uint8_t *) {}
+    bool loadCACert(Stream &, size_t) { return true; }
+    void setHandshakeTimeout(unsigned long) {}
+
+    using WiFiClient::connect;
+    int connect(IPAddress ip, uint16_t port, const char *, const char *, const char *, const char *) {
+        return WiFiClient::connect(ip, port);
+    }
+
+protected:
+    // same members as the ESP32 core, used by subclasses
+    const char *_CA_cert = NULL;
+    const char *_cert = NULL;
+    const char *_private_key = NULL;
+};
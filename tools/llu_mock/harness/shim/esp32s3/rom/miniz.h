@@ -0,0 +1,74 @@
+/**
+ * @file miniz.h
+ * @brief tinfl API of the ESP32-S3 ROM, implemented with the host zlib
+ *
+ * Only what inflatestream.cpp uses. zlib keeps its own copy of the window,
+ * so the output is the same as with tinfl writing into the circular buffer.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    z_stream z;
+    int state;      ///< 0 = not started, 1 = running, 2 = done, 3 = failed
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->state = 0; } while (0)
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *in_size,
+                                            uint8_t *out_start, uint8_t *out_next, size_t *out_size, uint32_t flags) {
+    (void)out_start;
+    if (r->state >= 2) {
+        *in_size = *out_size = 0;
+        return r->state == 2 ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+    }
+    if (r->state == 0) {
+        memset(&r->z, 0, sizeof(r->z));
+        if (inflateInit2(&r->z, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) return TINFL_STATUS_FAILED;
+        r->state = 1;
+    }
+
+    r->z.next_in = (Bytef *)in;
+    r->z.avail_in = *in_size;
+    r->z.next_out = out_next;
+    r->z.avail_out = *out_size;
+    int ret = inflate(&r->z, Z_NO_FLUSH);
+    *in_size -= r->z.avail_in;
+    *out_size -= r->z.avail_out;
+
+    if (ret == Z_STREAM_END) {
+        inflateEnd(&r->z);
+        r->state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    if (ret == Z_OK || ret == Z_BUF_ERROR) {
+        if (r->z.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+        if (flags & TINFL_FLAG_HAS_MORE_INPUT) return TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+    inflateEnd(&r->z);
+    r->state = 3;
+    return TINFL_STATUS_FAILED;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file FreeRTOS.h
+ * @brief FreeRTOS types for the harness (headers only, no task is created)
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
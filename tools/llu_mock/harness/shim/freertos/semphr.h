@@ -0,0 +1,10 @@
+/**
+ * @file semphr.h
+ * @brief FreeRTOS semaphore handle for the harness
+ */
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
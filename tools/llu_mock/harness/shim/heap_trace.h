@@ -0,0 +1,13 @@
+/**
+ * @file heap_trace.h
+ * @brief Heap accounting of the harness (malloc/free are wrapped in shim.cpp)
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+size_t heap_trace_current(void);        ///< Bytes allocated right now
+size_t heap_trace_peak(void);           ///< Highest value since heap_trace_reset_peak()
+size_t heap_trace_allocations(void);    ///< malloc calls since heap_trace_reset_peak()
+void heap_trace_reset_peak(void);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stddef.h>
+
+/** SHA-256 for the Account-ID header (implemented in shim.cpp) */
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224);
@@ -0,0 +1,448 @@
+/*
+ * Host implementation of the Arduino/ESP32 shim used by the replay harness
+ */
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <ESP32Ping.h>
+#include <WiFi.h>
+#include <mbedtls/sha256.h>
+#include <uuid/log.h>
+
+#include "heap_trace.h"
+
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+LittleFSFS LittleFS;
+PingClass Ping;
+
+//------------------------[heap accounting]-------------------------------
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static size_t heap_current = 0;
+static size_t heap_peak = 0;
+static size_t heap_allocations = 0;
+
+static void heap_add(void *ptr) {
+    if (ptr == NULL) return;
+    heap_current += malloc_usable_size(ptr);
+    heap_allocations++;
+    if (heap_current > heap_peak) heap_peak = heap_current;
+}
+
+static void heap_sub(void *ptr) {
+    if (ptr != NULL) heap_current -= malloc_usable_size(ptr);
+}
+
+extern "C" void *malloc(size_t size) {
+    void *ptr = __libc_malloc(size);
+    heap_add(ptr);
+    return ptr;
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    void *ptr = __libc_calloc(n, size);
+    heap_add(ptr);
+    return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    heap_sub(ptr);
+    void *result = __libc_realloc(ptr, size);
+    heap_add(result != NULL ? result : (size != 0 ? ptr : NULL));
+    return result;
+}
+
+extern "C" void free(void *ptr) {
+    heap_sub(ptr);
+    __libc_free(ptr);
+}
+
+size_t heap_trace_current(void) { return heap_current; }
+size_t heap_trace_peak(void) { return heap_peak; }
+size_t heap_trace_allocations(void) { return heap_allocations; }
+void heap_trace_reset_peak(void) { heap_peak = heap_current; heap_allocations = 0; }
+
+// free heap of an ESP32-S3 without PSRAM, so heap logs look familiar
+#define SHIM_HEAP_SIZE (320 * 1024)
+
+void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+void *heap_caps_calloc(size_t n, size_t size, uint32_t) { return calloc(n, size); }
+void heap_caps_free(void *ptr) { free(ptr); }
+size_t heap_caps_get_free_size(uint32_t) { return SHIM_HEAP_SIZE - std::min(heap_current, (size_t)SHIM_HEAP_SIZE); }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_caps_get_free_size(caps); }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return SHIM_HEAP_SIZE - std::min(heap_peak, (size_t)SHIM_HEAP_SIZE); }
+
+//------------------------[time / misc]-----------------------------------
+
+static const auto start_time = std::chrono::steady_clock::now();
+
+unsigned long millis(void) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long micros(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void yield(void) {}
+long random(long max) { return max > 0 ? rand() % max : 0; }
+long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+uint32_t esp_random(void) { return (uint32_t)rand(); }
+
+bool getLocalTime(struct tm *info, uint32_t) {
+    time_t now = time(NULL);
+    localtime_r(&now, info);
+    return true;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char buffer[512];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+    if (len < 0) return 0;
+    return write(reinterpret_cast<const uint8_t *>(buffer), std::min((size_t)len, sizeof(buffer) - 1));
+}
+
+static bool serial_enabled(void) {
+    static int enabled = -1;
+    if (enabled < 0) enabled = getenv("LLU_REPLAY_SERIAL") != NULL && atoi(getenv("LLU_REPLAY_SERIAL")) != 0;
+    return enabled;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (serial_enabled()) fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+namespace uuid {
+
+std::string read_flash_string(const __FlashStringHelper *flash_str) {
+    return reinterpret_cast<const char *>(flash_str);
+}
+
+void loop(void) {}
+
+namespace log {
+
+void Logger::vlog(Level level, const char *format, va_list ap) const {
+    static int max_level = -2;
+    if (max_level == -2) max_level = getenv("LLU_REPLAY_LOG") ? atoi(getenv("LLU_REPLAY_LOG")) : (int)Level::ERR;
+    if ((int)level > max_level) return;
+
+    const char *name = strrchr(_name, '/');
+    fprintf(stderr, "[%08lu][%s] ", millis(), name ? name + 1 : _name);
+    vfprintf(stderr, format, ap);
+    fputc('\n', stderr);
+}
+
+} // namespace log
+} // namespace uuid
+
+//------------------------[WiFiClient: TCP socket]------------------------
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    stop();
+
+    struct addrinfo hints = {}, *result = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    if (getaddrinfo(host, port_str, &hints, &result) != 0) return 0;
+
+    for (struct addrinfo *ai = result; ai != NULL; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            _fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(result);
+    return _fd >= 0 ? 1 : 0;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &result) {
+    struct addrinfo hints = {}, *info = NULL;
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(host, NULL, &hints, &info) != 0) return 0;
+    const uint8_t *addr = (const uint8_t *)&((struct sockaddr_in *)info->ai_addr)->sin_addr;
+    result = IPAddress(addr[0], addr[1], addr[2], addr[3]);
+    freeaddrinfo(info);
+    return 1;
+}
+
+void WiFiClient::stop(void) {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+    _peeked = -1;
+}
+
+uint8_t WiFiClient::connected(void) {
+    if (_fd < 0) return 0;
+    if (_peeked >= 0) return 1;
+    char c;
+    ssize_t n = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        stop();     // closed by the server
+        return 0;
+    }
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    size_t sent = 0;
+    while (_fd >= 0 && sent < size) {
+        ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            stop();
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (_fd < 0) return 0;
+    int count = 0;
+    if (ioctl(_fd, FIONREAD, &count) < 0) count = 0;
+    return count + (_peeked >= 0 ? 1 : 0);
+}
+
+bool WiFiClient::wait_readable(unsigned long timeout_ms) {
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    return poll(&pfd, 1, (int)timeout_ms) > 0;
+}
+
+int WiFiClient::read() {
+    char c;
+    return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+int WiFiClient::peek() {
+    if (_peeked < 0) {
+        char c;
+        if (readBytes(&c, 1) != 1) return -1;
+        _peeked = (uint8_t)c;
+    }
+    return _peeked;
+}
+
+// blocks until length bytes arrived, the stream timeout expired or the connection was closed
+size_t WiFiClient::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    if (length > 0 && _peeked >= 0) {
+        buffer[count++] = (char)_peeked;
+        _peeked = -1;
+    }
+    unsigned long start = millis();
+    while (count < length && _fd >= 0) {
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= _timeout || !wait_readable(_timeout - elapsed)) break;
+        ssize_t n = recv(_fd, buffer + count, length - count, 0);
+        if (n <= 0) {
+            stop();
+            break;
+        }
+        count += n;
+    }
+    return count;
+}
+
+//------------------------[HTTPClient]------------------------------------
+
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+    std::string u = url.c_str();
+    size_t scheme = u.find("://");
+    bool https = scheme != std::string::npos && u.compare(0, scheme, "https") == 0;
+    std::string rest = (scheme != std::string::npos) ? u.substr(scheme + 3) : u;
+
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    _path = (slash != std::string::npos) ? rest.substr(slash) : "/";
+
+    size_t colon = authority.find(':');
+    _host = authority.substr(0, colon);
+    _port = (colon != std::string::npos) ? atoi(authority.c_str() + colon + 1) : (https ? 443 : 80);
+
+    _client = &client;
+    _request_headers.clear();
+    _size = -1;
+    for (auto &h : _collected) h.second.clear();
+    return !_host.empty();
+}
+
+void HTTPClient::end(void) {
+    _request_headers.clear();
+    if (!_reuse && _client != nullptr) _client->stop();
+}
+
+void HTTPClient::collectHeaders(const char *names[], size_t count) {
+    _collected.clear();
+    for (size_t i = 0; i < count; i++) _collected.emplace_back(names[i], "");
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool, bool) {
+    _request_headers += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+String HTTPClient::header(const char *name) const {
+    for (auto &h : _collected) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return String(h.second);
+    }
+    return String();
+}
+
+bool HTTPClient::read_line(std::string &line) {
+    line.clear();
+    char c;
+    while (_client->readBytes(&c, 1) == 1) {
+        if (c == '\n') return true;
+        if (c != '\r') line += c;
+    }
+    return false;
+}
+
+int HTTPClient::send(const char *type, const String &payload) {
+    if (_client == nullptr) return HTTPC_ERROR_NOT_CONNECTED;
+    if (!_client->connected() && !_client->connect(_host.c_str(), _port)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string request = std::string(type) + " " + _path + " HTTP/1.1\r\n";
+    request += "Host: " + _host + "\r\n";
+    request += "User-Agent: llu_replay\r\nConnection: keep-alive\r\n";
+    request += "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";    // the ESP32 HTTPClient always sends this (HTTP/1.1)
+    request += _request_headers;
+    if (strcmp(type, "POST") == 0 || payload.length() > 0) {
+        request += "Content-Length: " + std::to_string(payload.length()) + "\r\n";
+    }
+    request += "\r\n";
+    request += payload.c_str();
+
+    if (_client->write(reinterpret_cast<const uint8_t *>(request.data()), request.size()) != request.size()) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+
+    std::string line;
+    if (!read_line(line)) return HTTPC_ERROR_CONNECTION_LOST;
+    if (line.compare(0, 5, "HTTP/") != 0) return HTTPC_ERROR_NO_HTTP_SERVER;
+    int code = atoi(line.c_str() + line.find(' ') + 1);
+
+    _size = -1;
+    while (read_line(line) && !line.empty()) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::string value = line.substr(line.find_first_not_of(' ', colon + 1));
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) _size = atoi(value.c_str());
+        for (auto &h : _collected) {
+            if (strcasecmp(h.first.c_str(), name.c_str()) == 0) h.second = value;
+        }
+    }
+    return code;
+}
+
+int HTTPClient::writeToStream(Stream *) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED:  return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED:  return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED:       return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST:     return "connection lost";
+        case HTTPC_ERROR_NO_HTTP_SERVER:      return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM:        return "too less ram";
+        case HTTPC_ERROR_READ_TIMEOUT:        return "read Timeout";
+        default:                              return String();
+    }
+}
+
+//------------------------[SHA-256]---------------------------------------
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void sha256_block(uint32_t h[8], const unsigned char *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[4 * i] << 24 | p[4 * i + 1] << 16 | p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224) {
+    (void)is224;    // only SHA-256 is used
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    size_t full = ilen / 64 * 64;
+    for (size_t i = 0; i < full; i += 64) sha256_block(h, input + i);
+
+    unsigned char tail[128] = {0};
+    size_t rest = ilen - full;
+    memcpy(tail, input + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = (rest < 56) ? 64 : 128;
+    uint64_t bits = (uint64_t)ilen * 8;
+    for (int i = 0; i < 8; i++) tail[tail_len - 1 - i] = (unsigned char)(bits >> (8 * i));
+    for (size_t i = 0; i < tail_len; i += 64) sha256_block(h, tail + i);
+
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = h[i] >> 24; output[4 * i + 1] = h[i] >> 16; output[4 * i + 2] = h[i] >> 8; output[4 * i + 3] = h[i];
+    }
+    return 0;
+}
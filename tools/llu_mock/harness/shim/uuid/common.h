@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace uuid {
+
+typedef std::vector<const __FlashStringHelper *> flash_string_vector;
+std::string read_flash_string(const __FlashStringHelper *flash_str);
+void loop(void);
+
+} // namespace uuid
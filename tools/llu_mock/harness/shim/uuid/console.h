@@ -0,0 +1,28 @@
+#pragma once
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+namespace uuid {
+namespace console {
+
+class Shell : public Stream {
+public:
+    size_t write(uint8_t) override { return 1; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void printfln(const char *, ...) {}
+    void printfln(const __FlashStringHelper *, ...) {}
+};
+
+typedef std::function<void(Shell &, const std::vector<std::string> &)> command_function;
+
+class Commands {
+public:
+    void add_command(const flash_string_vector &, command_function) {}
+    void add_command(const flash_string_vector &, const flash_string_vector &, command_function) {}
+};
+
+} // namespace console
+} // namespace uuid
@@ -0,0 +1,44 @@
+/**
+ * @file log.h
+ * @brief uuid logger, messages up to the level in LLU_REPLAY_LOG (0-8) go to stderr
+ */
+
+#pragma once
+
+#include <uuid/common.h>
+
+namespace uuid {
+namespace log {
+
+enum class Level : int8_t { OFF = -1, EMERG = 0, ALERT, CRIT, ERR, WARNING, NOTICE, INFO, DEBUG, TRACE, ALL };
+enum class Facility : uint8_t { KERN = 0, CONSOLE = 14 };
+
+class Logger {
+public:
+    Logger(const __FlashStringHelper *name, Facility facility) : _name(reinterpret_cast<const char *>(name)) { (void)facility; }
+
+#define UUID_LOG_LEVEL_FN(fn, level) \
+    void fn(const char *format, ...) const __attribute__((format(printf, 2, 3))) { \
+        va_list ap; va_start(ap, format); vlog(level, format, ap); va_end(ap); } \
+    void fn(const __FlashStringHelper *format, ...) const { \
+        va_list ap; va_start(ap, format); vlog(level, reinterpret_cast<const char *>(format), ap); va_end(ap); }
+
+    UUID_LOG_LEVEL_FN(emerg, Level::EMERG)
+    UUID_LOG_LEVEL_FN(alert, Level::ALERT)
+    UUID_LOG_LEVEL_FN(crit, Level::CRIT)
+    UUID_LOG_LEVEL_FN(err, Level::ERR)
+    UUID_LOG_LEVEL_FN(warning, Level::WARNING)
+    UUID_LOG_LEVEL_FN(notice, Level::NOTICE)
+    UUID_LOG_LEVEL_FN(info, Level::INFO)
+    UUID_LOG_LEVEL_FN(debug, Level::DEBUG)
+    UUID_LOG_LEVEL_FN(trace, Level::TRACE)
+#undef UUID_LOG_LEVEL_FN
+
+private:
+    void vlog(Level level, const char *format, va_list ap) const;
+
+    const char *_name;
+};
+
+} // namespace log
+} // namespace uuid
@@ -0,0 +1,385 @@
+#!/usr/bin/env python3
+# Local LibreLinkUp API stand-in for the panel and for the host replay harness
+#
+# Replays the responses in responses/ (or recorded ones with --responses) and
+# injects latency, chunked transfer, truncated bodies, 401/429/5xx and very
+# large graphData arrays. Bodies are gzip compressed if the client accepts it. The scenario is selected by the first path segment,
+# so the client only needs another base URL:
+#
+#   python3 llu_mock_server.py --port 8080                # plain HTTP (harness)
+#   python3 llu_mock_server.py --port 8443 --tls          # HTTPS (panel, self signed)
+#
+#   panel console: llu_server https://192.168.0.10:8443/chunked
+#   harness:       harness/llu_replay --port 8080 ok chunked truncated
+#
+# Control endpoints: GET /_mock/scenarios, GET /_mock/stats, POST /_mock/reset
+
+import argparse
+import copy
+import json
+import math
+import os
+import socket
+import ssl
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+GRAPH_INTERVAL = 300            # seconds between two graphData points
+GRAPH_POINTS = 141              # points of a normal /graph response (12 hours)
+
+# transport and content options of every scenario
+#   latency_ms      delay before the response headers
+#   chunked         Transfer-Encoding: chunked instead of Content-Length
+#   chunk_size      bytes per chunk / per send()
+#   chunk_delay_ms  delay between two chunks
+#   truncate        fraction of a connections/graph body sent before the connection is closed
+#   status          {endpoint: http status} for login, tou, connections, graph
+#   reject_first_token  API requests with the first issued token get 401
+#   graph_points    graphData points generated for /graph
+#   patients        patients in /llu/connections
+#   encoding        Content-Encoding instead of the negotiated one (gzip, deflate, identity)
+#   redirect_region login without the region suffix answers with a redirect, the API is only served
+#                   on /<scenario>-<region> (like api.libreview.io -> api-eu.libreview.io)
+SCENARIOS = {
+    "ok":               {"description": "content-length, 141 points"},
+    "chunked":          {"description": "chunked transfer, 512 byte chunks", "chunked": True, "chunk_size": 512},
+    "tiny_chunks":      {"description": "chunked transfer, 7 byte chunks", "chunked": True, "chunk_size": 7},
+    "slow":             {"description": "800ms latency, 256 byte chunks every 20ms",
+                         "latency_ms": 800, "chunked": True, "chunk_size": 256, "chunk_delay_ms": 20},
+    "truncated":        {"description": "content-length, connection closed after 60% of the body", "truncate": 0.6},
+    "truncated_chunked":{"description": "chunked, connection closed after 60% of the body", "chunked": True,
+                         "chunk_size": 512, "truncate": 0.6},
+    "unauthorized":     {"description": "first token rejected with 401, next login accepted", "reject_first_token": True},
+    "rate_limited":     {"description": "429 with Retry-After on the API endpoints",
+                         "status": {"connections": 429, "graph": 429}},
+    "server_error":     {"description": "500 on the API endpoints", "status": {"connections": 500, "graph": 500}},
+    "unavailable":      {"description": "503 on all endpoints",
+                         "status": {"login": 503, "tou": 503, "connections": 503, "graph": 503}},
+    "large":            {"description": "2000 graphData points, chunked", "graph_points": 2000, "chunked": True,
+                         "chunk_size": 1024},
+    "multi_patient":    {"description": "3 patients in /llu/connections", "patients": 3},
+    "identity":         {"description": "never compressed", "encoding": "identity"},
+    "deflate":          {"description": "zlib (Content-Encoding: deflate), 512 byte chunks", "encoding": "deflate",
+                         "chunked": True, "chunk_size": 512},
+    "redirect":         {"description": "login redirect to region eu, served on /redirect-eu", "redirect_region": "eu"},
+}
+
+REASONS = {200: "OK", 401: "Unauthorized", 404: "Not Found", 429: "Too Many Requests",
+           500: "Internal Server Error", 503: "Service Unavailable"}
+
+
+def llu_timestamp(t):
+    """LibreLinkUp timestamp format: 10/17/2026 1:45:00 PM"""
+    hour = t.tm_hour % 12 or 12
+    return "%d/%d/%d %d:%02d:%02d %s" % (t.tm_mon, t.tm_mday, t.tm_year, hour, t.tm_min, t.tm_sec,
+                                         "AM" if t.tm_hour < 12 else "PM")
+
+
+def set_timestamps(item, unixtime):
+    item["FactoryTimestamp"] = llu_timestamp(time.gmtime(unixtime))     # UTC
+    item["Timestamp"] = llu_timestamp(time.localtime(unixtime))         # local time of the account
+
+
+def glucose(i):
+    """deterministic glucose curve"""
+    return int(140 + 50 * math.sin(i / 9.0) + 15 * math.sin(i / 2.3))
+
+
+class MockState:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.templates = {}
+        for name in ("login", "connections", "graph"):
+            path = os.path.join(args.responses, name + ".json")
+            with open(path, encoding="utf-8") as f:
+                self.templates[name] = json.load(f)
+        self.reset()
+
+    def reset(self):
+        with self.lock:
+            self.tokens = 0
+            self.stats = {}
+
+    def count(self, scenario, endpoint, status):
+        with self.lock:
+            key = "%s %s %d" % (scenario, endpoint, status)
+            self.stats[key] = self.stats.get(key, 0) + 1
+
+    def issue_token(self):
+        with self.lock:
+            self.tokens += 1
+            return "mock-token-%d" % self.tokens
+
+    # ------------------------------------------------------------ responses
+
+    def login(self):
+        doc = copy.deepcopy(self.templates["login"])
+        if not self.args.static:
+            doc["data"]["authTicket"]["token"] = self.issue_token()
+            doc["data"]["authTicket"]["expires"] = int(time.time()) + 180 * 86400
+        return doc
+
+    def measurement_time(self, patient):
+        now = int(time.time())
+        return now - now % 60 - 15 * patient
+
+    def connections(self, scenario):
+        doc = copy.deepcopy(self.templates["connections"])
+        if self.args.static:
+            return doc
+        template = doc["data"][0]
+        doc["data"] = []
+        for p in range(scenario.get("patients", 1)):
+            conn = copy.deepcopy(template)
+            if p > 0:
+                conn["id"] = "mock-connection-%d" % (p + 1)
+                conn["patientId"] = "mock-patient-%d" % (p + 1)
+                conn["firstName"] = "Mock%d" % (p + 1)
+                conn["glucoseMeasurement"]["ValueInMgPerDl"] = 100 + 10 * p
+                conn["glucoseMeasurement"]["Value"] = 100 + 10 * p
+            set_timestamps(conn["glucoseMeasurement"], self.measurement_time(p))
+            conn["glucoseItem"] = copy.deepcopy(conn["glucoseMeasurement"])
+            doc["data"].append(conn)
+        return doc
+
+    def graph(self, scenario, patient):
+        doc = copy.deepcopy(self.templates["graph"])
+        if self.args.static:
+            return doc
+        measurement = self.measurement_time(patient)
+        gm = doc["data"]["connection"]["glucoseMeasurement"]
+        set_timestamps(gm, measurement)
+        doc["data"]["connection"]["glucoseItem"] = copy.deepcopy(gm)
+
+        points = scenario.get("graph_points", GRAPH_POINTS)
+        newest = measurement - measurement % GRAPH_INTERVAL
+        graph = []
+        for i in range(points):
+            value = glucose(i + 20 * patient)
+            item = {"FactoryTimestamp": "", "Timestamp": "", "type": 0, "ValueInMgPerDl": value,
+                    "MeasurementColor": 1, "GlucoseUnits": 1, "Value": value, "isHigh": False, "isLow": False}
+            set_timestamps(item, newest - (points - 1 - i) * GRAPH_INTERVAL)
+            graph.append(item)
+        doc["data"]["graphData"] = graph
+        return doc
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"       # keep-alive like api.libreview.io
+    disable_nagle_algorithm = True      # headers and body are written separately
+    server_version = "llu-mock/1.0"
+
+    def log_message(self, fmt, *args):
+        if self.server.state.args.verbose:
+            sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+    def do_GET(self):
+        self.handle_request()
+
+    def do_POST(self):
+        self.handle_request()
+
+    def handle_request(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        if length:
+            self.rfile.read(length)
+        state = self.server.state
+
+        # /<scenario>/llu/... -> scenario + API path
+        path = self.path.split("?", 1)[0]
+        parts = path.strip("/").split("/", 1)
+        if parts[0] == "_mock":
+            return self.control(parts[1] if len(parts) > 1 else "")
+        # /<scenario>-<region>/... -> regional host of a redirect scenario
+        base, _, region = parts[0].rpartition("-")
+        regional = base in SCENARIOS and SCENARIOS[base].get("redirect_region") == region
+        if parts[0] in SCENARIOS or regional:
+            name = base if regional else parts[0]
+            path = "/" + (parts[1] if len(parts) > 1 else "")
+        else:
+            name = state.args.scenario
+        scenario = SCENARIOS[name]
+
+        if path == "/llu/auth/login":
+            endpoint = "login"
+        elif path == "/auth/continue/tou":
+            endpoint = "tou"
+        elif path == "/llu/connections":
+            endpoint = "connections"
+        elif path.startswith("/llu/connections/") and path.endswith("/graph"):
+            endpoint = "graph"
+        else:
+            return self.respond(scenario, 404, {"status": 404, "error": {"message": "unknown path " + path}})
+
+        if scenario.get("redirect_region") and not regional:
+            state.count(name, endpoint + " redirect", 200)
+            if endpoint != "login":
+                return self.respond(scenario, 404, {"status": 404, "error": {"message": "wrong region"}})
+            return self.respond(scenario, 200, {"status": 0, "data": {"redirect": True,
+                                                                       "region": scenario["redirect_region"]}})
+
+        status = scenario.get("status", {}).get(endpoint, 200)
+        token = self.headers.get("Authorization", "").replace("Bearer ", "")
+        if status == 200 and endpoint in ("connections", "graph") and scenario.get("reject_first_token") \
+                and token == "mock-token-1":
+            status = 401
+
+        state.count(name, endpoint, status)
+        if status == 401:
+            return self.respond(scenario, 401, {"message": "InvalidCredentials"})
+        if status == 429:
+            return self.respond(scenario, 429, {"message": "RateLimited"}, {"Retry-After": "60"})
+        if status != 200:
+            return self.respond(scenario, status, {"status": status, "error": {"message": REASONS.get(status, "")}})
+
+        if endpoint in ("login", "tou"):
+            doc = state.login()
+        elif endpoint == "connections":
+            doc = state.connections(scenario)
+        else:
+            patient_id = path.split("/")[3]
+            patient = int(patient_id.rsplit("-", 1)[-1]) - 1 if patient_id.startswith("mock-patient-") else 0
+            doc = state.graph(scenario, patient)
+        self.respond(scenario, 200, doc, truncate=endpoint in ("connections", "graph"))
+
+    def control(self, command):
+        state = self.server.state
+        if command == "reset":
+            state.reset()
+            doc = {"reset": True}
+        elif command == "stats":
+            with state.lock:
+                doc = dict(state.stats)
+        else:
+            doc = {name: s["description"] for name, s in SCENARIOS.items()}
+        self.respond({}, 200, doc)
+
+    def accepted_encoding(self):
+        """gzip or deflate if the Accept-Encoding header allows it (q > 0), else identity"""
+        quality = {}
+        # the ESP32 HTTPClient sends its own "identity;q=1,chunked;q=0.1,*;q=0" line as well
+        for item in ",".join(self.headers.get_all("Accept-Encoding") or []).split(","):
+            name, _, params = item.strip().partition(";")
+            q = 1.0
+            if params.strip().startswith("q="):
+                try:
+                    q = float(params.strip()[2:])
+                except ValueError:
+                    q = 0.0
+            quality[name.strip().lower()] = q
+        for encoding in ("gzip", "deflate"):
+            if quality.get(encoding, quality.get("*", 0.0)) > 0:
+                return encoding
+        return "identity"
+
+    def respond(self, scenario, status, doc, headers=None, truncate=False):
+        body = json.dumps(doc, separators=(",", ":")).encode("utf-8")
+
+        encoding = scenario.get("encoding") or self.accepted_encoding()
+        if encoding == "gzip":
+            compressor = zlib.compressobj(6, zlib.DEFLATED, 31)
+            body = compressor.compress(body) + compressor.flush()
+        elif encoding == "deflate":
+            body = zlib.compress(body, 6)
+
+        if scenario.get("latency_ms"):
+            time.sleep(scenario["latency_ms"] / 1000.0)
+
+        chunked = scenario.get("chunked", False)
+        self.send_response(status, REASONS.get(status))
+        self.send_header("Content-Type", "application/json")
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        if encoding != "identity":
+            self.send_header("Content-Encoding", encoding)
+        if chunked:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+
+        limit = len(body)
+        if truncate and scenario.get("truncate") is not None:
+            limit = int(len(body) * scenario["truncate"])
+
+        size = scenario.get("chunk_size", 4096)
+        delay = scenario.get("chunk_delay_ms", 0) / 1000.0
+        sent = 0
+        try:
+            while sent < limit:
+                part = body[sent:min(sent + size, limit)]
+                if chunked:
+                    # a truncated chunk announces its full size
+                    full = len(body[sent:sent + size])
+                    self.wfile.write(b"%x\r\n" % full + part + (b"\r\n" if len(part) == full else b""))
+                else:
+                    self.wfile.write(part)
+                self.wfile.flush()
+                sent += len(part)
+                if delay:
+                    time.sleep(delay)
+            if limit < len(body):
+                # truncated body: close without finishing the response
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+                return
+            if chunked:
+                self.wfile.write(b"0\r\n\r\n")
+                self.wfile.flush()
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True
+
+
+def self_signed_certificate():
+    directory = tempfile.mkdtemp(prefix="llu_mock_")
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.check_call(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "30",
+                           "-subj", "/CN=llu-mock", "-keyout", key, "-out", cert],
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description="LibreLinkUp API mock server")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--scenario", default="ok", choices=sorted(SCENARIOS),
+                        help="scenario for paths without scenario prefix")
+    parser.add_argument("--responses", default=os.path.join(here, "responses"),
+                        help="directory with login.json, connections.json, graph.json")
+    parser.add_argument("--static", action="store_true",
+                        help="replay the responses unchanged (no fresh timestamps, tokens or graphData)")
+    parser.add_argument("--tls", action="store_true", help="serve HTTPS (needed by the panel)")
+    parser.add_argument("--cert", help="certificate for --tls (default: self signed)")
+    parser.add_argument("--key", help="private key for --tls")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    server.state = MockState(args)
+
+    if args.tls:
+        cert, key = (args.cert, args.key) if args.cert else self_signed_certificate()
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(cert, key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+
+    print("llu mock server on %s://%s:%d, scenarios: %s" % ("https" if args.tls else "http", args.host, args.port,
+                                                            ", ".join(sorted(SCENARIOS))))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds the host test and benchmark of the LibreLinkUp timestamp parser.
+# helper.cpp is compiled unchanged against the shim of the replay harness,
+# which also needs the sources helper.cpp links against.
+#
+#   ./build.sh [ARDUINOJSON_SRC]
+#
+# ArduinoJson is taken from the PlatformIO library folder of a firmware build
+# (.pio/libdeps/main/ArduinoJson/src) unless a path is given.
+
+set -e
+cd "$(dirname "$0")"
+
+MAIN=../../application/main
+SHIM=../llu_mock/harness/shim
+ARDUINOJSON=${1:-${ARDUINOJSON:-../../.pio/libdeps/main/ArduinoJson/src}}
+
+if [ ! -f "$ARDUINOJSON/ArduinoJson.h" ]; then
+    echo "ArduinoJson.h not found in $ARDUINOJSON"
+    echo "build the firmware once with PlatformIO or pass the ArduinoJson src folder"
+    exit 1
+fi
+
+${CXX:-g++} -std=gnu++17 -O2 -g \
+    -I"$SHIM" -I"$ARDUINOJSON" -I"$MAIN" \
+    -o timestamp_bench \
+    timestamp_bench.cpp "$SHIM/shim.cpp" \
+    "$MAIN/librelinkup.cpp" "$MAIN/helper.cpp" "$MAIN/jsonstream.cpp" "$MAIN/httpstream.cpp" \
+    "$MAIN/inflatestream.cpp" "$MAIN/truststore.cpp" "$MAIN/stagestats.cpp" -lz
+
+echo "built $(pwd)/timestamp_bench"
@@ -0,0 +1,241 @@
+// Host test and benchmark of the LibreLinkUp timestamp parser (application/main/helper.cpp).
+//
+//   timestamp_bench [--years FIRST LAST] [--repeat N]
+//
+// The sweep formats every minute of the given years (default 2020-2035) as
+// "M/D/YYYY h:mm:ss AM" and as "M/D/YYYY H:mm:ss" and compares
+// HELPER::parseTimestamp() with timegm(). It also checks malformed and out
+// of range strings and HELPER::getUtcOffset() against tm_gmtoff for every
+// hour (TZ of the panel, CET/CEST unless TZ is set). The benchmark parses
+// the 141 timestamps of a 12h history with the former strptime/mktime and
+// sscanf/mktime code and with HELPER::parseTimestamp(), and compares
+// HELPER::civilToUnixTime() with timegm(). Exit code 1 on a mismatch.
+
+#include <Arduino.h>
+
+#include "librelinkup.h"
+#include "helper.h"
+#include "settings.h"
+
+#include <chrono>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+HELPER helper;
+SETTINGS settings;
+LIBRELINKUP librelinkup;
+
+// firmware globals referenced by librelinkup.cpp
+int16_t glucose_delta = 0;
+uint16_t glucoseMeasurement_backup = 0;
+
+#define BENCH_TZ        "CET-1CEST-2,M3.5.0/2,M10.5.0/3"    ///< Default TZ (settings.h)
+#define BENCH_POINTS    141                                 ///< graphData points of a 12h history
+
+static int failures = 0;
+
+static void fail(const char *what, const char *str, long long got, long long expected) {
+    if (failures++ < 20) printf("FAIL %s \"%s\": %lld, expected %lld\n", what, str, got, expected);
+}
+
+static void format(char *buffer, size_t size, const struct tm &tm, bool meridian) {
+    if (meridian) {
+        int hour = tm.tm_hour % 12;
+        snprintf(buffer, size, "%d/%d/%d %d:%02d:%02d %s", tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900,
+                 hour == 0 ? 12 : hour, tm.tm_min, tm.tm_sec, tm.tm_hour < 12 ? "AM" : "PM");
+    } else {
+        snprintf(buffer, size, "%d/%d/%d %d:%02d:%02d", tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+}
+
+// every minute of the years, both formats, UTC
+static long sweep(int first, int last) {
+    struct tm tm = {};
+    tm.tm_year = first - 1900;
+    tm.tm_mday = 1;
+    time_t start = timegm(&tm);
+    tm.tm_year = last + 1 - 1900;
+    time_t end = timegm(&tm);
+
+    char buffer[32];
+    long count = 0;
+    for (time_t t = start; t < end; t += 60) {
+        gmtime_r(&t, &tm);
+        for (int meridian = 0; meridian < 2; meridian++) {
+            format(buffer, sizeof(buffer), tm, meridian);
+            time_t parsed = HELPER::parseTimestamp(buffer, 0);
+            if (parsed != t) fail("sweep", buffer, parsed, t);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void malformed(void) {
+    static const char *invalid[] = {
+        "", "garbage", "3/10", "3/10/2025", "3/10/2025 ", "3/10/2025 8:05", "3/10/2025 8:05:", "3-10-2025 8:05:00",
+        "3/10/2025 8:05:00 XM", "3/10/2025 8:05:00 A", "13/10/2025 8:05:00", "0/10/2025 8:05:00",
+        "3/32/2025 8:05:00", "3/0/2025 8:05:00", "3/10/2025 24:05:00", "3/10/2025 8:60:00",
+        "3/10/1969 8:05:00", "/10/2025 8:05:00",
+    };
+    for (const char *str : invalid) {
+        time_t parsed = HELPER::parseTimestamp(str, 0);
+        if (parsed != -1) fail("malformed", str, parsed, -1);
+    }
+
+    // offset is subtracted, 12 AM / 12 PM
+    struct { const char *str; int32_t offset; time_t expected; } valid[] = {
+        { "3/10/2025 12:00:00 AM", 0,    1741564800 },
+        { "3/10/2025 12:00:00 PM", 0,    1741608000 },
+        { "3/10/2025 1:00:00 am",  3600, 1741564800 },
+        { "3/10/2025 13:00:00",    3600, 1741608000 },
+    };
+    for (const auto &v : valid) {
+        time_t parsed = HELPER::parseTimestamp(v.str, v.offset);
+        if (parsed != v.expected) fail("valid", v.str, parsed, v.expected);
+    }
+}
+
+// HELPER::getUtcOffset() against the C library, every hour of the years
+static long offsets(int first, int last) {
+    struct tm tm = {};
+    tm.tm_year = first - 1900;
+    tm.tm_mday = 1;
+    time_t start = timegm(&tm);
+    tm.tm_year = last + 1 - 1900;
+    time_t end = timegm(&tm);
+
+    long count = 0;
+    for (time_t t = start; t < end; t += 3600) {
+        localtime_r(&t, &tm);
+        int32_t offset = HELPER::getUtcOffset(t);
+        if (offset != tm.tm_gmtoff) {
+            char buffer[32];
+            format(buffer, sizeof(buffer), tm, false);
+            fail("utc offset", buffer, offset, tm.tm_gmtoff);
+        }
+        count++;
+    }
+    return count;
+}
+
+// former LIBRELINKUP::parseTimestamp (strptime, setlocale per call, mktime)
+static time_t legacy_strptime(const char *str) {
+    setlocale(LC_TIME, "C");
+
+    struct tm tm_time;
+    memset(&tm_time, 0, sizeof(struct tm));
+    char clean[50];
+    strncpy(clean, str, sizeof(clean) - 1);
+    clean[sizeof(clean) - 1] = '\0';
+    int is_pm = strstr(clean, "PM") != NULL;
+    char *am_pm = strstr(clean, "AM");
+    if (!am_pm) am_pm = strstr(clean, "PM");
+    if (am_pm) *am_pm = '\0';
+
+    if (!strptime(clean, "%m/%d/%Y %I:%M:%S", &tm_time)) return -1;
+    if (is_pm && tm_time.tm_hour != 12) tm_time.tm_hour += 12;
+    else if (!is_pm && tm_time.tm_hour == 12) tm_time.tm_hour = 0;
+    tm_time.tm_isdst = -1;
+    return mktime(&tm_time);
+}
+
+// former HELPER::convertStrToUnixTime (sscanf, mktime)
+static time_t legacy_sscanf(const char *str) {
+    struct tm tm_time = {0};
+    int month, day, year, hour, minute, second;
+    char meridian[3];
+    if (sscanf(str, "%d/%d/%d %d:%d:%d %2s", &month, &day, &year, &hour, &minute, &second, meridian) != 7) return -1;
+    if (strcmp(meridian, "PM") == 0 && hour != 12) hour += 12;
+    else if (strcmp(meridian, "AM") == 0 && hour == 12) hour = 0;
+    tm_time.tm_year = year - 1900;
+    tm_time.tm_mon = month - 1;
+    tm_time.tm_mday = day;
+    tm_time.tm_hour = hour;
+    tm_time.tm_min = minute;
+    tm_time.tm_sec = second;
+    return mktime(&tm_time);
+}
+
+template <typename F>
+static double measure(int repeat, F call) {
+    volatile long long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        sink += call();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    (void)sink;
+    return elapsed.count() / repeat / BENCH_POINTS;
+}
+
+static void benchmark(int repeat) {
+    // 12h history, 5 minute steps ending now
+    std::vector<std::string> points;
+    std::vector<Timestamp_Fields> fields;
+    time_t now = time(NULL);
+    for (int i = 0; i < BENCH_POINTS; i++) {
+        time_t t = now - (BENCH_POINTS - 1 - i) * 300;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char buffer[32];
+        format(buffer, sizeof(buffer), tm, true);
+        points.push_back(buffer);
+        fields.push_back({tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec});
+    }
+    int32_t offset = HELPER::getUtcOffset(now);
+
+    printf("\n%-34s %10s\n", "per timestamp", "ns");
+    printf("%-34s %10.1f\n", "strptime + mktime (former LLU)", measure(repeat, [&]() {
+        long long s = 0; for (auto &p : points) s += legacy_strptime(p.c_str()); return s; }));
+    printf("%-34s %10.1f\n", "sscanf + mktime (former HELPER)", measure(repeat, [&]() {
+        long long s = 0; for (auto &p : points) s += legacy_sscanf(p.c_str()); return s; }));
+    printf("%-34s %10.1f\n", "HELPER::parseTimestamp", measure(repeat, [&]() {
+        long long s = 0; for (auto &p : points) s += HELPER::parseTimestamp(p.c_str(), offset); return s; }));
+    printf("%-34s %10.1f\n", "timegm (fields)", measure(repeat, [&]() {
+        long long s = 0;
+        for (auto &f : fields) {
+            struct tm tm = {};
+            tm.tm_year = f.year - 1900; tm.tm_mon = f.month - 1; tm.tm_mday = f.day;
+            tm.tm_hour = f.hour; tm.tm_min = f.minute; tm.tm_sec = f.second;
+            s += timegm(&tm);
+        }
+        return s; }));
+    printf("%-34s %10.1f\n", "HELPER::civilToUnixTime (fields)", measure(repeat, [&]() {
+        long long s = 0; for (auto &f : fields) s += HELPER::civilToUnixTime(f); return s; }));
+}
+
+int main(int argc, char **argv) {
+    int first = 2020, last = 2035, repeat = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--years") == 0 && i + 2 < argc) {
+            first = atoi(argv[++i]);
+            last = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--years FIRST LAST] [--repeat N]\n", argv[0]);
+            return 255;
+        }
+    }
+    if (first < 1970 || last < first || repeat < 1) {
+        fprintf(stderr, "invalid --years or --repeat\n");
+        return 255;
+    }
+    setenv("TZ", getenv("TZ") ? getenv("TZ") : BENCH_TZ, 1);
+    tzset();
+
+    long minutes = sweep(first, last);
+    malformed();
+    long hours = offsets(first, last);
+    printf("%ld timestamps (%d-%d), %ld utc offsets (TZ %s): %d mismatches\n", minutes, first, last, hours, getenv("TZ"), failures);
+
+    benchmark(repeat);
+    return failures ? 1 : 0;
+}